@@ -0,0 +1,130 @@
+// Calendar query benchmark: 100k one-off events and 10k recurring series
+// (daily, weekly, monthly and yearly) spread over five years, queried one
+// week at a time. is_busy checks a one-hour slot, as when proposing a new
+// meeting.
+//
+// Usage: calendar_bench [queries]
+//
+// For comparison it also runs a naive calendar that materialises every
+// occurrence of every series up to the end of the horizon and scans the
+// lot for each query.
+
+#include "calendar.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int queries = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int64_t horizon_begin = days_from_civil(2022, 1, 1) * kSecondsPerDay;
+    const int64_t horizon_days = 5 * 365;
+    const int64_t horizon_end = horizon_begin + horizon_days * kSecondsPerDay;
+    std::mt19937_64 rng(42);
+    auto random_start = [&](int64_t days) {
+        return horizon_begin + static_cast<int64_t>(rng() % days) * kSecondsPerDay +
+               (8 + static_cast<int64_t>(rng() % 11)) * 3600 + static_cast<int64_t>(rng() % 4) * 900;
+    };
+
+    Calendar calendar;
+    std::vector<Occurrence> materialised; // The naive calendar
+    auto build_started = Clock::now();
+    for (uint32_t i = 0; i < 100000; ++i) {
+        int64_t start = random_start(horizon_days);
+        int64_t end = start + (1 + static_cast<int64_t>(rng() % 16)) * 900;
+        uint32_t id = calendar.add_event(start, end);
+        materialised.push_back(Occurrence{id, start, end});
+    }
+    for (uint32_t i = 0; i < 10000; ++i) {
+        RecurrenceRule rule;
+        int kind = static_cast<int>(rng() % 10);
+        rule.frequency = kind < 3 ? Frequency::Daily : kind < 7 ? Frequency::Weekly
+                       : kind < 9 ? Frequency::Monthly : Frequency::Yearly;
+        rule.interval = 1 + static_cast<uint32_t>(rng() % 2);
+        if (rule.frequency == Frequency::Weekly) rule.weekdays = static_cast<uint8_t>(1 + rng() % 0x7f);
+        // Most series end: a quarter after a number of occurrences, three
+        // fifths on a date; the rest run forever.
+        int64_t start = random_start(horizon_days - 365);
+        int ending = static_cast<int>(rng() % 20);
+        if (ending < 5) rule.count = 5 + static_cast<uint32_t>(rng() % 100);
+        else if (ending < 17) rule.until = start + static_cast<int64_t>(30 + rng() % 700) * kSecondsPerDay;
+        int64_t end = start + (1 + static_cast<int64_t>(rng() % 8)) * 900;
+        uint32_t id = calendar.add_series(start, end, rule);
+        Recurrence recurrence(start, end - start, rule);
+        recurrence.expand(start, horizon_end, [&](int64_t s) {
+            materialised.push_back(Occurrence{id, s, s + (end - start)});
+        });
+    }
+    double build_ms = elapsed_us(build_started) / 1000.0;
+
+    std::vector<int64_t> weeks;
+    for (int i = 0; i < queries; ++i) {
+        weeks.push_back(horizon_begin + static_cast<int64_t>(rng() % (horizon_days - 7)) * kSecondsPerDay);
+    }
+
+    std::vector<double> week_us, conflict_us, busy_us, naive_us;
+    size_t occurrences = 0, conflicts = 0, busy = 0;
+    for (int64_t week : weeks) {
+        auto started = Clock::now();
+        occurrences += calendar.occurrences(week, week + 7 * kSecondsPerDay).size();
+        week_us.push_back(elapsed_us(started));
+
+        started = Clock::now();
+        conflicts += calendar.conflicts(week, week + 7 * kSecondsPerDay).size();
+        conflict_us.push_back(elapsed_us(started));
+
+        int64_t slot = week + 2 * kSecondsPerDay + 14 * 3600;
+        started = Clock::now();
+        busy += calendar.is_busy(slot, slot + 3600);
+        busy_us.push_back(elapsed_us(started));
+    }
+    size_t naive_matches = 0;
+    for (size_t i = 0; i < weeks.size() && i < 100; ++i) {
+        int64_t begin = weeks[i];
+        int64_t end = begin + 7 * kSecondsPerDay;
+        auto started = Clock::now();
+        std::vector<Occurrence> found;
+        for (const Occurrence& occurrence : materialised) {
+            if (occurrence.start < end && occurrence.end > begin) found.push_back(occurrence);
+        }
+        naive_matches += found.size();
+        naive_us.push_back(elapsed_us(started));
+    }
+
+    std::printf("events            100000\n");
+    std::printf("series            10000 (%zu occurrences if materialised)\n", materialised.size() - 100000);
+    std::printf("build             %.1f ms (including the naive calendar)\n", build_ms);
+    std::printf("%-17s %10s %10s %10s\n", "query", "mean us", "p50 us", "p99 us");
+    auto row = [](const char* name, const std::vector<double>& samples) {
+        double total = 0;
+        for (double sample : samples) total += sample;
+        std::printf("%-17s %10.1f %10.1f %10.1f\n", name, total / samples.size(), percentile(samples, 0.5),
+                    percentile(samples, 0.99));
+    };
+    row("week view", week_us);
+    row("week conflicts", conflict_us); // Every overlapping pair
+    row("is_busy 1h", busy_us);
+    row("naive week view", naive_us);
+    std::printf("avg occurrences per week %.1f, conflicts per week %.1f, busy slots %zu/%zu\n",
+                static_cast<double>(occurrences) / weeks.size(), static_cast<double>(conflicts) / weeks.size(),
+                busy, weeks.size());
+    return naive_matches == 0; // Keep the naive scan from being optimised away.
+}
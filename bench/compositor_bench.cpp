@@ -0,0 +1,114 @@
+// CPU compositing benchmark: blend kernels and damage-limited redraws.
+//
+// Usage: compositor_bench [frames]
+//
+// Composites eight translucent 1920x1080 surfaces over each other for 200
+// frames (or `frames`) with every blend path the CPU supports, and reports
+// frames per second and blended gigapixels per second. Then redraws a 64x64
+// damaged square per frame instead of the whole output, as a blinking
+// cursor would. Last, stacks 1 to 64 full-output windows that declare
+// themselves opaque: with occlusion culling only the top one is drawn, so
+// the frame rate should not depend on the count.
+
+#include "cpu_renderer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int32_t kWidth = 1920;
+const int32_t kHeight = 1080;
+const int kSurfaces = 8;
+
+double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// A full-output buffer of premultiplied gradients with varying alpha.
+ShmBuffer make_buffer(int seed) {
+    size_t size = size_t(kWidth) * kHeight * 4;
+    int fd = memfd_create("compositor_bench", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        std::perror("memfd");
+        std::exit(1);
+    }
+    uint32_t* data = static_cast<uint32_t*>(mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0));
+    for (int32_t y = 0; y < kHeight; ++y) {
+        for (int32_t x = 0; x < kWidth; ++x) {
+            uint32_t alpha = uint32_t(x + y + seed * 31) % 256;
+            uint32_t colour = uint32_t(x * seed + y) % (alpha + 1);
+            data[size_t(y) * kWidth + x] = alpha << 24 | colour << 16 | (alpha - colour) << 8 | colour / 2;
+        }
+    }
+    munmap(data, size);
+    ShmBuffer buffer;
+    buffer.pool = ShmPool::create(fd, int32_t(size));
+    close(fd);
+    buffer.width = kWidth;
+    buffer.height = kHeight;
+    buffer.stride = kWidth * 4;
+    return buffer;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    std::vector<ShmBuffer> buffers;
+    for (int i = 0; i < kSurfaces; ++i) buffers.push_back(make_buffer(i + 1));
+
+    std::printf("%d translucent %dx%d surfaces, %d frames\n", kSurfaces, kWidth, kHeight, frames);
+    for (BlendPath path : {BlendPath::Scalar, BlendPath::Sse2, BlendPath::Avx2}) {
+        if (path > best_blend_path()) continue;
+        Scene scene(kWidth, kHeight);
+        CpuRenderer renderer(kWidth, kHeight, path);
+        for (const ShmBuffer& buffer : buffers) {
+            Scene::SurfaceId id = scene.create_surface();
+            scene.attach(id, kWidth, kHeight);
+            scene.commit(id);
+            renderer.upload(id, buffer, scene.surface(id)->buffer_damage);
+        }
+        scene.take_damage();
+
+        Region everything(scene.output());
+        Clock::time_point start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) renderer.draw(scene, everything);
+        double full_ms = elapsed_ms(start);
+
+        Region cursor(Rect{kWidth / 2, kHeight / 2, 64, 64});
+        start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) renderer.draw(scene, cursor);
+        double cursor_ms = elapsed_ms(start);
+
+        double pixels = double(kWidth) * kHeight * kSurfaces * frames;
+        std::printf("  %-6s  full: %7.1f fps, %5.2f Gpx/s   64x64 damage: %9.1f fps\n", blend_path_name(path),
+                    frames * 1000.0 / full_ms, pixels / full_ms / 1e6, frames * 1000.0 / cursor_ms);
+    }
+
+    std::printf("stacked opaque %dx%d windows, %d frames\n", kWidth, kHeight, frames);
+    for (int windows : {1, 8, 64}) {
+        Scene scene(kWidth, kHeight);
+        CpuRenderer renderer(kWidth, kHeight);
+        for (int i = 0; i < windows; ++i) {
+            Scene::SurfaceId id = scene.create_surface();
+            scene.attach(id, kWidth, kHeight);
+            scene.set_opaque_region(id, Region(scene.output()));
+            scene.commit(id);
+            renderer.upload(id, buffers[i % kSurfaces], scene.surface(id)->buffer_damage);
+        }
+        scene.take_damage();
+
+        Region everything(scene.output());
+        Clock::time_point start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) renderer.draw(scene, everything);
+        std::printf("  %2d windows: %7.1f fps\n", windows, frames * 1000.0 / elapsed_ms(start));
+    }
+    return 0;
+}
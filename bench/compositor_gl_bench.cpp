@@ -0,0 +1,116 @@
+// GL compositing benchmark: per-surface draws against the atlas and
+// batched draws.
+//
+// Usage: compositor_gl_bench [surfaces] [frames]
+//
+// Scatters 400 (or `surfaces`) small surfaces, 16 to 96 pixels a side and
+// mostly translucent, over a 1920x1080 output, as cursors, panel buttons
+// and tooltips would be, and redraws the whole output for 100 frames (or
+// `frames`) with each GL renderer path, waiting for each frame to finish.
+// Both paths must produce the same pixels. Runs on whatever EGL gives,
+// e.g. llvmpipe with EGL_PLATFORM=surfaceless.
+
+#include "backend.hpp"
+#include <GLES2/gl2.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int32_t kWidth = 1920;
+const int32_t kHeight = 1080;
+
+double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// A width x height buffer of one premultiplied colour, every eighth one
+// XRGB8888.
+ShmBuffer make_buffer(int32_t width, int32_t height, std::mt19937& rng) {
+    size_t size = size_t(width) * height * 4;
+    int fd = memfd_create("compositor_gl_bench", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        std::perror("memfd");
+        std::exit(1);
+    }
+    bool opaque = rng() % 8 == 0;
+    uint32_t alpha = opaque ? 255 : 64 + rng() % 192;
+    uint32_t colour = alpha << 24 | (rng() % (alpha + 1)) << 16 | (rng() % (alpha + 1)) << 8 | rng() % (alpha + 1);
+    uint32_t* data = static_cast<uint32_t*>(mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0));
+    for (size_t i = 0; i < size / 4; ++i) data[i] = colour;
+    munmap(data, size);
+    ShmBuffer buffer;
+    buffer.pool = ShmPool::create(fd, int32_t(size));
+    close(fd);
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = width * 4;
+    buffer.format = opaque ? ShmFormat::XRGB8888 : ShmFormat::ARGB8888;
+    return buffer;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int surfaces = argc > 1 ? std::atoi(argv[1]) : 400;
+    int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    std::mt19937 rng(49);
+    std::vector<ShmBuffer> buffers;
+    std::vector<Rect> placement;
+    for (int i = 0; i < surfaces; ++i) {
+        int32_t width = 16 + rng() % 81, height = 16 + rng() % 81;
+        buffers.push_back(make_buffer(width, height, rng));
+        placement.push_back({int32_t(rng() % (kWidth - width)), int32_t(rng() % (kHeight - height)), width, height});
+    }
+
+    std::printf("%d small surfaces on %dx%d, %d full redraws\n", surfaces, kWidth, kHeight, frames);
+    std::vector<uint32_t> reference;
+    for (bool batch : {false, true}) {
+        std::unique_ptr<Backend> backend = create_gl_backend(kWidth, kHeight, batch);
+        if (!backend) {
+            std::fprintf(stderr, "GL is unavailable\n");
+            return 1;
+        }
+        Scene scene(kWidth, kHeight);
+        for (int i = 0; i < surfaces; ++i) {
+            Scene::SurfaceId id = scene.create_surface();
+            scene.attach(id, buffers[i].width, buffers[i].height, 0, 0, buffers[i].opaque());
+            scene.commit(id);
+            scene.set_position(id, placement[i].x, placement[i].y);
+            backend->upload(id, buffers[i], scene.surface(id)->buffer_damage);
+        }
+        Region everything(scene.output());
+        backend->repaint(scene, scene.take_damage());
+        glFinish();
+
+        Clock::time_point start = Clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            backend->repaint(scene, everything);
+            glFinish();
+        }
+        double ms = elapsed_ms(start);
+        std::printf("  %-10s %8.2f ms/frame %8.1f fps\n", batch ? "batched" : "per-surface", ms / frames,
+                    frames * 1000.0 / ms);
+
+        std::vector<uint32_t> pixels;
+        if (!backend->read_pixels(pixels)) {
+            std::fprintf(stderr, "Failed to read the output back\n");
+            return 1;
+        }
+        if (reference.empty()) {
+            reference = pixels;
+        } else if (pixels != reference) {
+            std::fprintf(stderr, "The batched output differs from the per-surface one\n");
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Highlighter benchmark: keystroke-to-highlight latency on a large C++ file.
+//
+// Usage: highlighter_bench [lines]
+//
+// Generates a C++ source of 100,000 lines (or `lines`), highlights a
+// 60-line viewport in the middle of it and then types there. Each keystroke
+// is timed from the PieceTable edit to the viewport being highlighted again.
+// Also reports the worst case of opening a raw string that never closes,
+// the time the idle loop needs to highlight the rest of the file, and a full
+// re-lex per keystroke for comparison.
+
+#include "highlighter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+std::string generate_source(uint64_t lines) {
+    static const char* body[] = {
+        "    // Adds the next value to the running total.",
+        "    uint64_t total = 0; /* reset below */",
+        "    for (size_t i = 0; i < values.size(); ++i) {",
+        "        total += values[i] * 0x9E3779B97F4A7C15ull;",
+        "        if (total > 1'000'000) return \"overflow\";",
+        "    }",
+        "    const char* pattern = R\"re((\\d+)\\s*)re\";",
+        "    return std::to_string(total / 2.5e3);",
+    };
+    std::string source = "#include <string>\n#include <vector>\n\n";
+    uint64_t line = 3;
+    for (int function = 0; line < lines; ++function) {
+        source += "/*\n * Function " + std::to_string(function) + ".\n */\n";
+        source += "static std::string f" + std::to_string(function) + "(const std::vector<uint64_t>& values) {\n";
+        line += 4;
+        for (const char* text : body) {
+            source += text;
+            source += '\n';
+            ++line;
+        }
+        source += "}\n\n";
+        line += 2;
+    }
+    return source;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    PieceTable table;
+    table.assign(generate_source(lines));
+    uint64_t first = table.line_count() / 2;
+    uint64_t last = first + 60;
+    std::printf("file              %llu lines, %.1f MB\n", static_cast<unsigned long long>(table.line_count()),
+                table.size() / 1048576.0);
+
+    auto started = Clock::now();
+    Highlighter highlighter(table);
+    highlighter.set_viewport(first, last);
+    std::printf("first viewport    %.2f ms (lines 0-%llu)\n", elapsed_us(started) / 1000.0,
+                static_cast<unsigned long long>(last));
+
+    // Type 2000 keystrokes across the viewport, a few at each spot.
+    std::mt19937_64 rng(3);
+    const char* text = "value + total";
+    std::vector<double> keystroke_us;
+    uint64_t lexed_before = highlighter.lexed_lines();
+    for (int burst = 0; burst < 200; ++burst) {
+        uint64_t line = first + rng() % (last - first);
+        uint64_t cursor = table.line_start(line) + rng() % (table.line_start(line + 1) - table.line_start(line));
+        for (int key = 0; key < 10; ++key) {
+            started = Clock::now();
+            table.insert(cursor++, text + key % 13, 1);
+            highlighter.edit(line, 1, 1);
+            keystroke_us.push_back(elapsed_us(started));
+        }
+    }
+    std::printf("keystroke         p50 %.2f us p99 %.2f us (%.2f lines lexed per key)\n", percentile(keystroke_us, 0.5),
+                percentile(keystroke_us, 0.99),
+                static_cast<double>(highlighter.lexed_lines() - lexed_before) / keystroke_us.size());
+
+    // Opening a raw string at the top of the viewport changes the state of
+    // every line below it; only the viewport is re-lexed right away.
+    lexed_before = highlighter.lexed_lines();
+    started = Clock::now();
+    table.insert(table.line_start(first), "R\"x(", 4);
+    highlighter.edit(first, 1, 1);
+    std::printf("open raw string   %.2f us (%llu lines lexed)\n", elapsed_us(started),
+                static_cast<unsigned long long>(highlighter.lexed_lines() - lexed_before));
+
+    started = Clock::now();
+    size_t steps = 0;
+    while (highlighter.background_step(1000)) ++steps;
+    std::printf("background        %.2f ms in %zu steps of 1000 lines\n", elapsed_us(started) / 1000.0, steps + 1);
+
+    lexed_before = highlighter.lexed_lines();
+    started = Clock::now();
+    table.erase(table.line_start(first), 4);
+    highlighter.edit(first, 1, 1);
+    std::printf("close raw string  %.2f us (%llu lines lexed)\n", elapsed_us(started),
+                static_cast<unsigned long long>(highlighter.lexed_lines() - lexed_before));
+
+    // What every keystroke would cost without incremental state.
+    std::vector<double> full_us;
+    for (int i = 0; i < 5; ++i) {
+        started = Clock::now();
+        highlighter.reset();
+        while (highlighter.background_step(1000)) {
+        }
+        full_us.push_back(elapsed_us(started));
+    }
+    std::printf("full re-lex       p50 %.2f ms\n", percentile(full_us, 0.5) / 1000.0);
+    return 0;
+}
@@ -0,0 +1,116 @@
+// PieceTable benchmark: open a large file, then type into it.
+//
+// Usage: piece_table_bench [file]
+//
+// Without a file argument a 2 GB file of 80-column lines is written to the
+// current directory first and removed afterwards. Reports the open time,
+// per-keystroke latency at the start and end of a long typing session at
+// random spots, line lookups before and after the newline counts are
+// cached, and undoing the whole session.
+
+#include "piece_table.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+bool write_sample(const std::string& path, uint64_t size) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    std::string line(79, 'x');
+    line += '\n';
+    std::string chunk;
+    while (chunk.size() < (1 << 20)) chunk += line;
+    bool ok = true;
+    for (uint64_t written = 0; ok && written < size; written += chunk.size()) {
+        ok = std::fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "piece_table_bench.txt";
+    if (argc <= 1 && !write_sample(path, 2ull << 30)) {
+        std::fprintf(stderr, "piece_table_bench: cannot write %s\n", path.c_str());
+        return 1;
+    }
+
+    PieceTable table;
+    auto started = Clock::now();
+    if (!table.open(path)) {
+        std::fprintf(stderr, "piece_table_bench: cannot open %s\n", path.c_str());
+        return 1;
+    }
+    double open_ms = elapsed_us(started) / 1000.0;
+    std::printf("file              %s (%.1f MB, %zu pieces)\n", path.c_str(), table.size() / 1048576.0,
+                table.piece_count());
+    std::printf("open              %.2f ms\n", open_ms);
+
+    started = Clock::now();
+    uint64_t offset = table.line_start(1000);
+    std::printf("line 1000 (cold)  %.1f us -> offset %llu\n", elapsed_us(started),
+                static_cast<unsigned long long>(offset));
+
+    // Typing: 200 bursts of 100 keystrokes, each burst at a random spot.
+    std::mt19937_64 rng(9);
+    std::vector<double> keystroke_us;
+    const char* text = "the quick brown fox jumps over the lazy dog\n";
+    for (int burst = 0; burst < 200; ++burst) {
+        uint64_t cursor = rng() % (table.size() + 1);
+        for (int key = 0; key < 100; ++key) {
+            started = Clock::now();
+            table.insert(cursor++, text + key % 44, 1);
+            keystroke_us.push_back(elapsed_us(started));
+        }
+    }
+    std::vector<double> first(keystroke_us.begin(), keystroke_us.begin() + 1000);
+    std::vector<double> last(keystroke_us.end() - 1000, keystroke_us.end());
+    std::printf("keystroke         first 1000: p50 %.2f us p99 %.2f us; last 1000: p50 %.2f us p99 %.2f us\n",
+                percentile(first, 0.5), percentile(first, 0.99), percentile(last, 0.5), percentile(last, 0.99));
+    std::printf("pieces after      %zu\n", table.piece_count());
+
+    started = Clock::now();
+    uint64_t lines = table.line_count();
+    std::printf("line_count (cold) %.1f ms -> %llu lines\n", elapsed_us(started) / 1000.0,
+                static_cast<unsigned long long>(lines));
+    std::vector<double> lookup_us;
+    uint64_t checksum = 0;
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t line = rng() % lines;
+        started = Clock::now();
+        checksum += table.line_start(line) + table.line_of(rng() % table.size());
+        lookup_us.push_back(elapsed_us(started));
+    }
+    std::printf("line lookup       p50 %.2f us p99 %.2f us (line_start + line_of)\n", percentile(lookup_us, 0.5),
+                percentile(lookup_us, 0.99));
+
+    started = Clock::now();
+    size_t undone = 0;
+    while (table.undo()) ++undone;
+    std::printf("undo all          %zu steps in %.2f ms\n", undone, elapsed_us(started) / 1000.0);
+
+    if (argc <= 1) {
+        std::remove(path.c_str());
+    }
+    return checksum == 0;
+}
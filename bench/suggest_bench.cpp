@@ -0,0 +1,171 @@
+// SuggestionModel benchmark: training, per-command updates and per-keystroke
+// suggestions.
+//
+// Usage: suggest_bench [commands]
+//
+// Writes a synthetic history of 100,000 commands (or `commands`) drawn from
+// a few habitual workflows in several directories, rebuilds a model from
+// it, then replays another 2,000 commands the way the shell would: every
+// prefix of each command is a keystroke that asks for suggestions, and the
+// command is observed once it has run. Reports latencies and how often the
+// top suggestion was the command about to be typed.
+
+#include "suggestion_model.hpp"
+#include "history_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+struct Command {
+    std::string cwd;
+    std::string line;
+    int status;
+};
+
+// Workflows are short command sequences that repeat with variations; a
+// build fails now and then and is followed by an edit instead of a run.
+class Workload {
+public:
+    explicit Workload(uint64_t seed) : rng_(seed) {}
+
+    Command next() {
+        if (pending_.empty()) start_workflow();
+        Command command = pending_.front();
+        pending_.erase(pending_.begin());
+        return command;
+    }
+
+private:
+    void start_workflow() {
+        static const char* projects[] = {"/src/neurodeck", "/src/website", "/src/notes", "/home/me", "/srv/api"};
+        std::string cwd = projects[zipf(5)];
+        std::string file = "file" + std::to_string(zipf(40)) + ".cpp";
+        switch (rng_() % 5) {
+        case 0: {
+            bool failed = rng_() % 4 == 0;
+            pending_.push_back({cwd, "make -j4", failed ? 2 : 0});
+            pending_.push_back({cwd, failed ? "vim " + file : "./build/app --test", 0});
+            break;
+        }
+        case 1:
+            pending_.push_back({cwd, "git status", 0});
+            pending_.push_back({cwd, "git add " + file, 0});
+            pending_.push_back({cwd, "git commit -m \"update " + file + "\"", 0});
+            break;
+        case 2:
+            pending_.push_back({cwd, "ls -la", 0});
+            pending_.push_back({cwd, "open " + file, 0});
+            break;
+        case 3:
+            pending_.push_back({cwd, "search -i todo " + cwd, 0});
+            break;
+        default:
+            pending_.push_back({cwd, "notes find meeting" + std::to_string(zipf(20)), 0});
+            break;
+        }
+    }
+
+    // Small indices are much more likely than large ones.
+    size_t zipf(size_t n) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+        return std::min(n - 1, static_cast<size_t>(n * u * u * u));
+    }
+
+    std::mt19937_64 rng_;
+    std::vector<Command> pending_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100000;
+    const std::string history_path = "suggest_bench.history";
+    const std::string model_path = "suggest_bench.model";
+    std::remove(history_path.c_str());
+    std::remove(model_path.c_str());
+
+    HistoryStore history;
+    if (!history.open(history_path)) {
+        std::fprintf(stderr, "suggest_bench: cannot open %s\n", history_path.c_str());
+        return 1;
+    }
+    Workload workload(11);
+    for (uint32_t i = 0; i < count; ++i) {
+        Command command = workload.next();
+        history.append(command.line, command.cwd, command.status, 1000, 1700000000 + i * 30);
+    }
+    history.refresh();
+
+    SuggestionModel model;
+    if (!model.open(model_path)) {
+        std::fprintf(stderr, "suggest_bench: cannot open %s\n", model_path.c_str());
+        return 1;
+    }
+    auto started = Clock::now();
+    model.rebuild(history);
+    std::printf("rebuild           %.1f ms for %u history entries (%u learned)\n", elapsed_us(started) / 1000.0,
+                count, model.observed());
+
+    SuggestionModel::Context context;
+    std::vector<double> keystroke_us;
+    std::vector<double> observe_us;
+    size_t predicted = 0;
+    size_t keys_typed = 0;
+    size_t keys_needed = 0;
+    const int replayed = 2000;
+    for (int i = 0; i < replayed; ++i) {
+        Command command = workload.next();
+        context.cwd = command.cwd;
+        // Keystrokes until the top suggestion is the whole command.
+        size_t typed_length = command.line.size();
+        for (size_t length = 0; length <= command.line.size(); ++length) {
+            started = Clock::now();
+            std::vector<SuggestionModel::Suggestion> results = model.suggest(context, command.line.substr(0, length), 5);
+            keystroke_us.push_back(elapsed_us(started));
+            if (!results.empty() && results[0].text == command.line && typed_length == command.line.size()) {
+                typed_length = length;
+                if (length == 0) ++predicted;
+            }
+        }
+        keys_typed += typed_length;
+        keys_needed += command.line.size();
+
+        started = Clock::now();
+        model.observe(context, command.line, command.status);
+        observe_us.push_back(elapsed_us(started));
+        context.before_previous = std::move(context.previous);
+        context.previous = command.line;
+        context.previous_status = command.status;
+    }
+    std::printf("suggest           p50 %.2f us p99 %.2f us per keystroke (%zu keystrokes)\n",
+                percentile(keystroke_us, 0.5), percentile(keystroke_us, 0.99), keystroke_us.size());
+    std::printf("observe           p50 %.2f us p99 %.2f us per command\n", percentile(observe_us, 0.5),
+                percentile(observe_us, 0.99));
+    std::printf("next command      predicted before typing %.1f%% of the time\n", 100.0 * predicted / replayed);
+    std::printf("keystrokes        %.1f%% of the characters typed before the suggestion was right\n",
+                100.0 * keys_typed / keys_needed);
+
+    history.close();
+    model.close();
+    std::remove(history_path.c_str());
+    std::remove(model_path.c_str());
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Built-in terminal benchmark: parsing and drawing a burst of output.
+//
+// Usage: terminal_bench [megabytes]
+//
+// Feeds 256 (or `megabytes`) MB of coloured log lines, like a build or
+// `cat` of a large file would print, into a 240x67 terminal (a 1920x1080
+// surface of 8x16 cells) in 64 KiB reads, as the compositor does. First
+// it only parses, then it also draws every megabyte, as the compositor
+// does once a frame, and reports megabytes per second for each.
+
+#include "terminal_renderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Neurodeck;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int kColumns = 240;
+const int kRows = 67;
+const int kCellWidth = 8;
+const int kCellHeight = 16;
+const size_t kReadSize = 64 * 1024;
+const size_t kFrameBytes = 1024 * 1024;
+
+double elapsed_ms(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// A stand-in for FreeType: a box with a pattern, so the benchmark measures
+// the terminal and not the font.
+bool box_glyph(char32_t ch, bool bold, uint8_t* mask) {
+    for (int y = 1; y < kCellHeight - 3; ++y) {
+        for (int x = 1; x < kCellWidth - 1; ++x) mask[y * kCellWidth + x] = uint8_t((ch * 13 + x * y + bold) | 0x80);
+    }
+    return true;
+}
+
+// About 1 MB of log lines of varying length, some with colour.
+std::string make_chunk() {
+    std::mt19937 rng(50);
+    const char* levels[] = {"\x1b[32mINFO\x1b[0m", "\x1b[33;1mWARN\x1b[0m", "\x1b[31mERROR\x1b[0m", "DEBUG"};
+    std::string text;
+    while (text.size() < kFrameBytes) {
+        text += "[" + std::to_string(rng() % 100000) + "] " + levels[rng() % 4] + " ";
+        for (int n = rng() % 150; n > 0; --n) text += char('a' + rng() % 26 + (rng() % 6 == 0 ? ' ' - 'a' : 0));
+        text += "\r\n";
+    }
+    return text;
+}
+
+// Feeds `megabytes` of `chunk` into a fresh terminal; draws after every
+// chunk if `renderer` is given. Returns megabytes per second.
+double run(const std::string& chunk, int megabytes, TerminalRenderer* renderer, std::vector<uint8_t>& pixels) {
+    Terminal terminal(kColumns, kRows);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < megabytes; ++i) {
+        for (size_t offset = 0; offset < chunk.size(); offset += kReadSize) {
+            terminal.feed(chunk.data() + offset, std::min(kReadSize, chunk.size() - offset));
+        }
+        if (renderer) renderer->draw(terminal, pixels.data(), kColumns * kCellWidth * 4);
+    }
+    return double(chunk.size()) * megabytes / (1024 * 1024) / (elapsed_ms(start) / 1000);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int megabytes = argc > 1 ? std::atoi(argv[1]) : 256;
+    std::string chunk = make_chunk();
+    std::vector<uint8_t> pixels(size_t(kColumns) * kCellWidth * kRows * kCellHeight * 4);
+
+    std::printf("%d MB of log lines into %dx%d cells\n", megabytes, kColumns, kRows);
+    std::printf("  %-16s %8.1f MB/s\n", "parse", run(chunk, megabytes, nullptr, pixels));
+    GlyphAtlas glyphs(kCellWidth, kCellHeight, box_glyph);
+    TerminalRenderer renderer(glyphs);
+    std::printf("  %-16s %8.1f MB/s\n", "parse and draw", run(chunk, megabytes, &renderer, pixels));
+    std::printf("  %zu cells drawn, %zu glyphs rasterized\n", renderer.cells_drawn(), glyphs.rasterized());
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "expression_graph.hpp"
+#include <cstring>
+#include <utility>
+
+namespace Neurodeck {
+
+namespace {
+
+uint64_t bits_of(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+bool is_commutative(Op op) {
+    return op == Op::Add || op == Op::Mul || op == Op::Min || op == Op::Max;
+}
+
+// True if 1 / value is an exact power of two, so x / value == x * (1 / value)
+// for every x.
+bool has_exact_reciprocal(double value) {
+    int exponent;
+    if (!std::isfinite(value) || std::frexp(value, &exponent) != 0.5) {
+        return false;
+    }
+    double reciprocal = 1.0 / value;
+    return std::isfinite(reciprocal) && reciprocal * value == 1.0;
+}
+
+} // namespace
+
+size_t ExpressionGraph::KeyHash::operator()(const Key& key) const {
+    uint64_t h = static_cast<uint64_t>(key.op);
+    h = h * 0x9e3779b97f4a7c15ull ^ key.a;
+    h = h * 0x9e3779b97f4a7c15ull ^ key.b;
+    h = h * 0x9e3779b97f4a7c15ull ^ key.bits;
+    return static_cast<size_t>(h ^ (h >> 29));
+}
+
+void ExpressionGraph::clear() {
+    nodes_.clear();
+    index_.clear();
+}
+
+uint32_t ExpressionGraph::intern(const Node& node) {
+    Key key{node.op, node.a, node.b, node.op == Op::Const ? bits_of(node.value) : 0};
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+        return found->second;
+    }
+    uint32_t id = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(node);
+    index_.emplace(key, id);
+    return id;
+}
+
+bool ExpressionGraph::is_constant(uint32_t id, double value) const {
+    return nodes_[id].op == Op::Const && bits_of(nodes_[id].value) == bits_of(value);
+}
+
+uint32_t ExpressionGraph::constant(double value) {
+    return intern(Node{Op::Const, 0, 0, value});
+}
+
+uint32_t ExpressionGraph::variable(uint32_t index) {
+    return intern(Node{Op::Var, index, 0, 0.0});
+}
+
+uint32_t ExpressionGraph::unary(Op op, uint32_t a) {
+    const Node& operand = nodes_[a];
+    if (operand.op == Op::Const) {
+        return constant(apply_unary(op, operand.value));
+    }
+    if (op == Op::Neg && operand.op == Op::Neg) {
+        return operand.a;
+    }
+    if (op == Op::Abs && (operand.op == Op::Abs || operand.op == Op::Neg)) {
+        return operand.op == Op::Abs ? a : unary(Op::Abs, operand.a);
+    }
+    return intern(Node{op, a, 0, 0.0});
+}
+
+uint32_t ExpressionGraph::binary(Op op, uint32_t a, uint32_t b) {
+    if (nodes_[a].op == Op::Const && nodes_[b].op == Op::Const) {
+        return constant(apply_binary(op, nodes_[a].value, nodes_[b].value));
+    }
+    if (is_commutative(op) && a > b) {
+        std::swap(a, b);
+    }
+    switch (op) {
+    case Op::Add: // x + -0 is x for every x, including -0.
+        if (is_constant(a, -0.0)) return b;
+        if (is_constant(b, -0.0)) return a;
+        break;
+    case Op::Sub:
+        if (is_constant(b, 0.0)) return a;
+        break;
+    case Op::Mul:
+        if (is_constant(a, 1.0)) return b;
+        if (is_constant(b, 1.0)) return a;
+        break;
+    case Op::Div:
+        if (is_constant(b, 1.0)) return a;
+        if (nodes_[b].op == Op::Const && has_exact_reciprocal(nodes_[b].value)) {
+            return binary(Op::Mul, a, constant(1.0 / nodes_[b].value));
+        }
+        break;
+    case Op::Pow:
+        if (is_constant(b, 1.0)) return a;
+        if (is_constant(b, 2.0)) return binary(Op::Mul, a, a);
+        break;
+    default:
+        break;
+    }
+    return intern(Node{op, a, b, 0.0});
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,123 @@
+#ifndef CALCULATOR_EXPRESSION_GRAPH_HPP
+#define CALCULATOR_EXPRESSION_GRAPH_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Operations shared by the expression graph and the bytecode. Const and Var
+// only appear as graph leaves; everything else is also a VM instruction.
+enum class Op : uint8_t {
+    Const,
+    Var,
+    // Unary
+    Neg,
+    Abs,
+    Sqrt,
+    Exp,
+    Log,
+    Sin,
+    Cos,
+    Tan,
+    Floor,
+    Ceil,
+    // Binary
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Pow,
+    Min,
+    Max,
+};
+
+inline bool is_binary(Op op) { return op >= Op::Add; }
+
+// The single definition of every operation: the constant folder and both VM
+// modes go through these, so a folded expression gives bit-for-bit the same
+// result as an evaluated one.
+inline double apply_unary(Op op, double a) {
+    switch (op) {
+    case Op::Neg: return -a;
+    case Op::Abs: return std::fabs(a);
+    case Op::Sqrt: return std::sqrt(a);
+    case Op::Exp: return std::exp(a);
+    case Op::Log: return std::log(a);
+    case Op::Sin: return std::sin(a);
+    case Op::Cos: return std::cos(a);
+    case Op::Tan: return std::tan(a);
+    case Op::Floor: return std::floor(a);
+    case Op::Ceil: return std::ceil(a);
+    default: return a;
+    }
+}
+
+inline double apply_binary(Op op, double a, double b) {
+    switch (op) {
+    case Op::Add: return a + b;
+    case Op::Sub: return a - b;
+    case Op::Mul: return a * b;
+    case Op::Div: return a / b;
+    case Op::Mod: return std::fmod(a, b);
+    case Op::Pow: return std::pow(a, b);
+    // fmin/fmax semantics (a NaN operand loses), spelled out so that the
+    // column loops can vectorise them.
+    case Op::Min: return a < b || b != b ? a : b;
+    case Op::Max: return a > b || b != b ? a : b;
+    default: return a;
+    }
+}
+
+// A hash-consed expression DAG. Every node is built through constant(),
+// variable(), unary() or binary(), which fold constant operands, drop
+// operations that cannot change their operand (x * 1, x - 0, --x, ...),
+// rewrite x ^ 2 as x * x and return the existing node when an identical one
+// was built before. Common subexpressions therefore collapse into a single
+// node as the parser goes.
+class ExpressionGraph {
+public:
+    struct Node {
+        Op op;
+        uint32_t a;   // Operand node, or the variable index for Var.
+        uint32_t b;   // Second operand node for binary ops.
+        double value; // For Const.
+    };
+
+    uint32_t constant(double value);
+    uint32_t variable(uint32_t index);
+    uint32_t unary(Op op, uint32_t a);
+    uint32_t binary(Op op, uint32_t a, uint32_t b);
+
+    const Node& node(uint32_t id) const { return nodes_[id]; }
+    size_t size() const { return nodes_.size(); }
+    void clear();
+
+private:
+    struct Key {
+        Op op;
+        uint32_t a;
+        uint32_t b;
+        uint64_t bits; // The constant's bit pattern, so 0.0 and -0.0 differ.
+        bool operator==(const Key& other) const {
+            return op == other.op && a == other.a && b == other.b && bits == other.bits;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    bool is_constant(uint32_t id, double value) const;
+    uint32_t intern(const Node& node);
+
+    std::vector<Node> nodes_;
+    std::unordered_map<Key, uint32_t, KeyHash> index_;
+};
+
+} // namespace Neurodeck
+
+#endif // CALCULATOR_EXPRESSION_GRAPH_HPP
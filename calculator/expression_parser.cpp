@@ -0,0 +1,291 @@
+#include "expression_parser.hpp"
+#include <cctype>
+#include <cstdlib>
+
+namespace Neurodeck {
+
+namespace {
+
+const int kMaxDepth = 200; // Nesting limit, so hostile input cannot exhaust the stack.
+
+struct Function {
+    const char* name;
+    Op op;
+    int min_args;
+    int max_args; // -1 for variadic
+};
+
+const Function kFunctions[] = {
+    {"abs", Op::Abs, 1, 1},   {"sqrt", Op::Sqrt, 1, 1}, {"exp", Op::Exp, 1, 1},
+    {"log", Op::Log, 1, 1},   {"sin", Op::Sin, 1, 1},   {"cos", Op::Cos, 1, 1},
+    {"tan", Op::Tan, 1, 1},   {"floor", Op::Floor, 1, 1}, {"ceil", Op::Ceil, 1, 1},
+    {"pow", Op::Pow, 2, 2},   {"mod", Op::Mod, 2, 2},   {"min", Op::Min, 2, -1},
+    {"max", Op::Max, 2, -1},
+};
+
+class Parser {
+public:
+    Parser(const std::string& source, const std::vector<std::string>& variables, ExpressionGraph& graph)
+        : source_(source), variables_(variables), graph_(graph) {}
+
+    bool parse(uint32_t& root) {
+        skip_space();
+        if (!expression(root)) {
+            return false;
+        }
+        if (pos_ < source_.size()) {
+            return fail("unexpected '" + std::string(1, source_[pos_]) + "'");
+        }
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    bool fail(const std::string& message) {
+        if (error_.empty()) {
+            error_ = message + " at column " + std::to_string(pos_ + 1);
+        }
+        return false;
+    }
+
+    void skip_space() {
+        while (pos_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[pos_]))) {
+            ++pos_;
+        }
+    }
+
+    bool accept(char c) {
+        if (pos_ < source_.size() && source_[pos_] == c) {
+            ++pos_;
+            skip_space();
+            return true;
+        }
+        return false;
+    }
+
+    bool expression(uint32_t& out) {
+        if (++depth_ > kMaxDepth) {
+            return fail("expression nested too deeply");
+        }
+        if (!term(out)) {
+            return false;
+        }
+        for (;;) {
+            Op op;
+            if (accept('+')) {
+                op = Op::Add;
+            } else if (accept('-')) {
+                op = Op::Sub;
+            } else {
+                break;
+            }
+            uint32_t rhs;
+            if (!term(rhs)) {
+                return false;
+            }
+            out = graph_.binary(op, out, rhs);
+        }
+        --depth_;
+        return true;
+    }
+
+    bool term(uint32_t& out) {
+        if (!unary(out)) {
+            return false;
+        }
+        for (;;) {
+            Op op;
+            if (accept('*')) {
+                op = Op::Mul;
+            } else if (accept('/')) {
+                op = Op::Div;
+            } else if (accept('%')) {
+                op = Op::Mod;
+            } else {
+                break;
+            }
+            uint32_t rhs;
+            if (!unary(rhs)) {
+                return false;
+            }
+            out = graph_.binary(op, out, rhs);
+        }
+        return true;
+    }
+
+    bool unary(uint32_t& out) {
+        if (++depth_ > kMaxDepth) {
+            return fail("expression nested too deeply");
+        }
+        bool ok;
+        if (accept('-')) {
+            ok = unary(out);
+            if (ok) {
+                out = graph_.unary(Op::Neg, out);
+            }
+        } else if (accept('+')) {
+            ok = unary(out);
+        } else {
+            ok = power(out);
+        }
+        --depth_;
+        return ok;
+    }
+
+    bool power(uint32_t& out) {
+        if (!primary(out)) {
+            return false;
+        }
+        if (accept('^')) {
+            uint32_t exponent;
+            if (!unary(exponent)) {
+                return false;
+            }
+            out = graph_.binary(Op::Pow, out, exponent);
+        }
+        return true;
+    }
+
+    bool primary(uint32_t& out) {
+        if (pos_ >= source_.size()) {
+            return fail("unexpected end of expression");
+        }
+        char c = source_[pos_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            return number(out);
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            return name(out);
+        }
+        if (accept('(')) {
+            if (!expression(out)) {
+                return false;
+            }
+            return accept(')') || fail("expected ')'");
+        }
+        return fail("unexpected '" + std::string(1, c) + "'");
+    }
+
+    bool number(uint32_t& out) {
+        size_t start = pos_;
+        auto digits = [&] {
+            size_t from = pos_;
+            while (pos_ < source_.size() && std::isdigit(static_cast<unsigned char>(source_[pos_]))) {
+                ++pos_;
+            }
+            return pos_ - from;
+        };
+        size_t mantissa = digits();
+        if (pos_ < source_.size() && source_[pos_] == '.') {
+            ++pos_;
+            mantissa += digits();
+        }
+        if (mantissa == 0) {
+            pos_ = start;
+            return fail("malformed number");
+        }
+        if (pos_ < source_.size() && (source_[pos_] == 'e' || source_[pos_] == 'E')) {
+            ++pos_;
+            if (pos_ < source_.size() && (source_[pos_] == '+' || source_[pos_] == '-')) {
+                ++pos_;
+            }
+            if (digits() == 0) {
+                return fail("malformed exponent");
+            }
+        }
+        // strtod would also accept hex and locale-specific forms, so it only
+        // sees the span already validated above.
+        std::string text = source_.substr(start, pos_ - start);
+        out = graph_.constant(std::strtod(text.c_str(), nullptr));
+        skip_space();
+        return true;
+    }
+
+    bool name(uint32_t& out) {
+        size_t start = pos_;
+        while (pos_ < source_.size() &&
+               (std::isalnum(static_cast<unsigned char>(source_[pos_])) || source_[pos_] == '_')) {
+            ++pos_;
+        }
+        std::string identifier = source_.substr(start, pos_ - start);
+        skip_space();
+        if (pos_ < source_.size() && source_[pos_] == '(') {
+            for (const Function& function : kFunctions) {
+                if (identifier == function.name) {
+                    return call(function, out);
+                }
+            }
+            pos_ = start;
+            return fail("unknown function '" + identifier + "'");
+        }
+        for (size_t i = 0; i < variables_.size(); ++i) {
+            if (variables_[i] == identifier) {
+                out = graph_.variable(static_cast<uint32_t>(i));
+                return true;
+            }
+        }
+        if (identifier == "pi") {
+            out = graph_.constant(3.14159265358979323846);
+            return true;
+        }
+        if (identifier == "e") {
+            out = graph_.constant(2.71828182845904523536);
+            return true;
+        }
+        pos_ = start;
+        return fail("unknown variable '" + identifier + "'");
+    }
+
+    bool call(const Function& function, uint32_t& out) {
+        size_t start = pos_;
+        accept('(');
+        std::vector<uint32_t> args;
+        do {
+            uint32_t arg;
+            if (!expression(arg)) {
+                return false;
+            }
+            args.push_back(arg);
+        } while (accept(','));
+        if (!accept(')')) {
+            return fail("expected ')'");
+        }
+        int count = static_cast<int>(args.size());
+        if (count < function.min_args || (function.max_args >= 0 && count > function.max_args)) {
+            pos_ = start;
+            return fail(std::string("wrong number of arguments to ") + function.name);
+        }
+        out = args[0];
+        if (!is_binary(function.op)) {
+            out = graph_.unary(function.op, out);
+        }
+        for (size_t i = 1; i < args.size(); ++i) {
+            out = graph_.binary(function.op, out, args[i]);
+        }
+        return true;
+    }
+
+    const std::string& source_;
+    const std::vector<std::string>& variables_;
+    ExpressionGraph& graph_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+    std::string error_;
+};
+
+} // namespace
+
+bool parse_expression(const std::string& source, const std::vector<std::string>& variables,
+                      ExpressionGraph& graph, uint32_t& root, std::string* error) {
+    Parser parser(source, variables, graph);
+    if (!parser.parse(root)) {
+        if (error) {
+            *error = parser.error();
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,31 @@
+#ifndef CALCULATOR_EXPRESSION_PARSER_HPP
+#define CALCULATOR_EXPRESSION_PARSER_HPP
+
+#include "expression_graph.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// Parses an arithmetic expression into `graph` and stores its node in
+// `root`.
+//
+//   expr    := term (('+' | '-') term)*
+//   term    := unary (('*' | '/' | '%') unary)*
+//   unary   := ('-' | '+') unary | power
+//   power   := primary ('^' unary)?          right-associative, so -2^2 = -4
+//   primary := number | name | name '(' expr (',' expr)* ')' | '(' expr ')'
+//
+// A name is the index of its entry in `variables`, or failing that one of
+// the constants pi and e. Functions: abs sqrt exp log sin cos tan floor ceil
+// with one argument, pow and mod with two, min and max with two or more.
+//
+// On failure returns false and, if `error` is given, describes the problem
+// and its 1-based column.
+bool parse_expression(const std::string& source, const std::vector<std::string>& variables,
+                      ExpressionGraph& graph, uint32_t& root, std::string* error = nullptr);
+
+} // namespace Neurodeck
+
+#endif // CALCULATOR_EXPRESSION_PARSER_HPP
@@ -0,0 +1,268 @@
+#include "program.hpp"
+#include "expression_parser.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace Neurodeck {
+
+namespace {
+
+const size_t kMaxRegisters = 65536;
+const size_t kStackRegisters = 256; // evaluate() keeps up to this many on the stack.
+
+const char* const kOpNames[] = {
+    "const", "var", "neg", "abs", "sqrt", "exp", "log", "sin", "cos", "tan", "floor", "ceil",
+    "add",   "sub", "mul", "div", "mod",  "pow", "min", "max",
+};
+
+template <typename Fn>
+inline void map_unary(double* __restrict dst, const double* __restrict a, size_t n, Fn fn) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = fn(a[i]);
+    }
+}
+
+template <typename Fn>
+inline void map_binary(double* __restrict dst, const double* __restrict a, const double* __restrict b,
+                       size_t n, Fn fn) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = fn(a[i], b[i]);
+    }
+}
+
+// Runs the program over one block. N is the row count when it is known at
+// compile time (a full block), which lets the loops vectorise without a
+// remainder; N == 0 handles the last, partial block.
+template <size_t N>
+void run_block(const Program::Instruction* code, size_t count, double* const* regs, size_t rows) {
+    const size_t n = N ? N : rows;
+    for (size_t pc = 0; pc < count; ++pc) {
+        const Program::Instruction& in = code[pc];
+        double* d = regs[in.dst];
+        const double* a = regs[in.a];
+        const double* b = regs[in.b];
+        switch (in.op) {
+        case Op::Neg: map_unary(d, a, n, [](double x) { return -x; }); break;
+        case Op::Abs: map_unary(d, a, n, [](double x) { return std::fabs(x); }); break;
+        case Op::Floor: map_unary(d, a, n, [](double x) { return std::floor(x); }); break;
+        case Op::Ceil: map_unary(d, a, n, [](double x) { return std::ceil(x); }); break;
+        case Op::Add: map_binary(d, a, b, n, [](double x, double y) { return x + y; }); break;
+        case Op::Sub: map_binary(d, a, b, n, [](double x, double y) { return x - y; }); break;
+        case Op::Mul: map_binary(d, a, b, n, [](double x, double y) { return x * y; }); break;
+        case Op::Div: map_binary(d, a, b, n, [](double x, double y) { return x / y; }); break;
+        case Op::Min: map_binary(d, a, b, n, [](double x, double y) { return apply_binary(Op::Min, x, y); }); break;
+        case Op::Max: map_binary(d, a, b, n, [](double x, double y) { return apply_binary(Op::Max, x, y); }); break;
+        default:
+            // Library calls gain nothing from a specialised loop.
+            if (is_binary(in.op)) {
+                for (size_t i = 0; i < n; ++i) d[i] = apply_binary(in.op, a[i], b[i]);
+            } else {
+                for (size_t i = 0; i < n; ++i) d[i] = apply_unary(in.op, a[i]);
+            }
+            break;
+        }
+    }
+}
+
+} // namespace
+
+bool Program::compile(const std::string& source, const std::vector<std::string>& variables, std::string* error) {
+    code_.clear();
+    constants_.clear();
+    inputs_.clear();
+    variable_count_ = variables.size();
+    register_count_ = 0;
+    result_ = 0;
+
+    ExpressionGraph graph;
+    uint32_t root;
+    if (!parse_expression(source, variables, graph, root, error)) {
+        return false;
+    }
+
+    // Nodes reachable from the root, operands before their users. Folding
+    // leaves unreachable nodes behind in the graph; they are never emitted.
+    std::vector<uint32_t> order;
+    std::vector<uint8_t> visited(graph.size(), 0);
+    std::vector<uint32_t> uses(graph.size(), 0);
+    std::vector<std::pair<uint32_t, bool>> stack{{root, false}};
+    while (!stack.empty()) {
+        auto [id, expanded] = stack.back();
+        stack.pop_back();
+        const ExpressionGraph::Node& node = graph.node(id);
+        if (expanded) {
+            order.push_back(id);
+            continue;
+        }
+        if (visited[id]) {
+            continue;
+        }
+        visited[id] = 1;
+        stack.emplace_back(id, true);
+        if (node.op == Op::Const || node.op == Op::Var) {
+            continue;
+        }
+        if (is_binary(node.op)) {
+            stack.emplace_back(node.b, false);
+        }
+        stack.emplace_back(node.a, false);
+    }
+    for (uint32_t id : order) {
+        const ExpressionGraph::Node& node = graph.node(id);
+        if (node.op != Op::Const && node.op != Op::Var) {
+            ++uses[node.a];
+            if (is_binary(node.op)) {
+                ++uses[node.b];
+            }
+        }
+    }
+
+    std::vector<uint32_t> reg(graph.size(), 0);
+    for (uint32_t id : order) {
+        if (graph.node(id).op == Op::Const) {
+            reg[id] = static_cast<uint32_t>(constants_.size());
+            constants_.push_back(graph.node(id).value);
+        }
+    }
+    for (uint32_t id : order) {
+        if (graph.node(id).op == Op::Var) {
+            reg[id] = static_cast<uint32_t>(constants_.size() + inputs_.size());
+            inputs_.push_back(Input{static_cast<uint16_t>(reg[id]), graph.node(id).a});
+        }
+    }
+    const size_t first_temp = constants_.size() + inputs_.size();
+    size_t next_temp = first_temp;
+    std::vector<uint32_t> free_temps;
+    auto release = [&](uint32_t operand) {
+        if (--uses[operand] == 0 && reg[operand] >= first_temp) {
+            free_temps.push_back(reg[operand]);
+        }
+    };
+    for (uint32_t id : order) {
+        const ExpressionGraph::Node& node = graph.node(id);
+        if (node.op == Op::Const || node.op == Op::Var) {
+            continue;
+        }
+        // The destination is taken before the operands are released, so an
+        // instruction never writes a register it reads; the block loops rely
+        // on that to vectorise.
+        uint32_t dst;
+        if (!free_temps.empty()) {
+            dst = free_temps.back();
+            free_temps.pop_back();
+        } else {
+            dst = static_cast<uint32_t>(next_temp++);
+        }
+        reg[id] = dst;
+        uint32_t b = is_binary(node.op) ? reg[node.b] : 0;
+        code_.push_back(Instruction{node.op, static_cast<uint16_t>(dst), static_cast<uint16_t>(reg[node.a]),
+                                    static_cast<uint16_t>(b)});
+        release(node.a);
+        if (is_binary(node.op)) {
+            release(node.b);
+        }
+    }
+    if (next_temp > kMaxRegisters) {
+        code_.clear();
+        constants_.clear();
+        inputs_.clear();
+        if (error) {
+            *error = "expression too large";
+        }
+        return false;
+    }
+    register_count_ = next_temp;
+    result_ = static_cast<uint16_t>(reg[root]);
+    return true;
+}
+
+double Program::evaluate(const double* values) const {
+    if (register_count_ == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double stack_regs[kStackRegisters];
+    std::vector<double> heap_regs;
+    double* regs = stack_regs;
+    if (register_count_ > kStackRegisters) {
+        heap_regs.resize(register_count_);
+        regs = heap_regs.data();
+    }
+    std::copy(constants_.begin(), constants_.end(), regs);
+    for (const Input& input : inputs_) {
+        regs[input.reg] = values[input.variable];
+    }
+    for (const Instruction& in : code_) {
+        regs[in.dst] = is_binary(in.op) ? apply_binary(in.op, regs[in.a], regs[in.b]) : apply_unary(in.op, regs[in.a]);
+    }
+    return regs[result_];
+}
+
+void Program::evaluate_columns(const double* const* columns, size_t rows, double* out) const {
+    if (register_count_ == 0) {
+        std::fill(out, out + rows, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+    // Constants and temporaries get a block of scratch each; variable
+    // registers point straight into the caller's columns and the result
+    // register into `out`, so nothing is copied in or out.
+    const size_t first_temp = constants_.size() + inputs_.size();
+    std::vector<double> scratch((constants_.size() + register_count_ - first_temp) * kBlockRows);
+    std::vector<double*> regs(register_count_, nullptr);
+    double* next = scratch.data();
+    for (size_t i = 0; i < constants_.size(); ++i, next += kBlockRows) {
+        regs[i] = next;
+        std::fill(next, next + kBlockRows, constants_[i]);
+    }
+    for (size_t r = first_temp; r < register_count_; ++r, next += kBlockRows) {
+        regs[r] = next;
+    }
+    const bool result_is_temp = result_ >= first_temp;
+
+    for (size_t row = 0; row < rows; row += kBlockRows) {
+        size_t n = std::min(kBlockRows, rows - row);
+        for (const Input& input : inputs_) {
+            regs[input.reg] = const_cast<double*>(columns[input.variable] + row);
+        }
+        if (result_is_temp) {
+            regs[result_] = out + row;
+        }
+        if (n == kBlockRows) {
+            run_block<kBlockRows>(code_.data(), code_.size(), regs.data(), n);
+        } else {
+            run_block<0>(code_.data(), code_.size(), regs.data(), n);
+        }
+        if (!result_is_temp) {
+            std::copy(regs[result_], regs[result_] + n, out + row);
+        }
+    }
+}
+
+std::string Program::disassemble() const {
+    std::string text;
+    char line[96];
+    for (size_t i = 0; i < constants_.size(); ++i) {
+        std::snprintf(line, sizeof line, "r%zu = const %.17g\n", i, constants_[i]);
+        text += line;
+    }
+    for (const Input& input : inputs_) {
+        std::snprintf(line, sizeof line, "r%u = var %u\n", static_cast<unsigned>(input.reg),
+                      static_cast<unsigned>(input.variable));
+        text += line;
+    }
+    for (const Instruction& in : code_) {
+        const char* name = kOpNames[static_cast<size_t>(in.op)];
+        if (is_binary(in.op)) {
+            std::snprintf(line, sizeof line, "r%u = %s r%u r%u\n", static_cast<unsigned>(in.dst), name,
+                          static_cast<unsigned>(in.a), static_cast<unsigned>(in.b));
+        } else {
+            std::snprintf(line, sizeof line, "r%u = %s r%u\n", static_cast<unsigned>(in.dst), name,
+                          static_cast<unsigned>(in.a));
+        }
+        text += line;
+    }
+    std::snprintf(line, sizeof line, "ret r%u\n", static_cast<unsigned>(result_));
+    return text + line;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,72 @@
+#ifndef CALCULATOR_PROGRAM_HPP
+#define CALCULATOR_PROGRAM_HPP
+
+#include "expression_graph.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// A compiled expression: bytecode for a small register machine.
+//
+// compile() parses the source into an ExpressionGraph, which folds constants
+// and merges common subexpressions, then walks the nodes reachable from the
+// result and emits one three-address instruction per operation. Constants
+// and variables are not instructions; they sit in their own registers,
+// filled before a run. Temporaries reuse a register as soon as its last
+// reader has executed.
+//
+// evaluate_columns() runs the program a block of rows at a time: every
+// register holds kBlockRows values and each instruction is a tight loop over
+// the block. Dispatch cost is paid once per block rather than once per row,
+// and the loops are simple enough for the compiler to vectorise.
+class Program {
+public:
+    static constexpr size_t kBlockRows = 256;
+
+    struct Instruction {
+        Op op;
+        uint16_t dst;
+        uint16_t a;
+        uint16_t b;
+    };
+
+    // Compiles `source`; names in it refer to entries of `variables`.
+    // Returns false (describing the problem in `error`, if given) on a
+    // syntax error, an unknown name, or more than 65535 live registers.
+    bool compile(const std::string& source, const std::vector<std::string>& variables,
+                 std::string* error = nullptr);
+
+    // Evaluates once. `values[i]` is the value of variables[i].
+    double evaluate(const double* values) const;
+    // Evaluates every row: out[r] = f(columns[0][r], columns[1][r], ...),
+    // with columns[i] the values of variables[i]. `out` must not overlap
+    // any column.
+    void evaluate_columns(const double* const* columns, size_t rows, double* out) const;
+
+    size_t variable_count() const { return variable_count_; }
+    const std::vector<Instruction>& instructions() const { return code_; }
+    size_t register_count() const { return register_count_; }
+    // One instruction per line, e.g. "r3 = mul r0 r1"; for tests and
+    // debugging.
+    std::string disassemble() const;
+
+private:
+    struct Input {
+        uint16_t reg;
+        uint32_t variable;
+    };
+
+    std::vector<Instruction> code_;
+    std::vector<double> constants_; // Held in registers 0 .. constants_.size() - 1
+    std::vector<Input> inputs_;     // Variables, in the registers after the constants
+    size_t variable_count_ = 0;
+    size_t register_count_ = 0;
+    uint16_t result_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // CALCULATOR_PROGRAM_HPP
@@ -0,0 +1,162 @@
+#include "calendar.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+namespace {
+
+bool by_start(const Occurrence& a, const Occurrence& b) {
+    return a.start != b.start ? a.start < b.start : a.id < b.id;
+}
+
+// Orders expanded occurrences by (start, id). A busy week holds thousands of
+// them, so this is an LSD radix sort on ((start - earliest) << 32 | id), one
+// byte per pass, skipping passes in which every key has the same byte.
+void sort_occurrences(std::vector<Occurrence>::iterator first, std::vector<Occurrence>::iterator last) {
+    size_t count = static_cast<size_t>(last - first);
+    if (count < 256) {
+        std::sort(first, last, by_start);
+        return;
+    }
+    auto bounds = std::minmax_element(first, last, by_start);
+    uint64_t base = static_cast<uint64_t>(bounds.first->start);
+    if (static_cast<uint64_t>(bounds.second->start) - base > UINT32_MAX) {
+        std::sort(first, last, by_start);
+        return;
+    }
+    auto key = [base](const Occurrence& o) {
+        return (static_cast<uint64_t>(o.start) - base) << 32 | o.id;
+    };
+    std::vector<Occurrence> keys(first, last);
+    std::vector<Occurrence> scratch(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const Occurrence& o : keys) ++counts[(key(o) >> shift) & 0xff];
+        if (counts[(key(keys[0]) >> shift) & 0xff] == count) continue;
+        size_t position = 0;
+        for (size_t& bucket : counts) {
+            size_t n = bucket;
+            bucket = position;
+            position += n;
+        }
+        for (const Occurrence& o : keys) scratch[counts[(key(o) >> shift) & 0xff]++] = o;
+        keys.swap(scratch);
+    }
+    std::copy(keys.begin(), keys.end(), first);
+}
+
+} // namespace
+
+const Calendar::Item* Calendar::item(uint32_t id) const {
+    if (id == 0 || id > items_.size() || !items_[id - 1].live) {
+        return nullptr;
+    }
+    return &items_[id - 1];
+}
+
+uint32_t Calendar::add_event(int64_t start, int64_t end, const std::string& title) {
+    Item entry;
+    entry.live = true;
+    entry.start = start;
+    entry.end = std::max(start, end);
+    entry.title = title;
+    items_.push_back(std::move(entry));
+    uint32_t id = static_cast<uint32_t>(items_.size());
+    events_.insert(start, items_.back().end, id);
+    return id;
+}
+
+uint32_t Calendar::add_series(int64_t first_start, int64_t first_end, const RecurrenceRule& rule,
+                              const std::string& title) {
+    Item entry;
+    entry.live = true;
+    entry.start = first_start;
+    entry.title = title;
+    entry.recurrence = std::make_unique<Recurrence>(first_start, first_end - first_start, rule);
+    int64_t last = entry.recurrence->last_start();
+    int64_t duration = entry.recurrence->duration();
+    entry.end = last > kForever - duration ? kForever : last + duration;
+    items_.push_back(std::move(entry));
+    uint32_t id = static_cast<uint32_t>(items_.size());
+    series_.insert(first_start, items_.back().end, id);
+    return id;
+}
+
+bool Calendar::exclude(uint32_t series_id, int64_t occurrence_start) {
+    if (!item(series_id) || !items_[series_id - 1].recurrence) {
+        return false;
+    }
+    items_[series_id - 1].recurrence->exclude(occurrence_start);
+    return true;
+}
+
+bool Calendar::remove(uint32_t id) {
+    const Item* entry = item(id);
+    if (!entry) {
+        return false;
+    }
+    (entry->recurrence ? series_ : events_).erase(entry->start, id);
+    Item& stored = items_[id - 1];
+    stored.live = false;
+    stored.title.clear();
+    stored.recurrence.reset();
+    return true;
+}
+
+const std::string* Calendar::title(uint32_t id) const {
+    const Item* entry = item(id);
+    return entry ? &entry->title : nullptr;
+}
+
+std::vector<Occurrence> Calendar::occurrences(int64_t begin, int64_t end) const {
+    std::vector<Occurrence> result;
+    events_.query(begin, end, [&](const IntervalTree::Interval& interval) {
+        result.push_back(Occurrence{interval.id, interval.start, interval.end});
+    });
+    size_t events = result.size();
+    series_.query(begin, end, [&](const IntervalTree::Interval& interval) {
+        const Recurrence& recurrence = *items_[interval.id - 1].recurrence;
+        recurrence.expand(begin, end, [&](int64_t start) {
+            result.push_back(Occurrence{interval.id, start, start + recurrence.duration()});
+        });
+    });
+    // Events arrive in order; only the expanded occurrences need sorting
+    // before the two runs are merged.
+    sort_occurrences(result.begin() + events, result.end());
+    std::inplace_merge(result.begin(), result.begin() + events, result.end(), by_start);
+    return result;
+}
+
+std::vector<std::pair<Occurrence, Occurrence>> Calendar::conflicts(int64_t begin, int64_t end) const {
+    std::vector<Occurrence> sorted = occurrences(begin, end);
+    std::vector<std::pair<Occurrence, Occurrence>> result;
+    // Sweep in start order, keeping the occurrences still running.
+    std::vector<Occurrence> active;
+    for (const Occurrence& occurrence : sorted) {
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](const Occurrence& other) { return other.end <= occurrence.start; }),
+                     active.end());
+        for (const Occurrence& other : active) {
+            if (occurrence.end > occurrence.start && other.end > other.start) {
+                result.emplace_back(other, occurrence);
+            }
+        }
+        active.push_back(occurrence);
+    }
+    return result;
+}
+
+bool Calendar::is_busy(int64_t begin, int64_t end) const {
+    if (events_.overlaps(begin, end)) {
+        return true;
+    }
+    bool busy = false;
+    series_.query(begin, end, [&](const IntervalTree::Interval& interval) {
+        if (!busy) {
+            items_[interval.id - 1].recurrence->expand(begin, end, [&](int64_t) { busy = true; });
+        }
+    });
+    return busy;
+}
+
+} // namespace Neurodeck
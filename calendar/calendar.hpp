@@ -0,0 +1,71 @@
+#ifndef CALENDAR_CALENDAR_HPP
+#define CALENDAR_CALENDAR_HPP
+
+#include "interval_tree.hpp"
+#include "recurrence.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Neurodeck {
+
+// One concrete occurrence of an event or of a recurring series.
+struct Occurrence {
+    uint32_t id; // Event or series id
+    int64_t start;
+    int64_t end;
+};
+
+// Events and recurring series for the calendar module.
+//
+// One-off events go into an interval tree keyed by their time span. Each
+// recurring series is stored once, in a second interval tree, under the span
+// from its first occurrence to the end of its last (open-ended series reach
+// kForever). A window query collects the events overlapping the window and
+// expands only the series whose span overlaps it, and only inside the
+// window; no occurrence outside the window is ever materialised.
+class Calendar {
+public:
+    // Adds a one-off event covering [start, end). Returns its id.
+    uint32_t add_event(int64_t start, int64_t end, const std::string& title = std::string());
+    // Adds a series whose first occurrence covers [first_start, first_end).
+    uint32_t add_series(int64_t first_start, int64_t first_end, const RecurrenceRule& rule,
+                        const std::string& title = std::string());
+    // Cancels one occurrence of a series. Returns false if `series_id` is
+    // not a series.
+    bool exclude(uint32_t series_id, int64_t occurrence_start);
+    bool remove(uint32_t id);
+
+    // Title of an event or series, or nullptr if there is no such id.
+    const std::string* title(uint32_t id) const;
+    size_t event_count() const { return events_.size(); }
+    size_t series_count() const { return series_.size(); }
+
+    // Occurrences overlapping [begin, end), ordered by start then id.
+    std::vector<Occurrence> occurrences(int64_t begin, int64_t end) const;
+    // Every pair of overlapping occurrences within [begin, end).
+    std::vector<std::pair<Occurrence, Occurrence>> conflicts(int64_t begin, int64_t end) const;
+    // True if anything is scheduled during [begin, end).
+    bool is_busy(int64_t begin, int64_t end) const;
+
+private:
+    struct Item {
+        bool live = false;
+        int64_t start = 0;
+        int64_t end = 0; // For a series, the end of its last occurrence.
+        std::string title;
+        std::unique_ptr<Recurrence> recurrence;
+    };
+
+    const Item* item(uint32_t id) const;
+
+    std::vector<Item> items_; // Indexed by id - 1
+    IntervalTree events_;
+    IntervalTree series_;
+};
+
+} // namespace Neurodeck
+
+#endif // CALENDAR_CALENDAR_HPP
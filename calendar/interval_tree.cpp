@@ -0,0 +1,160 @@
+#include "interval_tree.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+int32_t IntervalTree::allocate(const Interval& interval) {
+    Node node{interval, interval.end, kNil, kNil, 1};
+    if (!free_.empty()) {
+        int32_t index = free_.back();
+        free_.pop_back();
+        nodes_[index] = node;
+        return index;
+    }
+    nodes_.push_back(node);
+    return static_cast<int32_t>(nodes_.size() - 1);
+}
+
+void IntervalTree::update(int32_t index) {
+    Node& node = nodes_[index];
+    node.height = 1 + std::max(height(node.left), height(node.right));
+    node.max_end = node.interval.end;
+    if (node.left != kNil) node.max_end = std::max(node.max_end, nodes_[node.left].max_end);
+    if (node.right != kNil) node.max_end = std::max(node.max_end, nodes_[node.right].max_end);
+}
+
+int32_t IntervalTree::rotate_left(int32_t index) {
+    int32_t pivot = nodes_[index].right;
+    nodes_[index].right = nodes_[pivot].left;
+    nodes_[pivot].left = index;
+    update(index);
+    update(pivot);
+    return pivot;
+}
+
+int32_t IntervalTree::rotate_right(int32_t index) {
+    int32_t pivot = nodes_[index].left;
+    nodes_[index].left = nodes_[pivot].right;
+    nodes_[pivot].right = index;
+    update(index);
+    update(pivot);
+    return pivot;
+}
+
+int32_t IntervalTree::rebalance(int32_t index) {
+    update(index);
+    Node& node = nodes_[index];
+    int balance = height(node.left) - height(node.right);
+    if (balance > 1) {
+        if (height(nodes_[node.left].left) < height(nodes_[node.left].right)) {
+            nodes_[index].left = rotate_left(node.left);
+        }
+        return rotate_right(index);
+    }
+    if (balance < -1) {
+        if (height(nodes_[node.right].right) < height(nodes_[node.right].left)) {
+            nodes_[index].right = rotate_right(node.right);
+        }
+        return rotate_left(index);
+    }
+    return index;
+}
+
+int32_t IntervalTree::insert(int32_t index, int32_t node) {
+    if (index == kNil) {
+        return node;
+    }
+    const Interval& key = nodes_[node].interval;
+    if (less(key, nodes_[index].interval.start, nodes_[index].interval.id)) {
+        int32_t child = insert(nodes_[index].left, node);
+        nodes_[index].left = child;
+    } else {
+        int32_t child = insert(nodes_[index].right, node);
+        nodes_[index].right = child;
+    }
+    return rebalance(index);
+}
+
+void IntervalTree::insert(int64_t start, int64_t end, uint32_t id) {
+    int32_t node = allocate(Interval{start, end, id});
+    root_ = insert(root_, node);
+    ++size_;
+}
+
+int32_t IntervalTree::detach_min(int32_t index, int32_t& min) {
+    if (nodes_[index].left == kNil) {
+        min = index;
+        return nodes_[index].right;
+    }
+    int32_t child = detach_min(nodes_[index].left, min);
+    nodes_[index].left = child;
+    return rebalance(index);
+}
+
+int32_t IntervalTree::erase(int32_t index, int64_t start, uint32_t id, bool& found) {
+    if (index == kNil) {
+        return kNil;
+    }
+    const Interval& here = nodes_[index].interval;
+    if (here.start == start && here.id == id) {
+        found = true;
+        int32_t left = nodes_[index].left;
+        int32_t right = nodes_[index].right;
+        free_.push_back(index);
+        if (left == kNil || right == kNil) {
+            return left == kNil ? right : left;
+        }
+        int32_t successor;
+        right = detach_min(right, successor);
+        nodes_[successor].left = left;
+        nodes_[successor].right = right;
+        return rebalance(successor);
+    }
+    if (less(here, start, id)) {
+        int32_t child = erase(nodes_[index].right, start, id, found);
+        nodes_[index].right = child;
+    } else {
+        int32_t child = erase(nodes_[index].left, start, id, found);
+        nodes_[index].left = child;
+    }
+    return found ? rebalance(index) : index;
+}
+
+bool IntervalTree::erase(int64_t start, uint32_t id) {
+    bool found = false;
+    root_ = erase(root_, start, id, found);
+    if (found) {
+        --size_;
+    }
+    return found;
+}
+
+void IntervalTree::clear() {
+    nodes_.clear();
+    free_.clear();
+    root_ = kNil;
+    size_ = 0;
+}
+
+bool IntervalTree::overlaps(int64_t begin, int64_t end) const {
+    // Descend towards any overlap: if the left subtree reaches past `begin`,
+    // an overlap there is as likely as anywhere, and if it does not, only
+    // this node or the right subtree can overlap.
+    int32_t index = root_;
+    while (index != kNil) {
+        const Node& node = nodes_[index];
+        if (node.interval.start < end && node.interval.end > begin) {
+            return true;
+        }
+        if (node.left != kNil && nodes_[node.left].max_end > begin) {
+            index = node.left;
+        } else if (node.interval.start < end) {
+            index = node.right;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+} // namespace Neurodeck
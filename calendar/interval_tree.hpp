@@ -0,0 +1,86 @@
+#ifndef CALENDAR_INTERVAL_TREE_HPP
+#define CALENDAR_INTERVAL_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+// Half-open intervals [start, end) keyed by (start, id), kept in an AVL tree
+// where every node also records the largest end in its subtree. A window
+// query skips any subtree whose largest end is at or before the window and
+// anything starting at or after it, so it costs O(log n + matches) instead
+// of a scan over every interval.
+class IntervalTree {
+public:
+    struct Interval {
+        int64_t start;
+        int64_t end;
+        uint32_t id;
+    };
+
+    void insert(int64_t start, int64_t end, uint32_t id);
+    // Removes the interval inserted with this start and id. Returns false if
+    // there is none.
+    bool erase(int64_t start, uint32_t id);
+    void clear();
+    size_t size() const { return size_; }
+
+    // Calls fn(const Interval&) for every interval overlapping [begin, end),
+    // in (start, id) order.
+    template <typename Fn>
+    void query(int64_t begin, int64_t end, Fn&& fn) const {
+        query(root_, begin, end, fn);
+    }
+    // True if any interval overlaps [begin, end).
+    bool overlaps(int64_t begin, int64_t end) const;
+
+private:
+    static const int32_t kNil = -1;
+
+    struct Node {
+        Interval interval;
+        int64_t max_end;
+        int32_t left;
+        int32_t right;
+        int32_t height;
+    };
+
+    template <typename Fn>
+    void query(int32_t index, int64_t begin, int64_t end, Fn& fn) const {
+        while (index != kNil && nodes_[index].max_end > begin) {
+            const Node& node = nodes_[index];
+            query(node.left, begin, end, fn);
+            if (node.interval.start >= end) {
+                return;
+            }
+            if (node.interval.end > begin) {
+                fn(node.interval);
+            }
+            index = node.right;
+        }
+    }
+
+    static bool less(const Interval& a, int64_t start, uint32_t id) {
+        return a.start != start ? a.start < start : a.id < id;
+    }
+    int32_t height(int32_t index) const { return index == kNil ? 0 : nodes_[index].height; }
+    void update(int32_t index);
+    int32_t rotate_left(int32_t index);
+    int32_t rotate_right(int32_t index);
+    int32_t rebalance(int32_t index);
+    int32_t insert(int32_t index, int32_t node);
+    int32_t erase(int32_t index, int64_t start, uint32_t id, bool& found);
+    int32_t detach_min(int32_t index, int32_t& min);
+    int32_t allocate(const Interval& interval);
+
+    std::vector<Node> nodes_;
+    std::vector<int32_t> free_;
+    int32_t root_ = kNil;
+    size_t size_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // CALENDAR_INTERVAL_TREE_HPP
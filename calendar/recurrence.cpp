@@ -0,0 +1,79 @@
+#include "recurrence.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+// Howard Hinnant's civil calendar algorithms: exact for the proleptic
+// Gregorian calendar, with no table lookups or loops.
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = floor_div(year, 400);
+    const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+void civil_from_days(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = floor_div(days, 146097);
+    const unsigned day_of_era = static_cast<unsigned>(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned mp = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2);
+}
+
+unsigned days_in_month(int64_t year, unsigned month) {
+    static const unsigned kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+        return 29;
+    }
+    return kDays[month - 1];
+}
+
+Recurrence::Recurrence(int64_t first_start, int64_t duration, const RecurrenceRule& rule)
+    : first_start_(first_start), duration_(duration > 0 ? duration : 0), rule_(rule),
+      last_start_(rule.until) {
+    if (rule_.interval == 0) rule_.interval = 1;
+    int64_t day_number = floor_div(first_start_, kSecondsPerDay);
+    time_of_day_ = first_start_ - day_number * kSecondsPerDay;
+    // 1970-01-01 was a Thursday (weekday 3 counting from Monday = 0).
+    int64_t weekday = day_number + 3 - floor_div(day_number + 3, 7) * 7;
+    first_monday_ = day_number - weekday;
+    int64_t year;
+    unsigned month;
+    civil_from_days(day_number, year, month, day_of_month_);
+    first_month_ = year * 12 + month - 1;
+    weekdays_ = rule_.weekdays & 0x7f;
+    if (weekdays_ == 0) {
+        weekdays_ = static_cast<uint8_t>(1u << weekday);
+    }
+
+    if (rule_.count > 0) {
+        // Walk the first `count` occurrences once so that expansion only ever
+        // needs an end bound. EXDATEs do not change which ones are counted.
+        uint32_t seen = 0;
+        int64_t last = first_start_ - 1;
+        for_each_start(first_start_, rule_.until, [&](int64_t start) {
+            last = start;
+            return ++seen < rule_.count;
+        });
+        last_start_ = last;
+    }
+}
+
+void Recurrence::exclude(int64_t start) {
+    auto it = std::lower_bound(excluded_.begin(), excluded_.end(), start);
+    if (it == excluded_.end() || *it != start) {
+        excluded_.insert(it, start);
+    }
+}
+
+bool Recurrence::is_excluded(int64_t start) const {
+    return !excluded_.empty() && std::binary_search(excluded_.begin(), excluded_.end(), start);
+}
+
+} // namespace Neurodeck
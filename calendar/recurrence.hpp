@@ -0,0 +1,141 @@
+#ifndef CALENDAR_RECURRENCE_HPP
+#define CALENDAR_RECURRENCE_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+// Calendar times are seconds since the Unix epoch. Recurrences step through
+// civil days, months and years in UTC.
+static const int64_t kSecondsPerDay = 86400;
+static const int64_t kForever = INT64_MAX;
+
+// Days since 1970-01-01 for a proleptic Gregorian date, and back.
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day);
+void civil_from_days(int64_t days, int64_t& year, unsigned& month, unsigned& day);
+unsigned days_in_month(int64_t year, unsigned month);
+
+enum class Frequency { Daily, Weekly, Monthly, Yearly };
+
+// A subset of RFC 5545 RRULE: FREQ, INTERVAL, BYDAY (weekly only), COUNT
+// and UNTIL. Monthly and yearly series keep the first occurrence's day of
+// the month; months (or years) without that day are skipped, as in RFC 5545.
+struct RecurrenceRule {
+    Frequency frequency = Frequency::Weekly;
+    uint32_t interval = 1;
+    uint8_t weekdays = 0;    // Weekly: bit 0 = Monday ... bit 6 = Sunday; 0 = the first occurrence's day
+    uint32_t count = 0;      // Total occurrences; 0 = no limit
+    int64_t until = kForever; // Latest allowed occurrence start (inclusive)
+};
+
+// One recurring series: the first occurrence, how long each occurrence
+// lasts, the rule and any cancelled occurrences.
+class Recurrence {
+public:
+    Recurrence(int64_t first_start, int64_t duration, const RecurrenceRule& rule);
+
+    int64_t first_start() const { return first_start_; }
+    int64_t duration() const { return duration_; }
+    // Start of the last occurrence (kForever for open-ended series). A COUNT
+    // is turned into this bound once, on construction.
+    int64_t last_start() const { return last_start_; }
+    const RecurrenceRule& rule() const { return rule_; }
+
+    // Cancels the occurrence starting at `start` (RFC 5545 EXDATE).
+    void exclude(int64_t start);
+
+    // Calls fn(start) for every occurrence overlapping [begin, end), in
+    // order. Occurrences before the window are skipped arithmetically rather
+    // than generated, so the cost depends on the window, not on how long the
+    // series has been running.
+    template <typename Fn>
+    void expand(int64_t begin, int64_t end, Fn&& fn) const {
+        // An occurrence overlaps when begin - duration < start < end.
+        int64_t low = begin > INT64_MIN + duration_ ? begin - duration_ + 1 : INT64_MIN;
+        low = low > first_start_ ? low : first_start_;
+        int64_t high = end - 1 < last_start_ ? end - 1 : last_start_;
+        if (low > high) {
+            return;
+        }
+        for_each_start(low, high, [&](int64_t start) {
+            if (!is_excluded(start)) fn(start);
+            return true;
+        });
+    }
+
+private:
+    // Calls fn(start) for candidate starts in [low, high] until it returns false.
+    template <typename Fn>
+    void for_each_start(int64_t low, int64_t high, Fn&& fn) const;
+    bool is_excluded(int64_t start) const;
+
+    int64_t first_start_;
+    int64_t duration_;
+    RecurrenceRule rule_;
+    int64_t last_start_;
+    int64_t time_of_day_;  // Seconds after midnight of first_start_
+    int64_t first_monday_; // Day number of the Monday on or before first_start_
+    int64_t first_month_;  // year * 12 + month - 1 of first_start_
+    unsigned day_of_month_;
+    uint8_t weekdays_;     // rule_.weekdays, defaulted to the first day's weekday
+    std::vector<int64_t> excluded_; // Sorted
+};
+
+inline int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+template <typename Fn>
+void Recurrence::for_each_start(int64_t low, int64_t high, Fn&& fn) const {
+    const int64_t interval = rule_.interval;
+    switch (rule_.frequency) {
+    case Frequency::Daily: {
+        int64_t step = interval * kSecondsPerDay;
+        int64_t k = low > first_start_ ? floor_div(low - first_start_ + step - 1, step) : 0;
+        for (int64_t start = first_start_ + k * step; start <= high; start += step) {
+            if (!fn(start)) return;
+        }
+        return;
+    }
+    case Frequency::Weekly: {
+        // Periods of `interval` weeks, each starting on the Monday of the
+        // first occurrence's week.
+        int64_t base = first_monday_ * kSecondsPerDay + time_of_day_;
+        int64_t step = interval * 7 * kSecondsPerDay;
+        int64_t k = low > base ? floor_div(low - base, step) : 0;
+        for (int64_t period = base + k * step; period <= high; period += step) {
+            for (int weekday = 0; weekday < 7; ++weekday) {
+                if (!(weekdays_ & (1u << weekday))) continue;
+                int64_t start = period + weekday * kSecondsPerDay;
+                if (start > high) return;
+                if (start >= low && !fn(start)) return;
+            }
+        }
+        return;
+    }
+    case Frequency::Monthly:
+    case Frequency::Yearly: {
+        int64_t step = rule_.frequency == Frequency::Monthly ? interval : interval * 12;
+        int64_t year;
+        unsigned month, day;
+        civil_from_days(floor_div(low, kSecondsPerDay), year, month, day);
+        int64_t low_month = year * 12 + month - 1;
+        int64_t k = low_month > first_month_ ? (low_month - first_month_) / step : 0;
+        for (int64_t m = first_month_ + k * step;; m += step) {
+            int64_t y = floor_div(m, 12);
+            unsigned mon = static_cast<unsigned>(m - y * 12) + 1;
+            if (days_from_civil(y, mon, 1) * kSecondsPerDay + time_of_day_ > high) return;
+            if (day_of_month_ > days_in_month(y, mon)) continue;
+            int64_t start = days_from_civil(y, mon, day_of_month_) * kSecondsPerDay + time_of_day_;
+            if (start > high) return;
+            if (start >= low && !fn(start)) return;
+        }
+    }
+    }
+}
+
+} // namespace Neurodeck
+
+#endif // CALENDAR_RECURRENCE_HPP
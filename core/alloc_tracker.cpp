@@ -0,0 +1,199 @@
+#include "alloc_tracker.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace Neurodeck {
+
+namespace {
+
+struct TagSlot {
+    char name[48];
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> deallocations;
+    std::atomic<uint64_t> bytes;
+};
+
+// Fixed storage so that registering a tag never allocates. Slot 0 collects
+// tags that arrive after the table is full.
+TagSlot g_tags[AllocScope::kMaxTags + 1];
+int g_tag_count = 0;
+std::mutex g_tags_mutex;
+
+// Trivially constructible, so accessing it from operator new does not run a
+// TLS initialiser (which could itself allocate).
+struct ThreadState {
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t bytes;
+    TagSlot* tag;
+};
+thread_local ThreadState t_state;
+
+TagSlot* find_or_add_tag(const char* tag) {
+    std::lock_guard<std::mutex> lock(g_tags_mutex);
+    for (int i = 1; i <= g_tag_count; ++i) {
+        if (std::strncmp(g_tags[i].name, tag, sizeof(g_tags[i].name) - 1) == 0) return &g_tags[i];
+    }
+    if (g_tag_count == AllocScope::kMaxTags) {
+        if (g_tags[0].name[0] == '\0') std::strcpy(g_tags[0].name, "(other)");
+        return &g_tags[0];
+    }
+    TagSlot& slot = g_tags[++g_tag_count];
+    std::strncpy(slot.name, tag, sizeof(slot.name) - 1);
+    slot.name[sizeof(slot.name) - 1] = '\0';
+    return &slot;
+}
+
+inline void note_allocation(std::size_t size) {
+    ThreadState& state = t_state;
+    ++state.allocations;
+    state.bytes += size;
+    if (state.tag) {
+        state.tag->allocations.fetch_add(1, std::memory_order_relaxed);
+        state.tag->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+inline void note_deallocation(void* ptr) {
+    if (!ptr) return;
+    ThreadState& state = t_state;
+    ++state.deallocations;
+    if (state.tag) state.tag->deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* tracked_alloc(std::size_t size) {
+    if (size == 0) size = 1;
+    void* ptr = std::malloc(size);
+    if (ptr) note_allocation(size);
+    return ptr;
+}
+
+void* tracked_aligned_alloc(std::size_t size, std::size_t alignment) {
+    if (size == 0) size = 1;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) != 0) return nullptr;
+    note_allocation(size);
+    return ptr;
+}
+
+void* throwing_alloc(std::size_t size) {
+    for (;;) {
+        if (void* ptr = tracked_alloc(size)) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* throwing_aligned_alloc(std::size_t size, std::size_t alignment) {
+    for (;;) {
+        if (void* ptr = tracked_aligned_alloc(size, alignment)) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void tracked_free(void* ptr) {
+    note_deallocation(ptr);
+    std::free(ptr);
+}
+
+} // namespace
+
+AllocCounts AllocTracker::thread_counts() {
+    AllocCounts counts;
+    counts.allocations = t_state.allocations;
+    counts.deallocations = t_state.deallocations;
+    counts.bytes = t_state.bytes;
+    return counts;
+}
+
+AllocCounts AllocTracker::tag_counts(const char* tag) {
+    AllocCounts counts;
+    std::lock_guard<std::mutex> lock(g_tags_mutex);
+    for (int i = 0; i <= g_tag_count; ++i) {
+        if (std::strncmp(g_tags[i].name, tag, sizeof(g_tags[i].name) - 1) == 0) {
+            counts.allocations = g_tags[i].allocations.load(std::memory_order_relaxed);
+            counts.deallocations = g_tags[i].deallocations.load(std::memory_order_relaxed);
+            counts.bytes = g_tags[i].bytes.load(std::memory_order_relaxed);
+            break;
+        }
+    }
+    return counts;
+}
+
+void AllocTracker::write_report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(g_tags_mutex);
+    for (int i = 0; i <= g_tag_count; ++i) {
+        const TagSlot& slot = g_tags[i];
+        if (slot.name[0] == '\0') continue;
+        out << slot.name << ": " << slot.allocations.load(std::memory_order_relaxed) << " allocations, "
+            << slot.bytes.load(std::memory_order_relaxed) << " bytes, "
+            << slot.deallocations.load(std::memory_order_relaxed) << " deallocations\n";
+    }
+}
+
+void AllocTracker::reset_tags() {
+    std::lock_guard<std::mutex> lock(g_tags_mutex);
+    for (int i = 0; i <= g_tag_count; ++i) {
+        g_tags[i].allocations.store(0, std::memory_order_relaxed);
+        g_tags[i].deallocations.store(0, std::memory_order_relaxed);
+        g_tags[i].bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+AllocScope::AllocScope(const char* tag)
+    : previous_tag_(t_state.tag), start_(AllocTracker::thread_counts()) {
+    t_state.tag = find_or_add_tag(tag);
+}
+
+AllocScope::~AllocScope() {
+    t_state.tag = static_cast<TagSlot*>(previous_tag_);
+}
+
+AllocCounts AllocScope::counts() const {
+    AllocCounts now = AllocTracker::thread_counts();
+    now.allocations -= start_.allocations;
+    now.deallocations -= start_.deallocations;
+    now.bytes -= start_.bytes;
+    return now;
+}
+
+} // namespace Neurodeck
+
+// Replacement global allocation functions ([new.delete]). Defining them in
+// this translation unit means they are linked whenever the tracker API is.
+void* operator new(std::size_t size) { return Neurodeck::throwing_alloc(size); }
+void* operator new[](std::size_t size) { return Neurodeck::throwing_alloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return Neurodeck::tracked_alloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return Neurodeck::tracked_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return Neurodeck::throwing_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return Neurodeck::throwing_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Neurodeck::tracked_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Neurodeck::tracked_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { Neurodeck::tracked_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { Neurodeck::tracked_free(ptr); }
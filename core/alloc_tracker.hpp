@@ -0,0 +1,61 @@
+#ifndef CORE_ALLOC_TRACKER_HPP
+#define CORE_ALLOC_TRACKER_HPP
+
+#include <cstdint>
+#include <ostream>
+
+namespace Neurodeck {
+
+// Heap activity counters.
+struct AllocCounts {
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytes = 0; // Bytes requested by the allocations.
+};
+
+// Opt-in heap accounting.
+//
+// Linking the core_alloc_tracking library replaces the global operator
+// new/delete with versions that count every allocation per thread and, while
+// an AllocScope is active, attribute it to the scope's tag. Nothing here
+// allocates, so the hooks never recurse. Binaries that do not link the
+// library keep the standard allocator untouched.
+class AllocTracker {
+public:
+    // Totals for the calling thread since it started.
+    static AllocCounts thread_counts();
+
+    // Totals attributed to `tag` across all threads.
+    static AllocCounts tag_counts(const char* tag);
+
+    // One line per tag: allocations, bytes and deallocations.
+    static void write_report(std::ostream& out);
+
+    // Forgets all per-tag totals.
+    static void reset_tags();
+};
+
+// Attributes allocations made on this thread to `tag` for the lifetime of
+// the scope. Scopes nest; the innermost tag wins. At most kMaxTags distinct
+// tags are tracked, further tags are counted under "(other)".
+class AllocScope {
+public:
+    static const int kMaxTags = 128;
+
+    explicit AllocScope(const char* tag);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+    // Heap activity on this thread since the scope was entered.
+    AllocCounts counts() const;
+
+private:
+    void* previous_tag_;
+    AllocCounts start_;
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_ALLOC_TRACKER_HPP
@@ -0,0 +1,408 @@
+#include "history_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <unordered_set>
+#include <fcntl.h>    // For open()
+#include <sys/file.h> // For flock()
+#include <sys/mman.h> // For mmap()
+#include <sys/stat.h> // For fstat()
+#include <unistd.h>   // For write(), pread(), close()
+
+namespace Neurodeck {
+
+namespace {
+
+// "NDHIST01": identifies the file and its on-disk format version.
+const char kFileMagic[8] = {'N', 'D', 'H', 'I', 'S', 'T', '0', '1'};
+const size_t kFileHeaderSize = sizeof(kFileMagic);
+const uint32_t kRecordMagic = 0x5248444e; // "NDHR" in little-endian byte order
+const uint32_t kNoEntry = UINT32_MAX;
+
+// Grow the mapping in large steps so that a busy log is not remapped on
+// every append.
+const size_t kMapGranularity = 1u << 20;
+
+// No command comes near this; a header claiming more is corrupt rather
+// than a record still being written.
+const size_t kMaxRecordLength = 16u << 20;
+
+// Fixed header in front of every record. The payload (cwd, then command)
+// follows immediately and the whole record is padded to 8 bytes so that
+// headers stay aligned inside the mapping.
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;         // Header + payload + padding
+    int64_t timestamp;
+    int64_t duration_us;
+    int32_t exit_status;
+    uint32_t cwd_length;
+    uint32_t command_length;
+    uint32_t checksum;       // FNV-1a over the payload
+};
+static_assert(sizeof(RecordHeader) == 40, "RecordHeader layout is part of the file format");
+
+uint32_t fnv1a(const char* data, size_t length, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Distinct trigrams of a string, sorted. Each byte triple is packed into the
+// low 24 bits of a uint32_t.
+void collect_trigrams(const char* text, size_t length, std::vector<uint32_t>& out) {
+    out.clear();
+    if (length < 3) {
+        return;
+    }
+    out.reserve(length - 2);
+    for (size_t i = 0; i + 2 < length; ++i) {
+        out.push_back((static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16) |
+                      (static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8) |
+                      static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+RecordHeader read_header(const char* record) {
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    return header;
+}
+
+std::string_view command_of(const char* record) {
+    RecordHeader header = read_header(record);
+    return std::string_view(record + sizeof(RecordHeader) + header.cwd_length, header.command_length);
+}
+
+} // namespace
+
+HistoryStore::HistoryStore(size_t max_indexed_entries)
+    : max_indexed_entries_(max_indexed_entries == 0 ? 1 : max_indexed_entries) {}
+
+HistoryStore::~HistoryStore() {
+    close();
+}
+
+bool HistoryStore::open(const std::string& filename) {
+    close();
+
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    // Two sessions may race to create the log; the lock makes sure only one
+    // of them writes the file header.
+    flock(fd_, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd_, &st) == 0;
+    if (ok && st.st_size == 0) {
+        ok = ::write(fd_, kFileMagic, kFileHeaderSize) == static_cast<ssize_t>(kFileHeaderSize);
+    }
+    flock(fd_, LOCK_UN);
+
+    char magic[kFileHeaderSize];
+    if (!ok || pread(fd_, magic, kFileHeaderSize, 0) != static_cast<ssize_t>(kFileHeaderSize) ||
+        std::memcmp(magic, kFileMagic, kFileHeaderSize) != 0) {
+        close();
+        return false;
+    }
+
+    parsed_size_ = kFileHeaderSize;
+    refresh();
+    return true;
+}
+
+void HistoryStore::close() {
+    if (map_) {
+        munmap(const_cast<char*>(map_), map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    map_size_ = 0;
+    file_size_ = 0;
+    parsed_size_ = 0;
+    first_id_ = 0;
+    offsets_.clear();
+    postings_.clear();
+    stale_postings_ = 0;
+    live_postings_ = 0;
+}
+
+bool HistoryStore::append(const std::string& command, const std::string& cwd, int exit_status,
+                          int64_t duration_us, int64_t timestamp) {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    size_t payload = cwd.size() + command.size();
+    size_t length = (sizeof(RecordHeader) + payload + 7) & ~static_cast<size_t>(7);
+    if (length > kMaxRecordLength) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.magic = kRecordMagic;
+    header.length = static_cast<uint32_t>(length);
+    header.timestamp = timestamp;
+    header.duration_us = duration_us;
+    header.exit_status = exit_status;
+    header.cwd_length = static_cast<uint32_t>(cwd.size());
+    header.command_length = static_cast<uint32_t>(command.size());
+    header.checksum = fnv1a(command.data(), command.size(), fnv1a(cwd.data(), cwd.size()));
+
+    std::string record(length, '\0');
+    std::memcpy(&record[0], &header, sizeof(header));
+    std::memcpy(&record[sizeof(header)], cwd.data(), cwd.size());
+    std::memcpy(&record[sizeof(header) + cwd.size()], command.data(), command.size());
+
+    // A single write on an O_APPEND descriptor lands as one contiguous record
+    // even when other sessions are appending at the same time. The lock tells
+    // readers whether a short record at the end is still being written, and
+    // lets a torn tail be padded out first so that records stay aligned.
+    flock(fd_, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd_, &st) == 0;
+    size_t misalignment = ok ? static_cast<size_t>(st.st_size) % 8 : 0;
+    if (misalignment != 0) {
+        const char padding[8] = {};
+        ok = ::write(fd_, padding, 8 - misalignment) == static_cast<ssize_t>(8 - misalignment);
+    }
+    ok = ok && ::write(fd_, record.data(), record.size()) == static_cast<ssize_t>(record.size());
+    flock(fd_, LOCK_UN);
+    return ok;
+}
+
+bool HistoryStore::append(const std::string& command, const std::string& cwd, int exit_status,
+                          int64_t duration_us) {
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return append(command, cwd, exit_status, duration_us, now);
+}
+
+bool HistoryStore::remap(size_t min_size) {
+    size_t new_size = (min_size + kMapGranularity - 1) / kMapGranularity * kMapGranularity;
+    void* mapped = mmap(nullptr, new_size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    if (map_) {
+        munmap(const_cast<char*>(map_), map_size_);
+    }
+    map_ = static_cast<const char*>(mapped);
+    map_size_ = new_size;
+    return true;
+}
+
+size_t HistoryStore::refresh() {
+    if (fd_ < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        return 0;
+    }
+    file_size_ = static_cast<size_t>(st.st_size);
+    if (file_size_ > map_size_ && !remap(file_size_)) {
+        return 0;
+    }
+
+    size_t added = 0;
+    while (parsed_size_ + sizeof(RecordHeader) <= file_size_) {
+        const char* record = map_ + parsed_size_;
+        RecordHeader header = read_header(record);
+        bool framed = header.magic == kRecordMagic && header.length >= sizeof(RecordHeader) &&
+                      header.length <= kMaxRecordLength && header.length % 8 == 0 &&
+                      sizeof(RecordHeader) + static_cast<uint64_t>(header.cwd_length) +
+                              header.command_length <= header.length;
+        if (framed && parsed_size_ + header.length > file_size_) {
+            if (!torn_tail(parsed_size_ + header.length)) {
+                break; // Record still being written; pick it up next time.
+            }
+            // Its writer died; the next append pads up to here.
+            parsed_size_ = (file_size_ + 7) & ~static_cast<size_t>(7);
+            break;
+        }
+        const char* payload = record + sizeof(RecordHeader);
+        if (!framed || fnv1a(payload + header.cwd_length, header.command_length,
+                             fnv1a(payload, header.cwd_length)) != header.checksum) {
+            // A torn write left garbage behind; resynchronise on the next
+            // aligned record header.
+            parsed_size_ += 8;
+            continue;
+        }
+
+        uint32_t id = end_id();
+        offsets_.push_back(parsed_size_);
+        index_entry(id, payload + header.cwd_length, header.command_length);
+        if (offsets_.size() > max_indexed_entries_) {
+            evict_oldest();
+        }
+        parsed_size_ += header.length;
+        ++added;
+    }
+    return added;
+}
+
+bool HistoryStore::torn_tail(size_t record_end) {
+    // Appends hold the lock, so if it is free the record is as long as it
+    // will ever get. It may have been finished since the caller looked.
+    if (flock(fd_, LOCK_SH | LOCK_NB) != 0) {
+        return false;
+    }
+    struct stat st;
+    bool torn = fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) < record_end;
+    flock(fd_, LOCK_UN);
+    return torn;
+}
+
+void HistoryStore::index_entry(uint32_t id, const char* command, size_t length) {
+    std::vector<uint32_t> trigrams;
+    collect_trigrams(command, length, trigrams);
+    for (uint32_t trigram : trigrams) {
+        postings_[trigram].push_back(id);
+    }
+    live_postings_ += trigrams.size();
+}
+
+void HistoryStore::evict_oldest() {
+    std::string_view command = command_of(record_at(first_id_));
+    std::vector<uint32_t> trigrams;
+    collect_trigrams(command.data(), command.size(), trigrams);
+    live_postings_ -= trigrams.size();
+    stale_postings_ += trigrams.size();
+
+    offsets_.pop_front();
+    ++first_id_;
+
+    // Trimming every list on each eviction would be quadratic; instead drop
+    // the stale prefixes in one sweep once they outweigh the live postings.
+    if (stale_postings_ > live_postings_) {
+        compact_postings();
+    }
+}
+
+void HistoryStore::compact_postings() {
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        std::vector<uint32_t>& ids = it->second;
+        ids.erase(ids.begin(), std::lower_bound(ids.begin(), ids.end(), first_id_));
+        if (ids.empty()) {
+            it = postings_.erase(it);
+        } else {
+            if (ids.capacity() > 2 * ids.size()) {
+                ids.shrink_to_fit();
+            }
+            ++it;
+        }
+    }
+    stale_postings_ = 0;
+}
+
+const char* HistoryStore::record_at(uint32_t id) const {
+    return map_ + offsets_[id - first_id_];
+}
+
+bool HistoryStore::command_contains(uint32_t id, const std::string& query) const {
+    return command_of(record_at(id)).find(query) != std::string_view::npos;
+}
+
+bool HistoryStore::get(uint32_t id, Entry& out) const {
+    if (id < first_id_ || id >= end_id()) {
+        return false;
+    }
+    const char* record = record_at(id);
+    RecordHeader header = read_header(record);
+    const char* payload = record + sizeof(RecordHeader);
+    out.id = id;
+    out.timestamp = header.timestamp;
+    out.duration_us = header.duration_us;
+    out.exit_status = header.exit_status;
+    out.cwd.assign(payload, header.cwd_length);
+    out.command.assign(payload + header.cwd_length, header.command_length);
+    return true;
+}
+
+uint32_t HistoryStore::previous_candidate(const std::string& query, uint32_t before_id) const {
+    before_id = std::min(before_id, end_id());
+    if (before_id <= first_id_) {
+        return kNoEntry;
+    }
+
+    if (query.size() < 3) {
+        // Too short to have a trigram; fall back to a backwards scan.
+        for (uint32_t id = before_id; id-- > first_id_;) {
+            if (command_contains(id, query)) {
+                return id;
+            }
+        }
+        return kNoEntry;
+    }
+
+    std::vector<uint32_t> trigrams;
+    collect_trigrams(query.data(), query.size(), trigrams);
+    std::vector<const std::vector<uint32_t>*> lists;
+    lists.reserve(trigrams.size());
+    for (uint32_t trigram : trigrams) {
+        auto it = postings_.find(trigram);
+        if (it == postings_.end()) {
+            return kNoEntry;
+        }
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+
+    // Walk the rarest trigram's list from newest to oldest and confirm each
+    // candidate against the other lists, then against the actual text
+    // (trigrams alone cannot prove adjacency).
+    const std::vector<uint32_t>& rarest = *lists.front();
+    auto it = std::lower_bound(rarest.begin(), rarest.end(), before_id);
+    while (it != rarest.begin()) {
+        uint32_t id = *--it;
+        if (id < first_id_) {
+            break;
+        }
+        bool in_all = true;
+        for (size_t i = 1; i < lists.size() && in_all; ++i) {
+            in_all = std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+        }
+        if (in_all && command_contains(id, query)) {
+            return id;
+        }
+    }
+    return kNoEntry;
+}
+
+bool HistoryStore::find_previous(const std::string& query, uint32_t before_id, Entry& out) const {
+    uint32_t id = previous_candidate(query, before_id);
+    return id != kNoEntry && get(id, out);
+}
+
+std::vector<HistoryStore::Entry> HistoryStore::search(const std::string& query, size_t max_results) const {
+    std::vector<Entry> results;
+    std::unordered_set<std::string_view> seen;
+    uint32_t before_id = end_id();
+    while (results.size() < max_results) {
+        uint32_t id = previous_candidate(query, before_id);
+        if (id == kNoEntry) {
+            break;
+        }
+        before_id = id;
+        if (!seen.insert(command_of(record_at(id))).second) {
+            continue; // Only the newest occurrence of a command is reported.
+        }
+        results.emplace_back();
+        get(id, results.back());
+    }
+    return results;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,105 @@
+#ifndef CORE_HISTORY_STORE_HPP
+#define CORE_HISTORY_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Persistent command history shared by every shell session on the machine.
+//
+// The backing file is an append-only log of fixed-header records. Each session
+// appends with a single O_APPEND write, so concurrent sessions never interleave
+// records, and reads the log through a read-only shared mapping. A trigram
+// index over the most recent entries is kept up to date incrementally as the
+// log grows, which makes reverse substring search (Ctrl-R) independent of the
+// total history size.
+class HistoryStore {
+public:
+    // One history record as seen by callers.
+    struct Entry {
+        uint32_t id = 0;           // Position of the record in the log (0 = oldest).
+        int64_t timestamp = 0;     // Seconds since the Unix epoch.
+        int64_t duration_us = 0;   // Wall-clock run time of the command.
+        int32_t exit_status = 0;
+        std::string cwd;
+        std::string command;
+    };
+
+    // Only the newest max_indexed_entries records are kept searchable; older
+    // ones stay in the file but are dropped from memory, bounding RSS.
+    static constexpr size_t kDefaultMaxIndexedEntries = 1u << 20;
+
+    explicit HistoryStore(size_t max_indexed_entries = kDefaultMaxIndexedEntries);
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Opens (creating if needed) the history log and indexes its contents.
+    // Returns false if the file cannot be opened or is not a history log.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Appends one record atomically. The new entry (and anything other
+    // sessions appended meanwhile) becomes visible after the next refresh().
+    bool append(const std::string& command, const std::string& cwd, int exit_status,
+                int64_t duration_us, int64_t timestamp);
+    // Same as above, stamped with the current time.
+    bool append(const std::string& command, const std::string& cwd, int exit_status,
+                int64_t duration_us);
+
+    // Picks up records appended since the last call, by this or any other
+    // session. Returns the number of new entries.
+    size_t refresh();
+
+    // Ids of the searchable window are [first_id(), end_id()).
+    uint32_t first_id() const { return first_id_; }
+    uint32_t end_id() const { return first_id_ + static_cast<uint32_t>(offsets_.size()); }
+    size_t size() const { return offsets_.size(); }
+
+    // Fetches one entry. Returns false if id is outside the searchable window.
+    bool get(uint32_t id, Entry& out) const;
+
+    // Finds the newest entry with id < before_id whose command contains query.
+    // Pass end_id() to start from the newest entry. Returns false if none match.
+    bool find_previous(const std::string& query, uint32_t before_id, Entry& out) const;
+
+    // Returns up to max_results distinct commands containing query, newest first.
+    std::vector<Entry> search(const std::string& query, size_t max_results) const;
+
+private:
+    const char* record_at(uint32_t id) const;
+    bool command_contains(uint32_t id, const std::string& query) const;
+    bool remap(size_t min_size);
+    bool torn_tail(size_t record_end);
+    void index_entry(uint32_t id, const char* command, size_t length);
+    void evict_oldest();
+    void compact_postings();
+    uint32_t previous_candidate(const std::string& query, uint32_t before_id) const;
+
+    size_t max_indexed_entries_;
+    int fd_ = -1;
+    const char* map_ = nullptr;
+    size_t map_size_ = 0;        // Length of the mapping; may run past EOF.
+    size_t file_size_ = 0;
+    size_t parsed_size_ = 0;     // Bytes of the log already turned into entries.
+
+    uint32_t first_id_ = 0;
+    std::deque<uint64_t> offsets_; // File offset of each entry in the window.
+
+    // Trigram -> ascending ids of the entries containing it. Ids below
+    // first_id_ are stale and trimmed lazily by compact_postings().
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;
+    size_t stale_postings_ = 0;
+    size_t live_postings_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_HISTORY_STORE_HPP
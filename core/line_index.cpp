@@ -0,0 +1,149 @@
+#include "line_index.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Neurodeck {
+
+namespace {
+
+const size_t kReadSize = 1 << 20;
+// How often a followed file is checked for growth once fully indexed.
+const std::chrono::milliseconds kFollowInterval(200);
+
+} // namespace
+
+LineIndex::LineIndex(uint64_t stride) : stride_(stride ? stride : 1) {
+    checkpoints_.push_back(0);
+}
+
+LineIndex::~LineIndex() {
+    stop();
+}
+
+bool LineIndex::start(const std::string& filename, bool follow) {
+    stop();
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reset_locked();
+    }
+    stopping_.store(false);
+    thread_ = std::thread(&LineIndex::run, this, fd, follow);
+    return true;
+}
+
+void LineIndex::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_.store(true);
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void LineIndex::reset_locked() {
+    checkpoints_.assign(1, 0);
+    indexed_bytes_.store(0, std::memory_order_release);
+    newlines_.store(0, std::memory_order_release);
+    at_end_.store(false, std::memory_order_release);
+}
+
+void LineIndex::run(int fd, bool follow) {
+    std::vector<char> buffer(kReadSize);
+    uint64_t offset = 0;
+    uint64_t newlines = 0;
+    std::vector<uint64_t> found; // Checkpoints from the current chunk.
+
+    while (!stopping_.load()) {
+        ssize_t n = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+        if (n > 0) {
+            const char* begin = buffer.data();
+            const char* end = begin + n;
+            for (const char* p = begin; (p = static_cast<const char*>(std::memchr(p, '\n', end - p)));) {
+                ++p;
+                if (++newlines % stride_ == 0) {
+                    found.push_back(offset + static_cast<uint64_t>(p - begin));
+                }
+            }
+            offset += static_cast<uint64_t>(n);
+            std::lock_guard<std::mutex> lock(mutex_);
+            checkpoints_.insert(checkpoints_.end(), found.begin(), found.end());
+            found.clear();
+            newlines_.store(newlines, std::memory_order_release);
+            indexed_bytes_.store(offset, std::memory_order_release);
+            continue;
+        }
+        if (n < 0) {
+            break;
+        }
+
+        // Caught up with the end of the file.
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            at_end_.store(true, std::memory_order_release);
+        }
+        changed_.notify_all();
+        if (!follow) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait_for(lock, kFollowInterval, [this] { return stopping_.load(); });
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            break;
+        }
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        if (size < offset) {
+            // Truncated (e.g. log rotation by copytruncate): start over.
+            reset_locked();
+            offset = 0;
+            newlines = 0;
+        } else if (size > offset) {
+            at_end_.store(false, std::memory_order_release);
+        }
+    }
+    ::close(fd);
+}
+
+bool LineIndex::seek_line(uint64_t line, uint64_t& checkpoint_line, uint64_t& checkpoint_offset) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (line > newlines_.load(std::memory_order_acquire) && !at_end_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    uint64_t k = std::min<uint64_t>(line / stride_, checkpoints_.size() - 1);
+    checkpoint_line = k * stride_;
+    checkpoint_offset = checkpoints_[k];
+    return true;
+}
+
+bool LineIndex::seek_offset(uint64_t offset, uint64_t& checkpoint_line, uint64_t& checkpoint_offset) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (offset > indexed_bytes_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset);
+    size_t k = static_cast<size_t>(it - checkpoints_.begin()) - 1;
+    checkpoint_line = k * stride_;
+    checkpoint_offset = checkpoints_[k];
+    return true;
+}
+
+bool LineIndex::wait_until_end(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                      [this] { return at_end_.load(std::memory_order_acquire); });
+    return at_end_.load(std::memory_order_acquire);
+}
+
+} // namespace Neurodeck
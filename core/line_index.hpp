@@ -0,0 +1,75 @@
+#ifndef CORE_LINE_INDEX_HPP
+#define CORE_LINE_INDEX_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Neurodeck {
+
+// Sparse line-start index of a file, built by a background thread.
+//
+// Only every `stride`-th line start is recorded, so a multi-GB log with
+// hundreds of millions of lines needs a few hundred KB of index. To reach an
+// arbitrary line, callers take the nearest checkpoint and scan forward at most
+// stride - 1 newlines. The file is read with large sequential pread()s rather
+// than through a mapping, so indexing does not compete with a viewer's mapped
+// pages. With `follow`, the thread keeps watching the file and indexes data as
+// it is appended, starting over if the file is truncated.
+class LineIndex {
+public:
+    static const uint64_t kDefaultStride = 1024;
+
+    explicit LineIndex(uint64_t stride = kDefaultStride);
+    ~LineIndex();
+
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    // Starts indexing in the background. Returns false if the file cannot be
+    // opened.
+    bool start(const std::string& filename, bool follow);
+    void stop();
+
+    uint64_t stride() const { return stride_; }
+    // Bytes scanned so far and newlines among them.
+    uint64_t indexed_bytes() const { return indexed_bytes_.load(std::memory_order_acquire); }
+    uint64_t newline_count() const { return newlines_.load(std::memory_order_acquire); }
+    // True once the scan has caught up with the end of the file (it may
+    // become false again if a followed file grows).
+    bool at_end() const { return at_end_.load(std::memory_order_acquire); }
+
+    // Nearest checkpoint at or before `line` (0-based). Returns false if the
+    // scan has not reached that line yet.
+    bool seek_line(uint64_t line, uint64_t& checkpoint_line, uint64_t& checkpoint_offset) const;
+    // Nearest checkpoint at or before byte `offset`. Returns false if the scan
+    // has not reached that offset yet.
+    bool seek_offset(uint64_t offset, uint64_t& checkpoint_line, uint64_t& checkpoint_offset) const;
+
+    // Blocks until at_end() or `timeout_ms` elapses; returns at_end().
+    bool wait_until_end(int timeout_ms);
+
+private:
+    void run(int fd, bool follow);
+    void reset_locked();
+
+    const uint64_t stride_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> indexed_bytes_{0};
+    std::atomic<uint64_t> newlines_{0};
+    std::atomic<bool> at_end_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    // checkpoints_[k] is the offset of line k * stride_.
+    std::vector<uint64_t> checkpoints_;
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_LINE_INDEX_HPP
@@ -0,0 +1,129 @@
+#include "mapped_file.hpp"
+#include <csignal>    // For sigaction()
+#include <fcntl.h>    // For open()
+#include <mutex>      // For std::call_once()
+#include <sys/mman.h> // For mmap()
+#include <sys/stat.h> // For fstat()
+#include <unistd.h>   // For close()
+
+namespace Neurodeck {
+
+namespace {
+
+// The file the current thread is reading, and whether it faulted.
+thread_local MappedFile* accessing_file = nullptr;
+thread_local bool access_faulted = false;
+
+struct sigaction previous_sigbus_action;
+std::once_flag sigbus_handler_installed;
+
+void handle_sigbus(int signal_number, siginfo_t* info, void* context) {
+    MappedFile* file = accessing_file;
+    const char* address = static_cast<const char*>(info->si_addr);
+    if (file && address >= file->data() && address < file->data() + file->size()) {
+        // Replace the file with zero pages so the read can finish.
+        void* replaced = mmap(const_cast<char*>(file->data()), static_cast<size_t>(file->size()), PROT_READ,
+                              MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+        if (replaced != MAP_FAILED) {
+            access_faulted = true;
+            return;
+        }
+    }
+    // Not a read of ours: pass it on to whoever had the signal before.
+    if ((previous_sigbus_action.sa_flags & SA_SIGINFO) && previous_sigbus_action.sa_sigaction) {
+        previous_sigbus_action.sa_sigaction(signal_number, info, context);
+        return;
+    }
+    if (previous_sigbus_action.sa_handler != SIG_DFL && previous_sigbus_action.sa_handler != SIG_IGN) {
+        previous_sigbus_action.sa_handler(signal_number);
+        return;
+    }
+    sigaction(SIGBUS, &previous_sigbus_action, nullptr);
+    raise(signal_number);
+}
+
+void install_sigbus_handler() {
+    struct sigaction action = {};
+    action.sa_sigaction = handle_sigbus;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &previous_sigbus_action);
+}
+
+} // namespace
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+    fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode) || !map(static_cast<uint64_t>(st.st_size))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+    }
+    size_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool MappedFile::refresh() {
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || (static_cast<uint64_t>(st.st_size) == size_ && !faulted_)) {
+        return false;
+    }
+    return map(static_cast<uint64_t>(st.st_size));
+}
+
+bool MappedFile::map(uint64_t size) {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+    }
+    size_ = 0;
+    faulted_ = false;
+    if (size == 0) {
+        return true; // mmap() rejects empty mappings; an empty view is fine.
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const char*>(mapped);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::begin_access() {
+    std::call_once(sigbus_handler_installed, install_sigbus_handler);
+    accessing_file = this;
+    access_faulted = false;
+}
+
+bool MappedFile::end_access() {
+    accessing_file = nullptr;
+    if (access_faulted) {
+        faulted_ = true;
+    }
+    return !access_faulted;
+}
+
+} // namespace Neurodeck
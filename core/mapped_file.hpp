@@ -0,0 +1,57 @@
+#ifndef CORE_MAPPED_FILE_HPP
+#define CORE_MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace Neurodeck {
+
+// Read-only shared mapping of a whole file. Opening is O(1) regardless of the
+// file size: pages are faulted in only when touched. refresh() extends the
+// mapping when the file has grown, so callers can follow logs as they are
+// written.
+//
+// The file can also be truncated under us, and touching a mapped page past
+// its new end raises SIGBUS. Readers that cannot rule that out go between
+// begin_access() and end_access(): a SIGBUS inside that window maps zero
+// pages over the file instead of killing the process, and end_access()
+// reports it so the caller can refresh() and read again.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file cannot be opened, is not a regular file, or
+    // cannot be mapped.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Re-reads the file size and remaps if it changed, or if a read faulted
+    // since the last map. Returns true if the view changed. Pointers from
+    // data() are invalidated by a change.
+    bool refresh();
+
+    void begin_access();
+    // False if the file was truncated during the access; what was read past
+    // the new end is zeros until the next refresh().
+    bool end_access();
+
+    const char* data() const { return data_; }
+    uint64_t size() const { return size_; }
+
+private:
+    bool map(uint64_t size);
+
+    int fd_ = -1;
+    const char* data_ = nullptr;
+    uint64_t size_ = 0;
+    bool faulted_ = false; // The mapping was replaced by zero pages.
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_MAPPED_FILE_HPP
@@ -0,0 +1,528 @@
+#include "piece_table.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>     // For std::rename()
+#include <cstring>    // For memchr()
+#include <fcntl.h>    // For open()
+#include <unistd.h>   // For write(), fsync(), close()
+
+namespace Neurodeck {
+
+struct PieceTable::Piece {
+    uint64_t start = 0;
+    uint32_t length = 0;
+    bool in_file = false;       // Else in the add buffer
+    mutable int32_t newlines = -1; // -1 until counted
+};
+
+struct PieceTable::Node {
+    Piece piece;
+    NodePtr left;
+    NodePtr right;
+    uint64_t length;          // Bytes in this subtree
+    size_t pieces;            // Pieces in this subtree
+    int32_t height;
+    mutable int64_t newlines; // In this subtree; -1 until counted
+};
+
+namespace {
+
+int64_t count_newlines(const char* data, size_t length) {
+    int64_t count = 0;
+    const char* end = data + length;
+    while (data < end) {
+        const void* hit = std::memchr(data, '\n', static_cast<size_t>(end - data));
+        if (!hit) {
+            break;
+        }
+        data = static_cast<const char*>(hit) + 1;
+        ++count;
+    }
+    return count;
+}
+
+template <typename Ptr>
+int32_t height(const Ptr& node) {
+    return node ? node->height : 0;
+}
+
+template <typename Ptr>
+uint64_t length_of(const Ptr& node) {
+    return node ? node->length : 0;
+}
+
+bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+PieceTable::PieceTable() = default;
+PieceTable::~PieceTable() = default;
+
+// --- Tree primitives --------------------------------------------------------
+//
+// Nodes are immutable once built; every operation returns new nodes and
+// shares the untouched subtrees. join() and split() follow the join-based
+// formulation of AVL trees, each O(log n).
+
+PieceTable::NodePtr PieceTable::make(const NodePtr& left, const Piece& piece, const NodePtr& right) const {
+    auto node = std::make_shared<Node>();
+    node->piece = piece;
+    node->left = left;
+    node->right = right;
+    node->length = length_of(left) + piece.length + length_of(right);
+    node->pieces = (left ? left->pieces : 0) + 1 + (right ? right->pieces : 0);
+    node->height = std::max(height(left), height(right)) + 1;
+    int64_t left_newlines = left ? left->newlines : 0;
+    int64_t right_newlines = right ? right->newlines : 0;
+    node->newlines = left_newlines < 0 || right_newlines < 0 || piece.newlines < 0
+                         ? -1
+                         : left_newlines + piece.newlines + right_newlines;
+    return node;
+}
+
+PieceTable::NodePtr PieceTable::rotate_left(const NodePtr& node) const {
+    const NodePtr& right = node->right;
+    return make(make(node->left, node->piece, right->left), right->piece, right->right);
+}
+
+PieceTable::NodePtr PieceTable::rotate_right(const NodePtr& node) const {
+    const NodePtr& left = node->left;
+    return make(left->left, left->piece, make(left->right, node->piece, node->right));
+}
+
+PieceTable::NodePtr PieceTable::join_right(const NodePtr& left, const Piece& piece, const NodePtr& right) const {
+    const NodePtr& inner = left->right;
+    if (height(inner) <= height(right) + 1) {
+        NodePtr joined = make(inner, piece, right);
+        if (height(joined) <= height(left->left) + 1) {
+            return make(left->left, left->piece, joined);
+        }
+        return rotate_left(make(left->left, left->piece, rotate_right(joined)));
+    }
+    NodePtr joined = join_right(inner, piece, right);
+    NodePtr result = make(left->left, left->piece, joined);
+    return height(joined) <= height(left->left) + 1 ? result : rotate_left(result);
+}
+
+PieceTable::NodePtr PieceTable::join_left(const NodePtr& left, const Piece& piece, const NodePtr& right) const {
+    const NodePtr& inner = right->left;
+    if (height(inner) <= height(left) + 1) {
+        NodePtr joined = make(left, piece, inner);
+        if (height(joined) <= height(right->right) + 1) {
+            return make(joined, right->piece, right->right);
+        }
+        return rotate_right(make(rotate_left(joined), right->piece, right->right));
+    }
+    NodePtr joined = join_left(left, piece, inner);
+    NodePtr result = make(joined, right->piece, right->right);
+    return height(joined) <= height(right->right) + 1 ? result : rotate_right(result);
+}
+
+PieceTable::NodePtr PieceTable::join(const NodePtr& left, const Piece& piece, const NodePtr& right) const {
+    if (height(left) > height(right) + 1) {
+        return join_right(left, piece, right);
+    }
+    if (height(right) > height(left) + 1) {
+        return join_left(left, piece, right);
+    }
+    return make(left, piece, right);
+}
+
+PieceTable::NodePtr PieceTable::split_last(const NodePtr& node, Piece& last) const {
+    if (!node->right) {
+        last = node->piece;
+        return node->left;
+    }
+    NodePtr rest = split_last(node->right, last);
+    return join(node->left, node->piece, rest);
+}
+
+PieceTable::NodePtr PieceTable::concat(const NodePtr& left, const NodePtr& right) const {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    Piece last;
+    NodePtr rest = split_last(left, last);
+    return join(rest, last, right);
+}
+
+void PieceTable::split(const NodePtr& node, uint64_t offset, NodePtr& left, NodePtr& right) const {
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    uint64_t left_length = length_of(node->left);
+    if (offset <= left_length) {
+        NodePtr inner;
+        split(node->left, offset, left, inner);
+        right = join(inner, node->piece, node->right);
+        return;
+    }
+    offset -= left_length;
+    const Piece& piece = node->piece;
+    if (offset >= piece.length) {
+        NodePtr inner;
+        split(node->right, offset - piece.length, inner, right);
+        left = join(node->left, piece, inner);
+        return;
+    }
+    // The split point is inside this piece. Count newlines in the shorter
+    // half only; the other half's count follows from the piece's.
+    Piece head = piece;
+    Piece tail = piece;
+    head.length = static_cast<uint32_t>(offset);
+    tail.start += offset;
+    tail.length = piece.length - head.length;
+    head.newlines = tail.newlines = -1;
+    if (piece.newlines >= 0) {
+        const char* data = buffer(piece) + piece.start;
+        if (head.length <= tail.length) {
+            head.newlines = static_cast<int32_t>(count_newlines(data, head.length));
+            tail.newlines = piece.newlines - head.newlines;
+        } else {
+            tail.newlines = static_cast<int32_t>(count_newlines(data + head.length, tail.length));
+            head.newlines = piece.newlines - tail.newlines;
+        }
+    }
+    left = join(node->left, head, nullptr);
+    right = join(nullptr, tail, node->right);
+}
+
+PieceTable::NodePtr PieceTable::build(const std::vector<Piece>& pieces, size_t begin, size_t end) const {
+    if (begin >= end) {
+        return nullptr;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    return make(build(pieces, begin, middle), pieces[middle], build(pieces, middle + 1, end));
+}
+
+// --- Newline counts ---------------------------------------------------------
+
+const char* PieceTable::buffer(const Piece& piece) const {
+    return piece.in_file ? file_.data() : add_.data();
+}
+
+int64_t PieceTable::piece_newlines(const Piece& piece) const {
+    if (piece.newlines < 0) {
+        piece.newlines = static_cast<int32_t>(count_newlines(buffer(piece) + piece.start, piece.length));
+    }
+    return piece.newlines;
+}
+
+uint64_t PieceTable::newlines(const Node* node) const {
+    if (!node) {
+        return 0;
+    }
+    if (node->newlines < 0) {
+        node->newlines = static_cast<int64_t>(newlines(node->left.get()) + piece_newlines(node->piece) +
+                                              newlines(node->right.get()));
+    }
+    return static_cast<uint64_t>(node->newlines);
+}
+
+// Walks the subtree in order, passing `remaining` newlines. Subtrees whose
+// count is cached are skipped whole; the rest are scanned, and their counts
+// cached, only as far as the target, so finding an early line of a freshly
+// opened file reads just the start of it.
+bool PieceTable::seek_line(const Node* node, uint64_t& remaining, uint64_t& offset) const {
+    if (!node) {
+        return false;
+    }
+    if (node->newlines >= 0 && static_cast<uint64_t>(node->newlines) < remaining) {
+        remaining -= static_cast<uint64_t>(node->newlines);
+        offset += node->length;
+        return false;
+    }
+    if (seek_line(node->left.get(), remaining, offset)) {
+        return true;
+    }
+    const Piece& piece = node->piece;
+    if (piece.newlines >= 0 && static_cast<uint64_t>(piece.newlines) < remaining) {
+        remaining -= static_cast<uint64_t>(piece.newlines);
+    } else {
+        const char* data = buffer(piece) + piece.start;
+        const char* cursor = data;
+        const char* end = data + piece.length;
+        int32_t seen = 0;
+        while (const void* hit = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor))) {
+            cursor = static_cast<const char*>(hit) + 1;
+            ++seen;
+            if (--remaining == 0) {
+                offset += static_cast<uint64_t>(cursor - data);
+                return true;
+            }
+            if (cursor == end) {
+                break;
+            }
+        }
+        piece.newlines = seen;
+    }
+    offset += piece.length;
+    if (seek_line(node->right.get(), remaining, offset)) {
+        return true;
+    }
+    newlines(node); // Both children are counted by now; cache the sum.
+    return false;
+}
+
+// --- Public interface -------------------------------------------------------
+
+bool PieceTable::open(const std::string& filename) {
+    undo_.clear();
+    redo_.clear();
+    root_ = nullptr;
+    add_.clear();
+    if (!file_.open(filename)) {
+        return false;
+    }
+    std::vector<Piece> pieces;
+    for (uint64_t start = 0; start < file_.size(); start += kMaxPieceLength) {
+        Piece piece;
+        piece.start = start;
+        piece.length = static_cast<uint32_t>(std::min(kMaxPieceLength, file_.size() - start));
+        piece.in_file = true;
+        pieces.push_back(piece);
+    }
+    root_ = build(pieces, 0, pieces.size());
+    return true;
+}
+
+void PieceTable::assign(const std::string& text) {
+    undo_.clear();
+    redo_.clear();
+    root_ = nullptr;
+    file_.close();
+    add_.clear();
+    insert(0, text);
+    undo_.clear();
+}
+
+bool PieceTable::save(const std::string& filename) const {
+    std::string temp = filename + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    std::vector<const Node*> stack;
+    const Node* node = root_.get();
+    while (ok && (node || !stack.empty())) {
+        while (node) {
+            stack.push_back(node);
+            node = node->left.get();
+        }
+        node = stack.back();
+        stack.pop_back();
+        ok = write_all(fd, buffer(node->piece) + node->piece.start, node->piece.length);
+        node = node->right.get();
+    }
+    ok = ok && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), filename.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t PieceTable::size() const {
+    return length_of(root_);
+}
+
+uint64_t PieceTable::line_count() const {
+    return newlines(root_.get()) + 1;
+}
+
+size_t PieceTable::piece_count() const {
+    return root_ ? root_->pieces : 0;
+}
+
+void PieceTable::commit(NodePtr root) {
+    undo_.push_back(std::move(root_));
+    redo_.clear();
+    root_ = std::move(root);
+}
+
+void PieceTable::insert(uint64_t offset, const char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    offset = std::min(offset, size());
+    NodePtr left, right;
+    split(root_, offset, left, right);
+
+    uint64_t add_start = add_.size();
+    add_.append(data, length);
+    size_t consumed = 0;
+    // Typing appends to the add buffer right after the previous keystroke;
+    // growing that piece in place keeps the piece count from tracking the
+    // number of keystrokes.
+    if (left) {
+        Piece last;
+        NodePtr rest = split_last(left, last);
+        if (!last.in_file && last.start + last.length == add_start && last.length < kMaxPieceLength) {
+            consumed = static_cast<size_t>(std::min<uint64_t>(length, kMaxPieceLength - last.length));
+            last.length += static_cast<uint32_t>(consumed);
+            if (last.newlines >= 0) {
+                last.newlines += static_cast<int32_t>(count_newlines(data, consumed));
+            }
+            left = join(rest, last, nullptr);
+        }
+    }
+    std::vector<Piece> pieces;
+    for (size_t from = consumed; from < length; from += kMaxPieceLength) {
+        Piece piece;
+        piece.start = add_start + from;
+        piece.length = static_cast<uint32_t>(std::min<uint64_t>(kMaxPieceLength, length - from));
+        piece.newlines = static_cast<int32_t>(count_newlines(data + from, piece.length));
+        pieces.push_back(piece);
+    }
+    commit(concat(concat(left, build(pieces, 0, pieces.size())), right));
+}
+
+void PieceTable::erase(uint64_t offset, uint64_t length) {
+    uint64_t total = size();
+    offset = std::min(offset, total);
+    length = std::min(length, total - offset);
+    if (length == 0) {
+        return;
+    }
+    NodePtr left, rest, erased, right;
+    split(root_, offset, left, rest);
+    split(rest, length, erased, right);
+    commit(concat(left, right));
+}
+
+std::string PieceTable::text(uint64_t offset, uint64_t length) const {
+    std::string result;
+    uint64_t total = size();
+    offset = std::min(offset, total);
+    length = std::min(length, total - offset);
+    result.reserve(length);
+    // Descend to the piece holding `offset`, remembering the path, then walk
+    // in order until `length` bytes are collected.
+    std::vector<const Node*> stack;
+    const Node* node = root_.get();
+    uint64_t skip = offset;
+    while (node) {
+        uint64_t left_length = length_of(node->left);
+        if (skip < left_length) {
+            stack.push_back(node);
+            node = node->left.get();
+            continue;
+        }
+        skip -= left_length;
+        if (skip < node->piece.length) {
+            break;
+        }
+        skip -= node->piece.length;
+        node = node->right.get();
+    }
+    while (node && result.size() < length) {
+        const Piece& piece = node->piece;
+        uint64_t take = std::min<uint64_t>(piece.length - skip, length - result.size());
+        result.append(buffer(piece) + piece.start + skip, take);
+        skip = 0;
+        node = node->right.get();
+        while (node) {
+            stack.push_back(node);
+            node = node->left.get();
+        }
+        if (stack.empty()) {
+            break;
+        }
+        node = stack.back();
+        stack.pop_back();
+    }
+    return result;
+}
+
+uint64_t PieceTable::line_start(uint64_t line) const {
+    if (line == 0) {
+        return 0;
+    }
+    uint64_t remaining = line;
+    uint64_t offset = 0;
+    return seek_line(root_.get(), remaining, offset) ? offset : size();
+}
+
+uint64_t PieceTable::line_of(uint64_t offset) const {
+    offset = std::min(offset, size());
+    uint64_t line = 0;
+    const Node* node = root_.get();
+    while (node) {
+        uint64_t left_length = length_of(node->left);
+        if (offset < left_length) {
+            node = node->left.get();
+            continue;
+        }
+        line += newlines(node->left.get());
+        offset -= left_length;
+        const Piece& piece = node->piece;
+        if (offset < piece.length) {
+            return line + static_cast<uint64_t>(count_newlines(buffer(piece) + piece.start, offset));
+        }
+        line += static_cast<uint64_t>(piece_newlines(piece));
+        offset -= piece.length;
+        node = node->right.get();
+    }
+    return line;
+}
+
+std::string PieceTable::line(uint64_t line) const {
+    uint64_t start = line_start(line);
+    uint64_t end = line_start(line + 1);
+    std::string result = text(start, end - start);
+    if (!result.empty() && result.back() == '\n') {
+        result.pop_back();
+    }
+    return result;
+}
+
+bool PieceTable::undo() {
+    if (undo_.empty()) {
+        return false;
+    }
+    redo_.push_back(std::move(root_));
+    root_ = std::move(undo_.back());
+    undo_.pop_back();
+    return true;
+}
+
+bool PieceTable::redo() {
+    if (redo_.empty()) {
+        return false;
+    }
+    undo_.push_back(std::move(root_));
+    root_ = std::move(redo_.back());
+    redo_.pop_back();
+    return true;
+}
+
+PieceTable::Snapshot PieceTable::snapshot() const {
+    return Snapshot(root_);
+}
+
+void PieceTable::restore(const Snapshot& snapshot) {
+    if (snapshot.root_ != root_) {
+        commit(snapshot.root_);
+    }
+}
+
+} // namespace Neurodeck
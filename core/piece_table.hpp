@@ -0,0 +1,128 @@
+#ifndef CORE_PIECE_TABLE_HPP
+#define CORE_PIECE_TABLE_HPP
+
+#include "mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// Editable text buffer for large files.
+//
+// The opened file is mapped read-only and never copied; inserted text is
+// appended to an add buffer. The document is a sequence of pieces, each a
+// span of one of the two buffers, held in a persistent AVL tree: an edit
+// copies only the O(log n) nodes on its path and shares everything else with
+// the previous version. Every node caches its subtree's byte length and
+// newline count, so offset and line lookups are O(log n). Because old
+// versions stay intact, an undo or redo step just swaps the root pointer.
+//
+// Pieces are at most kMaxPieceLength bytes (the file is cut into that many
+// pieces when opened, which reads nothing), so splitting one on an edit
+// touches a bounded amount of text. Newline counts of file pieces are
+// computed the first time a lookup needs them and cached in the nodes.
+//
+// Not thread-safe, even for concurrent readers: lookups fill those caches.
+class PieceTable {
+    struct Node;
+
+public:
+    static constexpr uint64_t kMaxPieceLength = 64 * 1024;
+
+    // A saved document version; cheap to copy.
+    class Snapshot {
+    public:
+        Snapshot() = default;
+
+    private:
+        friend class PieceTable;
+        explicit Snapshot(std::shared_ptr<const Node> root) : root_(std::move(root)) {}
+        std::shared_ptr<const Node> root_;
+    };
+
+    PieceTable();
+    ~PieceTable();
+
+    PieceTable(const PieceTable&) = delete;
+    PieceTable& operator=(const PieceTable&) = delete;
+
+    // Maps `filename` as the new document, in O(size / kMaxPieceLength)
+    // without reading it. Clears the undo history. Returns false if the file
+    // cannot be mapped; the buffer is then empty.
+    bool open(const std::string& filename);
+    // Replaces the document with `text` and clears the undo history.
+    void assign(const std::string& text);
+    // Writes the document to `filename` through a temporary file and a
+    // rename, so the mapped original stays valid even if it is overwritten.
+    bool save(const std::string& filename) const;
+
+    uint64_t size() const;
+    // Lines are separated by '\n'; a trailing newline starts an empty last
+    // line, so an empty document has one line.
+    uint64_t line_count() const;
+    size_t piece_count() const;
+
+    // Offsets past the end are clamped.
+    void insert(uint64_t offset, const char* data, size_t length);
+    void insert(uint64_t offset, const std::string& text) { insert(offset, text.data(), text.size()); }
+    void erase(uint64_t offset, uint64_t length);
+
+    std::string text(uint64_t offset, uint64_t length) const;
+    std::string text() const { return text(0, size()); }
+    // Offset of the first byte of `line` (0-based), or size() if there are
+    // fewer lines.
+    uint64_t line_start(uint64_t line) const;
+    // Line containing byte `offset`.
+    uint64_t line_of(uint64_t offset) const;
+    // Contents of `line` without its newline.
+    std::string line(uint64_t line) const;
+
+    // Each insert() and erase() is one undo step. Both return false when
+    // there is nothing to undo or redo.
+    bool undo();
+    bool redo();
+    bool can_undo() const { return !undo_.empty(); }
+    bool can_redo() const { return !redo_.empty(); }
+
+    Snapshot snapshot() const;
+    // Returns to a snapshot taken from this buffer since the last open() or
+    // assign(). This is itself an undoable edit.
+    void restore(const Snapshot& snapshot);
+
+private:
+    using NodePtr = std::shared_ptr<const Node>;
+    struct Piece;
+
+    const char* buffer(const Piece& piece) const;
+    int64_t piece_newlines(const Piece& piece) const;
+    Piece sub_piece(const Piece& piece, uint64_t from, uint64_t length) const;
+    uint64_t newlines(const Node* node) const;
+    bool seek_line(const Node* node, uint64_t& remaining, uint64_t& offset) const;
+
+    NodePtr make(const NodePtr& left, const Piece& piece, const NodePtr& right) const;
+    NodePtr rotate_left(const NodePtr& node) const;
+    NodePtr rotate_right(const NodePtr& node) const;
+    NodePtr join(const NodePtr& left, const Piece& piece, const NodePtr& right) const;
+    NodePtr join_right(const NodePtr& left, const Piece& piece, const NodePtr& right) const;
+    NodePtr join_left(const NodePtr& left, const Piece& piece, const NodePtr& right) const;
+    NodePtr concat(const NodePtr& left, const NodePtr& right) const;
+    void split(const NodePtr& node, uint64_t offset, NodePtr& left, NodePtr& right) const;
+    NodePtr split_last(const NodePtr& node, Piece& last) const;
+    NodePtr build(const std::vector<Piece>& pieces, size_t begin, size_t end) const;
+
+    // Makes `root` the current version, as one undo step.
+    void commit(NodePtr root);
+
+    MappedFile file_;
+    std::string add_; // Append-only; pieces refer to it by offset.
+    NodePtr root_;
+    std::vector<NodePtr> undo_;
+    std::vector<NodePtr> redo_;
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_PIECE_TABLE_HPP
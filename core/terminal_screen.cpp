@@ -0,0 +1,283 @@
+#include "terminal_screen.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>   // For poll()
+#include <unistd.h> // For write()
+
+namespace Neurodeck {
+
+namespace {
+
+// Unchanged cells between two changed ones are rewritten rather than
+// skipped when the gap is shorter than a cursor-positioning sequence.
+const int kMaxRewriteGap = 4;
+
+void append_utf8(std::string& out, char32_t ch) {
+    if (ch < 0x80) {
+        out += static_cast<char>(ch);
+    } else if (ch < 0x800) {
+        out += static_cast<char>(0xc0 | (ch >> 6));
+        out += static_cast<char>(0x80 | (ch & 0x3f));
+    } else if (ch < 0x10000) {
+        out += static_cast<char>(0xe0 | (ch >> 12));
+        out += static_cast<char>(0x80 | ((ch >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (ch & 0x3f));
+    } else if (ch < 0x110000) {
+        out += static_cast<char>(0xf0 | (ch >> 18));
+        out += static_cast<char>(0x80 | ((ch >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((ch >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (ch & 0x3f));
+    } else {
+        out += '?';
+    }
+}
+
+// Decodes one code point at s[i], advancing i. Malformed input decodes to
+// U+FFFD one byte at a time.
+char32_t next_code_point(const std::string& s, size_t& i) {
+    unsigned char lead = static_cast<unsigned char>(s[i++]);
+    int extra = lead < 0x80 ? 0 : (lead & 0xe0) == 0xc0 ? 1 : (lead & 0xf0) == 0xe0 ? 2 : (lead & 0xf8) == 0xf0 ? 3 : -1;
+    if (extra < 0 || i + extra > s.size()) return 0xfffd;
+    char32_t ch = extra == 0 ? lead : lead & (0x3f >> extra);
+    for (int k = 0; k < extra; ++k) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if ((c & 0xc0) != 0x80) return 0xfffd;
+        ch = (ch << 6) | (c & 0x3f);
+        ++i;
+    }
+    return ch;
+}
+
+void append_color(std::string& out, int16_t color, bool foreground) {
+    if (color == Cell::kDefaultColor) {
+        out += foreground ? ";39" : ";49";
+    } else {
+        out += foreground ? ";38;5;" : ";48;5;";
+        out += std::to_string(color);
+    }
+}
+
+} // namespace
+
+ScreenBuffer::ScreenBuffer(int width, int height)
+    : width_(std::max(0, width)),
+      height_(std::max(0, height)),
+      cells_(static_cast<size_t>(width_) * height_),
+      dirty_(height_, 1) {}
+
+void ScreenBuffer::set(int x, int y, const Cell& cell) {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+    cells_[static_cast<size_t>(y) * width_ + x] = cell;
+    dirty_[y] = 1;
+}
+
+void ScreenBuffer::clear(const Cell& fill) {
+    std::fill(cells_.begin(), cells_.end(), fill);
+    mark_all_dirty();
+}
+
+void ScreenBuffer::clear_row(int y, const Cell& fill) {
+    if (y < 0 || y >= height_) return;
+    auto row = cells_.begin() + static_cast<size_t>(y) * width_;
+    std::fill(row, row + width_, fill);
+    dirty_[y] = 1;
+}
+
+int ScreenBuffer::put_text(int x, int y, const std::string& utf8, const Cell& style) {
+    if (y < 0 || y >= height_) return x;
+    Cell cell = style;
+    for (size_t i = 0; i < utf8.size() && x < width_;) {
+        cell.ch = next_code_point(utf8, i);
+        set(x++, y, cell);
+    }
+    return x;
+}
+
+void ScreenBuffer::mark_all_dirty() {
+    std::fill(dirty_.begin(), dirty_.end(), 1);
+}
+
+void ScreenBuffer::clear_dirty() {
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+}
+
+TerminalScreen::TerminalScreen(int out_fd, int width, int height)
+    : out_fd_(out_fd), front_(width, height), back_(width, height), min_frame_interval_(0) {}
+
+void TerminalScreen::resize(int width, int height) {
+    back_ = ScreenBuffer(width, height);
+    front_ = ScreenBuffer(width, height);
+    invalidate();
+}
+
+void TerminalScreen::invalidate() {
+    full_repaint_ = true;
+    term_x_ = term_y_ = -1;
+    term_style_known_ = false;
+}
+
+void TerminalScreen::set_max_fps(int fps) {
+    min_frame_interval_ = fps > 0
+        ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / fps
+        : std::chrono::steady_clock::duration(0);
+}
+
+void TerminalScreen::set_cursor(int x, int y, bool visible) {
+    cursor_x_ = x;
+    cursor_y_ = y;
+    cursor_visible_ = visible;
+}
+
+void TerminalScreen::enter_fullscreen() {
+    write_out("\x1b[?1049h");
+    invalidate();
+}
+
+void TerminalScreen::leave_fullscreen() {
+    write_out("\x1b[0m\x1b[?25h\x1b[?1049l");
+    term_cursor_visible_ = true;
+    invalidate();
+}
+
+int TerminalScreen::milliseconds_until_next_frame() const {
+    if (min_frame_interval_.count() == 0 || frames_presented_ == 0) return 0;
+    auto due = last_frame_ + min_frame_interval_;
+    auto now = std::chrono::steady_clock::now();
+    if (due <= now) return 0;
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()) + 1;
+}
+
+bool TerminalScreen::present() {
+    auto now = std::chrono::steady_clock::now();
+    if (frames_presented_ > 0 && now - last_frame_ < min_frame_interval_) {
+        pending_ = true;
+        ++frames_coalesced_;
+        return false;
+    }
+    // A terminal that has not drained the previous frame yet would only make
+    // us block in write(); let the damage pile up and send it all at once.
+    struct pollfd pfd = {out_fd_, POLLOUT, 0};
+    if (poll(&pfd, 1, 0) == 0) {
+        pending_ = true;
+        ++frames_coalesced_;
+        return false;
+    }
+
+    std::string body;
+    render_rows(body);
+
+    std::string out;
+    if (!body.empty()) {
+        // Hide the cursor while cells change so it does not flicker across
+        // the redraw.
+        if (term_cursor_visible_) out += "\x1b[?25l";
+        out += body;
+        term_cursor_visible_ = false;
+    }
+    if (cursor_visible_) {
+        move_cursor(out, cursor_x_, cursor_y_);
+        if (!term_cursor_visible_) out += "\x1b[?25h";
+        term_cursor_visible_ = true;
+    } else if (term_cursor_visible_) {
+        out += "\x1b[?25l";
+        term_cursor_visible_ = false;
+    }
+
+    if (!out.empty()) write_out(out);
+    back_.clear_dirty();
+    last_frame_ = now;
+    pending_ = false;
+    ++frames_presented_;
+    return true;
+}
+
+void TerminalScreen::render_rows(std::string& out) {
+    int width = back_.width();
+    int height = back_.height();
+    bool full = full_repaint_;
+    if (full) {
+        // Start from a known blank screen; blank cells then cost nothing.
+        out += "\x1b[0m\x1b[H\x1b[2J";
+        front_ = ScreenBuffer(width, height);
+        term_x_ = 0;
+        term_y_ = 0;
+        term_style_ = Cell();
+        term_style_known_ = true;
+        full_repaint_ = false;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        if (!full && !back_.row_dirty(y)) continue;
+        int x = 0;
+        while (x < width) {
+            if (back_.at(x, y) == front_.at(x, y)) {
+                ++x;
+                continue;
+            }
+            int last_changed = x;
+            for (int probe = x + 1; probe < width && probe - last_changed <= kMaxRewriteGap; ++probe) {
+                if (back_.at(probe, y) != front_.at(probe, y)) last_changed = probe;
+            }
+            move_cursor(out, x, y);
+            for (int i = x; i <= last_changed; ++i) {
+                const Cell& cell = back_.at(i, y);
+                apply_style(out, cell);
+                append_utf8(out, cell.ch);
+            }
+            term_x_ = last_changed + 1;
+            if (term_x_ >= width) term_x_ = -1; // Pending wrap: position is terminal-specific.
+            x = last_changed + 1;
+        }
+        auto row = back_.cells_.begin() + static_cast<size_t>(y) * width;
+        std::copy(row, row + width, front_.cells_.begin() + static_cast<size_t>(y) * width);
+    }
+}
+
+void TerminalScreen::move_cursor(std::string& out, int x, int y) {
+    if (term_x_ == x && term_y_ == y) return;
+    if (term_y_ == y && term_x_ >= 0 && x > term_x_) {
+        out += "\x1b[" + std::to_string(x - term_x_) + "C";
+    } else if (x == 0) {
+        out += "\x1b[" + std::to_string(y + 1) + "H";
+    } else {
+        out += "\x1b[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + "H";
+    }
+    term_x_ = x;
+    term_y_ = y;
+}
+
+void TerminalScreen::apply_style(std::string& out, const Cell& cell) {
+    if (term_style_known_ && cell.same_style(term_style_)) return;
+
+    std::string sgr;
+    bool reset = !term_style_known_ || (term_style_.attrs & ~cell.attrs) != 0;
+    uint8_t added = reset ? cell.attrs : static_cast<uint8_t>(cell.attrs & ~term_style_.attrs);
+    if (reset) sgr += ";0";
+    if (added & kAttrBold) sgr += ";1";
+    if (added & kAttrDim) sgr += ";2";
+    if (added & kAttrItalic) sgr += ";3";
+    if (added & kAttrUnderline) sgr += ";4";
+    if (added & kAttrReverse) sgr += ";7";
+    if (reset ? cell.fg != Cell::kDefaultColor : cell.fg != term_style_.fg) append_color(sgr, cell.fg, true);
+    if (reset ? cell.bg != Cell::kDefaultColor : cell.bg != term_style_.bg) append_color(sgr, cell.bg, false);
+
+    out += "\x1b[";
+    out.append(sgr, 1, std::string::npos);
+    out += 'm';
+    term_style_ = cell;
+    term_style_known_ = true;
+}
+
+void TerminalScreen::write_out(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(out_fd_, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+} // namespace Neurodeck
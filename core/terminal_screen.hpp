@@ -0,0 +1,146 @@
+#ifndef CORE_TERMINAL_SCREEN_HPP
+#define CORE_TERMINAL_SCREEN_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// Text attributes for a Cell, combined as a bit mask.
+enum CellAttr : uint8_t {
+    kAttrNone = 0,
+    kAttrBold = 1 << 0,
+    kAttrDim = 1 << 1,
+    kAttrItalic = 1 << 2,
+    kAttrUnderline = 1 << 3,
+    kAttrReverse = 1 << 4,
+};
+
+// One character cell. Colours are indices into the 256-colour palette, or
+// kDefaultColor for the terminal's own foreground/background.
+struct Cell {
+    static constexpr int16_t kDefaultColor = -1;
+
+    char32_t ch = U' ';
+    int16_t fg = kDefaultColor;
+    int16_t bg = kDefaultColor;
+    uint8_t attrs = kAttrNone;
+
+    bool same_style(const Cell& other) const {
+        return fg == other.fg && bg == other.bg && attrs == other.attrs;
+    }
+    bool operator==(const Cell& other) const { return ch == other.ch && same_style(other); }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+// A width x height grid of cells. Every mutation marks the touched rows
+// dirty so that TerminalScreen only has to compare those rows on present.
+class ScreenBuffer {
+public:
+    ScreenBuffer(int width = 0, int height = 0);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    const Cell& at(int x, int y) const { return cells_[static_cast<size_t>(y) * width_ + x]; }
+    // Out-of-range coordinates are ignored.
+    void set(int x, int y, const Cell& cell);
+
+    // Fills the whole buffer, or one row, with `fill`.
+    void clear(const Cell& fill = Cell());
+    void clear_row(int y, const Cell& fill = Cell());
+
+    // Writes UTF-8 text starting at (x, y) using `style` for colours and
+    // attributes, clipped to the row. Returns the column after the last cell.
+    int put_text(int x, int y, const std::string& utf8, const Cell& style = Cell());
+
+    bool row_dirty(int y) const { return dirty_[y] != 0; }
+    void mark_all_dirty();
+    void clear_dirty();
+
+private:
+    friend class TerminalScreen;
+
+    int width_;
+    int height_;
+    std::vector<Cell> cells_;
+    std::vector<uint8_t> dirty_;
+};
+
+// Double-buffered full-screen terminal output.
+//
+// Callers draw the next frame into back() and call present(). present()
+// compares the dirty rows of the back buffer with what is on screen, turns
+// the differences into the shortest cursor-move/SGR/text stream it can, and
+// writes it with a single write(). Frames are rate limited; a frame that
+// cannot be written yet (too soon, or the terminal is still draining the
+// previous one) is coalesced into the next.
+class TerminalScreen {
+public:
+    TerminalScreen(int out_fd, int width, int height);
+
+    ScreenBuffer& back() { return back_; }
+    int width() const { return back_.width(); }
+    int height() const { return back_.height(); }
+
+    // Changes the grid size; the next frame repaints everything.
+    void resize(int width, int height);
+
+    // Forces the next frame to repaint everything (e.g. after other output).
+    void invalidate();
+
+    // Frames per second cap; 0 disables the limit.
+    void set_max_fps(int fps);
+
+    void set_cursor(int x, int y, bool visible);
+
+    // Switches to the alternate screen (and back) so the shell's scrollback
+    // is restored when a full-screen module exits.
+    void enter_fullscreen();
+    void leave_fullscreen();
+
+    // Presents the back buffer. Returns false if the frame was deferred; its
+    // damage is kept and goes out with the next successful present().
+    bool present();
+    bool has_pending_frame() const { return pending_; }
+
+    // Milliseconds until the frame limiter will accept another frame.
+    int milliseconds_until_next_frame() const;
+
+    size_t frames_presented() const { return frames_presented_; }
+    size_t frames_coalesced() const { return frames_coalesced_; }
+
+private:
+    void render_rows(std::string& out);
+    void move_cursor(std::string& out, int x, int y);
+    void apply_style(std::string& out, const Cell& cell);
+    void write_out(const std::string& data);
+
+    int out_fd_;
+    ScreenBuffer front_; // What the terminal currently shows.
+    ScreenBuffer back_;
+    bool full_repaint_ = true;
+    bool pending_ = false;
+
+    // Terminal state as of the end of the last frame; -1 means unknown.
+    int term_x_ = -1;
+    int term_y_ = -1;
+    Cell term_style_;
+    bool term_style_known_ = false;
+
+    int cursor_x_ = 0;
+    int cursor_y_ = 0;
+    bool cursor_visible_ = true;
+    bool term_cursor_visible_ = true;
+
+    std::chrono::steady_clock::duration min_frame_interval_;
+    std::chrono::steady_clock::time_point last_frame_;
+    size_t frames_presented_ = 0;
+    size_t frames_coalesced_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // CORE_TERMINAL_SCREEN_HPP
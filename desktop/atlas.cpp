@@ -0,0 +1,67 @@
+#include "atlas.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+AtlasAllocator::AtlasAllocator(int32_t width, int32_t height) : width_(width), height_(height) {
+}
+
+bool AtlasAllocator::take(Shelf& shelf, int32_t width, int32_t height, Rect& slot) {
+    for (auto span = shelf.free.begin(); span != shelf.free.end(); ++span) {
+        if (span->width < width) continue;
+        slot = {span->x, shelf.y, width, height};
+        span->x += width;
+        span->width -= width;
+        if (span->width == 0) shelf.free.erase(span);
+        used_ += int64_t(width) * height;
+        return true;
+    }
+    return false;
+}
+
+bool AtlasAllocator::allocate(int32_t width, int32_t height, Rect& slot) {
+    if (width <= 0 || height <= 0 || width > width_ || height > height_) return false;
+    const int32_t rounded = std::min((height + kShelfStep - 1) / kShelfStep * kShelfStep, height_);
+    for (Shelf& shelf : shelves_) {
+        if (shelf.height >= rounded && shelf.height < 2 * rounded && take(shelf, width, height, slot)) return true;
+    }
+    if (top_ + rounded <= height_) {
+        Shelf shelf;
+        shelf.y = top_;
+        shelf.height = rounded;
+        shelf.free.push_back({0, width_});
+        top_ += rounded;
+        shelves_.push_back(shelf);
+        return take(shelves_.back(), width, height, slot);
+    }
+    // Out of rows: any shelf tall enough will do.
+    for (Shelf& shelf : shelves_) {
+        if (shelf.height >= height && take(shelf, width, height, slot)) return true;
+    }
+    return false;
+}
+
+void AtlasAllocator::release(const Rect& slot) {
+    auto shelf = std::find_if(shelves_.begin(), shelves_.end(), [&](const Shelf& s) { return s.y == slot.y; });
+    if (shelf == shelves_.end() || slot.empty()) return;
+    used_ -= slot.area();
+    std::vector<Span>& free = shelf->free;
+    auto next = std::lower_bound(free.begin(), free.end(), slot.x,
+                                 [](const Span& span, int32_t x) { return span.x < x; });
+    next = free.insert(next, Span{slot.x, slot.width});
+    if (next + 1 != free.end() && next->x + next->width == (next + 1)->x) {
+        next->width += (next + 1)->width;
+        free.erase(next + 1);
+    }
+    if (next != free.begin() && (next - 1)->x + (next - 1)->width == next->x) {
+        (next - 1)->width += next->width;
+        free.erase(next);
+    }
+    // Empty shelves at the top go back to the free rows.
+    while (!shelves_.empty() && shelves_.back().free.size() == 1 && shelves_.back().free[0].width == width_) {
+        top_ = shelves_.back().y;
+        shelves_.pop_back();
+    }
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,56 @@
+#ifndef DESKTOP_ATLAS_HPP
+#define DESKTOP_ATLAS_HPP
+
+#include "region.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+// Finds room for small surfaces in one shared texture.
+//
+// Slots are packed on shelves: horizontal bands whose height is a request's
+// height rounded up to kShelfStep, so cursors, tooltips and panel buttons of
+// similar sizes share a band. A slot is taken from the first free span of
+// the first shelf that is tall enough without wasting more than half of
+// it. Released spans merge with their neighbours, and the last shelves
+// are given back, for any height, once they are empty.
+class AtlasAllocator {
+public:
+    static constexpr int32_t kShelfStep = 8;
+
+    AtlasAllocator(int32_t width, int32_t height);
+
+    // Sets `slot` to a free width x height rectangle; false if there is
+    // none.
+    bool allocate(int32_t width, int32_t height, Rect& slot);
+    // `slot` must have come from allocate() and not been released since.
+    void release(const Rect& slot);
+
+    int32_t width() const { return width_; }
+    int32_t height() const { return height_; }
+    int64_t used() const { return used_; } // Pixels in slots.
+
+private:
+    struct Span {
+        int32_t x = 0;
+        int32_t width = 0;
+    };
+    struct Shelf {
+        int32_t y = 0;
+        int32_t height = 0;
+        std::vector<Span> free; // By x, never touching.
+    };
+
+    bool take(Shelf& shelf, int32_t width, int32_t height, Rect& slot);
+
+    int32_t width_;
+    int32_t height_;
+    std::vector<Shelf> shelves_; // By y.
+    int32_t top_ = 0;            // Rows below this belong to no shelf.
+    int64_t used_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_ATLAS_HPP
@@ -0,0 +1,63 @@
+#include "backend.hpp"
+#include "cpu_renderer.hpp"
+#include <cstdio>
+
+namespace Neurodeck {
+
+void Backend::run_frame_hook() {
+    if (!frame_hook_) return;
+    if (read_pixels(hook_pixels_)) frame_hook_(hook_pixels_, width(), height());
+}
+
+bool write_ppm(const std::string& path, const std::vector<uint32_t>& pixels, int32_t width, int32_t height) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> row(size_t(width) * 3);
+    bool ok = true;
+    for (int32_t y = 0; y < height && ok; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            uint32_t pixel = pixels[size_t(y) * width + x];
+            row[x * 3] = uint8_t(pixel >> 16);
+            row[x * 3 + 1] = uint8_t(pixel >> 8);
+            row[x * 3 + 2] = uint8_t(pixel);
+        }
+        ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+namespace {
+
+class HeadlessBackend : public Backend {
+public:
+    HeadlessBackend(int32_t width, int32_t height) : renderer_(width, height) {}
+
+    const char* name() const override { return "headless"; }
+    int32_t width() const override { return renderer_.width(); }
+    int32_t height() const override { return renderer_.height(); }
+
+    bool upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage) override {
+        return renderer_.upload(id, buffer, damage);
+    }
+    void remove(Scene::SurfaceId id) override { renderer_.remove(id); }
+    void repaint(const Scene& scene, const Region& damage) override {
+        renderer_.draw(scene, damage);
+        run_frame_hook();
+    }
+    bool read_pixels(std::vector<uint32_t>& pixels) override {
+        pixels = renderer_.pixels();
+        return true;
+    }
+
+private:
+    CpuRenderer renderer_;
+};
+
+} // namespace
+
+std::unique_ptr<Backend> create_headless_backend(int32_t width, int32_t height) {
+    return std::unique_ptr<Backend>(new HeadlessBackend(width, height));
+}
+
+} // namespace Neurodeck
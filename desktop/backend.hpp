@@ -0,0 +1,62 @@
+#ifndef DESKTOP_BACKEND_HPP
+#define DESKTOP_BACKEND_HPP
+
+#include "region.hpp"
+#include "scene.hpp"
+#include "shm_pool.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// Where frames go and what draws them. The compositor talks only to this
+// interface; "gl" renders with EGL/GLES2 into an offscreen surface and
+// "headless" composites on the CPU, so the compositor also runs on
+// machines without a GPU.
+class Backend {
+public:
+    // The whole output after a repaint, ARGB8888 with the top row first.
+    using FrameHook = std::function<void(const std::vector<uint32_t>& pixels, int32_t width, int32_t height)>;
+
+    virtual ~Backend() = default;
+
+    virtual const char* name() const = 0;
+    virtual int32_t width() const = 0;
+    virtual int32_t height() const = 0;
+
+    // Copies `damage` (buffer coordinates) of a committed buffer; the buffer
+    // can be released afterwards. False if the client's pool faulted.
+    virtual bool upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage) = 0;
+    virtual void remove(Scene::SurfaceId id) = 0;
+    // Redraws `damage` (output coordinates) and presents the frame.
+    virtual void repaint(const Scene& scene, const Region& damage) = 0;
+    virtual bool read_pixels(std::vector<uint32_t>& pixels) = 0;
+
+    // Runs after every repaint, e.g. to dump frames. Reading the output
+    // back is not free on the GL backend, so only set it when wanted.
+    void set_frame_hook(FrameHook hook) { frame_hook_ = std::move(hook); }
+
+protected:
+    void run_frame_hook();
+
+private:
+    FrameHook frame_hook_;
+    std::vector<uint32_t> hook_pixels_;
+};
+
+// CPU compositing into memory; never fails.
+std::unique_ptr<Backend> create_headless_backend(int32_t width, int32_t height);
+// EGL pbuffer and GLES2; nullptr if EGL or GLES2 is unavailable. Unbatched,
+// every surface is drawn with its own texture and draw calls (see
+// GlRenderer); for comparison only.
+std::unique_ptr<Backend> create_gl_backend(int32_t width, int32_t height, bool batch = true);
+
+// Writes pixels as a binary PPM; the output is opaque, so alpha is dropped.
+bool write_ppm(const std::string& path, const std::vector<uint32_t>& pixels, int32_t width, int32_t height);
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_BACKEND_HPP
@@ -0,0 +1,144 @@
+#include "blend.hpp"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NEURODECK_AVX2_KERNEL 1
+#endif
+
+namespace Neurodeck {
+
+namespace {
+
+// x * a / 255, rounded, exact for 8-bit x and a. The SIMD kernels do the
+// same arithmetic in 16-bit lanes.
+inline uint32_t mul_div255(uint32_t x, uint32_t a) {
+    uint32_t t = x * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+inline uint32_t over(uint32_t src, uint32_t dst) {
+    uint32_t inverse = 255 - (src >> 24);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t channel = ((src >> shift) & 0xff) + mul_div255((dst >> shift) & 0xff, inverse);
+        out |= std::min<uint32_t>(channel, 255) << shift;
+    }
+    return out;
+}
+
+void blend_scalar(uint32_t* dst, const uint32_t* src, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t alpha = src[i] >> 24;
+        if (alpha == 255) dst[i] = src[i];
+        else if (src[i] != 0) dst[i] = over(src[i], dst[i]);
+    }
+}
+
+#ifdef __SSE2__
+// Two pixels widened to 16-bit lanes: dst * (255 - src.alpha) / 255.
+inline __m128i scale_by_inverse_alpha(__m128i dst16, __m128i src16) {
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i c255 = _mm_set1_epi16(255);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src16, 0xff), 0xff);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(dst16, _mm_sub_epi16(c255, alpha)), c128);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void blend_sse2(uint32_t* dst, const uint32_t* src, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask)) == 0xffff) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff) continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i low = scale_by_inverse_alpha(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        __m128i high = scale_by_inverse_alpha(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(_mm_packus_epi16(low, high), s));
+    }
+    blend_scalar(dst + i, src + i, count - i);
+}
+#endif
+
+#ifdef NEURODECK_AVX2_KERNEL
+__attribute__((target("avx2"))) inline __m256i scale_by_inverse_alpha_avx2(__m256i dst16, __m256i src16) {
+    const __m256i c128 = _mm256_set1_epi16(128);
+    const __m256i c255 = _mm256_set1_epi16(255);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src16, 0xff), 0xff);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(dst16, _mm256_sub_epi16(c255, alpha)), c128);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// The unpacks and the pack both work within 128-bit lanes, so pixels come
+// back in order.
+__attribute__((target("avx2"))) void blend_avx2(uint32_t* dst, const uint32_t* src, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), alpha_mask)) == -1) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1) continue;
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i low = scale_by_inverse_alpha_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        __m256i high = scale_by_inverse_alpha_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(low, high), s));
+    }
+    blend_scalar(dst + i, src + i, count - i);
+}
+
+bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+} // namespace
+
+BlendPath best_blend_path() {
+#ifdef NEURODECK_AVX2_KERNEL
+    if (cpu_has_avx2()) return BlendPath::Avx2;
+#endif
+#ifdef __SSE2__
+    return BlendPath::Sse2;
+#else
+    return BlendPath::Scalar;
+#endif
+}
+
+const char* blend_path_name(BlendPath path) {
+    switch (path) {
+    case BlendPath::Scalar: return "scalar";
+    case BlendPath::Sse2: return "sse2";
+    case BlendPath::Avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+void blend_row(uint32_t* dst, const uint32_t* src, size_t count, BlendPath path) {
+#ifdef NEURODECK_AVX2_KERNEL
+    if (path == BlendPath::Avx2 && cpu_has_avx2()) {
+        blend_avx2(dst, src, count);
+        return;
+    }
+#endif
+#ifdef __SSE2__
+    if (path != BlendPath::Scalar) {
+        blend_sse2(dst, src, count);
+        return;
+    }
+#endif
+    blend_scalar(dst, src, count);
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,29 @@
+#ifndef DESKTOP_BLEND_HPP
+#define DESKTOP_BLEND_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Neurodeck {
+
+// Row kernels for compositing premultiplied ARGB8888 (wl_shm's ARGB8888:
+// B, G, R, A bytes in memory) on the CPU.
+enum class BlendPath {
+    Scalar,
+    Sse2, // 4 pixels a step.
+    Avx2, // 8 pixels a step, chosen at run time where the CPU has it.
+};
+
+// The fastest path this build and CPU support.
+BlendPath best_blend_path();
+const char* blend_path_name(BlendPath path);
+
+// dst = src OVER dst, i.e. src + dst * (255 - src.alpha) / 255 per channel,
+// rounded. Blocks of fully opaque or fully transparent pixels are copied or
+// skipped. Every path gives the same result; a path the CPU lacks falls
+// back to the next slower one.
+void blend_row(uint32_t* dst, const uint32_t* src, size_t count, BlendPath path = best_blend_path());
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_BLEND_HPP
@@ -0,0 +1,98 @@
+#include "cpu_renderer.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Neurodeck {
+
+CpuRenderer::CpuRenderer(int32_t output_width, int32_t output_height, BlendPath path)
+    : width_(output_width), height_(output_height), path_(path),
+      framebuffer_(size_t(output_width) * output_height, kBackground) {
+}
+
+bool CpuRenderer::upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage) {
+    Image& image = images_[id];
+    Region to_upload = damage;
+    if (image.width != buffer.width || image.height != buffer.height) {
+        image.width = buffer.width;
+        image.height = buffer.height;
+        image.pixels.assign(size_t(buffer.width) * buffer.height, 0);
+        to_upload = Region(buffer.bounds());
+    }
+    image.opaque = buffer.opaque();
+    to_upload.intersect(buffer.bounds());
+
+    buffer.pool->begin_access();
+    for (const Rect& rect : to_upload.rects()) {
+        for (int32_t y = rect.y; y < rect.bottom(); ++y) {
+            const uint8_t* from = buffer.pixels() + size_t(y) * buffer.stride + size_t(rect.x) * 4;
+            uint32_t* to = image.pixels.data() + size_t(y) * image.width + rect.x;
+            memcpy(to, from, size_t(rect.width) * 4);
+            if (image.opaque) {
+                // The alpha byte of XRGB8888 is undefined.
+                for (int32_t x = 0; x < rect.width; ++x) to[x] |= 0xff000000;
+            }
+        }
+    }
+    return buffer.pool->end_access();
+}
+
+void CpuRenderer::remove(Scene::SurfaceId id) {
+    images_.erase(id);
+}
+
+void CpuRenderer::composite(const Image& image, const Scene::Surface& surface, const Rect& clip, bool blend) {
+    for (int32_t y = clip.y; y < clip.bottom(); ++y) {
+        uint32_t* to = framebuffer_.data() + size_t(y) * width_ + clip.x;
+        const uint32_t* from;
+        if (surface.scale == 1) {
+            from = image.pixels.data() + size_t(y - surface.y) * image.width + (clip.x - surface.x);
+        } else {
+            // Nearest buffer pixel for each output pixel.
+            const uint32_t* source_row = image.pixels.data() + size_t(y - surface.y) * surface.scale * image.width;
+            row_.resize(clip.width);
+            for (int32_t x = 0; x < clip.width; ++x) row_[x] = source_row[(clip.x + x - surface.x) * surface.scale];
+            from = row_.data();
+        }
+        if (blend) blend_row(to, from, clip.width, path_);
+        else memcpy(to, from, size_t(clip.width) * 4);
+    }
+}
+
+void CpuRenderer::fill(const Rect& rect, uint32_t colour) {
+    for (int32_t y = rect.y; y < rect.bottom(); ++y) {
+        uint32_t* row = framebuffer_.data() + size_t(y) * width_ + rect.x;
+        std::fill(row, row + rect.width, colour);
+    }
+}
+
+void CpuRenderer::draw(const Scene& scene, const Region& damage) {
+    Region clipped = damage;
+    clipped.intersect(Rect{0, 0, width_, height_});
+    Region background;
+    std::vector<Scene::Layer> layers = scene.visible_layers(clipped, &background);
+    for (const Rect& rect : background.rects()) fill(rect, kBackground);
+    for (const Scene::Layer& layer : layers) {
+        const Scene::Surface* surface = scene.surface(layer.id);
+        auto image = images_.find(layer.id);
+        if (image == images_.end()) {
+            // Nothing uploaded yet; whatever it hides still shows as the
+            // background rather than stale pixels.
+            for (const Rect& rect : layer.opaque) fill(rect, kBackground);
+            continue;
+        }
+        // The image can lag the surface size for one commit if an upload
+        // failed; never read past it.
+        Rect bounds = surface->bounds().intersect(
+            Rect{surface->x, surface->y, image->second.width / surface->scale, image->second.height / surface->scale});
+        for (const Rect& rect : layer.opaque) {
+            Rect visible = rect.intersect(bounds);
+            if (!visible.empty()) composite(image->second, *surface, visible, false);
+        }
+        for (const Rect& rect : layer.blended) {
+            Rect visible = rect.intersect(bounds);
+            if (!visible.empty()) composite(image->second, *surface, visible, !image->second.opaque);
+        }
+    }
+}
+
+} // namespace Neurodeck
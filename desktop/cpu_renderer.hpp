@@ -0,0 +1,64 @@
+#ifndef DESKTOP_CPU_RENDERER_HPP
+#define DESKTOP_CPU_RENDERER_HPP
+
+#include "blend.hpp"
+#include "region.hpp"
+#include "scene.hpp"
+#include "shm_pool.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Composites the scene on the CPU into an ARGB8888 framebuffer.
+//
+// Like the GL renderer, every surface keeps its own copy of the pixels,
+// updated only in the rectangles a commit damaged, so buffers are released
+// at once. draw() touches only the damaged part of the framebuffer, and of
+// that only what Scene::visible_layers() leaves showing: the background is
+// cleared where nothing opaque covers it, then the surfaces are blended
+// bottom to top a row at a time with blend_row(), except in their opaque
+// regions (all of an XRGB8888 surface), which are copied.
+class CpuRenderer {
+public:
+    static constexpr uint32_t kBackground = 0xffff0000; // Opaque red.
+
+    CpuRenderer(int32_t output_width, int32_t output_height, BlendPath path = best_blend_path());
+
+    // Copies `damage` (buffer coordinates) of the buffer. Returns false if
+    // the client truncated the pool meanwhile.
+    bool upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage);
+    void remove(Scene::SurfaceId id);
+
+    // Redraws `damage` (output coordinates) from the scene.
+    void draw(const Scene& scene, const Region& damage);
+
+    int32_t width() const { return width_; }
+    int32_t height() const { return height_; }
+    // Top row first, `width()` pixels per row.
+    const std::vector<uint32_t>& pixels() const { return framebuffer_; }
+    uint32_t pixel(int32_t x, int32_t y) const { return framebuffer_[size_t(y) * width_ + x]; }
+
+private:
+    struct Image {
+        int32_t width = 0;
+        int32_t height = 0;
+        bool opaque = false;
+        std::vector<uint32_t> pixels;
+    };
+
+    void composite(const Image& image, const Scene::Surface& surface, const Rect& clip, bool blend);
+    void fill(const Rect& rect, uint32_t colour);
+
+    int32_t width_;
+    int32_t height_;
+    BlendPath path_;
+    std::vector<uint32_t> framebuffer_;
+    std::unordered_map<Scene::SurfaceId, Image> images_;
+    std::vector<uint32_t> row_; // A scaled source row.
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_CPU_RENDERER_HPP
@@ -0,0 +1,61 @@
+#include "font.hpp"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+#include <algorithm>
+
+namespace Neurodeck {
+
+Font::~Font() {
+    if (face_) FT_Done_Face(face_);
+    if (library_) FT_Done_FreeType(library_);
+}
+
+bool Font::open(const std::string& path, int pixel_size) {
+    if (!library_ && FT_Init_FreeType(&library_) != 0) return false;
+    FT_Face face = nullptr;
+    if (FT_New_Face(library_, path.c_str(), 0, &face) != 0) return false;
+    if (FT_Set_Pixel_Sizes(face, 0, FT_UInt(pixel_size)) != 0) {
+        FT_Done_Face(face);
+        return false;
+    }
+    if (face_) FT_Done_Face(face_);
+    face_ = face;
+
+    // Cells fit the ascender and descender, and one advance: every glyph
+    // of a monospace font has the same.
+    const FT_Size_Metrics& metrics = face->size->metrics;
+    baseline_ = int((metrics.ascender + 63) >> 6);
+    cell_height_ = baseline_ + int((-metrics.descender + 63) >> 6);
+    if (FT_Load_Char(face, 'M', FT_LOAD_DEFAULT) == 0) cell_width_ = int((face->glyph->advance.x + 32) >> 6);
+    else cell_width_ = int((metrics.max_advance + 63) >> 6);
+    return cell_width_ > 0 && cell_height_ > 0;
+}
+
+bool Font::rasterize(char32_t ch, bool bold, uint8_t* mask) const {
+    FT_UInt index = FT_Get_Char_Index(face_, FT_ULong(ch));
+    if (index == 0 || FT_Load_Glyph(face_, index, FT_LOAD_TARGET_LIGHT) != 0) return false;
+    FT_GlyphSlot slot = face_->glyph;
+    if (bold && slot->format == FT_GLYPH_FORMAT_OUTLINE) FT_Outline_EmboldenXY(&slot->outline, 64, 0);
+    if (FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT) != 0 || slot->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+        return false;
+    }
+
+    // Whatever overhangs the cell is cut off.
+    const FT_Bitmap& bitmap = slot->bitmap;
+    const int left = slot->bitmap_left;
+    const int top = baseline_ - slot->bitmap_top;
+    for (int row = 0; row < int(bitmap.rows); ++row) {
+        const int y = top + row;
+        if (y < 0 || y >= cell_height_) continue;
+        const uint8_t* source = bitmap.buffer + row * bitmap.pitch;
+        for (int column = 0; column < int(bitmap.width); ++column) {
+            const int x = left + column;
+            if (x < 0 || x >= cell_width_) continue;
+            mask[y * cell_width_ + x] = std::max(mask[y * cell_width_ + x], source[column]);
+        }
+    }
+    return true;
+}
+
+} // namespace Neurodeck
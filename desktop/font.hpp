@@ -0,0 +1,43 @@
+#ifndef DESKTOP_FONT_HPP
+#define DESKTOP_FONT_HPP
+
+#include <cstdint>
+#include <string>
+
+// FreeType's handles, so users of Font need no FreeType includes.
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace Neurodeck {
+
+// A monospace font file, rasterized with FreeType into fixed-size cells
+// for a GlyphAtlas. Bold is the regular face emboldened.
+class Font {
+public:
+    Font() = default;
+    ~Font();
+
+    Font(const Font&) = delete;
+    Font& operator=(const Font&) = delete;
+
+    // Loads the face at `path` at `pixel_size` pixels per em. Returns false
+    // if FreeType cannot read it.
+    bool open(const std::string& path, int pixel_size);
+
+    int cell_width() const { return cell_width_; }
+    int cell_height() const { return cell_height_; }
+
+    // A GlyphAtlas::Rasterizer.
+    bool rasterize(char32_t ch, bool bold, uint8_t* mask) const;
+
+private:
+    FT_LibraryRec_* library_ = nullptr;
+    FT_FaceRec_* face_ = nullptr;
+    int cell_width_ = 0;
+    int cell_height_ = 0;
+    int baseline_ = 0; // Rows from the top of a cell.
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_FONT_HPP
@@ -0,0 +1,100 @@
+#include "frame_scheduler.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+namespace {
+
+void erase_listener(std::vector<FrameScheduler::Listener>& listeners, FrameScheduler::Listener listener) {
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+
+} // namespace
+
+FrameScheduler::FrameScheduler(int64_t refresh_nsec)
+    : refresh_nsec_(std::max<int64_t>(1, refresh_nsec)) {
+}
+
+void FrameScheduler::frame(Scene::SurfaceId surface, Listener callback) {
+    pending_[surface].callbacks.push_back(callback);
+}
+
+void FrameScheduler::feedback(Scene::SurfaceId surface, Listener feedback) {
+    pending_[surface].feedback.push_back(feedback);
+}
+
+std::vector<FrameScheduler::Listener> FrameScheduler::commit(Scene::SurfaceId surface) {
+    std::vector<Listener> discarded;
+    auto it = pending_.find(surface);
+    if (it == pending_.end()) return discarded;
+    Listeners& pending = it->second;
+    if (!pending.feedback.empty()) {
+        // The previous commit will never be seen on its own.
+        std::vector<Listener>& committed = committed_feedback_[surface];
+        discarded.swap(committed);
+        committed.swap(pending.feedback);
+        scheduled_ = true;
+    }
+    if (!pending.callbacks.empty()) {
+        committed_callbacks_.insert(committed_callbacks_.end(), pending.callbacks.begin(), pending.callbacks.end());
+        scheduled_ = true;
+    }
+    pending_.erase(it);
+    return discarded;
+}
+
+std::vector<FrameScheduler::Listener> FrameScheduler::remove_surface(Scene::SurfaceId surface) {
+    std::vector<Listener> discarded;
+    auto pending = pending_.find(surface);
+    if (pending != pending_.end()) {
+        discarded.swap(pending->second.feedback);
+        pending_.erase(pending);
+    }
+    auto committed = committed_feedback_.find(surface);
+    if (committed != committed_feedback_.end()) {
+        discarded.insert(discarded.end(), committed->second.begin(), committed->second.end());
+        committed_feedback_.erase(committed);
+    }
+    return discarded;
+}
+
+void FrameScheduler::forget(Listener listener) {
+    erase_listener(committed_callbacks_, listener);
+    erase_listener(in_flight_.callbacks, listener);
+    erase_listener(in_flight_.feedback, listener);
+    for (auto& entry : pending_) {
+        erase_listener(entry.second.callbacks, listener);
+        erase_listener(entry.second.feedback, listener);
+    }
+    for (auto& entry : committed_feedback_) erase_listener(entry.second, listener);
+}
+
+int64_t FrameScheduler::next_refresh(int64_t now_nsec) const {
+    int64_t sequence = (now_nsec + refresh_nsec_ - 1) / refresh_nsec_;
+    sequence = std::max(sequence, last_sequence_ + 1);
+    return sequence * refresh_nsec_;
+}
+
+void FrameScheduler::dispatch() {
+    scheduled_ = false;
+    in_flight_.callbacks.insert(in_flight_.callbacks.end(), committed_callbacks_.begin(), committed_callbacks_.end());
+    committed_callbacks_.clear();
+    for (auto& entry : committed_feedback_) {
+        in_flight_.feedback.insert(in_flight_.feedback.end(), entry.second.begin(), entry.second.end());
+    }
+    committed_feedback_.clear();
+}
+
+FrameScheduler::Frame FrameScheduler::present(int64_t now_nsec) {
+    int64_t sequence = std::max(now_nsec / refresh_nsec_, last_sequence_ + 1);
+    last_sequence_ = sequence;
+
+    Frame frame;
+    frame.sequence = static_cast<uint64_t>(sequence);
+    frame.presented_nsec = sequence * refresh_nsec_;
+    frame.callbacks.swap(in_flight_.callbacks);
+    frame.feedback.swap(in_flight_.feedback);
+    return frame;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,82 @@
+#ifndef DESKTOP_FRAME_SCHEDULER_HPP
+#define DESKTOP_FRAME_SCHEDULER_HPP
+
+#include "scene.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Decides when the compositor draws and whom to tell afterwards.
+//
+// Frames are paced to a fixed refresh grid (multiples of the refresh period
+// on the monotonic clock, standing in for vblank) and happen only when
+// asked for: schedule() after new damage, or a commit that carries frame
+// callbacks or presentation feedback. Nothing scheduled means no wakeups.
+//
+// Frame callbacks and feedback follow wl_surface's pending/current split:
+// they are requested on a surface, become current on its next commit and
+// complete with the frame that shows that commit: the next one dispatched,
+// not the one in flight. Feedback whose commit is replaced by a newer one
+// before a frame is handed back as discarded.
+// Listeners are opaque pointers to the caller (Wayland resources).
+class FrameScheduler {
+public:
+    using Listener = void*;
+
+    static constexpr int64_t kDefaultRefreshNsec = 16666667; // 60 Hz
+
+    // What to send once a frame is on screen.
+    struct Frame {
+        uint64_t sequence = 0;       // Refresh count since the clock's epoch.
+        int64_t presented_nsec = 0;  // Time of that refresh.
+        std::vector<Listener> callbacks;
+        std::vector<Listener> feedback;
+    };
+
+    explicit FrameScheduler(int64_t refresh_nsec = kDefaultRefreshNsec);
+
+    int64_t refresh_nsec() const { return refresh_nsec_; }
+
+    // Pending until the surface's next commit.
+    void frame(Scene::SurfaceId surface, Listener callback);
+    void feedback(Scene::SurfaceId surface, Listener feedback);
+    // Makes the surface's pending listeners current and schedules a frame
+    // if there were any. Returns feedback discarded by this commit.
+    std::vector<Listener> commit(Scene::SurfaceId surface);
+    // Drops the surface's listeners; returns its feedback for discarding.
+    // Committed frame callbacks still fire with the next frame.
+    std::vector<Listener> remove_surface(Scene::SurfaceId surface);
+    // A listener was destroyed by its client.
+    void forget(Listener listener);
+
+    void schedule() { scheduled_ = true; }
+    bool scheduled() const { return scheduled_; }
+    // The first refresh after the last presented one, at or after now.
+    int64_t next_refresh(int64_t now_nsec) const;
+    // A frame of everything committed so far went to be drawn. Clears the
+    // schedule; anything committed from now on needs another frame.
+    void dispatch();
+    // The frame dispatched last, at the last refresh at or before now, was
+    // presented. Hands back the listeners it completes.
+    Frame present(int64_t now_nsec);
+
+private:
+    struct Listeners {
+        std::vector<Listener> callbacks;
+        std::vector<Listener> feedback;
+    };
+
+    int64_t refresh_nsec_;
+    bool scheduled_ = false;
+    int64_t last_sequence_ = -1; // None presented yet.
+    std::unordered_map<Scene::SurfaceId, Listeners> pending_;
+    std::unordered_map<Scene::SurfaceId, std::vector<Listener>> committed_feedback_;
+    std::vector<Listener> committed_callbacks_;
+    Listeners in_flight_; // Dispatched, waiting for present().
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_FRAME_SCHEDULER_HPP
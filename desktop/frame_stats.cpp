@@ -0,0 +1,185 @@
+#include "frame_stats.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace Neurodeck {
+
+namespace {
+
+// Nearest-rank percentile (0-100) of `values`; 0 when there are none.
+int64_t percentile(std::vector<int64_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p / 100 * (values.size() - 1) + 0.5)];
+}
+
+template <typename Field>
+std::vector<int64_t> collect(const std::vector<FrameRecord>& frames, Field field) {
+    std::vector<int64_t> values;
+    values.reserve(frames.size());
+    for (const FrameRecord& frame : frames) values.push_back(field(frame));
+    return values;
+}
+
+void write_percentiles_json(std::ostream& out, const char* name, const std::vector<int64_t>& values) {
+    out << "\"" << name << "\":{"
+        << "\"p50\":" << percentile(values, 50)
+        << ",\"p90\":" << percentile(values, 90)
+        << ",\"p99\":" << percentile(values, 99)
+        << ",\"max\":" << percentile(values, 100) << "}";
+}
+
+bool write_file(const std::string& filename, const std::string& contents) {
+    std::ofstream file(filename, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << contents;
+    file.close();
+    return !file.fail();
+}
+
+// Chrome trace timestamps are microseconds.
+double us(int64_t nsec) {
+    return nsec / 1e3;
+}
+
+} // namespace
+
+FrameStats::FrameStats(size_t capacity) : ring_(std::max<size_t>(capacity, 1)) {
+}
+
+void FrameStats::dispatched(int64_t duration_nsec) {
+    dispatch_nsec_ += duration_nsec;
+    ++dispatches_;
+}
+
+void FrameStats::committed(int64_t now_nsec) {
+    if (commits_++ == 0) oldest_commit_nsec_ = now_nsec;
+}
+
+void FrameStats::targeted(int64_t target_nsec) {
+    if (target_nsec_ == 0) target_nsec_ = target_nsec;
+}
+
+void FrameStats::presented(FrameRecord frame, int64_t refresh_nsec) {
+    frame.dispatch_nsec = dispatch_nsec_;
+    frame.dispatches = dispatches_;
+    frame.commits = commits_;
+    // A commit that came in after the refresh the frame is credited to
+    // still made it; count that as no latency rather than negative.
+    frame.latency_nsec = commits_ ? std::max<int64_t>(0, frame.presented_nsec - oldest_commit_nsec_) : 0;
+    frame.dropped = 0;
+    if (target_nsec_ != 0 && refresh_nsec > 0 && frame.presented_nsec > target_nsec_) {
+        frame.dropped = static_cast<uint32_t>((frame.presented_nsec - target_nsec_) / refresh_nsec);
+    }
+
+    ring_[next_] = frame;
+    next_ = (next_ + 1) % ring_.size();
+    size_ = std::min(size_ + 1, ring_.size());
+    ++total_frames_;
+    total_dropped_ += frame.dropped;
+
+    dispatch_nsec_ = 0;
+    dispatches_ = 0;
+    commits_ = 0;
+    target_nsec_ = 0;
+}
+
+std::vector<FrameRecord> FrameStats::frames() const {
+    std::vector<FrameRecord> frames;
+    frames.reserve(size_);
+    size_t first = (next_ + ring_.size() - size_) % ring_.size();
+    for (size_t i = 0; i < size_; ++i) frames.push_back(ring_[(first + i) % ring_.size()]);
+    return frames;
+}
+
+void FrameStats::write_json(std::ostream& out) const {
+    std::vector<FrameRecord> kept = frames();
+    out << "{\"total_frames\":" << total_frames_ << ",\"total_dropped\":" << total_dropped_ << ",";
+    write_percentiles_json(out, "render_cpu_ns",
+                           collect(kept, [](const FrameRecord& f) { return f.render_cpu_nsec; }));
+    out << ",";
+    write_percentiles_json(out, "render_wall_ns",
+                           collect(kept, [](const FrameRecord& f) { return f.render_wall_nsec; }));
+    out << ",";
+    write_percentiles_json(out, "dispatch_ns", collect(kept, [](const FrameRecord& f) { return f.dispatch_nsec; }));
+    out << ",";
+    write_percentiles_json(out, "latency_ns", collect(kept, [](const FrameRecord& f) { return f.latency_nsec; }));
+    out << ",\"frames\":[";
+    for (size_t i = 0; i < kept.size(); ++i) {
+        const FrameRecord& f = kept[i];
+        if (i) out << ",";
+        out << "{\"sequence\":" << f.sequence
+            << ",\"presented_ns\":" << f.presented_nsec
+            << ",\"render_start_ns\":" << f.render_start_nsec
+            << ",\"render_wall_ns\":" << f.render_wall_nsec
+            << ",\"render_cpu_ns\":" << f.render_cpu_nsec
+            << ",\"dispatch_ns\":" << f.dispatch_nsec
+            << ",\"dispatches\":" << f.dispatches
+            << ",\"commits\":" << f.commits
+            << ",\"latency_ns\":" << f.latency_nsec
+            << ",\"dropped\":" << f.dropped << "}";
+    }
+    out << "]}\n";
+}
+
+void FrameStats::write_chrome_trace(std::ostream& out) const {
+    std::vector<FrameRecord> kept = frames();
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "";
+    auto event = [&](const char* name, const char* phase, double ts) -> std::ostream& {
+        out << separator << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"ts\":" << ts
+            << ",\"pid\":1,\"tid\":1";
+        separator = ",";
+        return out;
+    };
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const FrameRecord& f : kept) {
+        if (f.render_wall_nsec > 0) {
+            event("render", "X", us(f.render_start_nsec))
+                << ",\"dur\":" << us(f.render_wall_nsec)
+                << ",\"args\":{\"cpu_us\":" << us(f.render_cpu_nsec) << ",\"sequence\":" << f.sequence << "}}";
+        }
+        event("dispatch_us", "C", us(f.presented_nsec)) << ",\"args\":{\"value\":" << us(f.dispatch_nsec) << "}}";
+        event("latency_us", "C", us(f.presented_nsec)) << ",\"args\":{\"value\":" << us(f.latency_nsec) << "}}";
+        event("commits", "C", us(f.presented_nsec)) << ",\"args\":{\"value\":" << f.commits << "}}";
+        if (f.dropped) {
+            event("dropped", "i", us(f.presented_nsec)) << ",\"s\":\"t\",\"args\":{\"refreshes\":" << f.dropped << "}}";
+        }
+    }
+    out << "]}\n";
+}
+
+bool FrameStats::dump_json(const std::string& filename) const {
+    std::ostringstream json;
+    write_json(json);
+    return write_file(filename, json.str());
+}
+
+bool FrameStats::dump_chrome_trace(const std::string& filename) const {
+    std::ostringstream json;
+    write_chrome_trace(json);
+    return write_file(filename, json.str());
+}
+
+std::string FrameStats::summary() const {
+    std::vector<FrameRecord> kept = frames();
+    std::vector<int64_t> render = collect(kept, [](const FrameRecord& f) { return f.render_cpu_nsec; });
+    std::vector<int64_t> dispatch = collect(kept, [](const FrameRecord& f) { return f.dispatch_nsec; });
+    std::vector<int64_t> latency = collect(kept, [](const FrameRecord& f) { return f.latency_nsec; });
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%llu frames, %llu dropped refreshes; render cpu p50 %.2f ms max %.2f ms, "
+             "dispatch p50 %.2f ms max %.2f ms, latency p50 %.2f ms max %.2f ms",
+             static_cast<unsigned long long>(total_frames_), static_cast<unsigned long long>(total_dropped_),
+             percentile(render, 50) / 1e6, percentile(render, 100) / 1e6,
+             percentile(dispatch, 50) / 1e6, percentile(dispatch, 100) / 1e6,
+             percentile(latency, 50) / 1e6, percentile(latency, 100) / 1e6);
+    return line;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,82 @@
+#ifndef DESKTOP_FRAME_STATS_HPP
+#define DESKTOP_FRAME_STATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// Where one frame's time went. Times are CLOCK_MONOTONIC nanoseconds.
+struct FrameRecord {
+    uint64_t sequence = 0;        // Refresh the frame was presented at.
+    int64_t presented_nsec = 0;   // Time of that refresh.
+    int64_t render_start_nsec = 0;
+    int64_t render_wall_nsec = 0; // Drawing and presenting; 0 if nothing was damaged.
+    int64_t render_cpu_nsec = 0;  // CPU time of the compositor thread meanwhile.
+    int64_t dispatch_nsec = 0;    // Handling client requests since the previous frame.
+    uint32_t dispatches = 0;      // Event loop wakeups that took it.
+    uint32_t commits = 0;         // Surface commits this frame shows.
+    int64_t latency_nsec = 0;     // Oldest of those commits to presentation.
+    uint32_t dropped = 0;         // Refreshes missed after the one aimed for.
+};
+
+// Frame timing for the last `capacity` frames, in a ring buffer.
+//
+// The compositor reports as it goes: every event loop dispatch, every
+// commit, the refresh each frame is scheduled for and, once it is shown,
+// the frame itself. Recording is a few stores and never allocates, so it is
+// always on; the numbers are only formatted when exported, as JSON or in
+// the Chrome trace event format (chrome://tracing, Perfetto).
+class FrameStats {
+public:
+    explicit FrameStats(size_t capacity = 1024);
+
+    void dispatched(int64_t duration_nsec);
+    void committed(int64_t now_nsec);
+    // The next frame is due at `target_nsec`; only the first target counts
+    // until it is presented.
+    void targeted(int64_t target_nsec);
+    // Completes the frame that began with the last targeted() call. The
+    // dispatch, commit and drop fields are filled in here.
+    void presented(FrameRecord frame, int64_t refresh_nsec);
+
+    // Oldest first.
+    std::vector<FrameRecord> frames() const;
+    uint64_t total_frames() const { return total_frames_; }
+    uint64_t total_dropped() const { return total_dropped_; }
+
+    // Every kept frame, plus percentiles of render CPU time, dispatch time
+    // and latency over them.
+    void write_json(std::ostream& out) const;
+    // Renders as slices, dispatch time, latency and commits as counters
+    // per frame, and dropped frames as instant events.
+    void write_chrome_trace(std::ostream& out) const;
+    // Returns false if the file cannot be written.
+    bool dump_json(const std::string& filename) const;
+    bool dump_chrome_trace(const std::string& filename) const;
+
+    // One line: frames, drops and the median and worst render, dispatch and
+    // latency figures.
+    std::string summary() const;
+
+private:
+    std::vector<FrameRecord> ring_;
+    size_t next_ = 0; // Where the next frame goes.
+    size_t size_ = 0;
+    uint64_t total_frames_ = 0;
+    uint64_t total_dropped_ = 0;
+
+    // The frame in progress.
+    int64_t dispatch_nsec_ = 0;
+    uint32_t dispatches_ = 0;
+    uint32_t commits_ = 0;
+    int64_t oldest_commit_nsec_ = 0;
+    int64_t target_nsec_ = 0; // 0 until targeted().
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_FRAME_STATS_HPP
@@ -0,0 +1,166 @@
+#include "backend.hpp"
+#include "gl_renderer.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdio>
+#include <cstring>
+
+namespace Neurodeck {
+
+namespace {
+
+// There is no display hardware to drive yet, so the output is an EGL
+// pbuffer; unlike a window surface its contents survive between frames,
+// which redrawing only the damaged parts relies on.
+class GlBackend : public Backend {
+public:
+    GlBackend(int32_t width, int32_t height, bool batch) : width_(width), height_(height), batch_(batch) {}
+    ~GlBackend() override;
+
+    bool init();
+
+    const char* name() const override { return "gl"; }
+    int32_t width() const override { return width_; }
+    int32_t height() const override { return height_; }
+
+    bool upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage) override {
+        return renderer_->upload(id, buffer, damage);
+    }
+    void remove(Scene::SurfaceId id) override { renderer_->remove(id); }
+    void repaint(const Scene& scene, const Region& damage) override;
+    bool read_pixels(std::vector<uint32_t>& pixels) override;
+
+private:
+    int32_t width_;
+    int32_t height_;
+    bool batch_;
+    EGLDisplay display_ = EGL_NO_DISPLAY;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+    std::unique_ptr<GlRenderer> renderer_;
+};
+
+// Prefers Mesa's surfaceless platform, which needs neither a window system
+// nor a GPU (llvmpipe), over whatever the default display is.
+EGLDisplay open_display() {
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        auto get_platform_display =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (get_platform_display) {
+            EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+GlBackend::~GlBackend() {
+    if (display_ == EGL_NO_DISPLAY) return;
+    renderer_.reset(); // Needs the context.
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != EGL_NO_SURFACE) eglDestroySurface(display_, surface_);
+    if (context_ != EGL_NO_CONTEXT) eglDestroyContext(display_, context_);
+    eglTerminate(display_);
+}
+
+bool GlBackend::init() {
+    display_ = open_display();
+    if (display_ == EGL_NO_DISPLAY) {
+        fprintf(stderr, "Failed to get EGL display\n");
+        return false;
+    }
+    EGLint major, minor;
+    if (!eglInitialize(display_, &major, &minor)) {
+        fprintf(stderr, "Failed to initialize EGL: %x\n", eglGetError());
+        display_ = EGL_NO_DISPLAY;
+        return false;
+    }
+    printf("EGL Initialized. Version: %d.%d\n", major, minor);
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(display_, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+        fprintf(stderr, "No suitable EGL config found: %x\n", eglGetError());
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2, // Request OpenGL ES 2.0
+        EGL_NONE
+    };
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+    if (context_ == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create EGL context: %x\n", eglGetError());
+        return false;
+    }
+
+    const EGLint surface_attribs[] = {
+        EGL_WIDTH, width_,
+        EGL_HEIGHT, height_,
+        EGL_NONE
+    };
+    surface_ = eglCreatePbufferSurface(display_, config, surface_attribs);
+    if (surface_ == EGL_NO_SURFACE) {
+        fprintf(stderr, "Failed to create output surface: %x\n", eglGetError());
+        return false;
+    }
+
+    // The context stays current: textures are uploaded as surfaces commit.
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+        fprintf(stderr, "Failed to make EGL context current: %x\n", eglGetError());
+        return false;
+    }
+    renderer_.reset(new GlRenderer(width_, height_, batch_));
+    if (!renderer_->init()) {
+        fprintf(stderr, "Failed to initialize the GL renderer\n");
+        return false;
+    }
+    printf("GL output: %dx%d on %s\n", width_, height_, glGetString(GL_RENDERER));
+    return true;
+}
+
+void GlBackend::repaint(const Scene& scene, const Region& damage) {
+    renderer_->draw(scene, damage);
+    if (!eglSwapBuffers(display_, surface_)) {
+        fprintf(stderr, "Failed to swap EGL buffers, EGL error %x\n", eglGetError());
+    }
+    run_frame_hook();
+}
+
+bool GlBackend::read_pixels(std::vector<uint32_t>& pixels) {
+    std::vector<uint32_t> rgba(size_t(width_) * height_);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    if (glGetError() != GL_NO_ERROR) return false;
+    // GL rows run bottom to top, in R, G, B, A byte order.
+    pixels.resize(rgba.size());
+    for (int32_t y = 0; y < height_; ++y) {
+        const uint32_t* from = rgba.data() + size_t(height_ - 1 - y) * width_;
+        uint32_t* to = pixels.data() + size_t(y) * width_;
+        for (int32_t x = 0; x < width_; ++x) {
+            uint32_t p = from[x];
+            to[x] = (p & 0xff00ff00) | ((p & 0xff) << 16) | ((p >> 16) & 0xff);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<Backend> create_gl_backend(int32_t width, int32_t height, bool batch) {
+    std::unique_ptr<GlBackend> backend(new GlBackend(width, height, batch));
+    if (!backend->init()) return nullptr;
+    return std::unique_ptr<Backend>(backend.release());
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,389 @@
+#include "gl_renderer.hpp"
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+namespace Neurodeck {
+
+namespace {
+
+// `opaque` is per vertex, so XRGB8888 and ARGB8888 surfaces can share a
+// draw call.
+const char* kVertexShader =
+    "attribute vec2 position;\n"
+    "attribute vec2 texcoord;\n"
+    "attribute float opaque;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying float v_opaque;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "    v_texcoord = texcoord;\n"
+    "    v_opaque = opaque;\n"
+    "}\n";
+
+// wl_shm pixels are premultiplied BGRA in memory; without BGRA textures
+// they are uploaded as RGBA and swizzled here.
+const char* kFragmentShader =
+    "precision mediump float;\n"
+    "uniform sampler2D texture;\n"
+    "uniform float swizzle;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying float v_opaque;\n"
+    "void main() {\n"
+    "    vec4 color = texture2D(texture, v_texcoord);\n"
+    "    if (swizzle > 0.5) color = color.bgra;\n"
+    "    if (v_opaque > 0.5) color.a = 1.0;\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+bool has_extension(const char* name) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (!extensions) return false;
+    size_t length = strlen(name);
+    for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+        bool starts = found == extensions || found[-1] == ' ';
+        bool ends = found[length] == ' ' || found[length] == '\0';
+        if (starts && ends) return true;
+    }
+    return false;
+}
+
+GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        fprintf(stderr, "Failed to compile shader: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Pixels are drawn one to one or scaled up, never filtered.
+GLuint create_texture() {
+    GLuint name = 0;
+    glGenTextures(1, &name);
+    glBindTexture(GL_TEXTURE_2D, name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return name;
+}
+
+const int kVertexFloats = 5; // x, y, u, v, opaque
+
+} // namespace
+
+GlRenderer::GlRenderer(int32_t output_width, int32_t output_height, bool batch)
+    : output_width_(output_width), output_height_(output_height), batch_(batch) {
+}
+
+GlRenderer::~GlRenderer() {
+    for (auto& entry : textures_) {
+        if (!entry.second.in_atlas) glDeleteTextures(1, &entry.second.name);
+    }
+    if (atlas_texture_) glDeleteTextures(1, &atlas_texture_);
+    if (vertex_buffer_) glDeleteBuffers(1, &vertex_buffer_);
+    if (program_) glDeleteProgram(program_);
+}
+
+bool GlRenderer::init() {
+    unpack_subimage_ = has_extension("GL_EXT_unpack_subimage");
+    bgra_ = has_extension("GL_EXT_texture_format_BGRA8888");
+
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, kVertexShader);
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, kFragmentShader);
+    if (!vertex || !fragment) return false;
+    program_ = glCreateProgram();
+    glAttachShader(program_, vertex);
+    glAttachShader(program_, fragment);
+    glLinkProgram(program_);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        fprintf(stderr, "Failed to link shader program\n");
+        return false;
+    }
+    position_attribute_ = glGetAttribLocation(program_, "position");
+    texcoord_attribute_ = glGetAttribLocation(program_, "texcoord");
+    opaque_attribute_ = glGetAttribLocation(program_, "opaque");
+    swizzle_uniform_ = glGetUniformLocation(program_, "swizzle");
+
+    glUseProgram(program_);
+    glUniform1i(glGetUniformLocation(program_, "texture"), 0);
+    glUniform1f(swizzle_uniform_, bgra_ ? 0.0f : 1.0f);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // Premultiplied alpha.
+
+    if (batch_) {
+        GLint max_size = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+        int32_t size = std::min<int32_t>(kAtlasSize, max_size);
+        GLenum format = bgra_ ? GL_BGRA_EXT : GL_RGBA;
+        atlas_texture_ = create_texture();
+        glTexImage2D(GL_TEXTURE_2D, 0, format, size, size, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        atlas_.reset(new AtlasAllocator(size, size));
+        glGenBuffers(1, &vertex_buffer_);
+    }
+    return true;
+}
+
+bool GlRenderer::upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage) {
+    Texture& texture = textures_[id];
+    texture.opaque = buffer.opaque();
+
+    Region to_upload = damage;
+    if (texture.width != buffer.width || texture.height != buffer.height) {
+        place(texture, buffer);
+        to_upload = Region(buffer.bounds());
+    }
+    to_upload.intersect(buffer.bounds());
+
+    glBindTexture(GL_TEXTURE_2D, texture.name);
+    const int32_t dx = texture.in_atlas ? texture.slot.x : 0;
+    const int32_t dy = texture.in_atlas ? texture.slot.y : 0;
+    buffer.pool->begin_access();
+    for (const Rect& rect : to_upload.rects()) upload_rect(buffer, rect, dx, dy);
+    return buffer.pool->end_access();
+}
+
+// Finds the texture for a buffer of a new size: a slot in the atlas if it
+// is small and one is free, else a texture of its own.
+void GlRenderer::place(Texture& texture, const ShmBuffer& buffer) {
+    if (texture.in_atlas) {
+        atlas_->release(texture.slot);
+        texture.in_atlas = false;
+        texture.name = 0;
+    }
+    texture.width = buffer.width;
+    texture.height = buffer.height;
+    if (atlas_ && buffer.width <= kAtlasMaxSurface && buffer.height <= kAtlasMaxSurface &&
+        atlas_->allocate(buffer.width, buffer.height, texture.slot)) {
+        if (texture.name) glDeleteTextures(1, &texture.name);
+        texture.name = atlas_texture_;
+        texture.in_atlas = true;
+        return;
+    }
+    if (!texture.name) texture.name = create_texture();
+    else glBindTexture(GL_TEXTURE_2D, texture.name);
+    GLenum format = bgra_ ? GL_BGRA_EXT : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, format, buffer.width, buffer.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+}
+
+// Copies `rect` of the buffer to the bound texture, offset by (dx, dy).
+void GlRenderer::upload_rect(const ShmBuffer& buffer, const Rect& rect, int32_t dx, int32_t dy) {
+    GLenum format = bgra_ ? GL_BGRA_EXT : GL_RGBA;
+    const uint8_t* pixels = buffer.pixels();
+    if (unpack_subimage_ && buffer.stride % 4 == 0) {
+        // Straight from the pool: the driver skips to the rectangle.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, buffer.stride / 4);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, rect.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, rect.y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, dx + rect.x, dy + rect.y, rect.width, rect.height, format, GL_UNSIGNED_BYTE,
+                        pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
+    } else if (buffer.stride == buffer.width * 4) {
+        // Rows are contiguous, so whole rows can go in one call.
+        glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy + rect.y, buffer.width, rect.height, format, GL_UNSIGNED_BYTE,
+                        pixels + size_t(rect.y) * buffer.stride);
+    } else {
+        size_t row_bytes = size_t(rect.width) * 4;
+        scratch_.resize(row_bytes * rect.height);
+        for (int32_t row = 0; row < rect.height; ++row) {
+            memcpy(scratch_.data() + row * row_bytes,
+                   pixels + size_t(rect.y + row) * buffer.stride + size_t(rect.x) * 4, row_bytes);
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, dx + rect.x, dy + rect.y, rect.width, rect.height, format, GL_UNSIGNED_BYTE,
+                        scratch_.data());
+    }
+}
+
+void GlRenderer::remove(Scene::SurfaceId id) {
+    auto it = textures_.find(id);
+    if (it == textures_.end()) return;
+    if (it->second.in_atlas) atlas_->release(it->second.slot);
+    else glDeleteTextures(1, &it->second.name);
+    textures_.erase(it);
+}
+
+void GlRenderer::draw_quad(const Rect& bounds) {
+    float left = 2.0f * bounds.x / output_width_ - 1.0f;
+    float right = 2.0f * bounds.right() / output_width_ - 1.0f;
+    float top = 1.0f - 2.0f * bounds.y / output_height_;
+    float bottom = 1.0f - 2.0f * bounds.bottom() / output_height_;
+    const GLfloat positions[] = {left, top, left, bottom, right, top, right, bottom};
+    const GLfloat texcoords[] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+    glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, GL_FALSE, 0, positions);
+    glVertexAttribPointer(texcoord_attribute_, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void GlRenderer::add_quad(const Scene::Surface& surface, const Texture& texture, const Rect& rect, bool blend) {
+    // The texture can lag the surface size for one commit if an upload
+    // failed; never sample past it, into a neighbour in the atlas.
+    const int32_t scale = surface.scale;
+    Rect clipped = rect.intersect(Rect{surface.x, surface.y, texture.width / scale, texture.height / scale});
+    if (clipped.empty()) return;
+    if (runs_.empty() || runs_.back().texture != texture.name || runs_.back().blend != blend) {
+        Run run;
+        run.texture = texture.name;
+        run.blend = blend;
+        run.first = GLint(vertices_.size() / kVertexFloats);
+        runs_.push_back(run);
+    }
+    runs_.back().count += 6;
+
+    // Output pixels to buffer pixels to texels.
+    const float texture_width = float(texture.in_atlas ? atlas_->width() : texture.width);
+    const float texture_height = float(texture.in_atlas ? atlas_->height() : texture.height);
+    const int32_t origin_x = (texture.in_atlas ? texture.slot.x : 0) - surface.x * scale;
+    const int32_t origin_y = (texture.in_atlas ? texture.slot.y : 0) - surface.y * scale;
+    const GLfloat u0 = (origin_x + clipped.x * scale) / texture_width;
+    const GLfloat v0 = (origin_y + clipped.y * scale) / texture_height;
+    const GLfloat u1 = (origin_x + clipped.right() * scale) / texture_width;
+    const GLfloat v1 = (origin_y + clipped.bottom() * scale) / texture_height;
+    const GLfloat left = 2.0f * clipped.x / output_width_ - 1.0f;
+    const GLfloat right = 2.0f * clipped.right() / output_width_ - 1.0f;
+    const GLfloat top = 1.0f - 2.0f * clipped.y / output_height_;
+    const GLfloat bottom = 1.0f - 2.0f * clipped.bottom() / output_height_;
+    const GLfloat a = texture.opaque ? 1.0f : 0.0f;
+    const GLfloat quad[] = {
+        left,  top,    u0, v0, a,
+        left,  bottom, u0, v1, a,
+        right, top,    u1, v0, a,
+        right, top,    u1, v0, a,
+        left,  bottom, u0, v1, a,
+        right, bottom, u1, v1, a,
+    };
+    vertices_.insert(vertices_.end(), std::begin(quad), std::end(quad));
+}
+
+void GlRenderer::draw_batched(const Scene& scene, const std::vector<Scene::Layer>& layers, bool exclusive) {
+    vertices_.clear();
+    runs_.clear();
+    if (exclusive) {
+        // No two opaque rectangles overlap and nothing is drawn under one,
+        // so they can go first in any order: those in the atlas together.
+        for (bool in_atlas : {true, false}) {
+            for (const Scene::Layer& layer : layers) {
+                auto texture = textures_.find(layer.id);
+                if (texture == textures_.end() || texture->second.in_atlas != in_atlas) continue;
+                const Scene::Surface* surface = scene.surface(layer.id);
+                for (const Rect& rect : layer.opaque) add_quad(*surface, texture->second, rect, false);
+            }
+        }
+    }
+    for (const Scene::Layer& layer : layers) {
+        auto texture = textures_.find(layer.id);
+        if (texture == textures_.end()) continue;
+        const Scene::Surface* surface = scene.surface(layer.id);
+        if (!exclusive) {
+            for (const Rect& rect : layer.opaque) add_quad(*surface, texture->second, rect, false);
+        }
+        for (const Rect& rect : layer.blended) add_quad(*surface, texture->second, rect, true);
+    }
+    if (runs_.empty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(GLfloat), vertices_.data(), GL_STREAM_DRAW);
+    const GLsizei stride = kVertexFloats * sizeof(GLfloat);
+    glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glVertexAttribPointer(texcoord_attribute_, 2, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(2 * sizeof(GLfloat)));
+    glVertexAttribPointer(opaque_attribute_, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void*>(4 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(position_attribute_);
+    glEnableVertexAttribArray(texcoord_attribute_);
+    glEnableVertexAttribArray(opaque_attribute_);
+    GLuint bound = 0;
+    bool blending = false;
+    glDisable(GL_BLEND);
+    for (const Run& run : runs_) {
+        if (run.texture != bound) glBindTexture(GL_TEXTURE_2D, bound = run.texture);
+        if (run.blend != blending) {
+            blending = run.blend;
+            if (blending) glEnable(GL_BLEND);
+            else glDisable(GL_BLEND);
+        }
+        glDrawArrays(GL_TRIANGLES, run.first, run.count);
+    }
+    glDisableVertexAttribArray(position_attribute_);
+    glDisableVertexAttribArray(texcoord_attribute_);
+    glDisableVertexAttribArray(opaque_attribute_);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GlRenderer::draw_unbatched(const Scene& scene, const std::vector<Scene::Layer>& layers) {
+    glEnableVertexAttribArray(position_attribute_);
+    glEnableVertexAttribArray(texcoord_attribute_);
+    for (const Scene::Layer& layer : layers) {
+        const Scene::Surface* surface = scene.surface(layer.id);
+        auto texture = textures_.find(layer.id);
+        if (texture == textures_.end()) continue;
+        const Rect bounds = surface->bounds();
+        glBindTexture(GL_TEXTURE_2D, texture->second.name);
+        glVertexAttrib1f(opaque_attribute_, texture->second.opaque ? 1.0f : 0.0f);
+        // Opaque parts overwrite what is below; blending only where the
+        // surface may be translucent.
+        glDisable(GL_BLEND);
+        for (const Rect& rect : layer.opaque) {
+            glScissor(rect.x, output_height_ - rect.bottom(), rect.width, rect.height);
+            draw_quad(bounds);
+        }
+        if (!layer.blended.empty()) {
+            if (!texture->second.opaque) glEnable(GL_BLEND);
+            for (const Rect& rect : layer.blended) {
+                glScissor(rect.x, output_height_ - rect.bottom(), rect.width, rect.height);
+                draw_quad(bounds);
+            }
+        }
+    }
+    glDisableVertexAttribArray(position_attribute_);
+    glDisableVertexAttribArray(texcoord_attribute_);
+}
+
+void GlRenderer::draw(const Scene& scene, const Region& damage) {
+    Region background;
+    bool exclusive = true;
+    std::vector<Scene::Layer> layers = scene.visible_layers(damage, &background, &exclusive);
+    glViewport(0, 0, output_width_, output_height_);
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(1.0f, 0.0f, 0.0f, 1.0f); // Red background, as before.
+    for (const Rect& rect : background.rects()) {
+        glScissor(rect.x, output_height_ - rect.bottom(), rect.width, rect.height);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    for (const Scene::Layer& layer : layers) {
+        if (textures_.count(layer.id)) continue;
+        // Nothing uploaded yet; clear what it hides.
+        for (const Rect& rect : layer.opaque) {
+            glScissor(rect.x, output_height_ - rect.bottom(), rect.width, rect.height);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+    }
+
+    glUseProgram(program_);
+    glActiveTexture(GL_TEXTURE0);
+    if (batch_) {
+        // The quads are clipped already.
+        glDisable(GL_SCISSOR_TEST);
+        draw_batched(scene, layers, exclusive);
+    } else {
+        draw_unbatched(scene, layers);
+    }
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+} // namespace Neurodeck
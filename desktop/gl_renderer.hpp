@@ -0,0 +1,102 @@
+#ifndef DESKTOP_GL_RENDERER_HPP
+#define DESKTOP_GL_RENDERER_HPP
+
+#include "atlas.hpp"
+#include "region.hpp"
+#include "scene.hpp"
+#include "shm_pool.hpp"
+#include <GLES2/gl2.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Draws the scene with OpenGL ES 2.0 into whatever surface is current.
+//
+// Every surface keeps one texture for its whole life; a commit uploads only
+// the rectangles it damaged, straight from the client's pool with
+// GL_EXT_unpack_subimage when available, so the wl_buffer can be released
+// as soon as upload() returns. A new texture is allocated only when the
+// buffer size changes.
+//
+// Batched, surfaces up to kAtlasMaxSurface on a side (cursors, panels,
+// tooltips) share one atlas texture instead, and draw() builds every
+// visible rectangle of every surface as a quad in one vertex buffer,
+// uploaded once per frame: the opaque quads go first in a single draw
+// call, as no two of them overlap, then the blended ones bottom to top in
+// one call per run of quads from the same texture. Unbatched, each
+// rectangle is scissored and drawn on its own, binding each surface's
+// texture.
+class GlRenderer {
+public:
+    static constexpr int32_t kAtlasSize = 1024;
+    static constexpr int32_t kAtlasMaxSurface = 256;
+
+    GlRenderer(int32_t output_width, int32_t output_height, bool batch = true);
+    ~GlRenderer();
+
+    GlRenderer(const GlRenderer&) = delete;
+    GlRenderer& operator=(const GlRenderer&) = delete;
+
+    // Compiles the shaders; needs a current context, as does the rest.
+    bool init();
+
+    // Copies `damage` (buffer coordinates) of the buffer into the surface's
+    // texture. Returns false if the client truncated the pool meanwhile.
+    bool upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage);
+    void remove(Scene::SurfaceId id);
+
+    // Redraws `damage` (output coordinates, top-left origin) from the
+    // scene: clears the background where nothing opaque covers it, and
+    // draws only what Scene::visible_layers() leaves showing of each
+    // surface, with blending off in its opaque region.
+    void draw(const Scene& scene, const Region& damage);
+
+private:
+    struct Texture {
+        GLuint name = 0; // The atlas's if `in_atlas`.
+        int32_t width = 0;
+        int32_t height = 0;
+        bool opaque = false;
+        bool in_atlas = false;
+        Rect slot; // In the atlas.
+    };
+    // Consecutive quads drawn with one texture and blend state.
+    struct Run {
+        GLuint texture = 0;
+        bool blend = false;
+        GLint first = 0; // Vertex.
+        GLsizei count = 0;
+    };
+
+    void place(Texture& texture, const ShmBuffer& buffer);
+    void upload_rect(const ShmBuffer& buffer, const Rect& rect, int32_t dx, int32_t dy);
+    void draw_quad(const Rect& bounds);
+    void draw_unbatched(const Scene& scene, const std::vector<Scene::Layer>& layers);
+    void draw_batched(const Scene& scene, const std::vector<Scene::Layer>& layers, bool exclusive);
+    void add_quad(const Scene::Surface& surface, const Texture& texture, const Rect& rect, bool blend);
+
+    int32_t output_width_;
+    int32_t output_height_;
+    bool batch_;
+    bool unpack_subimage_ = false; // GL_EXT_unpack_subimage
+    bool bgra_ = false;            // GL_EXT_texture_format_BGRA8888
+    GLuint program_ = 0;
+    GLint position_attribute_ = -1;
+    GLint texcoord_attribute_ = -1;
+    GLint opaque_attribute_ = -1;
+    GLint swizzle_uniform_ = -1;
+    std::unordered_map<Scene::SurfaceId, Texture> textures_;
+    GLuint atlas_texture_ = 0;
+    std::unique_ptr<AtlasAllocator> atlas_;
+    GLuint vertex_buffer_ = 0;
+    std::vector<GLfloat> vertices_; // This frame's quads: x, y, u, v, opaque.
+    std::vector<Run> runs_;
+    std::vector<uint8_t> scratch_; // Rows repacked for uploads without unpack_subimage.
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_GL_RENDERER_HPP
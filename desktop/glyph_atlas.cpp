@@ -0,0 +1,58 @@
+#include "glyph_atlas.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Neurodeck {
+
+GlyphAtlas::GlyphAtlas(int cell_width, int cell_height, Rasterizer rasterizer, size_t capacity)
+    : cell_width_(cell_width),
+      cell_height_(cell_height),
+      rasterizer_(std::move(rasterizer)),
+      capacity_(std::max<size_t>(capacity, 1)),
+      masks_(capacity_ * cell_width * cell_height) {
+    std::fill(&ascii_[0][0], &ascii_[0][0] + 2 * 128, kAbsent);
+}
+
+const uint8_t* GlyphAtlas::lookup(char32_t ch, bool bold) {
+    if (ch < 128) {
+        if (ascii_[bold][ch] == kAbsent) {
+            // Stored after add(), which may empty the tables.
+            int32_t index = add(ch, bold);
+            ascii_[bold][ch] = index;
+        }
+        return slot(ascii_[bold][ch]);
+    }
+    const uint32_t key = uint32_t(ch) | uint32_t(bold) << 31;
+    auto found = others_.find(key);
+    if (found != others_.end()) return slot(found->second);
+    int32_t index = add(ch, bold);
+    others_[key] = index;
+    return slot(index);
+}
+
+// Rasterizes into the next free slot. Glyphs the font lacks are drawn as
+// an empty box.
+int32_t GlyphAtlas::add(char32_t ch, bool bold) {
+    if (used_ == capacity_) {
+        used_ = 0;
+        std::fill(&ascii_[0][0], &ascii_[0][0] + 2 * 128, kAbsent);
+        others_.clear();
+    }
+    const size_t size = size_t(cell_width_) * cell_height_;
+    uint8_t* mask = &masks_[used_ * size];
+    std::memset(mask, 0, size);
+    ++rasterized_;
+    if (!rasterizer_(ch, bold, mask)) {
+        std::memset(mask, 0, size);
+        const int left = 1, right = cell_width_ - 2, top = 2, bottom = cell_height_ - 3;
+        for (int y = top; y <= bottom; ++y) {
+            for (int x = left; x <= right; ++x) {
+                if (y == top || y == bottom || x == left || x == right) mask[y * cell_width_ + x] = 255;
+            }
+        }
+    }
+    if (std::all_of(mask, mask + size, [](uint8_t coverage) { return coverage == 0; })) return kBlank;
+    return int32_t(used_++);
+}
+
+} // namespace Neurodeck
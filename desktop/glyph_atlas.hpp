@@ -0,0 +1,57 @@
+#ifndef DESKTOP_GLYPH_ATLAS_HPP
+#define DESKTOP_GLYPH_ATLAS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// Glyph coverage masks, one cell in size, rasterized once each and kept in
+// a single page of `capacity` slots.
+//
+// ASCII is found through a table, everything else through a hash map.
+// When the page is full it is emptied and filled again as glyphs are asked
+// for, which only costs rasterizing them anew.
+class GlyphAtlas {
+public:
+    // Draws `ch` into a zeroed cell_width x cell_height mask, a byte of
+    // coverage per pixel; false if the font has no glyph for it.
+    using Rasterizer = std::function<bool(char32_t ch, bool bold, uint8_t* mask)>;
+
+    GlyphAtlas(int cell_width, int cell_height, Rasterizer rasterizer, size_t capacity = 4096);
+
+    int cell_width() const { return cell_width_; }
+    int cell_height() const { return cell_height_; }
+
+    // The mask for `ch`, cell_width() bytes per row, or nullptr if it is
+    // blank. Valid until the next lookup.
+    const uint8_t* lookup(char32_t ch, bool bold);
+
+    size_t rasterized() const { return rasterized_; } // Cache misses so far.
+
+private:
+    static constexpr int32_t kBlank = -1;
+    static constexpr int32_t kAbsent = -2;
+
+    int32_t add(char32_t ch, bool bold);
+    const uint8_t* slot(int32_t index) const {
+        return index < 0 ? nullptr : &masks_[size_t(index) * cell_width_ * cell_height_];
+    }
+
+    int cell_width_;
+    int cell_height_;
+    Rasterizer rasterizer_;
+    size_t capacity_;
+    std::vector<uint8_t> masks_;
+    size_t used_ = 0;
+    int32_t ascii_[2][128]; // Slot by weight and character.
+    std::unordered_map<uint32_t, int32_t> others_;
+    size_t rasterized_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_GLYPH_ATLAS_HPP
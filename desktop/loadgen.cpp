@@ -0,0 +1,302 @@
+// Synthetic load for the compositor: N surfaces, each double-buffered in
+// its own pool, moving a small square and committing at a fixed rate, to
+// see how the compositor scales with the number of clients' surfaces.
+//
+//   neurodeck_compositor_loadgen [--surfaces N] [--rate HZ] [--size WxH]
+//                                [--seconds S] [--frame]
+//
+// Every surface commits --rate times a second; 0 means as fast as its
+// buffers come back. A surface whose buffers are both still held by the
+// compositor when its turn comes skips that commit, and the skips are
+// reported. --frame also waits for a frame callback between commits. The
+// compositor's own side of the numbers comes from its --frame-stats.
+#include <wayland-client.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+static struct wl_compositor *compositor = nullptr;
+static struct wl_shm *shm = nullptr;
+
+static const int32_t kSquare = 16;
+static const uint32_t kBackground = 0xff202020;
+
+struct LoadBuffer {
+    struct wl_buffer *buffer = nullptr;
+    uint32_t *pixels = nullptr;
+    bool busy = false; // Attached and not yet released.
+    int64_t committed_nsec = 0;
+};
+
+struct LoadSurface {
+    struct wl_surface *surface = nullptr;
+    LoadBuffer buffers[2];
+    void *memory = nullptr;
+    uint32_t color = 0;
+    int frame = 0; // Commits so far.
+    bool frame_done = true;
+};
+
+static int32_t width = 128;
+static int32_t height = 128;
+static bool use_frame_callbacks = false;
+
+// Client-side totals.
+static uint64_t commits = 0;
+static uint64_t skips = 0;
+static uint64_t releases = 0;
+static int64_t release_nsec_total = 0; // Commit to release.
+static int64_t release_nsec_max = 0;
+
+static int64_t now_nsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static void registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version) {
+    if (strcmp(interface, "wl_compositor") == 0) {
+        compositor = static_cast<struct wl_compositor *>(wl_registry_bind(registry, name, &wl_compositor_interface, 4));
+    } else if (strcmp(interface, "wl_shm") == 0) {
+        shm = static_cast<struct wl_shm *>(wl_registry_bind(registry, name, &wl_shm_interface, 1));
+    }
+}
+
+static void registry_global_remove(void *data, struct wl_registry *registry, uint32_t name) {
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+static void buffer_release(void *data, struct wl_buffer *buffer) {
+    LoadBuffer *load_buffer = static_cast<LoadBuffer *>(data);
+    load_buffer->busy = false;
+    int64_t held_nsec = now_nsec() - load_buffer->committed_nsec;
+    ++releases;
+    release_nsec_total += held_nsec;
+    release_nsec_max = std::max(release_nsec_max, held_nsec);
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void frame_callback_done(void *data, struct wl_callback *callback, uint32_t time) {
+    static_cast<LoadSurface *>(data)->frame_done = true;
+    wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_callback_done,
+};
+
+static void fill(uint32_t *pixels, int32_t x, int32_t y, int32_t fill_width, int32_t fill_height, uint32_t color) {
+    for (int32_t row = y; row < y + fill_height; ++row) {
+        std::fill(pixels + row * width + x, pixels + row * width + x + fill_width, color);
+    }
+}
+
+static bool create_load_surface(LoadSurface &load, int index) {
+    int32_t stride = width * 4;
+    int32_t buffer_bytes = stride * height;
+    int fd = memfd_create("neurodeck-loadgen", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, buffer_bytes * 2) < 0) return false;
+    load.memory = mmap(nullptr, buffer_bytes * 2, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (load.memory == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, buffer_bytes * 2);
+    for (int i = 0; i < 2; ++i) {
+        LoadBuffer &buffer = load.buffers[i];
+        buffer.pixels = reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(load.memory) + i * buffer_bytes);
+        fill(buffer.pixels, 0, 0, width, height, kBackground);
+        buffer.buffer = wl_shm_pool_create_buffer(pool, i * buffer_bytes, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+        wl_buffer_add_listener(buffer.buffer, &buffer_listener, &buffer);
+    }
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    load.surface = wl_compositor_create_surface(compositor);
+    load.color = 0xff000000 | (static_cast<uint32_t>(index) * 0x9e3779b9u & 0xffffff);
+    return true;
+}
+
+// Draws the next position of the square into a free buffer and commits it,
+// damaging only where the square was and is. False if there is no free
+// buffer or the frame callback is outstanding.
+static bool commit_next(LoadSurface &load) {
+    if (use_frame_callbacks && !load.frame_done) return false;
+    LoadBuffer &buffer = load.buffers[load.frame % 2];
+    if (buffer.busy) return false;
+
+    int32_t track = width - kSquare;
+    auto square_x = [track](int frame) { return frame < 0 ? 0 : frame % track; };
+    int32_t y = (height - kSquare) / 2;
+    // This buffer shows the square from two commits ago.
+    if (load.frame >= 2) fill(buffer.pixels, square_x(load.frame - 2), y, kSquare, kSquare, kBackground);
+    fill(buffer.pixels, square_x(load.frame - 1), y, kSquare, kSquare, kBackground);
+    fill(buffer.pixels, square_x(load.frame), y, kSquare, kSquare, load.color);
+
+    wl_surface_attach(load.surface, buffer.buffer, 0, 0);
+    if (load.frame == 0) {
+        wl_surface_damage_buffer(load.surface, 0, 0, width, height);
+    } else {
+        wl_surface_damage_buffer(load.surface, square_x(load.frame - 1), y, kSquare, kSquare);
+        wl_surface_damage_buffer(load.surface, square_x(load.frame), y, kSquare, kSquare);
+    }
+    if (use_frame_callbacks) {
+        load.frame_done = false;
+        wl_callback_add_listener(wl_surface_frame(load.surface), &frame_listener, &load);
+    }
+    wl_surface_commit(load.surface);
+    buffer.busy = true;
+    buffer.committed_nsec = now_nsec();
+    ++load.frame;
+    ++commits;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int surface_count = 16;
+    double rate = 60;
+    double seconds = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--surfaces") == 0 && i + 1 < argc) {
+            surface_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) width = height = 0;
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frame") == 0) {
+            use_frame_callbacks = true;
+        } else {
+            fprintf(stderr, "usage: %s [--surfaces N] [--rate HZ] [--size WxH] [--seconds S] [--frame]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (width <= kSquare || height < kSquare) {
+        fprintf(stderr, "Surfaces must be larger than %dx%d\n", kSquare, kSquare);
+        return 2;
+    }
+    if (surface_count <= 0 || rate < 0 || seconds <= 0) {
+        fprintf(stderr, "Need at least one surface, a rate of 0 or more and a positive duration\n");
+        return 2;
+    }
+
+    struct wl_display *display = wl_display_connect(nullptr);
+    if (!display) {
+        fprintf(stderr, "Failed to connect to the Wayland display\n");
+        return 1;
+    }
+    struct wl_registry *registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &registry_listener, nullptr);
+    wl_display_roundtrip(display);
+    if (!compositor || !shm) {
+        fprintf(stderr, "Compositor lacks wl_compositor or wl_shm\n");
+        return 1;
+    }
+
+    // Buffers point back at their surface, so the vector never reallocates.
+    std::vector<LoadSurface> surfaces(surface_count);
+    for (int i = 0; i < surface_count; ++i) {
+        if (!create_load_surface(surfaces[i], i)) {
+            fprintf(stderr, "Failed to create shared memory for surface %d\n", i);
+            return 1;
+        }
+    }
+    wl_display_roundtrip(display);
+
+    // Ticks at the commit rate; with no rate, surfaces commit whenever a
+    // release or frame callback frees them.
+    int timer_fd = -1;
+    if (rate > 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        int64_t period_nsec = std::max<int64_t>(1, static_cast<int64_t>(1e9 / rate));
+        struct itimerspec period = {};
+        period.it_interval.tv_sec = period_nsec / 1000000000;
+        period.it_interval.tv_nsec = period_nsec % 1000000000;
+        period.it_value = period.it_interval;
+        if (timer_fd < 0 || timerfd_settime(timer_fd, 0, &period, nullptr) < 0) {
+            fprintf(stderr, "Failed to create the commit timer\n");
+            return 1;
+        }
+    }
+
+    int64_t start_nsec = now_nsec();
+    int64_t end_nsec = start_nsec + static_cast<int64_t>(seconds * 1e9);
+    bool tick = true; // The first commits go out at once.
+    for (;;) {
+        if (tick || rate == 0) {
+            for (LoadSurface &load : surfaces) {
+                if (!commit_next(load) && tick) ++skips;
+            }
+            tick = false;
+        }
+        int64_t now = now_nsec();
+        if (now >= end_nsec) break;
+
+        while (wl_display_prepare_read(display) != 0) wl_display_dispatch_pending(display);
+        wl_display_flush(display);
+        struct pollfd fds[2] = {{wl_display_get_fd(display), POLLIN, 0}, {timer_fd, POLLIN, 0}};
+        int timeout_ms = static_cast<int>((end_nsec - now + 999999) / 1000000);
+        if (poll(fds, timer_fd >= 0 ? 2 : 1, timeout_ms) < 0 && errno != EINTR) {
+            wl_display_cancel_read(display);
+            perror("poll");
+            return 1;
+        }
+        if (fds[0].revents & POLLIN) {
+            if (wl_display_read_events(display) < 0) {
+                fprintf(stderr, "Lost the connection after %llu commits\n", static_cast<unsigned long long>(commits));
+                return 1;
+            }
+        } else {
+            wl_display_cancel_read(display);
+        }
+        if (wl_display_dispatch_pending(display) < 0) {
+            fprintf(stderr, "Lost the connection after %llu commits\n", static_cast<unsigned long long>(commits));
+            return 1;
+        }
+        uint64_t expirations;
+        if (timer_fd >= 0 && (fds[1].revents & POLLIN) && read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+            tick = true;
+            // Ticks missed while busy count as skipped for every surface.
+            skips += (expirations - 1) * surfaces.size();
+        }
+    }
+    double elapsed = (now_nsec() - start_nsec) / 1e9;
+    wl_display_roundtrip(display);
+
+    if (rate > 0) {
+        printf("%d surfaces of %dx%d at %.0f Hz for %.1f s\n", surface_count, width, height, rate, elapsed);
+    } else {
+        printf("%d surfaces of %dx%d, unpaced, for %.1f s\n", surface_count, width, height, elapsed);
+    }
+    printf("%llu commits: %.0f/s, %.1f/s per surface; %llu skipped for want of a free buffer%s\n",
+           static_cast<unsigned long long>(commits), commits / elapsed, commits / elapsed / surface_count,
+           static_cast<unsigned long long>(skips), use_frame_callbacks ? " or frame callback" : "");
+    printf("%llu releases, commit to release mean %.2f ms, max %.2f ms\n",
+           static_cast<unsigned long long>(releases),
+           releases ? release_nsec_total / 1e6 / releases : 0.0, release_nsec_max / 1e6);
+
+    if (timer_fd >= 0) close(timer_fd);
+    for (LoadSurface &load : surfaces) {
+        wl_surface_destroy(load.surface);
+        for (LoadBuffer &buffer : load.buffers) wl_buffer_destroy(buffer.buffer);
+        munmap(load.memory, static_cast<size_t>(width) * height * 4 * 2);
+    }
+    wl_display_disconnect(display);
+    return 0;
+}
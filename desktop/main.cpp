@@ -1,57 +1,332 @@
 #include <wayland-server.h>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <EGL/egl.h>
-#include <wayland-egl.h> // Needs to be included after EGL/egl.h
-#include <GLES2/gl2.h>
+#include <ctime>
+#include <algorithm>
+#include <csignal>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "backend.hpp"
+#include "font.hpp"
+#include "frame_scheduler.hpp"
+#include "frame_stats.hpp"
+#include "glyph_atlas.hpp"
+#include "presentation-time-server-protocol.h"
+#include "pty.hpp"
+#include "render_thread.hpp"
+#include "scene.hpp"
+#include "shm_pool.hpp"
+#include "terminal.hpp"
+#include "terminal_renderer.hpp"
 
 // Global Wayland objects
 static struct wl_display *display = nullptr;
 static struct wl_event_loop *loop = nullptr;
 
-// Global EGL objects
-static EGLDisplay egl_display = EGL_NO_DISPLAY;
-static EGLConfig egl_config = nullptr;
-static EGLContext egl_context = EGL_NO_CONTEXT;
+// The output. There is no display hardware to drive yet, so it is an
+// offscreen framebuffer, drawn with GL or on the CPU.
+static const int32_t kOutputWidth = 640;
+static const int32_t kOutputHeight = 480;
 
-// Global client surface resources (for the first client that creates a surface)
-static struct wl_surface *g_client_surface = nullptr;
-static struct wl_egl_window *g_client_egl_window = nullptr;
-static EGLSurface g_client_egl_rendering_surface = EGL_NO_SURFACE;
+// Every client surface, in stacking order, with the damage since the last
+// frame.
+static Neurodeck::Scene scene(kOutputWidth, kOutputHeight);
 
-// Timer for rendering
+// Owns the backend (chosen with --backend), which keeps the surface pixels
+// and draws the output, on a thread of its own.
+static Neurodeck::RenderThread render_thread;
+
+// A wl_buffer in one of our shm pools. An attached buffer is referenced by
+// the surface until commit, so one destroyed in between can still be read.
+struct Buffer {
+    struct wl_resource *resource = nullptr; // Null once the client destroyed it.
+    Neurodeck::ShmBuffer shm;
+};
+
+// User data of a wl_surface resource.
+struct SurfaceState {
+    Neurodeck::Scene::SurfaceId id = 0;
+    bool attached = false;                  // attach since the last commit...
+    std::shared_ptr<Buffer> pending_buffer; // ...of this buffer, or null.
+};
+
+// When to draw next, and the frame callbacks and presentation feedback
+// waiting for it.
+static Neurodeck::FrameScheduler frame_scheduler;
+
+// Fires at the next refresh while a frame is scheduled; disarmed otherwise,
+// so an idle desktop never wakes up.
 static struct wl_event_source *g_render_timer_source = nullptr;
+static bool g_render_timer_armed = false;
+// A frame was handed to the render thread and has not come back. The next
+// one waits for it; clients are still served meanwhile.
+static bool g_frame_in_flight = false;
+
+// Timing of the last frames, exported with --frame-stats and --frame-trace.
+static Neurodeck::FrameStats frame_stats;
+// Cleared by SIGINT and SIGTERM.
+static bool g_running = true;
+
+// The built-in terminal (--terminal PROGRAM): a surface of the compositor's
+// own, under every client, showing PROGRAM on a pty. Output is parsed as
+// it arrives; at each frame the cells it changed are drawn into the
+// surface's buffer and uploaded as a client's commit would be. Until there
+// is a wl_seat, keyboard input is what arrives on our stdin.
+struct BuiltinTerminal {
+    Neurodeck::Font font;
+    std::unique_ptr<Neurodeck::GlyphAtlas> glyphs;
+    std::unique_ptr<Neurodeck::Terminal> terminal;
+    std::unique_ptr<Neurodeck::TerminalRenderer> renderer;
+    Neurodeck::Scene::SurfaceId id = 0;
+    Neurodeck::ShmBuffer buffer; // In a memfd of ours...
+    uint8_t *pixels = nullptr;   // ...mapped writable here.
+    std::shared_ptr<void> token; // Identifies its uploads among the completions.
+    bool uploading = false;      // The render thread may be reading the pixels.
+    bool changed = false;        // Output since the last draw.
+    int master = -1;
+    pid_t pid = -1;
+    struct wl_event_source *output_source = nullptr;
+    struct wl_event_source *input_source = nullptr;
+};
+static BuiltinTerminal builtin_terminal;
+static const int kTerminalFontSize = 13; // Pixels per em; 8x16 cells in DejaVu Sans Mono.
 
 
 // Wayland globals (interfaces)
-// Generic resource destroy callback
-static void handle_destroy(struct wl_resource *resource)
+// Generic resource destroy callback; these resources own nothing.
+static void handle_destroy(struct wl_resource *)
 {
-    // cleanup if needed
-    printf("Resource %p destroyed\n", resource);
 }
 
-// Specific destroy handler for our global surface resource
+static int64_t now_nsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Arms the render timer for the next refresh if a frame is wanted.
+static void schedule_repaint() {
+    if (g_render_timer_armed || g_frame_in_flight || !frame_scheduler.scheduled() || !g_render_timer_source) {
+        return;
+    }
+    int64_t target_nsec = frame_scheduler.next_refresh(now_nsec());
+    frame_stats.targeted(target_nsec);
+    int64_t delay_nsec = target_nsec - now_nsec();
+    // Rounded up, so the timer never fires before the refresh; 0 would
+    // disarm it.
+    int delay_ms = static_cast<int>(std::max<int64_t>(1, (delay_nsec + 999999) / 1000000));
+    wl_event_source_timer_update(g_render_timer_source, delay_ms);
+    g_render_timer_armed = true;
+}
+
+static void send_feedback_discarded(const std::vector<Neurodeck::FrameScheduler::Listener> &feedback) {
+    for (Neurodeck::FrameScheduler::Listener listener : feedback) {
+        struct wl_resource *resource = static_cast<struct wl_resource *>(listener);
+        wp_presentation_feedback_send_discarded(resource);
+        wl_resource_destroy(resource);
+    }
+}
+
+static SurfaceState *surface_state(struct wl_resource *resource) {
+    return static_cast<SurfaceState *>(wl_resource_get_user_data(resource));
+}
+
+static Neurodeck::Scene::SurfaceId surface_id(struct wl_resource *resource) {
+    return surface_state(resource)->id;
+}
+
+// Removes the surface from the scene, which damages where it was.
 static void handle_surface_destroy(struct wl_resource *resource) {
-    printf("Surface resource %p destroyed\n", resource);
-    if (g_client_surface == (struct wl_surface *)resource) {
-        g_client_surface = nullptr;
-        // Note: g_client_egl_window and g_client_egl_rendering_surface should be cleaned up
-        // before or around the time the wl_surface is actually destroyed.
-        // For this example, we'll do it in main's cleanup.
+    SurfaceState *state = surface_state(resource);
+    Neurodeck::Scene::SurfaceId id = state->id;
+    delete state;
+    scene.destroy_surface(id);
+    render_thread.remove(id);
+    send_feedback_discarded(frame_scheduler.remove_surface(id));
+    if (scene.needs_frame()) frame_scheduler.schedule();
+    schedule_repaint();
+}
+
+// Frame callbacks and feedback a client destroys are never sent.
+static void handle_listener_destroy(struct wl_resource *resource) {
+    frame_scheduler.forget(resource);
+}
+
+// wl_surface requests. Everything but frame only updates pending state in
+// the scene; commit applies it.
+static void surface_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static std::shared_ptr<Buffer> buffer_from_resource(struct wl_resource *resource);
+
+static void surface_attach(struct wl_client *client, struct wl_resource *resource,
+                           struct wl_resource *buffer, int32_t x, int32_t y) {
+    std::shared_ptr<Buffer> attached = buffer ? buffer_from_resource(buffer) : nullptr;
+    if (buffer && !attached) {
+        // Only wl_shm is advertised, so the client made this up.
+        wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "wl_buffer@%u is not a wl_shm buffer",
+                               wl_resource_get_id(buffer));
+        return;
+    }
+    SurfaceState *state = surface_state(resource);
+    state->attached = true;
+    state->pending_buffer = std::move(attached);
+    if (state->pending_buffer) {
+        const Neurodeck::ShmBuffer &shm = state->pending_buffer->shm;
+        scene.attach(state->id, shm.width, shm.height, x, y, shm.opaque());
+    } else {
+        scene.attach(state->id, 0, 0, x, y);
+    }
+}
+
+static void surface_damage(struct wl_client *client, struct wl_resource *resource,
+                           int32_t x, int32_t y, int32_t width, int32_t height) {
+    scene.damage(surface_id(resource), Neurodeck::Rect{x, y, width, height});
+}
+
+static void surface_frame(struct wl_client *client, struct wl_resource *resource, uint32_t callback) {
+    struct wl_resource *callback_resource = wl_resource_create(client, &wl_callback_interface, 1, callback);
+    if (!callback_resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(callback_resource, nullptr, nullptr, handle_listener_destroy);
+    frame_scheduler.frame(surface_id(resource), callback_resource);
+}
+
+static Neurodeck::Region *region_from_resource(struct wl_resource *resource) {
+    return static_cast<Neurodeck::Region *>(wl_resource_get_user_data(resource));
+}
+
+// The region is copied, so the client can destroy or change it at once.
+static void surface_set_opaque_region(struct wl_client *client, struct wl_resource *resource,
+                                      struct wl_resource *region) {
+    scene.set_opaque_region(surface_id(resource), region ? *region_from_resource(region) : Neurodeck::Region());
+}
+
+static void surface_set_input_region(struct wl_client *client, struct wl_resource *resource,
+                                     struct wl_resource *region) {
+    scene.set_input_region(surface_id(resource), region ? region_from_resource(region) : nullptr);
+}
+
+// Applies the pending state; a frame follows at the next refresh if the
+// commit changed something on screen or asked to be told when it is shown.
+static void surface_commit(struct wl_client *client, struct wl_resource *resource) {
+    SurfaceState *state = surface_state(resource);
+    Neurodeck::Scene::SurfaceId id = state->id;
+    scene.commit(id);
+    frame_stats.committed(now_nsec());
+    if (state->attached) {
+        std::shared_ptr<Buffer> buffer = std::move(state->pending_buffer);
+        state->attached = false;
+        if (!buffer) {
+            render_thread.remove(id);
+        } else {
+            // The render thread copies the damaged pixels and hands the
+            // buffer back; it is released then, without waiting for a frame.
+            render_thread.upload(id, buffer->shm, scene.surface(id)->buffer_damage, buffer);
+        }
     }
+    send_feedback_discarded(frame_scheduler.commit(id));
+    if (scene.needs_frame()) frame_scheduler.schedule();
+    schedule_repaint();
+}
+
+static void surface_set_buffer_transform(struct wl_client *client, struct wl_resource *resource,
+                                         int32_t transform) {
+    // Buffers are always drawn untransformed.
 }
 
+static void surface_set_buffer_scale(struct wl_client *client, struct wl_resource *resource, int32_t scale) {
+    if (scale < 1) {
+        wl_resource_post_error(resource, WL_SURFACE_ERROR_INVALID_SCALE, "buffer scale must be at least one");
+        return;
+    }
+    scene.set_buffer_scale(surface_id(resource), scale);
+}
+
+static void surface_damage_buffer(struct wl_client *client, struct wl_resource *resource,
+                                  int32_t x, int32_t y, int32_t width, int32_t height) {
+    scene.damage_buffer(surface_id(resource), Neurodeck::Rect{x, y, width, height});
+}
+
+static const struct wl_surface_interface app_surface_implementation = {
+    .destroy = surface_destroy,
+    .attach = surface_attach,
+    .damage = surface_damage,
+    .frame = surface_frame,
+    .set_opaque_region = surface_set_opaque_region,
+    .set_input_region = surface_set_input_region,
+    .commit = surface_commit,
+    .set_buffer_transform = surface_set_buffer_transform,
+    .set_buffer_scale = surface_set_buffer_scale,
+    .damage_buffer = surface_damage_buffer,
+};
+
+
+// wl_region: a Region built up by the client, then copied into surfaces
+// with set_opaque_region and set_input_region.
+static void handle_region_destroy(struct wl_resource *resource) {
+    delete region_from_resource(resource);
+}
+
+static void region_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+// Clients pass INT32_MAX sizes for "everything"; keep right() and bottom()
+// from overflowing.
+static Neurodeck::Rect region_rect(int32_t x, int32_t y, int32_t width, int32_t height) {
+    width = static_cast<int32_t>(std::min<int64_t>(width, int64_t(INT32_MAX) - x));
+    height = static_cast<int32_t>(std::min<int64_t>(height, int64_t(INT32_MAX) - y));
+    return Neurodeck::Rect{x, y, width, height};
+}
+
+static void region_add(struct wl_client *client, struct wl_resource *resource,
+                       int32_t x, int32_t y, int32_t width, int32_t height) {
+    region_from_resource(resource)->add(region_rect(x, y, width, height));
+}
+
+static void region_subtract(struct wl_client *client, struct wl_resource *resource,
+                            int32_t x, int32_t y, int32_t width, int32_t height) {
+    region_from_resource(resource)->subtract(region_rect(x, y, width, height));
+}
+
+static const struct wl_region_interface app_region_implementation = {
+    .destroy = region_destroy,
+    .add = region_add,
+    .subtract = region_subtract,
+};
 
 // Forward declaration for compositor interface
 static void compositor_interface_create_surface(struct wl_client *client, struct wl_resource *compositor_resource, uint32_t id);
 
+static void compositor_interface_create_region(struct wl_client *client, struct wl_resource *compositor_resource,
+                                               uint32_t id) {
+    struct wl_resource *region_resource = wl_resource_create(client, &wl_region_interface, wl_resource_get_version(compositor_resource), id);
+    if (!region_resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(region_resource, &app_region_implementation, new Neurodeck::Region,
+                                   handle_region_destroy);
+}
+
 static const struct wl_compositor_interface app_compositor_implementation = {
     .create_surface = compositor_interface_create_surface,
-    // .create_region = NULL, // create_region is also part of wl_compositor_interface, but can be NULL if not implemented
+    .create_region = compositor_interface_create_region,
 };
 
-// Implementation of wl_compositor.create_surface
+// Implementation of wl_compositor.create_surface: every surface gets a node
+// in the scene, on top of the others.
 static void compositor_interface_create_surface(struct wl_client *client,
                                             struct wl_resource *compositor_resource, // This is the client's wl_compositor resource
                                             uint32_t id)
@@ -62,46 +337,9 @@ static void compositor_interface_create_surface(struct wl_client *client,
         fprintf(stderr, "Failed to create surface resource for client.\n");
         return;
     }
-    // Set a specific destroy handler if we want to track our global surface
-    wl_resource_set_implementation(surface_resource, NULL /* no methods needed for wl_surface itself from server side for EGL */, 
-                                   NULL /* no server-side data associated with wl_surface directly */, 
-                                   handle_surface_destroy);
-    printf("wl_surface (id=%u) created for client %p\n", id, client);
-
-    // HACK: Store the first created surface globally for EGL window creation.
-    // A real compositor would manage a list of surfaces or associate EGL parts differently.
-    if (!g_client_surface) {
-        g_client_surface = (struct wl_surface*)surface_resource; // wl_resource is the server-side representation of wl_surface
-        printf("Stored as g_client_surface: %p\n", g_client_surface);
-
-        // Now that we have a wl_surface, create the wl_egl_window and EGLSurface
-        if (egl_display != EGL_NO_DISPLAY && egl_config != NULL) {
-            printf("Attempting to create wl_egl_window with surface %p\n", g_client_surface);
-            g_client_egl_window = wl_egl_window_create(g_client_surface, 640, 480); // Fixed size for now
-            if (!g_client_egl_window) {
-                fprintf(stderr, "Failed to create wl_egl_window\n");
-                // Don't clear g_client_surface here, its lifecycle is managed by Wayland.
-                // But we can't proceed to create EGL rendering surface.
-                return;
-            }
-            printf("wl_egl_window created: %p\n", g_client_egl_window);
-
-            g_client_egl_rendering_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)g_client_egl_window, NULL);
-            if (g_client_egl_rendering_surface == EGL_NO_SURFACE) {
-                fprintf(stderr, "Failed to create EGL window surface, EGL error %x\n", eglGetError());
-                wl_egl_window_destroy(g_client_egl_window);
-                g_client_egl_window = NULL;
-                // Don't clear g_client_surface here.
-                return;
-            }
-            printf("EGL rendering surface created: %p\n", g_client_egl_rendering_surface);
-            printf("Created wl_surface, wl_egl_window, and EGL surface for the first client.\n");
-        } else {
-            fprintf(stderr, "EGL not ready or surface not created properly, cannot create EGL window/surface.\n");
-        }
-    } else {
-        printf("Another client created a surface, not using for global EGL window.\n");
-    }
+    SurfaceState *state = new SurfaceState;
+    state->id = scene.create_surface();
+    wl_resource_set_implementation(surface_resource, &app_surface_implementation, state, handle_surface_destroy);
 }
 
 // Bind callback for compositor interface
@@ -120,55 +358,236 @@ static void bind_compositor(struct wl_client *client,
     // Set the compositor implementation that handles create_surface
     // The 'data' here could be a pointer to our main compositor struct if we had one.
     wl_resource_set_implementation(resource, &app_compositor_implementation, data, handle_destroy);
-    printf("Client %p bound to wl_compositor (id=%u)\n", client, id);
     // The actual surface creation will happen when the client calls wl_compositor.create_surface,
     // which will trigger compositor_interface_create_surface above.
 }
 
-// Basic OpenGL ES v2 rendering function
-static void render_solid_color() {
-    if (egl_display == EGL_NO_DISPLAY || 
-        g_client_egl_rendering_surface == EGL_NO_SURFACE || 
-        egl_context == EGL_NO_CONTEXT) {
-        // fprintf(stderr, "render_solid_color: EGL resources not ready.\n");
+// Tells clients the frame is on screen: frame callbacks get its time in
+// milliseconds and may draw again, presentation feedback gets the exact
+// refresh time and sequence number.
+static void send_frame_done(const Neurodeck::FrameScheduler::Frame &frame) {
+    uint32_t time_ms = static_cast<uint32_t>(frame.presented_nsec / 1000000);
+    for (Neurodeck::FrameScheduler::Listener listener : frame.callbacks) {
+        struct wl_resource *callback = static_cast<struct wl_resource *>(listener);
+        wl_callback_send_done(callback, time_ms);
+        wl_resource_destroy(callback);
+    }
+    uint64_t seconds = static_cast<uint64_t>(frame.presented_nsec / 1000000000);
+    uint32_t nanoseconds = static_cast<uint32_t>(frame.presented_nsec % 1000000000);
+    for (Neurodeck::FrameScheduler::Listener listener : frame.feedback) {
+        struct wl_resource *feedback = static_cast<struct wl_resource *>(listener);
+        // The refresh is emulated on the monotonic clock, so only the
+        // vsync pacing is real.
+        wp_presentation_feedback_send_presented(feedback,
+                                                static_cast<uint32_t>(seconds >> 32),
+                                                static_cast<uint32_t>(seconds),
+                                                nanoseconds,
+                                                static_cast<uint32_t>(frame_scheduler.refresh_nsec()),
+                                                static_cast<uint32_t>(frame.sequence >> 32),
+                                                static_cast<uint32_t>(frame.sequence),
+                                                WP_PRESENTATION_FEEDBACK_KIND_VSYNC);
+        wl_resource_destroy(feedback);
+    }
+}
+
+// The refresh a frame was scheduled for has come: hand what changed to the
+// render thread, with a copy of the scene to draw it from. Clients waiting
+// for the frame are answered when it comes back.
+static void draw_terminal();
+
+static int render_timer_callback(void *data) {
+    g_render_timer_armed = false;
+    draw_terminal();
+    Neurodeck::Region damage = scene.take_damage();
+    std::shared_ptr<const Neurodeck::Scene> snapshot;
+    if (!damage.empty()) snapshot = std::make_shared<const Neurodeck::Scene>(scene);
+    render_thread.frame(std::move(snapshot), damage);
+    // Commits from here on wait for the next frame, along with their
+    // callbacks.
+    frame_scheduler.dispatch();
+    g_frame_in_flight = true;
+    return 0; // Success
+}
+
+// Completions from the render thread: uploaded buffers go back to their
+// clients, and a presented frame answers everyone waiting for it. The timer
+// stays disarmed until something asks for another frame, or already did
+// while this one was drawn.
+static int handle_render_completions(int fd, uint32_t mask, void *data) {
+    render_thread.acknowledge();
+    Neurodeck::RenderThread::Completion completion;
+    while (render_thread.next_completion(completion)) {
+        if (completion.kind == Neurodeck::RenderThread::Completion::Kind::Upload &&
+            completion.token == builtin_terminal.token) {
+            builtin_terminal.uploading = false;
+            if (builtin_terminal.changed) frame_scheduler.schedule();
+            continue;
+        }
+        if (completion.kind == Neurodeck::RenderThread::Completion::Kind::Upload) {
+            auto buffer = std::static_pointer_cast<Buffer>(completion.token);
+            if (!buffer->resource) continue; // Destroyed meanwhile.
+            if (completion.ok) {
+                wl_buffer_send_release(buffer->resource);
+            } else {
+                // The client truncated the pool under us.
+                wl_resource_post_error(buffer->resource, WL_SHM_ERROR_INVALID_FD, "error accessing SHM buffer");
+            }
+            continue;
+        }
+        g_frame_in_flight = false;
+        Neurodeck::FrameScheduler::Frame frame = frame_scheduler.present(now_nsec());
+        Neurodeck::FrameRecord record = completion.frame;
+        record.sequence = frame.sequence;
+        record.presented_nsec = frame.presented_nsec;
+        frame_stats.presented(record, frame_scheduler.refresh_nsec());
+        send_frame_done(frame);
+        schedule_repaint();
+    }
+    return 0;
+}
+
+// wp_presentation: feedback requests are tied to the surface's next commit.
+static void presentation_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void presentation_feedback(struct wl_client *client, struct wl_resource *resource,
+                                  struct wl_resource *surface, uint32_t callback) {
+    struct wl_resource *feedback_resource =
+        wl_resource_create(client, &wp_presentation_feedback_interface, wl_resource_get_version(resource), callback);
+    if (!feedback_resource) {
+        wl_client_post_no_memory(client);
         return;
     }
+    wl_resource_set_implementation(feedback_resource, nullptr, nullptr, handle_listener_destroy);
+    frame_scheduler.feedback(surface_id(surface), feedback_resource);
+}
+
+static const struct wp_presentation_interface app_presentation_implementation = {
+    .destroy = presentation_destroy,
+    .feedback = presentation_feedback,
+};
 
-    if (!eglMakeCurrent(egl_display, g_client_egl_rendering_surface, g_client_egl_rendering_surface, egl_context)) {
-        fprintf(stderr, "Failed to make EGL context current, EGL error %x\n", eglGetError());
+static void bind_presentation(struct wl_client *client,
+                              void *data,
+                              uint32_t version,
+                              uint32_t id)
+{
+    struct wl_resource *resource = wl_resource_create(client, &wp_presentation_interface, version, id);
+    if (!resource) {
+        wl_client_post_no_memory(client);
         return;
     }
+    wl_resource_set_implementation(resource, &app_presentation_implementation, data, handle_destroy);
+    wp_presentation_send_clock_id(resource, CLOCK_MONOTONIC);
+}
+
+static int handle_terminate_signal(int signal_number, void *data) {
+    printf("Received signal %d, shutting down\n", signal_number);
+    g_running = false;
+    return 0;
+}
+
+// wl_buffer: the client may destroy it while a surface still references it.
+static void buffer_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
 
-    // Using fixed size as per wl_egl_window_create
-    int width = 640;
-    int height = 480;
-    glViewport(0, 0, width, height);
+static const struct wl_buffer_interface app_buffer_implementation = {
+    .destroy = buffer_destroy,
+};
 
-    // Clear to red
-    glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+static void handle_buffer_destroy(struct wl_resource *resource) {
+    auto *buffer = static_cast<std::shared_ptr<Buffer> *>(wl_resource_get_user_data(resource));
+    (*buffer)->resource = nullptr;
+    delete buffer;
+}
 
-    if (!eglSwapBuffers(egl_display, g_client_egl_rendering_surface)) {
-        fprintf(stderr, "Failed to swap EGL buffers, EGL error %x\n", eglGetError());
+static std::shared_ptr<Buffer> buffer_from_resource(struct wl_resource *resource) {
+    if (!wl_resource_instance_of(resource, &wl_buffer_interface, &app_buffer_implementation)) {
+        return nullptr; // Not from our wl_shm.
     }
+    return *static_cast<std::shared_ptr<Buffer> *>(wl_resource_get_user_data(resource));
+}
 
-    // It's good practice to unbind the context.
-    if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT)) {
-        // This might fail if the surface is already destroyed, not necessarily a critical error for unbinding.
-        // fprintf(stderr, "Failed to unbind EGL context, EGL error %x\n", eglGetError());
+// wl_shm_pool: user data is a shared_ptr to the mapping, which its buffers
+// share.
+static std::shared_ptr<Neurodeck::ShmPool> &pool_from_resource(struct wl_resource *resource) {
+    return *static_cast<std::shared_ptr<Neurodeck::ShmPool> *>(wl_resource_get_user_data(resource));
+}
+
+static void shm_pool_create_buffer(struct wl_client *client, struct wl_resource *resource, uint32_t id,
+                                   int32_t offset, int32_t width, int32_t height, int32_t stride, uint32_t format) {
+    if (format != WL_SHM_FORMAT_ARGB8888 && format != WL_SHM_FORMAT_XRGB8888) {
+        wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FORMAT, "invalid format 0x%x", format);
+        return;
     }
-    // printf("Rendered solid color.\n"); // Can be noisy if called frequently
+    auto buffer = std::make_shared<Buffer>();
+    buffer->shm.pool = pool_from_resource(resource);
+    buffer->shm.offset = offset;
+    buffer->shm.width = width;
+    buffer->shm.height = height;
+    buffer->shm.stride = stride;
+    buffer->shm.format = static_cast<Neurodeck::ShmFormat>(format);
+    if (!buffer->shm.valid()) {
+        wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE,
+                               "invalid width, height or stride (%dx%d, %d)", width, height, stride);
+        return;
+    }
+    buffer->resource = wl_resource_create(client, &wl_buffer_interface, 1, id);
+    if (!buffer->resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(buffer->resource, &app_buffer_implementation,
+                                   new std::shared_ptr<Buffer>(buffer), handle_buffer_destroy);
 }
 
-// Timer callback for rendering
-static int render_timer_callback(void *data) {
-    render_solid_color();
-    if (g_render_timer_source) { // Re-arm the timer for continuous rendering
-        wl_event_source_timer_update(g_render_timer_source, 16); // ~60 FPS
+static void shm_pool_destroy(struct wl_client *client, struct wl_resource *resource) {
+    wl_resource_destroy(resource);
+}
+
+static void shm_pool_resize(struct wl_client *client, struct wl_resource *resource, int32_t size) {
+    std::shared_ptr<Neurodeck::ShmPool> &pool = pool_from_resource(resource);
+    if (size < pool->size()) {
+        wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE, "shrinking pool invalid");
+        return;
+    }
+    if (!pool->resize(size)) {
+        wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FD, "failed to remap pool to %d bytes", size);
     }
-    return 0; // Success
 }
 
+static const struct wl_shm_pool_interface app_shm_pool_implementation = {
+    .create_buffer = shm_pool_create_buffer,
+    .destroy = shm_pool_destroy,
+    .resize = shm_pool_resize,
+};
+
+static void handle_shm_pool_destroy(struct wl_resource *resource) {
+    delete static_cast<std::shared_ptr<Neurodeck::ShmPool> *>(wl_resource_get_user_data(resource));
+}
+
+static void shm_create_pool(struct wl_client *client, struct wl_resource *resource, uint32_t id, int32_t fd, int32_t size) {
+    std::shared_ptr<Neurodeck::ShmPool> pool = Neurodeck::ShmPool::create(fd, size);
+    close(fd); // The mapping keeps the memory.
+    if (!pool) {
+        wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FD, "failed to map pool of %d bytes", size);
+        return;
+    }
+    struct wl_resource *pool_resource = wl_resource_create(client, &wl_shm_pool_interface, 1, id);
+    if (!pool_resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(pool_resource, &app_shm_pool_implementation,
+                                   new std::shared_ptr<Neurodeck::ShmPool>(pool), handle_shm_pool_destroy);
+}
+
+static const struct wl_shm_interface app_shm_implementation = {
+    .create_pool = shm_create_pool,
+};
+
 static void bind_shm(struct wl_client *client,
                      void *data,
                      uint32_t version,
@@ -176,71 +595,244 @@ static void bind_shm(struct wl_client *client,
 {
     wl_resource *resource =
         wl_resource_create(client, &wl_shm_interface, version, id);
-    wl_resource_set_implementation(resource, nullptr, nullptr, handle_destroy);
-    printf("Client bound to wl_shm (id=%u)\n", id);
+    if (!resource) {
+        wl_client_post_no_memory(client);
+        return;
+    }
+    wl_resource_set_implementation(resource, &app_shm_implementation, nullptr, handle_destroy);
+    wl_shm_send_format(resource, WL_SHM_FORMAT_ARGB8888);
+    wl_shm_send_format(resource, WL_SHM_FORMAT_XRGB8888);
 }
 
-int main(int argc, char *argv[])
-{
-    // 1. Create the Wayland display
-    display = wl_display_create();
-    if (!display)
-    {
-        fprintf(stderr, "Failed to create Wayland display\n");
-        return 1;
+// Draws what the terminal's output changed, unless the last upload is still
+// being read, and commits it; called as a frame starts.
+static void draw_terminal() {
+    BuiltinTerminal &t = builtin_terminal;
+    if (!t.terminal || !t.changed || t.uploading) return;
+    t.changed = false;
+    Neurodeck::Region damage = t.renderer->draw(*t.terminal, t.pixels, t.buffer.stride);
+    if (damage.empty()) return;
+    scene.attach(t.id, t.buffer.width, t.buffer.height, 0, 0, true);
+    for (const Neurodeck::Rect &rect : damage.rects()) scene.damage(t.id, rect);
+    scene.commit(t.id);
+    frame_stats.committed(now_nsec());
+    render_thread.upload(t.id, t.buffer, scene.surface(t.id)->buffer_damage, t.token);
+    t.uploading = true;
+}
+
+// Collects the terminal program's exit status, if it has one yet (or
+// waits for it, with `options` 0).
+static void reap_terminal_program(int options) {
+    BuiltinTerminal &t = builtin_terminal;
+    int status = 0;
+    if (t.pid > 0 && waitpid(t.pid, &status, options) == t.pid) {
+        printf("Terminal program exited with status %d\n",
+               WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+        t.pid = -1;
     }
+}
 
-    // Initialize EGL
-    egl_display = eglGetDisplay((EGLNativeDisplayType)display);
-    if (egl_display == EGL_NO_DISPLAY) {
-        fprintf(stderr, "Failed to get EGL display\n");
-        wl_display_destroy(display);
-        return 1;
+static void stop_terminal_program() {
+    BuiltinTerminal &t = builtin_terminal;
+    if (t.output_source) wl_event_source_remove(t.output_source);
+    if (t.input_source) wl_event_source_remove(t.input_source);
+    t.output_source = t.input_source = nullptr;
+    if (t.master >= 0) close(t.master); // Hangs up on the program, if it is still there.
+    t.master = -1;
+    reap_terminal_program(WNOHANG);
+}
+
+// The terminal program may exit after its output ends.
+static int handle_child_signal(int signal_number, void *data) {
+    reap_terminal_program(WNOHANG);
+    return 0;
+}
+
+// Output from the terminal program. At most 256 KiB, a couple of
+// milliseconds of parsing, is taken per wakeup so that frames and clients
+// are still served during a flood; the fd stays readable.
+static int handle_terminal_output(int fd, uint32_t mask, void *data) {
+    BuiltinTerminal &t = builtin_terminal;
+    static char chunk[64 * 1024];
+    size_t budget = 256 << 10;
+    while (budget > 0) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            t.terminal->feed(chunk, static_cast<size_t>(n));
+            budget -= std::min(budget, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        // EOF or EIO: the program closed its side, or exited.
+        stop_terminal_program();
+        break;
     }
+    std::string replies = t.terminal->take_replies();
+    if (!replies.empty() && t.master >= 0 && write(t.master, replies.data(), replies.size()) < 0) {
+        perror("write to terminal");
+    }
+    t.changed = true;
+    frame_scheduler.schedule();
+    schedule_repaint();
+    return 0;
+}
 
-    EGLint major, minor;
-    if (!eglInitialize(egl_display, &major, &minor)) {
-        fprintf(stderr, "Failed to initialize EGL: %x\n", eglGetError());
-        wl_display_destroy(display);
-        return 1;
+// Our stdin, passed on to the terminal program as typed.
+static int handle_terminal_input(int fd, uint32_t mask, void *data) {
+    BuiltinTerminal &t = builtin_terminal;
+    char chunk[4096];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) return 0;
+    if (n <= 0) {
+        wl_event_source_remove(t.input_source);
+        t.input_source = nullptr;
+        return 0;
     }
-    printf("EGL Initialized. Version: %d.%d\n", major, minor);
-
-    const EGLint config_attribs[] = {
-        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-        EGL_RED_SIZE, 8,
-        EGL_GREEN_SIZE, 8,
-        EGL_BLUE_SIZE, 8,
-        EGL_ALPHA_SIZE, 8,
-        EGL_NONE
-    };
-    EGLint num_configs;
-    if (!eglChooseConfig(egl_display, config_attribs, &egl_config, 1, &num_configs)) {
-        fprintf(stderr, "Failed to choose EGL config: %x\n", eglGetError());
-        eglTerminate(egl_display);
-        wl_display_destroy(display);
+    if (t.master >= 0 && write(t.master, chunk, static_cast<size_t>(n)) < 0) perror("write to terminal");
+    return 0;
+}
+
+// Sets up the terminal surface, covering the output with as many cells as
+// fit, and starts `program` on it.
+static bool start_terminal(const char *program, const char *font_path) {
+    BuiltinTerminal &t = builtin_terminal;
+    if (!t.font.open(font_path, kTerminalFontSize)) {
+        fprintf(stderr, "Failed to load the font %s\n", font_path);
+        return false;
+    }
+    const int columns = kOutputWidth / t.font.cell_width();
+    const int rows = kOutputHeight / t.font.cell_height();
+    Neurodeck::Font *font = &t.font;
+    t.glyphs.reset(new Neurodeck::GlyphAtlas(
+        t.font.cell_width(), t.font.cell_height(),
+        [font](char32_t ch, bool bold, uint8_t *mask) { return font->rasterize(ch, bold, mask); }));
+    t.terminal.reset(new Neurodeck::Terminal(columns, rows));
+    t.renderer.reset(new Neurodeck::TerminalRenderer(*t.glyphs));
+
+    const int32_t stride = kOutputWidth * 4;
+    const size_t size = static_cast<size_t>(stride) * kOutputHeight;
+    int fd = memfd_create("neurodeck-terminal", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        perror("memfd");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    void *pixels = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    t.buffer.pool = pixels != MAP_FAILED ? Neurodeck::ShmPool::create(fd, static_cast<int32_t>(size)) : nullptr;
+    close(fd);
+    if (!t.buffer.pool) {
+        fprintf(stderr, "Failed to map the terminal buffer\n");
+        if (pixels != MAP_FAILED) munmap(pixels, size);
+        return false;
+    }
+    t.pixels = static_cast<uint8_t *>(pixels);
+    // What the cells leave uncovered on the right and at the bottom.
+    std::fill(reinterpret_cast<uint32_t *>(t.pixels), reinterpret_cast<uint32_t *>(t.pixels + size),
+              Neurodeck::TerminalRenderer::kBackground);
+    t.buffer.width = kOutputWidth;
+    t.buffer.height = kOutputHeight;
+    t.buffer.stride = stride;
+    t.buffer.format = Neurodeck::ShmFormat::XRGB8888;
+    t.token = std::make_shared<int>(0);
+
+    t.pid = Neurodeck::spawn_on_pty({program}, columns, rows, t.master);
+    if (t.pid < 0) {
+        perror("Failed to start the terminal program");
+        return false;
+    }
+    t.id = scene.create_surface();
+    t.output_source = wl_event_loop_add_fd(loop, t.master, WL_EVENT_READABLE, handle_terminal_output, nullptr);
+    t.input_source = wl_event_loop_add_fd(loop, STDIN_FILENO, WL_EVENT_READABLE, handle_terminal_input, nullptr);
+    t.changed = true;
+    printf("Terminal: %s on %dx%d cells of %dx%d pixels\n", program, columns, rows, t.font.cell_width(),
+           t.font.cell_height());
+    return true;
+}
+
+// "auto" is GL where EGL works and the CPU otherwise.
+static std::unique_ptr<Neurodeck::Backend> create_backend(const char *name, int32_t width, int32_t height) {
+    if (strcmp(name, "headless") == 0) {
+        return Neurodeck::create_headless_backend(width, height);
+    }
+    std::unique_ptr<Neurodeck::Backend> gl = Neurodeck::create_gl_backend(width, height);
+    if (!gl && strcmp(name, "auto") == 0) {
+        fprintf(stderr, "GL is unavailable, compositing on the CPU\n");
+        return Neurodeck::create_headless_backend(width, height);
+    }
+    return gl;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *backend_name = "auto";
+    const char *dump_directory = nullptr; // Every frame is written here.
+    const char *stats_file = nullptr;     // Frame timing on exit, as JSON...
+    const char *trace_file = nullptr;     // ...and as a Chrome trace.
+    const char *terminal_program = nullptr;
+    const char *font_path = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            backend_name = argv[++i];
+        } else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc) {
+            dump_directory = argv[++i];
+        } else if (strcmp(argv[i], "--frame-stats") == 0 && i + 1 < argc) {
+            stats_file = argv[++i];
+        } else if (strcmp(argv[i], "--frame-trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--terminal") == 0 && i + 1 < argc) {
+            terminal_program = argv[++i];
+        } else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc) {
+            font_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--backend auto|gl|headless] [--dump-frames DIR] "
+                            "[--frame-stats FILE] [--frame-trace FILE] [--terminal PROGRAM [--font FILE]]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (strcmp(backend_name, "auto") != 0 && strcmp(backend_name, "gl") != 0 &&
+        strcmp(backend_name, "headless") != 0) {
+        fprintf(stderr, "Unknown backend %s\n", backend_name);
         return 1;
     }
-    if (num_configs == 0) {
-        fprintf(stderr, "No suitable EGL config found\n");
-        eglTerminate(egl_display);
-        wl_display_destroy(display);
+
+    // 1. Create the Wayland display
+    display = wl_display_create();
+    if (!display)
+    {
+        fprintf(stderr, "Failed to create Wayland display\n");
         return 1;
     }
 
-    const EGLint context_attribs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2, // Request OpenGL ES 2.0
-        EGL_NONE
-    };
-    egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
-    if (egl_context == EGL_NO_CONTEXT) {
-        fprintf(stderr, "Failed to create EGL context: %x\n", eglGetError());
-        eglTerminate(egl_display);
+    // The backend is created on the render thread, which keeps its GL
+    // context current; frames are dumped from there too.
+    std::string backend_choice = backend_name;
+    std::string directory = dump_directory ? dump_directory : "";
+    bool started = render_thread.start([backend_choice, directory]() {
+        std::unique_ptr<Neurodeck::Backend> backend =
+            create_backend(backend_choice.c_str(), kOutputWidth, kOutputHeight);
+        if (backend && !directory.empty()) {
+            uint64_t frame_number = 0;
+            backend->set_frame_hook([directory, frame_number](const std::vector<uint32_t> &pixels,
+                                                              int32_t width, int32_t height) mutable {
+                char name[32];
+                snprintf(name, sizeof(name), "/frame-%06llu.ppm", static_cast<unsigned long long>(frame_number++));
+                if (!Neurodeck::write_ppm(directory + name, pixels, width, height)) {
+                    fprintf(stderr, "Failed to write %s%s\n", directory.c_str(), name);
+                }
+            });
+        }
+        return backend;
+    });
+    if (!started) {
         wl_display_destroy(display);
         return 1;
     }
-    printf("EGL context created.\n");
+    printf("Output: %dx%d, %s backend on a render thread\n", kOutputWidth, kOutputHeight,
+           render_thread.backend_name());
+    scene.damage_all(); // The first frame draws the background.
+    frame_scheduler.schedule();
 
     // 2. Add a UNIX socket at WAYLAND_DISPLAY=wayland-0
     const char *sock = wl_display_add_socket_auto(display);
@@ -257,25 +849,69 @@ int main(int argc, char *argv[])
     printf("wl_compositor global advertised\n");
     wl_global_create(display, &wl_shm_interface, 1 /*version*/, nullptr, bind_shm);
     printf("wl_shm global advertised\n");
+    wl_global_create(display, &wp_presentation_interface, 1 /*version*/, nullptr, bind_presentation);
+    printf("wp_presentation global advertised\n");
 
-    // 4. Optional: advertise wl_shm for shared memory
-    // wl_global_create(display, &wl_shm_interface, 1, nullptr, bind_shm);
-
-    // 5. Run the event loop
+    // 4. Run the event loop
     printf("Entering Wayland event loop...\n");
     loop = wl_display_get_event_loop(display);
+    if (terminal_program && !start_terminal(terminal_program, font_path)) {
+        render_thread.stop();
+        wl_display_destroy(display);
+        return 1;
+    }
 
-    // Setup render timer
+    // Setup render timer; it is armed only while a frame is scheduled.
     g_render_timer_source = wl_event_loop_add_timer(loop, render_timer_callback, nullptr);
     if (g_render_timer_source) {
-        wl_event_source_timer_update(g_render_timer_source, 16); // Initial fire after 16ms
+        schedule_repaint(); // The first frame.
         printf("Render timer initialized.\n");
     } else {
         fprintf(stderr, "Failed to create render timer source.\n");
         // Consider cleanup and exit if timer is critical
     }
 
-    wl_event_loop_dispatch(loop, -1);
+    struct wl_event_source *completion_source = wl_event_loop_add_fd(
+        loop, render_thread.completion_fd(), WL_EVENT_READABLE, handle_render_completions, nullptr);
+    struct wl_event_source *sigint_source = wl_event_loop_add_signal(loop, SIGINT, handle_terminate_signal, nullptr);
+    struct wl_event_source *sigterm_source = wl_event_loop_add_signal(loop, SIGTERM, handle_terminate_signal, nullptr);
+    struct wl_event_source *sigchld_source = wl_event_loop_add_signal(loop, SIGCHLD, handle_child_signal, nullptr);
+
+    // What wl_display_run does, but with the wait split from the work so
+    // the time spent on client requests can be measured, and the render
+    // thread woken once for everything a dispatch queued.
+    int loop_fd = wl_event_loop_get_fd(loop);
+    while (g_running) {
+        wl_display_flush_clients(display);
+        wl_event_loop_dispatch_idle(loop);
+        // Sleeps until a client request, the render timer or a signal.
+        struct pollfd ready = {loop_fd, POLLIN, 0};
+        if (poll(&ready, 1, -1) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        int64_t start_nsec = now_nsec();
+        wl_event_loop_dispatch(loop, 0);
+        render_thread.wake();
+        frame_stats.dispatched(now_nsec() - start_nsec);
+    }
+
+    if (sigint_source) wl_event_source_remove(sigint_source);
+    if (sigterm_source) wl_event_source_remove(sigterm_source);
+    if (sigchld_source) wl_event_source_remove(sigchld_source);
+    if (completion_source) wl_event_source_remove(completion_source);
+    // The terminal program is hung up on and given a second to exit, then
+    // killed, so it is never left behind as a zombie.
+    stop_terminal_program();
+    if (builtin_terminal.pid > 0) kill(builtin_terminal.pid, SIGHUP);
+    for (int tries = 0; builtin_terminal.pid > 0 && tries < 100; ++tries) {
+        usleep(10000);
+        reap_terminal_program(WNOHANG);
+    }
+    if (builtin_terminal.pid > 0) {
+        kill(builtin_terminal.pid, SIGKILL);
+        reap_terminal_program(0);
+    }
 
     // Cleanup
     // Remove timer first
@@ -285,32 +921,21 @@ int main(int argc, char *argv[])
         g_render_timer_source = nullptr;
     }
 
-    // Destroy EGL surface and wl_egl_window first
-    if (g_client_egl_rendering_surface != EGL_NO_SURFACE) {
-        printf("Destroying EGL rendering surface %p\n", g_client_egl_rendering_surface);
-        eglDestroySurface(egl_display, g_client_egl_rendering_surface);
-        g_client_egl_rendering_surface = EGL_NO_SURFACE;
-    }
-    if (g_client_egl_window != NULL) {
-        printf("Destroying wl_egl_window %p\n", g_client_egl_window);
-        wl_egl_window_destroy(g_client_egl_window);
-        g_client_egl_window = NULL;
-    }
-    // g_client_surface is a wl_resource, it will be destroyed when the client disconnects
-    // or explicitly via wl_resource_destroy. handle_surface_destroy will clear the global.
-    // If g_client_surface is not null at this point, it means the client did not disconnect
-    // or the surface was not explicitly destroyed. For this example, we assume client disconnect
-    // handles it or that it's already null due to handle_surface_destroy.
-
-    if (egl_display != EGL_NO_DISPLAY) {
-        if (egl_context != EGL_NO_CONTEXT) {
-            printf("Destroying EGL context %p\n", egl_context);
-            eglDestroyContext(egl_display, egl_context);
-            egl_context = EGL_NO_CONTEXT;
-        }
-        printf("Terminating EGL display %p\n", egl_display);
-        eglTerminate(egl_display);
-        egl_display = EGL_NO_DISPLAY;
+    // Client surfaces and callbacks go with their clients in
+    // wl_display_destroy; the scene is updated from their destructors, and
+    // what they would queue for the stopped render thread is dropped.
+    render_thread.stop();
+    if (builtin_terminal.pixels) {
+        const Neurodeck::ShmBuffer& buffer = builtin_terminal.buffer;
+        munmap(builtin_terminal.pixels, static_cast<size_t>(buffer.stride) * buffer.height);
+    }
+
+    printf("%s\n", frame_stats.summary().c_str());
+    if (stats_file && !frame_stats.dump_json(stats_file)) {
+        fprintf(stderr, "Failed to write %s\n", stats_file);
+    }
+    if (trace_file && !frame_stats.dump_chrome_trace(trace_file)) {
+        fprintf(stderr, "Failed to write %s\n", trace_file);
     }
 
     printf("Destroying Wayland display %p\n", display);
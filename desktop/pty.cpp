@@ -0,0 +1,75 @@
+#include "pty.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace Neurodeck {
+
+pid_t spawn_on_pty(const std::vector<std::string>& argv, int columns, int rows, int& master) {
+    if (argv.empty()) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    char name[64];
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname_r(fd, name, sizeof(name)) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    struct winsize size = {};
+    size.ws_col = static_cast<unsigned short>(columns);
+    size.ws_row = static_cast<unsigned short>(rows);
+    ioctl(fd, TIOCSWINSZ, &size);
+
+    // The compositor has other threads, so the child may not allocate:
+    // the arguments and environment are put together here.
+    std::vector<char*> args;
+    for (const std::string& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+    std::string term = "TERM=xterm-256color";
+    std::vector<char*> env;
+    for (char** var = environ; *var; ++var) {
+        if (strncmp(*var, "TERM=", 5) != 0) env.push_back(*var);
+    }
+    env.push_back(&term[0]);
+    env.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if (pid == 0) {
+        // Signals the compositor takes through signalfd are blocked, and
+        // the mask would outlive exec.
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        setsid();
+        int slave = open(name, O_RDWR); // Becomes the controlling terminal.
+        if (slave < 0) _exit(127);
+        ioctl(slave, TIOCSCTTY, 0);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO) close(slave);
+        execvpe(args[0], args.data(), env.data());
+        _exit(127);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    master = fd;
+    return pid;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,20 @@
+#ifndef DESKTOP_PTY_HPP
+#define DESKTOP_PTY_HPP
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace Neurodeck {
+
+// Starts `argv` (searched for in PATH) on a new pseudo-terminal of
+// `columns` x `rows`, as a session leader with the pty as its controlling
+// terminal and TERM=xterm-256color. Sets `master` to the master side,
+// non-blocking and close-on-exec. Returns the child's pid, or -1 with
+// errno set if the pty or the process could not be created; a program
+// that fails to start exits with status 127.
+pid_t spawn_on_pty(const std::vector<std::string>& argv, int columns, int rows, int& master);
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_PTY_HPP
@@ -0,0 +1,107 @@
+#include "region.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+namespace {
+
+// Appends the parts of `a` outside `b`: up to four bands, full-width above
+// and below `b` and clipped to its rows left and right of it.
+void subtract_into(const Rect& a, const Rect& b, std::vector<Rect>& out) {
+    Rect overlap = a.intersect(b);
+    if (overlap.empty()) {
+        out.push_back(a);
+        return;
+    }
+    if (overlap.y > a.y) out.push_back({a.x, a.y, a.width, overlap.y - a.y});
+    if (overlap.bottom() < a.bottom()) out.push_back({a.x, overlap.bottom(), a.width, a.bottom() - overlap.bottom()});
+    if (overlap.x > a.x) out.push_back({a.x, overlap.y, overlap.x - a.x, overlap.height});
+    if (overlap.right() < a.right()) out.push_back({overlap.right(), overlap.y, a.right() - overlap.right(), overlap.height});
+}
+
+} // namespace
+
+Rect Rect::intersect(const Rect& other) const {
+    int32_t left = std::max(x, other.x);
+    int32_t top = std::max(y, other.y);
+    int32_t r = std::min(right(), other.right());
+    int32_t b = std::min(bottom(), other.bottom());
+    if (r <= left || b <= top) return Rect();
+    return {left, top, r - left, b - top};
+}
+
+bool Rect::contains(const Rect& other) const {
+    return other.empty() || (other.x >= x && other.y >= y && other.right() <= right() && other.bottom() <= bottom());
+}
+
+void Region::add(const Rect& rect) {
+    if (rect.empty()) return;
+    std::vector<Rect> pieces{rect};
+    std::vector<Rect> next;
+    for (const Rect& existing : rects_) {
+        if (!existing.intersects(rect)) continue;
+        next.clear();
+        for (const Rect& piece : pieces) subtract_into(piece, existing, next);
+        pieces.swap(next);
+        if (pieces.empty()) return; // Already covered.
+    }
+    rects_.insert(rects_.end(), pieces.begin(), pieces.end());
+    if (rects_.size() > kMaxRects) {
+        Rect box = bounds();
+        rects_.assign(1, box);
+        exact_ = false;
+    }
+}
+
+void Region::add(const Region& other) {
+    for (const Rect& rect : other.rects_) add(rect);
+    exact_ = exact_ && other.exact_;
+}
+
+void Region::subtract(const Rect& rect) {
+    if (rect.empty() || rects_.empty()) return;
+    std::vector<Rect> out;
+    out.reserve(rects_.size() + 3);
+    for (const Rect& existing : rects_) subtract_into(existing, rect, out);
+    rects_.swap(out);
+}
+
+void Region::intersect(const Rect& clip) {
+    size_t kept = 0;
+    for (const Rect& existing : rects_) {
+        Rect clipped = existing.intersect(clip);
+        if (!clipped.empty()) rects_[kept++] = clipped;
+    }
+    rects_.resize(kept);
+}
+
+void Region::translate(int32_t dx, int32_t dy) {
+    for (Rect& rect : rects_) rect = rect.translated(dx, dy);
+}
+
+Rect Region::bounds() const {
+    if (rects_.empty()) return Rect();
+    int32_t left = rects_[0].x, top = rects_[0].y, right = rects_[0].right(), bottom = rects_[0].bottom();
+    for (const Rect& rect : rects_) {
+        left = std::min(left, rect.x);
+        top = std::min(top, rect.y);
+        right = std::max(right, rect.right());
+        bottom = std::max(bottom, rect.bottom());
+    }
+    return {left, top, right - left, bottom - top};
+}
+
+int64_t Region::area() const {
+    int64_t total = 0;
+    for (const Rect& rect : rects_) total += rect.area();
+    return total;
+}
+
+bool Region::intersects(const Rect& rect) const {
+    for (const Rect& existing : rects_) {
+        if (existing.intersects(rect)) return true;
+    }
+    return false;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,68 @@
+#ifndef DESKTOP_REGION_HPP
+#define DESKTOP_REGION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+struct Rect {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    int32_t right() const { return x + width; }
+    int32_t bottom() const { return y + height; }
+    int64_t area() const { return empty() ? 0 : int64_t(width) * height; }
+
+    Rect intersect(const Rect& other) const;
+    bool intersects(const Rect& other) const { return !intersect(other).empty(); }
+    bool contains(const Rect& other) const;
+    Rect translated(int32_t dx, int32_t dy) const { return {x + dx, y + dy, width, height}; }
+    bool operator==(const Rect& other) const {
+        return x == other.x && y == other.y && width == other.width && height == other.height;
+    }
+};
+
+// A set of pixels kept as non-overlapping rectangles, for damage and
+// visibility. Adding a rectangle adds only the parts not already covered,
+// so area() is exact and every rectangle can be scissored and drawn once.
+// Past kMaxRects the region collapses to its bounding box: redrawing a few
+// extra pixels is cheaper than scissoring hundreds of slivers. That is
+// wrong where the region has to stay within what was added, as an opaque
+// region does; exact() says whether it still does.
+class Region {
+public:
+    static constexpr size_t kMaxRects = 32;
+
+    Region() = default;
+    explicit Region(const Rect& rect) { add(rect); }
+
+    void add(const Rect& rect);
+    void add(const Region& other);
+    void subtract(const Rect& rect);
+    void intersect(const Rect& clip);
+    void translate(int32_t dx, int32_t dy);
+    void clear() {
+        rects_.clear();
+        exact_ = true;
+    }
+
+    bool empty() const { return rects_.empty(); }
+    bool exact() const { return exact_; }
+    const std::vector<Rect>& rects() const { return rects_; }
+    Rect bounds() const;
+    int64_t area() const;
+    bool intersects(const Rect& rect) const;
+
+private:
+    std::vector<Rect> rects_;
+    bool exact_ = true; // Never collapsed since the last clear().
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_REGION_HPP
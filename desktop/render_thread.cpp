@@ -0,0 +1,184 @@
+#include "render_thread.hpp"
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <future>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace Neurodeck {
+
+namespace {
+
+int64_t clock_nsec(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void signal_fd(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0) perror("eventfd write");
+}
+
+} // namespace
+
+RenderThread::RenderThread()
+    : request_fd_(eventfd(0, EFD_CLOEXEC)), completion_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+}
+
+RenderThread::~RenderThread() {
+    stop();
+    if (request_fd_ >= 0) close(request_fd_);
+    if (completion_fd_ >= 0) close(completion_fd_);
+}
+
+bool RenderThread::start(BackendFactory factory) {
+    if (running() || request_fd_ < 0 || completion_fd_ < 0) return false;
+    std::promise<const char*> created;
+    std::future<const char*> name = created.get_future();
+    thread_ = std::thread([this, factory = std::move(factory), created = std::move(created)]() mutable {
+        // Signals are for the dispatch thread, which reads them from its
+        // event loop. Faults stay deliverable: a blocked SIGBUS would kill
+        // the process instead of reaching ShmPool's handler when a client
+        // shrinks a pool this thread is reading.
+        sigset_t all;
+        sigfillset(&all);
+        for (int fault : {SIGBUS, SIGSEGV, SIGFPE, SIGILL}) sigdelset(&all, fault);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+        std::unique_ptr<Backend> backend = factory();
+        created.set_value(backend ? backend->name() : nullptr);
+        if (backend) run(std::move(backend));
+    });
+    backend_name_ = name.get();
+    if (!backend_name_) {
+        thread_.join();
+        backend_name_ = "";
+        return false;
+    }
+    return true;
+}
+
+void RenderThread::stop() {
+    if (!running()) return;
+    Request request;
+    request.kind = Request::Kind::Stop;
+    push(std::move(request));
+    wake();
+    thread_.join();
+    // Tokens of uploads that never completed go here.
+    Completion completion;
+    while (completions_.pop(completion)) {
+    }
+}
+
+void RenderThread::push(Request request) {
+    requests_.push(std::move(request));
+    requests_pending_ = true;
+}
+
+void RenderThread::upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage,
+                          std::shared_ptr<void> token) {
+    if (!running()) return;
+    Request request;
+    request.kind = Request::Kind::Upload;
+    request.id = id;
+    request.buffer = buffer;
+    request.damage = damage;
+    request.token = std::move(token);
+    push(std::move(request));
+}
+
+void RenderThread::remove(Scene::SurfaceId id) {
+    if (!running()) return;
+    Request request;
+    request.kind = Request::Kind::Remove;
+    request.id = id;
+    push(std::move(request));
+}
+
+void RenderThread::frame(std::shared_ptr<const Scene> scene, const Region& damage) {
+    if (!running()) return;
+    Request request;
+    request.kind = Request::Kind::Frame;
+    request.scene = std::move(scene);
+    request.damage = damage;
+    push(std::move(request));
+}
+
+void RenderThread::wake() {
+    if (!requests_pending_) return;
+    requests_pending_ = false;
+    signal_fd(request_fd_);
+}
+
+void RenderThread::acknowledge() {
+    uint64_t count;
+    if (read(completion_fd_, &count, sizeof(count)) < 0) {
+        // EAGAIN: already acknowledged.
+    }
+}
+
+bool RenderThread::next_completion(Completion& completion) {
+    return completions_.pop(completion);
+}
+
+void RenderThread::complete(Completion completion) {
+    completions_.push(std::move(completion));
+    completions_pending_ = true;
+}
+
+void RenderThread::signal_completions() {
+    if (!completions_pending_) return;
+    completions_pending_ = false;
+    signal_fd(completion_fd_);
+}
+
+void RenderThread::run(std::unique_ptr<Backend> backend) {
+    for (;;) {
+        // The eventfd counts wakeups, so one that comes while the queue is
+        // being drained is not lost.
+        uint64_t count;
+        if (read(request_fd_, &count, sizeof(count)) < 0) continue;
+        Request request;
+        while (requests_.pop(request)) {
+            switch (request.kind) {
+            case Request::Kind::Upload: {
+                Completion completion;
+                completion.kind = Completion::Kind::Upload;
+                completion.ok = backend->upload(request.id, request.buffer, request.damage);
+                completion.token = std::move(request.token);
+                complete(std::move(completion));
+                break;
+            }
+            case Request::Kind::Remove:
+                backend->remove(request.id);
+                break;
+            case Request::Kind::Frame: {
+                Completion completion;
+                completion.kind = Completion::Kind::Frame;
+                completion.frame.render_start_nsec = clock_nsec(CLOCK_MONOTONIC);
+                int64_t cpu_start_nsec = clock_nsec(CLOCK_THREAD_CPUTIME_ID);
+                if (request.scene && !request.damage.empty()) {
+                    backend->repaint(*request.scene, request.damage);
+                    completion.frame.render_wall_nsec =
+                        clock_nsec(CLOCK_MONOTONIC) - completion.frame.render_start_nsec;
+                    completion.frame.render_cpu_nsec = clock_nsec(CLOCK_THREAD_CPUTIME_ID) - cpu_start_nsec;
+                }
+                complete(std::move(completion));
+                // Frame callbacks should not wait for uploads queued after
+                // the frame.
+                signal_completions();
+                break;
+            }
+            case Request::Kind::Stop:
+                backend.reset();
+                return;
+            }
+            request = Request();
+        }
+        signal_completions();
+    }
+}
+
+} // namespace Neurodeck
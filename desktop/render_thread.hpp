@@ -0,0 +1,99 @@
+#ifndef DESKTOP_RENDER_THREAD_HPP
+#define DESKTOP_RENDER_THREAD_HPP
+
+#include "backend.hpp"
+#include "frame_stats.hpp"
+#include "region.hpp"
+#include "scene.hpp"
+#include "shm_pool.hpp"
+#include "spsc_queue.hpp"
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace Neurodeck {
+
+// Runs the backend on its own thread, so a slow frame never holds up the
+// Wayland dispatch thread.
+//
+// The dispatch thread queues requests: buffer uploads as surfaces commit,
+// texture removals, and frames to draw, each frame with an immutable
+// snapshot of the scene. The render thread carries them out in order and
+// queues completions back: an upload's token once its pixels are copied
+// (the buffer can then be released), and each frame's timing once it is
+// presented. Both queues are lock-free SPSC queues; an eventfd in each
+// direction wakes the other side, at most once per batch.
+//
+// The backend is created on the render thread, so a GL context is current
+// there and only there.
+class RenderThread {
+public:
+    using BackendFactory = std::function<std::unique_ptr<Backend>()>;
+
+    struct Completion {
+        enum class Kind { Upload, Frame };
+        Kind kind = Kind::Upload;
+        std::shared_ptr<void> token; // Upload: what upload() was given...
+        bool ok = true;              // ...and false if the pool faulted.
+        FrameRecord frame;           // Frame: render start, wall and CPU time.
+    };
+
+    RenderThread();
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Starts the thread and creates the backend on it. Returns false, with
+    // no thread left running, if the factory returns nullptr.
+    bool start(BackendFactory factory);
+    // Finishes what is queued, destroys the backend on its thread and
+    // joins it. Later requests are dropped.
+    void stop();
+    bool running() const { return thread_.joinable(); }
+    const char* backend_name() const { return backend_name_; }
+
+    // Dispatch thread. Queued until wake().
+    void upload(Scene::SurfaceId id, const ShmBuffer& buffer, const Region& damage, std::shared_ptr<void> token);
+    void remove(Scene::SurfaceId id);
+    // Redraws `damage` of `scene` and presents it; with no damage only the
+    // completion comes back, after everything queued before it.
+    void frame(std::shared_ptr<const Scene> scene, const Region& damage);
+    // Wakes the render thread if anything was queued since the last call.
+    void wake();
+
+    // Readable while completions wait. Call acknowledge() before draining
+    // them with next_completion().
+    int completion_fd() const { return completion_fd_; }
+    void acknowledge();
+    bool next_completion(Completion& completion);
+
+private:
+    struct Request {
+        enum class Kind { Upload, Remove, Frame, Stop };
+        Kind kind = Kind::Upload;
+        Scene::SurfaceId id = 0;
+        ShmBuffer buffer;
+        Region damage;
+        std::shared_ptr<void> token;
+        std::shared_ptr<const Scene> scene;
+    };
+
+    void run(std::unique_ptr<Backend> backend);
+    void push(Request request);
+    void complete(Completion completion);
+    void signal_completions();
+
+    int request_fd_ = -1;    // Dispatch -> render wakeups.
+    int completion_fd_ = -1; // Render -> dispatch wakeups.
+    SpscQueue<Request> requests_;
+    SpscQueue<Completion> completions_;
+    bool requests_pending_ = false;    // Dispatch thread: queued since wake().
+    bool completions_pending_ = false; // Render thread: queued since signalled.
+    const char* backend_name_ = "";
+    std::thread thread_;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_RENDER_THREAD_HPP
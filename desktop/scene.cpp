@@ -0,0 +1,288 @@
+#include "scene.hpp"
+#include <algorithm>
+
+namespace Neurodeck {
+
+namespace {
+
+// Client rectangles as often as not are (0, 0, INT32_MAX, INT32_MAX) for
+// "everything"; trim them so that right() and bottom() cannot overflow.
+Rect clamped(const Rect& rect) {
+    Rect out = rect;
+    out.width = int32_t(std::min<int64_t>(rect.width, int64_t(INT32_MAX) - rect.x));
+    out.height = int32_t(std::min<int64_t>(rect.height, int64_t(INT32_MAX) - rect.y));
+    return out;
+}
+
+Rect surface_to_buffer(const Rect& rect, int32_t scale) {
+    return {rect.x * scale, rect.y * scale, rect.width * scale, rect.height * scale};
+}
+
+// Buffer coordinates to surface coordinates, rounding outwards so that no
+// damaged pixel is lost.
+Rect buffer_to_surface(const Rect& rect, int32_t scale) {
+    if (scale <= 1) return rect;
+    int32_t left = rect.x / scale;
+    int32_t top = rect.y / scale;
+    int32_t right = (rect.right() + scale - 1) / scale;
+    int32_t bottom = (rect.bottom() + scale - 1) / scale;
+    return {left, top, right - left, bottom - top};
+}
+
+// Past this many rectangles, what is left uncovered stops being cut up
+// further; surfaces below then draw some pixels that end up hidden, which
+// costs time but is still correct.
+const size_t kMaxUncoveredRects = 1024;
+
+} // namespace
+
+Scene::Scene(int32_t output_width, int32_t output_height)
+    : output_width_(output_width), output_height_(output_height) {
+}
+
+Scene::Scene(const Scene& other)
+    : output_width_(other.output_width_), output_height_(other.output_height_), next_id_(other.next_id_),
+      stacking_(other.stacking_), damage_(other.damage_) {
+    nodes_.reserve(other.nodes_.size());
+    for (const auto& entry : other.nodes_) {
+        nodes_.emplace(entry.first, std::unique_ptr<Node>(new Node(*entry.second)));
+    }
+}
+
+Scene::~Scene() = default;
+
+Scene::Node* Scene::find(SurfaceId id) {
+    auto it = nodes_.find(id);
+    return it == nodes_.end() ? nullptr : it->second.get();
+}
+
+const Scene::Surface* Scene::surface(SurfaceId id) const {
+    auto it = nodes_.find(id);
+    return it == nodes_.end() ? nullptr : &it->second->surface;
+}
+
+void Scene::add_damage(const Rect& rect) {
+    damage_.add(rect.intersect(output()));
+}
+
+Scene::SurfaceId Scene::create_surface() {
+    SurfaceId id = next_id_++;
+    std::unique_ptr<Node> node(new Node);
+    node->surface.id = id;
+    nodes_.emplace(id, std::move(node));
+    stacking_.push_back(id);
+    return id;
+}
+
+void Scene::destroy_surface(SurfaceId id) {
+    auto it = nodes_.find(id);
+    if (it == nodes_.end()) return;
+    if (it->second->surface.mapped) add_damage(it->second->surface.bounds());
+    nodes_.erase(it);
+    stacking_.erase(std::find(stacking_.begin(), stacking_.end(), id));
+}
+
+void Scene::attach(SurfaceId id, int32_t buffer_width, int32_t buffer_height, int32_t dx, int32_t dy,
+                   bool opaque) {
+    Node* node = find(id);
+    if (!node) return;
+    node->pending.attached = true;
+    node->pending.opaque_buffer = opaque;
+    node->pending.buffer_width = std::max(0, buffer_width);
+    node->pending.buffer_height = std::max(0, buffer_height);
+    node->pending.dx = dx;
+    node->pending.dy = dy;
+}
+
+void Scene::damage(SurfaceId id, const Rect& rect) {
+    Node* node = find(id);
+    if (node) node->pending.damage.add(clamped(rect));
+}
+
+void Scene::damage_buffer(SurfaceId id, const Rect& rect) {
+    Node* node = find(id);
+    if (node) node->pending.buffer_damage.add(clamped(rect));
+}
+
+void Scene::set_buffer_scale(SurfaceId id, int32_t scale) {
+    Node* node = find(id);
+    if (node && scale > 0) node->pending.scale = scale;
+}
+
+void Scene::set_opaque_region(SurfaceId id, const Region& region) {
+    Node* node = find(id);
+    if (!node) return;
+    node->pending.opaque_set = true;
+    node->pending.opaque.clear();
+    // A region that collapsed to its bounds would claim pixels the client
+    // never said were opaque.
+    if (region.exact()) node->pending.opaque = region;
+}
+
+void Scene::set_input_region(SurfaceId id, const Region* region) {
+    Node* node = find(id);
+    if (!node) return;
+    node->pending.input_set = true;
+    node->pending.input_everywhere = region == nullptr;
+    node->pending.input.clear();
+    if (region) node->pending.input = *region;
+}
+
+void Scene::commit(SurfaceId id) {
+    Node* node = find(id);
+    if (!node) return;
+    Surface& surface = node->surface;
+    Pending& pending = node->pending;
+    const bool was_mapped = surface.mapped;
+    const Rect before = was_mapped ? surface.bounds() : Rect();
+    const bool rescaled = pending.scale != surface.scale;
+    surface.scale = pending.scale;
+
+    bool geometry_changed = rescaled;
+    bool buffer_resized = false;
+    if (pending.attached) {
+        buffer_resized = pending.buffer_width != node->buffer_width || pending.buffer_height != node->buffer_height;
+        node->buffer_width = pending.buffer_width;
+        node->buffer_height = pending.buffer_height;
+        bool mapped = node->buffer_width > 0 && node->buffer_height > 0;
+        geometry_changed = geometry_changed || mapped != surface.mapped || pending.dx != 0 || pending.dy != 0;
+        surface.mapped = mapped;
+        surface.opaque_buffer = pending.opaque_buffer;
+        surface.x += pending.dx;
+        surface.y += pending.dy;
+    }
+    int32_t width = node->buffer_width / surface.scale;
+    int32_t height = node->buffer_height / surface.scale;
+    geometry_changed = geometry_changed || width != surface.width || height != surface.height;
+    surface.width = width;
+    surface.height = height;
+
+    const Rect buffer = {0, 0, node->buffer_width, node->buffer_height};
+    surface.buffer_damage.clear();
+    if (surface.mapped && (buffer_resized || !was_mapped)) {
+        surface.buffer_damage.add(buffer);
+    } else if (surface.mapped) {
+        const Rect local = {0, 0, surface.width, surface.height};
+        for (const Rect& rect : pending.damage.rects()) {
+            surface.buffer_damage.add(surface_to_buffer(rect.intersect(local), surface.scale).intersect(buffer));
+        }
+        for (const Rect& rect : pending.buffer_damage.rects()) surface.buffer_damage.add(rect.intersect(buffer));
+    }
+
+    if (geometry_changed) {
+        add_damage(before);
+        if (surface.mapped) add_damage(surface.bounds());
+        if (surface.mapped || !before.empty()) ++surface.commits;
+    } else if (surface.mapped && (!pending.damage.empty() || !pending.buffer_damage.empty())) {
+        // Only what the client said changed, clipped to the surface.
+        const Rect local = {0, 0, surface.width, surface.height};
+        for (const Rect& rect : pending.damage.rects()) {
+            add_damage(rect.intersect(local).translated(surface.x, surface.y));
+        }
+        for (const Rect& rect : pending.buffer_damage.rects()) {
+            add_damage(buffer_to_surface(rect, surface.scale).intersect(local).translated(surface.x, surface.y));
+        }
+        ++surface.commits;
+    }
+
+    if (pending.opaque_set) {
+        surface.opaque = pending.opaque;
+        pending.opaque_set = false;
+    }
+    if (pending.input_set) {
+        surface.input_everywhere = pending.input_everywhere;
+        surface.input = pending.input;
+        pending.input_set = false;
+    }
+
+    pending.attached = false;
+    pending.dx = 0;
+    pending.dy = 0;
+    pending.damage.clear();
+    pending.buffer_damage.clear();
+}
+
+void Scene::set_position(SurfaceId id, int32_t x, int32_t y) {
+    Node* node = find(id);
+    if (!node || (node->surface.x == x && node->surface.y == y)) return;
+    if (node->surface.mapped) add_damage(node->surface.bounds());
+    node->surface.x = x;
+    node->surface.y = y;
+    if (node->surface.mapped) add_damage(node->surface.bounds());
+}
+
+void Scene::raise(SurfaceId id) {
+    auto it = std::find(stacking_.begin(), stacking_.end(), id);
+    if (it == stacking_.end() || it + 1 == stacking_.end()) return;
+    stacking_.erase(it);
+    stacking_.push_back(id);
+    const Surface* raised = surface(id);
+    if (raised->mapped) add_damage(raised->bounds());
+}
+
+Scene::SurfaceId Scene::surface_at(int32_t x, int32_t y) const {
+    const Rect pixel = {x, y, 1, 1};
+    for (auto it = stacking_.rbegin(); it != stacking_.rend(); ++it) {
+        const Surface& surface = nodes_.at(*it)->surface;
+        if (!surface.mapped || !surface.bounds().contains(pixel)) continue;
+        if (surface.input_everywhere || surface.input.intersects(pixel.translated(-surface.x, -surface.y))) {
+            return surface.id;
+        }
+    }
+    return 0;
+}
+
+std::vector<Scene::Layer> Scene::visible_layers(const Region& damage, Region* background, bool* exclusive) const {
+    if (exclusive) *exclusive = true;
+    Region uncovered = damage;
+    uncovered.intersect(output());
+    std::vector<Layer> layers;
+    std::vector<Rect> opaque;
+    // Front to back, until nothing of the damage is left uncovered.
+    for (auto it = stacking_.rbegin(); it != stacking_.rend() && !uncovered.empty(); ++it) {
+        const Surface& surface = nodes_.at(*it)->surface;
+        if (!surface.mapped) continue;
+        const Rect bounds = surface.bounds();
+        Region visible = uncovered;
+        visible.intersect(bounds);
+        if (visible.empty()) continue;
+
+        opaque.clear();
+        if (surface.opaque_buffer) {
+            opaque.push_back(bounds);
+        } else {
+            for (const Rect& rect : surface.opaque.rects()) {
+                Rect clipped = rect.translated(surface.x, surface.y).intersect(bounds);
+                if (!clipped.empty()) opaque.push_back(clipped);
+            }
+        }
+
+        Layer layer;
+        layer.id = surface.id;
+        // The opaque rectangles are disjoint, and so are the visible ones.
+        for (const Rect& cover : opaque) {
+            for (const Rect& rect : visible.rects()) {
+                Rect both = rect.intersect(cover);
+                if (!both.empty()) layer.opaque.push_back(both);
+            }
+        }
+        for (const Rect& cover : opaque) {
+            visible.subtract(cover);
+            if (uncovered.rects().size() <= kMaxUncoveredRects) uncovered.subtract(cover);
+            else if (exclusive) *exclusive = false;
+        }
+        layer.blended = visible.rects();
+        layers.push_back(std::move(layer));
+    }
+    std::reverse(layers.begin(), layers.end());
+    if (background) *background = std::move(uncovered);
+    return layers;
+}
+
+Region Scene::take_damage() {
+    Region taken;
+    std::swap(taken, damage_);
+    return taken;
+}
+
+} // namespace Neurodeck
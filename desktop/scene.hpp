@@ -0,0 +1,153 @@
+#ifndef DESKTOP_SCENE_HPP
+#define DESKTOP_SCENE_HPP
+
+#include "region.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Neurodeck {
+
+// The compositor's surfaces, in stacking order, and the part of the output
+// that has to be redrawn.
+//
+// Surface state follows wl_surface: attach(), damage(), damage_buffer() and
+// set_buffer_scale() only change pending state, and commit() applies it.
+// Every change that alters what is on screen adds the affected output
+// pixels to the scene's damage: a commit adds its damage translated to the
+// surface position, mapping, unmapping, resizing, moving, restacking and
+// destroying add the old and new bounds. The renderer redraws only
+// damage() and skips the frame when it is empty.
+//
+// Within the damage, visible_layers() works out front to back what each
+// surface still shows: the opaque region of a surface (all of it when its
+// buffer has no alpha) hides whatever is below, so a surface that is
+// covered is never drawn and an opaque one is drawn without blending.
+class Scene {
+public:
+    using SurfaceId = uint32_t;
+
+    struct Surface {
+        SurfaceId id = 0;
+        int32_t x = 0; // Position on the output.
+        int32_t y = 0;
+        int32_t width = 0; // In surface coordinates, i.e. buffer size / scale.
+        int32_t height = 0;
+        int32_t scale = 1;
+        bool mapped = false;  // Has a buffer.
+        uint64_t commits = 0; // Commits that changed content.
+        // Buffer pixels the last commit changed, in buffer coordinates: all
+        // of a buffer of a new size, else what the client damaged. This is
+        // what has to be uploaded.
+        Region buffer_damage;
+        // Surface coordinates, as last committed; parts outside the surface
+        // do not count. An opaque buffer makes all of the surface opaque.
+        Region opaque;
+        bool opaque_buffer = false;
+        Region input;                 // Only if !input_everywhere.
+        bool input_everywhere = true; // Until the client sets an input region.
+
+        Rect bounds() const { return {x, y, width, height}; }
+    };
+
+    // What one surface shows of the damage, in output coordinates: the
+    // rectangles to draw without blending and those to blend.
+    struct Layer {
+        SurfaceId id = 0;
+        std::vector<Rect> opaque;
+        std::vector<Rect> blended;
+    };
+
+    Scene(int32_t output_width, int32_t output_height);
+    // A deep copy; the render thread draws from one while the original
+    // takes new commits.
+    Scene(const Scene& other);
+    Scene& operator=(const Scene&) = delete;
+    ~Scene();
+
+    SurfaceId create_surface();
+    void destroy_surface(SurfaceId id);
+
+    // Pending state. A buffer of 0x0 unmaps the surface; dx and dy move it
+    // relative to its current position on commit. An opaque buffer has no
+    // alpha channel (XRGB8888).
+    void attach(SurfaceId id, int32_t buffer_width, int32_t buffer_height, int32_t dx = 0, int32_t dy = 0,
+                bool opaque = false);
+    void damage(SurfaceId id, const Rect& rect);        // Surface coordinates.
+    void damage_buffer(SurfaceId id, const Rect& rect); // Buffer coordinates.
+    void set_buffer_scale(SurfaceId id, int32_t scale);
+    // Surface coordinates. An empty opaque region, the default, claims
+    // nothing; one that is not exact() is ignored rather than trusted. A
+    // null input region means the whole surface.
+    void set_opaque_region(SurfaceId id, const Region& region);
+    void set_input_region(SurfaceId id, const Region* region);
+    void commit(SurfaceId id);
+
+    // Compositor-side placement; these take effect at once.
+    void set_position(SurfaceId id, int32_t x, int32_t y);
+    void raise(SurfaceId id);
+
+    const Surface* surface(SurfaceId id) const;
+    // Bottom to top.
+    const std::vector<SurfaceId>& stacking() const { return stacking_; }
+    // The topmost mapped surface whose input region holds the output pixel
+    // (x, y), or 0.
+    SurfaceId surface_at(int32_t x, int32_t y) const;
+    Rect output() const { return {0, 0, output_width_, output_height_}; }
+
+    // Output pixels changed since the last take_damage(), clipped to the
+    // output.
+    const Region& damage() const { return damage_; }
+    bool needs_frame() const { return !damage_.empty(); }
+    Region take_damage();
+    // Everything needs redrawing, e.g. after the output was lost.
+    void damage_all() { damage_.add(output()); }
+
+    // The visible parts of `damage` (clipped to the output), bottom to top,
+    // leaving out surfaces that show none of it. `background` gets the rest
+    // of the damage, which nothing opaque covers and so has to be cleared.
+    // Nothing of a layer is under the opaque part of one above it, unless
+    // the damage got too ragged to keep cutting; then `exclusive` is set to
+    // false, and the layers are only right drawn in order.
+    std::vector<Layer> visible_layers(const Region& damage, Region* background, bool* exclusive = nullptr) const;
+
+private:
+    struct Pending {
+        bool attached = false;
+        int32_t buffer_width = 0;
+        int32_t buffer_height = 0;
+        int32_t dx = 0;
+        int32_t dy = 0;
+        int32_t scale = 1;
+        bool opaque_buffer = false;
+        Region damage;        // Surface coordinates.
+        Region buffer_damage; // Buffer coordinates.
+        // Regions are double-buffered too, but kept until set again.
+        bool opaque_set = false;
+        Region opaque;
+        bool input_set = false;
+        bool input_everywhere = true;
+        Region input;
+    };
+    struct Node {
+        Surface surface;
+        Pending pending;
+        int32_t buffer_width = 0;
+        int32_t buffer_height = 0;
+    };
+
+    Node* find(SurfaceId id);
+    void add_damage(const Rect& rect);
+
+    int32_t output_width_;
+    int32_t output_height_;
+    SurfaceId next_id_ = 1;
+    std::unordered_map<SurfaceId, std::unique_ptr<Node>> nodes_;
+    std::vector<SurfaceId> stacking_;
+    Region damage_;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_SCENE_HPP
@@ -0,0 +1,193 @@
+// Headless wl_shm client for exercising the compositor: one surface,
+// double-buffered from one pool, committing as fast as buffers come back.
+// A small square moves across the surface and only the pixels that changed
+// are damaged, so each commit is a partial upload.
+//
+//   neurodeck_shm_client [--commits N] [--size WxH] [--frame]
+//
+// --frame waits for a frame callback before each commit instead. Exits with
+// status 1 if the compositor stops releasing buffers.
+#include <wayland-client.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static struct wl_compositor *compositor = nullptr;
+static struct wl_shm *shm = nullptr;
+
+static const int32_t kSquare = 32;
+static const uint32_t kBackground = 0xff202020;
+static const uint32_t kForeground = 0xff30a0ff;
+
+struct ClientBuffer {
+    struct wl_buffer *buffer = nullptr;
+    uint32_t *pixels = nullptr;
+    bool busy = false; // Attached and not yet released.
+};
+
+static ClientBuffer buffers[2];
+static bool frame_done = true;
+static uint64_t releases = 0;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version) {
+    if (strcmp(interface, "wl_compositor") == 0) {
+        compositor = static_cast<struct wl_compositor *>(wl_registry_bind(registry, name, &wl_compositor_interface, 4));
+    } else if (strcmp(interface, "wl_shm") == 0) {
+        shm = static_cast<struct wl_shm *>(wl_registry_bind(registry, name, &wl_shm_interface, 1));
+    }
+}
+
+static void registry_global_remove(void *data, struct wl_registry *registry, uint32_t name) {
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+static void buffer_release(void *data, struct wl_buffer *buffer) {
+    static_cast<ClientBuffer *>(data)->busy = false;
+    ++releases;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void frame_callback_done(void *data, struct wl_callback *callback, uint32_t time) {
+    frame_done = true;
+    wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_callback_done,
+};
+
+static void fill(uint32_t *pixels, int32_t stride_pixels, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color) {
+    for (int32_t row = y; row < y + height; ++row) {
+        for (int32_t column = x; column < x + width; ++column) pixels[row * stride_pixels + column] = color;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int commits = 2000;
+    int32_t width = 256;
+    int32_t height = 256;
+    bool use_frame_callbacks = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--commits") == 0 && i + 1 < argc) {
+            commits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) width = height = 0;
+        } else if (strcmp(argv[i], "--frame") == 0) {
+            use_frame_callbacks = true;
+        } else {
+            fprintf(stderr, "usage: %s [--commits N] [--size WxH] [--frame]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (width <= kSquare || height < kSquare || commits <= 0) {
+        fprintf(stderr, "Surface must be larger than %dx%d\n", kSquare, kSquare);
+        return 2;
+    }
+
+    struct wl_display *display = wl_display_connect(nullptr);
+    if (!display) {
+        fprintf(stderr, "Failed to connect to the Wayland display\n");
+        return 1;
+    }
+    struct wl_registry *registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &registry_listener, nullptr);
+    wl_display_roundtrip(display);
+    if (!compositor || !shm) {
+        fprintf(stderr, "Compositor lacks wl_compositor or wl_shm\n");
+        return 1;
+    }
+
+    // The pool starts with room for one buffer and grows for the second.
+    int32_t stride = width * 4;
+    int32_t buffer_bytes = stride * height;
+    int fd = memfd_create("neurodeck-shm-client", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, buffer_bytes * 2) < 0) {
+        fprintf(stderr, "Failed to create shared memory\n");
+        return 1;
+    }
+    void *memory = mmap(nullptr, buffer_bytes * 2, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Failed to map shared memory\n");
+        return 1;
+    }
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, buffer_bytes);
+    for (int i = 0; i < 2; ++i) {
+        if (i == 1) wl_shm_pool_resize(pool, buffer_bytes * 2);
+        buffers[i].pixels = reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(memory) + i * buffer_bytes);
+        fill(buffers[i].pixels, width, 0, 0, width, height, kBackground);
+        buffers[i].buffer = wl_shm_pool_create_buffer(pool, i * buffer_bytes, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+        wl_buffer_add_listener(buffers[i].buffer, &buffer_listener, &buffers[i]);
+    }
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    struct wl_surface *surface = wl_compositor_create_surface(compositor);
+    int32_t track = width - kSquare;
+    auto square_x = [track](int frame) { return frame < 0 ? 0 : frame % track; };
+
+    uint64_t waits = 0;
+    double start = now_seconds();
+    for (int frame = 0; frame < commits; ++frame) {
+        // Wait for a free buffer (and the frame callback, if asked to).
+        while (buffers[frame % 2].busy || (use_frame_callbacks && !frame_done)) {
+            ++waits;
+            if (wl_display_dispatch(display) < 0) {
+                fprintf(stderr, "Lost the connection after %d commits\n", frame);
+                return 1;
+            }
+        }
+        ClientBuffer &buffer = buffers[frame % 2];
+        // This buffer still shows the square from two frames ago; the
+        // compositor shows last frame's, so that and the new one are damage.
+        int32_t y = (height - kSquare) / 2;
+        if (frame >= 2) fill(buffer.pixels, width, square_x(frame - 2), y, kSquare, kSquare, kBackground);
+        fill(buffer.pixels, width, square_x(frame - 1), y, kSquare, kSquare, kBackground);
+        fill(buffer.pixels, width, square_x(frame), y, kSquare, kSquare, kForeground);
+
+        wl_surface_attach(surface, buffer.buffer, 0, 0);
+        if (frame == 0) {
+            wl_surface_damage_buffer(surface, 0, 0, width, height);
+        } else {
+            wl_surface_damage_buffer(surface, square_x(frame - 1), y, kSquare, kSquare);
+            wl_surface_damage_buffer(surface, square_x(frame), y, kSquare, kSquare);
+        }
+        if (use_frame_callbacks) {
+            frame_done = false;
+            wl_callback_add_listener(wl_surface_frame(surface), &frame_listener, nullptr);
+        }
+        wl_surface_commit(surface);
+        buffer.busy = true;
+        wl_display_flush(display);
+    }
+    wl_display_roundtrip(display);
+    double elapsed = now_seconds() - start;
+
+    bool released = !buffers[0].busy && !buffers[1].busy;
+    printf("%d commits of %dx%d in %.3f s: %.0f commits/s, %llu releases, %llu waits\n",
+           commits, width, height, elapsed, commits / elapsed,
+           static_cast<unsigned long long>(releases), static_cast<unsigned long long>(waits));
+    if (!released) fprintf(stderr, "A buffer was never released\n");
+
+    wl_surface_destroy(surface);
+    for (ClientBuffer &buffer : buffers) wl_buffer_destroy(buffer.buffer);
+    munmap(memory, buffer_bytes * 2);
+    wl_display_disconnect(display);
+    return released ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "shm_pool.hpp"
+#include <csignal>
+#include <mutex>
+#include <sys/mman.h>
+
+namespace Neurodeck {
+
+namespace {
+
+// The pool the current thread is reading, and whether it faulted.
+thread_local ShmPool* accessing_pool = nullptr;
+thread_local bool access_faulted = false;
+
+struct sigaction previous_sigbus_action;
+std::once_flag sigbus_handler_installed;
+
+void handle_sigbus(int signal_number, siginfo_t* info, void* /*context*/) {
+    ShmPool* pool = accessing_pool;
+    const uint8_t* address = static_cast<const uint8_t*>(info->si_addr);
+    if (pool && address >= pool->data() && address < pool->data() + pool->size()) {
+        // Replace the pool with zero pages so the read can finish.
+        void* replaced = mmap(const_cast<uint8_t*>(pool->data()), static_cast<size_t>(pool->size()), PROT_READ,
+                              MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+        if (replaced != MAP_FAILED) {
+            access_faulted = true;
+            return;
+        }
+    }
+    // Not a pool read: let the previous handler (or the default) have it.
+    sigaction(SIGBUS, &previous_sigbus_action, nullptr);
+    raise(signal_number);
+}
+
+void install_sigbus_handler() {
+    struct sigaction action = {};
+    action.sa_sigaction = handle_sigbus;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &previous_sigbus_action);
+}
+
+} // namespace
+
+std::shared_ptr<ShmPool> ShmPool::create(int fd, int32_t size) {
+    if (fd < 0 || size <= 0) return nullptr;
+    void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) return nullptr;
+    return std::shared_ptr<ShmPool>(new ShmPool(static_cast<uint8_t*>(data), size));
+}
+
+ShmPool::~ShmPool() {
+    munmap(data_, static_cast<size_t>(size_));
+}
+
+bool ShmPool::resize(int32_t size) {
+    if (size < size_) return false;
+    if (size == size_) return true;
+    std::unique_lock<std::shared_mutex> lock(mapping_mutex_);
+    void* data = mremap(data_, static_cast<size_t>(size_), static_cast<size_t>(size), MREMAP_MAYMOVE);
+    if (data == MAP_FAILED) return false;
+    data_ = static_cast<uint8_t*>(data);
+    size_ = size;
+    return true;
+}
+
+void ShmPool::begin_access() {
+    std::call_once(sigbus_handler_installed, install_sigbus_handler);
+    mapping_mutex_.lock_shared();
+    accessing_pool = this;
+    access_faulted = false;
+}
+
+bool ShmPool::end_access() {
+    accessing_pool = nullptr;
+    mapping_mutex_.unlock_shared();
+    return !access_faulted;
+}
+
+bool ShmBuffer::valid() const {
+    if (!pool || offset < 0 || width <= 0 || height <= 0) return false;
+    if (stride < int64_t(width) * 4) return false;
+    return int64_t(offset) + int64_t(stride) * height <= pool->size();
+}
+
+} // namespace Neurodeck
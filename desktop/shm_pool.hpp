@@ -0,0 +1,78 @@
+#ifndef DESKTOP_SHM_POOL_HPP
+#define DESKTOP_SHM_POOL_HPP
+
+#include "region.hpp"
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+
+namespace Neurodeck {
+
+// Pixel formats, numbered as in wl_shm.format.
+enum class ShmFormat : uint32_t {
+    ARGB8888 = 0, // Premultiplied alpha.
+    XRGB8888 = 1, // Alpha byte ignored.
+};
+
+// A client's shared-memory pool: the file behind a wl_shm_pool, mapped
+// read-only. The mapping outlives the wl_shm_pool object for as long as a
+// buffer in it is alive, so buffers hold a shared_ptr to it.
+//
+// The client can truncate the file under us, and touching a page past its
+// end raises SIGBUS. Reads therefore go between begin_access() and
+// end_access(): a SIGBUS inside that window maps zero pages over the pool
+// instead of killing the compositor, and end_access() reports it so the
+// client can be disconnected.
+//
+// Reads happen on the render thread while resize() comes from the
+// dispatch thread and may move the mapping, so an access also holds the
+// pool against resize() until end_access().
+class ShmPool {
+public:
+    // Maps `size` bytes of `fd`; the fd is not needed afterwards. Returns
+    // nullptr if the fd cannot be mapped.
+    static std::shared_ptr<ShmPool> create(int fd, int32_t size);
+    ~ShmPool();
+
+    ShmPool(const ShmPool&) = delete;
+    ShmPool& operator=(const ShmPool&) = delete;
+
+    // Pools only grow. Returns false if the mapping could not be extended.
+    // Waits for an access in progress on another thread.
+    bool resize(int32_t size);
+
+    const uint8_t* data() const { return data_; }
+    int32_t size() const { return size_; }
+
+    void begin_access();
+    // False if the client truncated the file during the access; what was
+    // read is zeros.
+    bool end_access();
+
+private:
+    ShmPool(uint8_t* data, int32_t size) : data_(data), size_(size) {}
+
+    uint8_t* data_;
+    int32_t size_;
+    std::shared_mutex mapping_mutex_; // Shared during an access.
+};
+
+// A wl_buffer in a pool.
+struct ShmBuffer {
+    std::shared_ptr<ShmPool> pool;
+    int32_t offset = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t stride = 0;
+    ShmFormat format = ShmFormat::ARGB8888;
+
+    // The layout fits the pool, whose size can only grow.
+    bool valid() const;
+    const uint8_t* pixels() const { return pool->data() + offset; }
+    Rect bounds() const { return {0, 0, width, height}; }
+    bool opaque() const { return format == ShmFormat::XRGB8888; }
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_SHM_POOL_HPP
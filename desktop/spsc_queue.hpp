@@ -0,0 +1,64 @@
+#ifndef DESKTOP_SPSC_QUEUE_HPP
+#define DESKTOP_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+namespace Neurodeck {
+
+// Unbounded single-producer, single-consumer FIFO without locks.
+//
+// A linked list that always holds one node the consumer has already
+// emptied: push() links a new node after the last one and pop() advances
+// past the first, so the two ends never touch the same pointer. The
+// producer never waits for the consumer, however far behind it is. Waking
+// a consumer that is asleep is left to the caller (an eventfd in the
+// compositor).
+template <typename T>
+class SpscQueue {
+public:
+    SpscQueue() : head_(new Node), tail_(head_) {}
+    ~SpscQueue() {
+        while (head_) {
+            Node* next = head_->next.load(std::memory_order_relaxed);
+            delete head_;
+            head_ = next;
+        }
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only.
+    void push(T value) {
+        Node* node = new Node;
+        node->value = std::move(value);
+        tail_->next.store(node, std::memory_order_release);
+        tail_ = node;
+    }
+
+    // Consumer only. False if the queue is empty.
+    bool pop(T& value) {
+        Node* next = head_->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        value = std::move(next->value);
+        next->value = T(); // Drop what it held now, not when the node goes.
+        delete head_;
+        head_ = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    // On separate cache lines, so each thread writes only its own.
+    alignas(64) Node* head_; // Consumer side: the emptied node.
+    alignas(64) Node* tail_; // Producer side: the last node.
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_SPSC_QUEUE_HPP
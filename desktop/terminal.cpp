@@ -0,0 +1,504 @@
+#include "terminal.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace Neurodeck {
+
+namespace {
+
+// Parameter `i`, or `fallback` if it was omitted.
+int param_or(const int32_t* params, int count, int i, int fallback) {
+    return i < count && params[i] >= 0 ? params[i] : fallback;
+}
+
+// Counts and positions, where 0 means 1 as well.
+int count_param(const int32_t* params, int count, int i) {
+    return std::max(1, param_or(params, count, i, 1));
+}
+
+// The nearest colour of the 6x6x6 cube or the grey ramp of the 256.
+int16_t nearest_color(int red, int green, int blue) {
+    auto level = [](int value) { return value < 48 ? 0 : value < 115 ? 1 : (value - 35) / 40; };
+    auto cube_value = [](int level) { return level == 0 ? 0 : 55 + 40 * level; };
+    int r = level(red), g = level(green), b = level(blue);
+    auto distance = [&](int x, int y, int z) {
+        return (x - red) * (x - red) + (y - green) * (y - green) + (z - blue) * (z - blue);
+    };
+    int cube = distance(cube_value(r), cube_value(g), cube_value(b));
+    int grey_level = std::min(23, std::max(0, ((red + green + blue) / 3 - 3) / 10));
+    int grey = 8 + 10 * grey_level;
+    if (distance(grey, grey, grey) < cube) return int16_t(232 + grey_level);
+    return int16_t(16 + 36 * r + 6 * g + b);
+}
+
+// Combining marks and other zero-width characters are dropped rather than
+// given a cell of their own.
+bool zero_width(char32_t ch) {
+    return (ch >= 0x300 && ch <= 0x36f) || (ch >= 0x200b && ch <= 0x200f) || (ch >= 0xfe00 && ch <= 0xfe0f);
+}
+
+} // namespace
+
+Terminal::Terminal(int columns, int rows)
+    : columns_(std::max(1, columns)),
+      rows_(std::max(1, rows)),
+      parser_(*this),
+      dirty_begin_(rows_),
+      dirty_end_(rows_) {
+    reset();
+}
+
+void Terminal::reset() {
+    for (Screen& screen : screens_) {
+        screen.cells.assign(size_t(columns_) * rows_, Cell());
+        screen.rows.resize(rows_);
+        for (int y = 0; y < rows_; ++y) screen.rows[y] = y;
+        screen.used.assign(rows_, 0);
+    }
+    alternate_ = false;
+    cursor_ = Cursor();
+    saved_[0] = saved_[1] = Cursor();
+    cursor_visible_ = true;
+    autowrap_ = true;
+    scroll_top_ = 0;
+    scroll_bottom_ = rows_ - 1;
+    touch_all();
+}
+
+void Terminal::clear_damage() {
+    std::fill(dirty_begin_.begin(), dirty_begin_.end(), columns_);
+    std::fill(dirty_end_.begin(), dirty_end_.end(), 0);
+    scrolled_ = 0;
+}
+
+std::string Terminal::take_replies() {
+    std::string replies;
+    replies.swap(replies_);
+    return replies;
+}
+
+Cell Terminal::blank() const {
+    Cell cell;
+    cell.bg = cursor_.style.bg; // Erasing paints the current background.
+    return cell;
+}
+
+void Terminal::touch(int y, int begin, int end) {
+    dirty_begin_[y] = std::min(dirty_begin_[y], begin);
+    dirty_end_[y] = std::max(dirty_end_[y], end);
+    int& used = screen().used[screen().rows[y]];
+    used = std::max(used, end);
+}
+
+void Terminal::touch_all() {
+    std::fill(dirty_begin_.begin(), dirty_begin_.end(), 0);
+    std::fill(dirty_end_.begin(), dirty_end_.end(), columns_);
+}
+
+void Terminal::print_ascii(const char* text, size_t length) {
+    while (length > 0) {
+        if (cursor_.wrap_pending && autowrap_) wrap();
+        Cell* cells = row(cursor_.y);
+        const int x = cursor_.x;
+        const int n = int(std::min<size_t>(length, size_t(columns_ - x)));
+        Cell cell = cursor_.style;
+        for (int i = 0; i < n; ++i) {
+            cell.ch = static_cast<unsigned char>(text[i]);
+            cells[x + i] = cell;
+        }
+        touch(cursor_.y, x, x + n);
+        text += n;
+        length -= size_t(n);
+        if (x + n >= columns_) {
+            cursor_.x = columns_ - 1;
+            cursor_.wrap_pending = true;
+        } else {
+            cursor_.x = x + n;
+        }
+    }
+}
+
+void Terminal::print(char32_t ch) {
+    if (!zero_width(ch)) put(ch);
+}
+
+void Terminal::put(char32_t ch) {
+    if (cursor_.wrap_pending && autowrap_) wrap();
+    Cell cell = cursor_.style;
+    cell.ch = ch;
+    row(cursor_.y)[cursor_.x] = cell;
+    touch(cursor_.y, cursor_.x, cursor_.x + 1);
+    if (cursor_.x + 1 >= columns_) cursor_.wrap_pending = true;
+    else ++cursor_.x;
+}
+
+void Terminal::wrap() {
+    cursor_.x = 0;
+    cursor_.wrap_pending = false;
+    line_feed();
+}
+
+void Terminal::line_feed() {
+    if (cursor_.y == scroll_bottom_) scroll_up(scroll_top_, scroll_bottom_, 1);
+    else if (cursor_.y < rows_ - 1) ++cursor_.y;
+}
+
+void Terminal::reverse_index() {
+    if (cursor_.y == scroll_top_) scroll_down(scroll_top_, scroll_bottom_, 1);
+    else if (cursor_.y > 0) --cursor_.y;
+}
+
+void Terminal::scroll_up(int top, int bottom, int lines) {
+    lines = std::min(lines, bottom - top + 1);
+    std::vector<int>& rows = screen().rows;
+    std::rotate(rows.begin() + top, rows.begin() + top + lines, rows.begin() + bottom + 1);
+    if (top == 0 && bottom == rows_ - 1) {
+        // The damage moves with the rows, and a renderer can move what it
+        // drew of them too.
+        std::rotate(dirty_begin_.begin(), dirty_begin_.begin() + lines, dirty_begin_.end());
+        std::rotate(dirty_end_.begin(), dirty_end_.begin() + lines, dirty_end_.end());
+        scrolled_ = std::min(scrolled_ + lines, rows_);
+    } else {
+        for (int y = top; y <= bottom; ++y) touch(y, 0, columns_);
+    }
+    for (int y = bottom - lines + 1; y <= bottom; ++y) erase(y, 0, columns_);
+}
+
+void Terminal::scroll_down(int top, int bottom, int lines) {
+    lines = std::min(lines, bottom - top + 1);
+    std::vector<int>& rows = screen().rows;
+    std::rotate(rows.begin() + top, rows.begin() + bottom + 1 - lines, rows.begin() + bottom + 1);
+    for (int y = top; y <= bottom; ++y) touch(y, 0, columns_);
+    for (int y = top; y < top + lines; ++y) erase(y, 0, columns_);
+}
+
+void Terminal::erase(int y, int begin, int end) {
+    begin = std::max(0, begin);
+    end = std::min(columns_, end);
+    if (begin >= end) return;
+    const Cell cell = blank();
+    if (begin == 0 && end == columns_ && cell == Cell()) {
+        // Past what was written the row is blank already.
+        std::fill(row(y), row(y) + screen().used[screen().rows[y]], cell);
+        touch(y, begin, end);
+        screen().used[screen().rows[y]] = 0;
+        return;
+    }
+    std::fill(row(y) + begin, row(y) + end, cell);
+    touch(y, begin, end);
+}
+
+void Terminal::move_to(int x, int y) {
+    cursor_.x = std::min(std::max(x, 0), columns_ - 1);
+    cursor_.y = std::min(std::max(y, 0), rows_ - 1);
+    cursor_.wrap_pending = false;
+}
+
+void Terminal::execute(uint8_t control) {
+    switch (control) {
+    case '\b':
+        move_to(cursor_.x - 1, cursor_.y);
+        break;
+    case '\t':
+        move_to((cursor_.x / 8 + 1) * 8, cursor_.y); // Stops every 8 columns.
+        break;
+    case '\n':
+    case '\v':
+    case '\f':
+        cursor_.wrap_pending = false;
+        line_feed();
+        break;
+    case '\r':
+        move_to(0, cursor_.y);
+        break;
+    default:
+        break; // BEL and the rest.
+    }
+}
+
+void Terminal::esc(const char* intermediates, char final) {
+    if (intermediates[0] != 0) return; // Character sets and the like.
+    switch (final) {
+    case '7':
+        saved_[alternate_] = cursor_;
+        break;
+    case '8':
+        cursor_ = saved_[alternate_];
+        break;
+    case 'D':
+        cursor_.wrap_pending = false;
+        line_feed();
+        break;
+    case 'E':
+        move_to(0, cursor_.y);
+        line_feed();
+        break;
+    case 'M':
+        cursor_.wrap_pending = false;
+        reverse_index();
+        break;
+    case 'c':
+        reset();
+        break;
+    default:
+        break;
+    }
+}
+
+void Terminal::csi(const int32_t* params, int count, const char* intermediates, char final) {
+    if (intermediates[0] == '?' && intermediates[1] == 0 && (final == 'h' || final == 'l')) {
+        set_mode(params, count, true, final == 'h');
+        return;
+    }
+    if (intermediates[0] == '>' && intermediates[1] == 0 && final == 'c') {
+        replies_ += "\x1b[>0;0;0c"; // Secondary device attributes.
+        return;
+    }
+    if (intermediates[0] != 0) return;
+
+    const int n = count_param(params, count, 0);
+    const int x = cursor_.x;
+    const int y = cursor_.y;
+    // Vertical movement stops at the scrolling region if it starts inside.
+    const int top = y >= scroll_top_ ? scroll_top_ : 0;
+    const int bottom = y <= scroll_bottom_ ? scroll_bottom_ : rows_ - 1;
+    switch (final) {
+    case '@': { // ICH
+        Cell* cells = row(y);
+        int moved = std::max(0, columns_ - x - n);
+        std::copy_backward(cells + x, cells + x + moved, cells + x + moved + std::min(n, columns_ - x));
+        erase(y, x, x + n);
+        touch(y, x, columns_);
+        cursor_.wrap_pending = false;
+        break;
+    }
+    case 'A':
+        move_to(x, std::max(y - n, top));
+        break;
+    case 'B':
+    case 'e':
+        move_to(x, std::min(y + n, bottom));
+        break;
+    case 'C':
+    case 'a':
+        move_to(x + n, y);
+        break;
+    case 'D':
+        move_to(x - n, y);
+        break;
+    case 'E':
+        move_to(0, std::min(y + n, bottom));
+        break;
+    case 'F':
+        move_to(0, std::max(y - n, top));
+        break;
+    case 'G':
+    case '`':
+        move_to(n - 1, y);
+        break;
+    case 'H':
+    case 'f':
+        move_to(count_param(params, count, 1) - 1, n - 1);
+        break;
+    case 'J': // ED
+        switch (param_or(params, count, 0, 0)) {
+        case 0:
+            erase(y, x, columns_);
+            for (int row = y + 1; row < rows_; ++row) erase(row, 0, columns_);
+            break;
+        case 1:
+            for (int row = 0; row < y; ++row) erase(row, 0, columns_);
+            erase(y, 0, x + 1);
+            break;
+        case 2:
+        case 3:
+            for (int row = 0; row < rows_; ++row) erase(row, 0, columns_);
+            break;
+        }
+        break;
+    case 'K': // EL
+        switch (param_or(params, count, 0, 0)) {
+        case 0:
+            erase(y, x, columns_);
+            break;
+        case 1:
+            erase(y, 0, x + 1);
+            break;
+        case 2:
+            erase(y, 0, columns_);
+            break;
+        }
+        break;
+    case 'L': // IL
+        if (y >= scroll_top_ && y <= scroll_bottom_) scroll_down(y, scroll_bottom_, n);
+        move_to(0, y);
+        break;
+    case 'M': // DL
+        if (y >= scroll_top_ && y <= scroll_bottom_) scroll_up(y, scroll_bottom_, n);
+        move_to(0, y);
+        break;
+    case 'P': { // DCH
+        Cell* cells = row(y);
+        int deleted = std::min(n, columns_ - x);
+        std::copy(cells + x + deleted, cells + columns_, cells + x);
+        erase(y, columns_ - deleted, columns_);
+        touch(y, x, columns_);
+        cursor_.wrap_pending = false;
+        break;
+    }
+    case 'S':
+        scroll_up(scroll_top_, scroll_bottom_, n);
+        break;
+    case 'T':
+        scroll_down(scroll_top_, scroll_bottom_, n);
+        break;
+    case 'X': // ECH
+        erase(y, x, x + n);
+        cursor_.wrap_pending = false;
+        break;
+    case 'd':
+        move_to(x, n - 1);
+        break;
+    case 'm':
+        select_graphic_rendition(params, count);
+        break;
+    case 'n':
+        if (param_or(params, count, 0, 0) == 5) {
+            replies_ += "\x1b[0n";
+        } else if (param_or(params, count, 0, 0) == 6) {
+            char report[32];
+            snprintf(report, sizeof(report), "\x1b[%d;%dR", y + 1, x + 1);
+            replies_ += report;
+        }
+        break;
+    case 'c':
+        if (param_or(params, count, 0, 0) == 0) replies_ += "\x1b[?6c"; // A VT102.
+        break;
+    case 'r': { // DECSTBM
+        int new_top = count_param(params, count, 0) - 1;
+        int new_bottom = std::min(param_or(params, count, 1, rows_), rows_) - 1;
+        if (new_bottom == -1) new_bottom = rows_ - 1;
+        if (new_top < new_bottom) {
+            scroll_top_ = new_top;
+            scroll_bottom_ = new_bottom;
+            move_to(0, 0);
+        }
+        break;
+    }
+    case 's':
+        saved_[alternate_] = cursor_;
+        break;
+    case 'u':
+        cursor_ = saved_[alternate_];
+        break;
+    default:
+        break;
+    }
+}
+
+void Terminal::set_mode(const int32_t* params, int count, bool private_mode, bool on) {
+    if (!private_mode) return;
+    for (int i = 0; i < count; ++i) {
+        switch (params[i]) {
+        case 7:
+            autowrap_ = on;
+            break;
+        case 25:
+            cursor_visible_ = on;
+            break;
+        case 47:
+        case 1047:
+            switch_screen(on);
+            break;
+        case 1048:
+            if (on) saved_[alternate_] = cursor_;
+            else cursor_ = saved_[alternate_];
+            break;
+        case 1049:
+            if (on) {
+                saved_[0] = cursor_;
+                switch_screen(true);
+            } else {
+                switch_screen(false);
+                cursor_ = saved_[0];
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// The alternate screen is cleared on the way in, as full-screen programs
+// expect.
+void Terminal::switch_screen(bool alternate) {
+    if (alternate_ == alternate) return;
+    alternate_ = alternate;
+    if (alternate) {
+        std::fill(screen().cells.begin(), screen().cells.end(), blank());
+        std::fill(screen().used.begin(), screen().used.end(), columns_);
+    }
+    touch_all();
+}
+
+void Terminal::select_graphic_rendition(const int32_t* params, int count) {
+    Cell& style = cursor_.style;
+    if (count == 0) {
+        style = Cell();
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        const int p = std::max(0, params[i]);
+        if (p == 0) {
+            style = Cell();
+        } else if (p == 1) {
+            style.attrs |= kAttrBold;
+        } else if (p == 2) {
+            style.attrs |= kAttrDim;
+        } else if (p == 3) {
+            style.attrs |= kAttrItalic;
+        } else if (p == 4) {
+            style.attrs |= kAttrUnderline;
+        } else if (p == 7) {
+            style.attrs |= kAttrReverse;
+        } else if (p == 22) {
+            style.attrs &= ~(kAttrBold | kAttrDim);
+        } else if (p == 23) {
+            style.attrs &= ~kAttrItalic;
+        } else if (p == 24) {
+            style.attrs &= ~kAttrUnderline;
+        } else if (p == 27) {
+            style.attrs &= ~kAttrReverse;
+        } else if (p >= 30 && p <= 37) {
+            style.fg = int16_t(p - 30);
+        } else if (p == 39) {
+            style.fg = Cell::kDefaultColor;
+        } else if (p >= 40 && p <= 47) {
+            style.bg = int16_t(p - 40);
+        } else if (p == 49) {
+            style.bg = Cell::kDefaultColor;
+        } else if (p >= 90 && p <= 97) {
+            style.fg = int16_t(p - 90 + 8);
+        } else if (p >= 100 && p <= 107) {
+            style.bg = int16_t(p - 100 + 8);
+        } else if (p == 38 || p == 48) {
+            // 38;5;index or 38;2;red;green;blue, and the same for 48.
+            int16_t color = Cell::kDefaultColor;
+            int mode = param_or(params, count, i + 1, 0);
+            if (mode == 5 && i + 2 < count) {
+                color = int16_t(std::min(255, std::max(0, params[i + 2])));
+                i += 2;
+            } else if (mode == 2 && i + 4 < count) {
+                color = nearest_color(std::min(255, std::max(0, params[i + 2])),
+                                      std::min(255, std::max(0, params[i + 3])),
+                                      std::min(255, std::max(0, params[i + 4])));
+                i += 4;
+            } else {
+                break; // Malformed; the rest would be misread.
+            }
+            (p == 38 ? style.fg : style.bg) = color;
+        }
+    }
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,112 @@
+#ifndef DESKTOP_TERMINAL_HPP
+#define DESKTOP_TERMINAL_HPP
+
+#include "terminal_screen.hpp"
+#include "vt_parser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+// The screen of a program running in a terminal: a grid of Cells, kept up
+// to date from what the program writes.
+//
+// Understands what the shell and the usual full-screen programs send:
+// cursor movement, erasing (with the current background), insert and
+// delete, scrolling regions, SGR attributes and colours (24-bit colours go
+// to the nearest of the 256), autowrap, the alternate screen and status
+// reports, which are queued for take_replies(). The rest is ignored.
+// Characters are one cell wide.
+//
+// Screen rows are found through an index, so a scroll moves row numbers
+// rather than cells, and a row remembers how much of it was written, so
+// clearing the line that scrolled in costs what the line held rather than
+// the width. Each row keeps the span of columns changed since
+// clear_damage(), and scrolls of the whole screen are counted, so a
+// renderer can move what it drew and redraw only the rest.
+class Terminal : private VtParser::Handler {
+public:
+    Terminal(int columns, int rows);
+
+    void feed(const char* data, size_t length) { parser_.feed(data, length); }
+
+    int columns() const { return columns_; }
+    int rows() const { return rows_; }
+    const Cell& at(int x, int y) const { return screen().cells[size_t(screen().rows[y]) * columns_ + x]; }
+
+    int cursor_x() const { return cursor_.x; }
+    int cursor_y() const { return cursor_.y; }
+    bool cursor_visible() const { return cursor_visible_; }
+
+    // Lines the whole screen moved up since clear_damage(); what moved
+    // with them is unchanged unless its row says otherwise.
+    int scrolled() const { return scrolled_; }
+    // Columns [dirty_begin, dirty_end) of row `y` may have changed since
+    // clear_damage(); empty if the row is clean.
+    int dirty_begin(int y) const { return dirty_begin_[y]; }
+    int dirty_end(int y) const { return dirty_end_[y]; }
+    void clear_damage();
+
+    // Answers to the program's queries, to be written back to it.
+    std::string take_replies();
+
+private:
+    struct Screen {
+        std::vector<Cell> cells;
+        std::vector<int> rows; // Screen row to row of `cells`.
+        std::vector<int> used; // Per row of `cells`: from here on all Cell().
+    };
+    struct Cursor {
+        int x = 0;
+        int y = 0;
+        Cell style;                // Attributes and colours of new text.
+        bool wrap_pending = false; // The last column was written.
+    };
+
+    void print_ascii(const char* text, size_t length) override;
+    void print(char32_t ch) override;
+    void execute(uint8_t control) override;
+    void csi(const int32_t* params, int count, const char* intermediates, char final) override;
+    void esc(const char* intermediates, char final) override;
+
+    Screen& screen() { return screens_[alternate_]; }
+    const Screen& screen() const { return screens_[alternate_]; }
+    Cell* row(int y) { return &screen().cells[size_t(screen().rows[y]) * columns_]; }
+    Cell blank() const;
+    void touch(int y, int begin, int end);
+    void touch_all();
+    void put(char32_t ch);
+    void wrap();
+    void line_feed();
+    void reverse_index();
+    void scroll_up(int top, int bottom, int lines);
+    void scroll_down(int top, int bottom, int lines);
+    void erase(int y, int begin, int end);
+    void move_to(int x, int y);
+    void set_mode(const int32_t* params, int count, bool private_mode, bool on);
+    void select_graphic_rendition(const int32_t* params, int count);
+    void switch_screen(bool alternate);
+    void reset();
+
+    int columns_;
+    int rows_;
+    VtParser parser_;
+    Screen screens_[2];
+    bool alternate_ = false;
+    Cursor cursor_;
+    Cursor saved_[2]; // DECSC, per screen.
+    bool cursor_visible_ = true;
+    bool autowrap_ = true;
+    int scroll_top_ = 0;    // Scrolling region, inclusive.
+    int scroll_bottom_ = 0;
+    int scrolled_ = 0;
+    std::vector<int> dirty_begin_;
+    std::vector<int> dirty_end_;
+    std::string replies_;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_TERMINAL_HPP
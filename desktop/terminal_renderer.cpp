@@ -0,0 +1,132 @@
+#include "terminal_renderer.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Neurodeck {
+
+namespace {
+
+const uint32_t kBasicColors[16] = {
+    0xff000000, 0xffcd0000, 0xff00cd00, 0xffcdcd00, 0xff0000ee, 0xffcd00cd, 0xff00cdcd, 0xffe5e5e5,
+    0xff7f7f7f, 0xffff0000, 0xff00ff00, 0xffffff00, 0xff5c5cff, 0xffff00ff, 0xff00ffff, 0xffffffff,
+};
+
+// Never equal to a real cell, so what it stands for is redrawn.
+Cell unknown_cell() {
+    Cell cell;
+    cell.ch = 0xffffffff;
+    return cell;
+}
+
+// `coverage` of the way from `background` to `foreground`, rounded. Red
+// and blue, then green, share a multiply: each lane stays below 16 bits.
+uint32_t mix(uint32_t foreground, uint32_t background, uint32_t coverage) {
+    const uint32_t inverse = 255 - coverage;
+    uint32_t rb = (foreground & 0xff00ff) * coverage + (background & 0xff00ff) * inverse + 0x800080;
+    uint32_t g = (foreground & 0xff00) * coverage + (background & 0xff00) * inverse + 0x8000;
+    rb = (rb + (rb >> 8 & 0xff00ff)) >> 8 & 0xff00ff;
+    g = (g + (g >> 8 & 0xff00)) >> 8 & 0xff00;
+    return 0xff000000 | rb | g;
+}
+
+} // namespace
+
+TerminalRenderer::TerminalRenderer(GlyphAtlas& glyphs) : glyphs_(glyphs) {
+    std::copy(std::begin(kBasicColors), std::end(kBasicColors), palette_);
+    const uint32_t levels[6] = {0, 95, 135, 175, 215, 255};
+    for (int i = 0; i < 216; ++i) {
+        palette_[16 + i] = 0xff000000 | levels[i / 36] << 16 | levels[i / 6 % 6] << 8 | levels[i % 6];
+    }
+    for (int i = 0; i < 24; ++i) {
+        uint32_t grey = 8 + 10 * i;
+        palette_[232 + i] = 0xff000000 | grey << 16 | grey << 8 | grey;
+    }
+}
+
+Region TerminalRenderer::draw(Terminal& terminal, uint8_t* pixels, int32_t stride) {
+    const int cell_width = glyphs_.cell_width();
+    const int cell_height = glyphs_.cell_height();
+    Region damage;
+    // Rows from here down show nothing known and are compared in full.
+    int unknown_from = rows_;
+    if (terminal.columns() != columns_ || terminal.rows() != rows_) {
+        columns_ = terminal.columns();
+        rows_ = terminal.rows();
+        shown_.assign(size_t(columns_) * rows_, unknown_cell());
+        cursor_x_ = cursor_y_ = -1;
+        unknown_from = 0;
+    } else if (terminal.scrolled() > 0) {
+        const int lines = std::min(terminal.scrolled(), rows_);
+        const size_t row_bytes = size_t(stride) * cell_height;
+        std::memmove(pixels, pixels + lines * row_bytes, (rows_ - lines) * row_bytes);
+        std::copy(shown_.begin() + size_t(lines) * columns_, shown_.end(), shown_.begin());
+        std::fill(shown_.end() - size_t(lines) * columns_, shown_.end(), unknown_cell());
+        cursor_y_ -= lines;
+        if (cursor_y_ < 0) cursor_x_ = cursor_y_ = -1;
+        unknown_from = rows_ - lines;
+        damage.add(Rect{0, 0, columns_ * cell_width, (rows_ - lines) * cell_height});
+    }
+
+    const bool cursor_visible = terminal.cursor_visible();
+    const int cursor_x = terminal.cursor_x();
+    const int cursor_y = terminal.cursor_y();
+    // Redraws what differs in [begin, end) of row `y`.
+    auto update = [&](int y, int begin, int end) {
+        Cell* shown = &shown_[size_t(y) * columns_];
+        int changed_begin = end, changed_end = begin;
+        for (int x = begin; x < end; ++x) {
+            Cell cell = terminal.at(x, y);
+            if (cursor_visible && x == cursor_x && y == cursor_y) cell.attrs ^= kAttrReverse;
+            if (cell == shown[x]) continue;
+            draw_cell(cell, pixels, stride, x, y);
+            shown[x] = cell;
+            changed_begin = std::min(changed_begin, x);
+            changed_end = x + 1;
+        }
+        if (changed_begin < changed_end) {
+            damage.add(Rect{changed_begin * cell_width, y * cell_height, (changed_end - changed_begin) * cell_width,
+                            cell_height});
+        }
+    };
+    for (int y = 0; y < rows_; ++y) {
+        if (y >= unknown_from) update(y, 0, columns_);
+        else if (terminal.dirty_begin(y) < terminal.dirty_end(y)) {
+            update(y, terminal.dirty_begin(y), terminal.dirty_end(y));
+        }
+    }
+    // The cursor moves without the cells under it changing.
+    if (cursor_x_ >= 0) update(cursor_y_, cursor_x_, cursor_x_ + 1);
+    update(cursor_y, cursor_x, cursor_x + 1);
+    cursor_x_ = cursor_x;
+    cursor_y_ = cursor_y;
+    terminal.clear_damage();
+    return damage;
+}
+
+void TerminalRenderer::draw_cell(const Cell& cell, uint8_t* pixels, int32_t stride, int x, int y) {
+    ++cells_drawn_;
+    const int cell_width = glyphs_.cell_width();
+    const int cell_height = glyphs_.cell_height();
+    const bool bold = cell.attrs & kAttrBold;
+    uint32_t foreground = color(bold && cell.fg >= 0 && cell.fg < 8 ? int16_t(cell.fg + 8) : cell.fg, kForeground);
+    uint32_t background = color(cell.bg, kBackground);
+    if (cell.attrs & kAttrReverse) std::swap(foreground, background);
+    if (cell.attrs & kAttrDim) foreground = mix(foreground, background, 128);
+
+    const uint8_t* mask = cell.ch == U' ' ? nullptr : glyphs_.lookup(cell.ch, bold);
+    const int underline = cell.attrs & kAttrUnderline ? cell_height - 2 : -1;
+    for (int row = 0; row < cell_height; ++row) {
+        uint32_t* out = reinterpret_cast<uint32_t*>(pixels + size_t(y * cell_height + row) * stride) + x * cell_width;
+        if (!mask || row == underline) {
+            std::fill(out, out + cell_width, row == underline ? foreground : background);
+            continue;
+        }
+        const uint8_t* coverage = mask + row * cell_width;
+        for (int column = 0; column < cell_width; ++column) {
+            const uint32_t a = coverage[column];
+            out[column] = a == 0 ? background : a == 255 ? foreground : mix(foreground, background, a);
+        }
+    }
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,55 @@
+#ifndef DESKTOP_TERMINAL_RENDERER_HPP
+#define DESKTOP_TERMINAL_RENDERER_HPP
+
+#include "glyph_atlas.hpp"
+#include "region.hpp"
+#include "terminal.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+// Draws a Terminal into an XRGB8888 image, a cell at a time: a glyph
+// mask from the GlyphAtlas blended between the cell's colours.
+//
+// The renderer remembers every cell it drew, so draw() only compares the
+// spans the terminal marked dirty and redraws the cells that differ. When
+// the whole screen scrolled, the image and what it shows are moved up
+// first, so a burst of output costs one move and the new lines however
+// many lines went by. Colours are xterm's 256; bold text in the first
+// eight is brightened, and the cursor is a reversed cell.
+class TerminalRenderer {
+public:
+    static constexpr uint32_t kForeground = 0xffd0d0d0;
+    static constexpr uint32_t kBackground = 0xff1c1c1c;
+
+    explicit TerminalRenderer(GlyphAtlas& glyphs);
+
+    // Brings `pixels` (`stride` bytes per row, room for every cell) up to
+    // date with `terminal` and clears its damage. Returns the rectangles
+    // that changed, in pixels. The first call draws everything, as does
+    // the first after the terminal changes size.
+    Region draw(Terminal& terminal, uint8_t* pixels, int32_t stride);
+
+    size_t cells_drawn() const { return cells_drawn_; }
+
+private:
+    void draw_cell(const Cell& cell, uint8_t* pixels, int32_t stride, int x, int y);
+    uint32_t color(int16_t index, uint32_t fallback) const {
+        return index == Cell::kDefaultColor ? fallback : palette_[index & 0xff];
+    }
+
+    GlyphAtlas& glyphs_;
+    uint32_t palette_[256];
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<Cell> shown_; // What the image shows, row by row.
+    int cursor_x_ = -1;       // Where the cursor was drawn; -1 if nowhere.
+    int cursor_y_ = -1;
+    size_t cells_drawn_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_TERMINAL_RENDERER_HPP
@@ -0,0 +1,196 @@
+#include "vt_parser.hpp"
+
+namespace Neurodeck {
+
+namespace {
+
+const char32_t kReplacement = 0xfffd;
+
+bool is_final(uint8_t byte) {
+    return byte >= 0x40 && byte <= 0x7e;
+}
+
+} // namespace
+
+void VtParser::feed(const char* data, size_t length) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = p + length;
+    while (p < end) {
+        if (state_ == State::Ground && utf8_remaining_ == 0) {
+            const uint8_t* run = p;
+            while (p < end && *p >= 0x20 && *p < 0x7f) ++p;
+            if (p != run) {
+                handler_.print_ascii(reinterpret_cast<const char*>(run), size_t(p - run));
+                continue;
+            }
+        }
+        advance(*p++);
+    }
+}
+
+void VtParser::clear() {
+    param_count_ = 0;
+    intermediate_count_ = 0;
+    intermediates_[0] = 0;
+    overflow_ = false;
+}
+
+void VtParser::collect(uint8_t byte) {
+    if (intermediate_count_ + 1 >= int(sizeof(intermediates_))) {
+        overflow_ = true;
+        return;
+    }
+    intermediates_[intermediate_count_++] = char(byte);
+    intermediates_[intermediate_count_] = 0;
+}
+
+void VtParser::param(uint8_t byte) {
+    if (param_count_ == 0) params_[param_count_++] = -1;
+    if (byte == ';' || byte == ':') {
+        if (param_count_ < kMaxParams) params_[param_count_++] = -1;
+        return;
+    }
+    int32_t& value = params_[param_count_ - 1];
+    value = value < 0 ? byte - '0' : value * 10 + (byte - '0');
+    if (value > 65535) value = 65535;
+}
+
+void VtParser::dispatch_csi(uint8_t final) {
+    state_ = State::Ground;
+    if (!overflow_) handler_.csi(params_, param_count_, intermediates_, char(final));
+}
+
+void VtParser::decode_utf8(uint8_t byte) {
+    if (utf8_remaining_ > 0) {
+        if ((byte & 0xc0) == 0x80) {
+            codepoint_ = codepoint_ << 6 | (byte & 0x3f);
+            if (--utf8_remaining_ == 0) {
+                bool valid = codepoint_ <= 0x10ffff && (codepoint_ < 0xd800 || codepoint_ > 0xdfff);
+                handler_.print(valid ? codepoint_ : kReplacement);
+            }
+            return;
+        }
+        // Cut short: what came so far is one bad character, and this byte
+        // starts afresh.
+        utf8_remaining_ = 0;
+        handler_.print(kReplacement);
+        advance(byte);
+        return;
+    }
+    if (byte >= 0xc2 && byte <= 0xdf) {
+        codepoint_ = byte & 0x1f;
+        utf8_remaining_ = 1;
+    } else if (byte >= 0xe0 && byte <= 0xef) {
+        codepoint_ = byte & 0x0f;
+        utf8_remaining_ = 2;
+    } else if (byte >= 0xf0 && byte <= 0xf4) {
+        codepoint_ = byte & 0x07;
+        utf8_remaining_ = 3;
+    } else {
+        handler_.print(kReplacement);
+    }
+}
+
+void VtParser::advance(uint8_t byte) {
+    if (state_ == State::Ground && (byte >= 0x80 || utf8_remaining_ > 0)) {
+        decode_utf8(byte);
+        return;
+    }
+
+    // Transitions from anywhere.
+    if (byte == 0x18 || byte == 0x1a) { // CAN, SUB: abandon the sequence.
+        state_ = State::Ground;
+        return;
+    }
+    if (byte == 0x1b) {
+        // ESC \ (ST) ends a string; the backslash is then an ignored
+        // escape sequence.
+        if (state_ == State::OscString) handler_.osc(osc_);
+        state_ = State::Escape;
+        clear();
+        return;
+    }
+    if (state_ == State::OscString) {
+        if (byte == 0x07) { // BEL ends it too, as xterm allows.
+            handler_.osc(osc_);
+            state_ = State::Ground;
+        } else if (byte >= 0x20 && osc_.size() < kMaxOsc) {
+            osc_.push_back(char(byte));
+        }
+        return;
+    }
+    if (state_ == State::StringIgnore) return;
+    if (byte < 0x20) {
+        handler_.execute(byte);
+        return;
+    }
+    if (byte == 0x7f || byte >= 0x80) return;
+
+    switch (state_) {
+    case State::Ground:
+        // Only reached for single characters; feed() takes the runs.
+        handler_.print_ascii(reinterpret_cast<const char*>(&byte), 1);
+        break;
+    case State::Escape:
+        if (byte == '[') {
+            state_ = State::CsiEntry;
+        } else if (byte == ']') {
+            osc_.clear();
+            state_ = State::OscString;
+        } else if (byte == 'P' || byte == 'X' || byte == '^' || byte == '_') {
+            state_ = State::StringIgnore;
+        } else if (byte < 0x30) {
+            collect(byte);
+            state_ = State::EscapeIntermediate;
+        } else {
+            state_ = State::Ground;
+            handler_.esc(intermediates_, char(byte));
+        }
+        break;
+    case State::EscapeIntermediate:
+        if (byte < 0x30) {
+            collect(byte);
+        } else {
+            state_ = State::Ground;
+            if (!overflow_) handler_.esc(intermediates_, char(byte));
+        }
+        break;
+    case State::CsiEntry:
+        if (byte >= 0x3c && byte <= 0x3f) { // Private marker.
+            collect(byte);
+            state_ = State::CsiParam;
+            break;
+        }
+        state_ = State::CsiParam;
+        [[fallthrough]];
+    case State::CsiParam:
+        if ((byte >= '0' && byte <= '9') || byte == ';' || byte == ':') {
+            param(byte);
+        } else if (byte < 0x30) {
+            collect(byte);
+            state_ = State::CsiIntermediate;
+        } else if (is_final(byte)) {
+            dispatch_csi(byte);
+        } else {
+            state_ = State::CsiIgnore;
+        }
+        break;
+    case State::CsiIntermediate:
+        if (byte < 0x30) {
+            collect(byte);
+        } else if (is_final(byte)) {
+            dispatch_csi(byte);
+        } else {
+            state_ = State::CsiIgnore;
+        }
+        break;
+    case State::CsiIgnore:
+        if (is_final(byte)) state_ = State::Ground;
+        break;
+    case State::OscString:
+    case State::StringIgnore:
+        break;
+    }
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,79 @@
+#ifndef DESKTOP_VT_PARSER_HPP
+#define DESKTOP_VT_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Neurodeck {
+
+// Splits what a program writes to its terminal into text, control
+// characters and escape sequences, following the DEC VT500 state machine
+// (vt100.net/emu/dec_ansi_parser), with UTF-8 decoded in the ground state.
+//
+// Most of the stream is printable ASCII, so runs of it are found with a
+// tight loop and handed over whole. Sequences can be split anywhere across
+// feed() calls. DCS, SOS, PM and APC strings are skipped; OSC strings
+// (window titles and the like) are passed on, cut at kMaxOsc bytes.
+class VtParser {
+public:
+    static constexpr int kMaxParams = 16;
+    static constexpr size_t kMaxOsc = 512;
+
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+        // Printable ASCII, 0x20 to 0x7e; never empty.
+        virtual void print_ascii(const char* text, size_t length) = 0;
+        // Any other character; malformed UTF-8 comes as U+FFFD.
+        virtual void print(char32_t ch) = 0;
+        // C0 controls: BS, HT, LF, CR and so on.
+        virtual void execute(uint8_t control) = 0;
+        // A control sequence: ESC [ params intermediates final. Omitted
+        // parameters are -1; sub-parameters (':') count as parameters.
+        // `intermediates` starts with the private marker, if any ("?").
+        virtual void csi(const int32_t* params, int count, const char* intermediates, char final) = 0;
+        // ESC intermediates final.
+        virtual void esc(const char* intermediates, char final) = 0;
+        virtual void osc(const std::string& /*text*/) {}
+    };
+
+    explicit VtParser(Handler& handler) : handler_(handler) {}
+
+    void feed(const char* data, size_t length);
+
+private:
+    enum class State {
+        Ground,
+        Escape,
+        EscapeIntermediate,
+        CsiEntry,
+        CsiParam,
+        CsiIntermediate,
+        CsiIgnore,
+        OscString,
+        StringIgnore, // DCS, SOS, PM, APC: until ST.
+    };
+
+    void advance(uint8_t byte);
+    void decode_utf8(uint8_t byte);
+    void clear();
+    void collect(uint8_t byte);
+    void param(uint8_t byte);
+    void dispatch_csi(uint8_t final);
+
+    Handler& handler_;
+    State state_ = State::Ground;
+    int32_t params_[kMaxParams];
+    int param_count_ = 0;
+    char intermediates_[4] = {};
+    int intermediate_count_ = 0;
+    bool overflow_ = false; // Too many intermediates: the sequence is dropped.
+    std::string osc_;
+    char32_t codepoint_ = 0; // UTF-8 sequence in progress...
+    int utf8_remaining_ = 0; // ...and its continuation bytes still to come.
+};
+
+} // namespace Neurodeck
+
+#endif // DESKTOP_VT_PARSER_HPP
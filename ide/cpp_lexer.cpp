@@ -0,0 +1,280 @@
+#include "cpp_lexer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_set>
+
+namespace Neurodeck {
+
+namespace {
+
+const size_t npos = static_cast<size_t>(-1);
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool is_ident_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool is_ident(char c) {
+    return is_ident_start(c) || is_digit(c);
+}
+
+TokenKind classify(std::string_view word, bool& highlighted) {
+    static const std::unordered_set<std::string_view> keywords = {
+        "alignas", "alignof", "asm", "auto", "break", "case", "catch", "class", "co_await", "co_return",
+        "co_yield", "concept", "const", "consteval", "constexpr", "constinit", "const_cast", "continue",
+        "decltype", "default", "delete", "do", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+        "false", "final", "for", "friend", "goto", "if", "inline", "mutable", "namespace", "new", "noexcept",
+        "nullptr", "operator", "override", "private", "protected", "public", "register", "reinterpret_cast",
+        "requires", "return", "sizeof", "static", "static_assert", "static_cast", "struct", "switch",
+        "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+        "using", "virtual", "volatile", "while",
+    };
+    static const std::unordered_set<std::string_view> types = {
+        "bool", "char", "char8_t", "char16_t", "char32_t", "double", "float", "int", "int8_t", "int16_t",
+        "int32_t", "int64_t", "long", "short", "signed", "size_t", "ssize_t", "uint8_t", "uint16_t",
+        "uint32_t", "uint64_t", "unsigned", "void", "wchar_t",
+    };
+    highlighted = true;
+    if (keywords.count(word)) {
+        return TokenKind::Keyword;
+    }
+    if (types.count(word)) {
+        return TokenKind::Type;
+    }
+    highlighted = false;
+    return TokenKind::Keyword;
+}
+
+bool is_literal_prefix(std::string_view word) {
+    return word == "L" || word == "u" || word == "U" || word == "u8";
+}
+
+bool is_raw_prefix(std::string_view word) {
+    return word == "R" || (word.size() >= 2 && word.back() == 'R' && is_literal_prefix(word.substr(0, word.size() - 1)));
+}
+
+void add(std::vector<TokenSpan>& spans, size_t begin, size_t end, TokenKind kind) {
+    if (end > begin) {
+        spans.push_back(TokenSpan{static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), kind});
+    }
+}
+
+size_t find(const char* text, size_t length, size_t from, const char* needle, size_t needle_length) {
+    for (size_t pos = from; pos + needle_length <= length; ++pos) {
+        if (std::memcmp(text + pos, needle, needle_length) == 0) {
+            return pos;
+        }
+    }
+    return npos;
+}
+
+// Scans a quoted literal whose opening quote is just before `pos`. Returns
+// the position after the closing quote, or `length` if the line ends first;
+// `continued` is set when it ends in a backslash-newline.
+size_t scan_quoted(const char* text, size_t length, size_t pos, char quote, bool& continued) {
+    continued = false;
+    while (pos < length) {
+        if (text[pos] == '\\') {
+            if (pos + 1 == length) {
+                continued = true;
+                return length;
+            }
+            pos += 2;
+            continue;
+        }
+        if (text[pos] == quote) {
+            return pos + 1;
+        }
+        ++pos;
+    }
+    return length;
+}
+
+// Returns the position after the raw string's closing )delimiter", or npos.
+size_t find_raw_end(const char* text, size_t length, size_t from, const LexState& state) {
+    char closing[LexState::kMaxDelimiter + 2];
+    closing[0] = ')';
+    std::memcpy(closing + 1, state.delimiter, state.delimiter_length);
+    closing[state.delimiter_length + 1] = '"';
+    size_t found = find(text, length, from, closing, state.delimiter_length + 2u);
+    return found == npos ? npos : found + state.delimiter_length + 2u;
+}
+
+bool ends_with_backslash(const char* text, size_t length) {
+    return length > 0 && text[length - 1] == '\\';
+}
+
+} // namespace
+
+bool LexState::operator==(const LexState& other) const {
+    return kind == other.kind && delimiter_length == other.delimiter_length &&
+           std::memcmp(delimiter, other.delimiter, delimiter_length) == 0;
+}
+
+LexState lex_cpp_line(const char* text, size_t length, LexState state, std::vector<TokenSpan>& spans) {
+    size_t pos = 0;
+    bool continued = false;
+    bool directive = false;
+
+    // Finish whatever the previous line left open.
+    switch (state.kind) {
+    case LexState::BlockComment: {
+        size_t end = find(text, length, 0, "*/", 2);
+        if (end == npos) {
+            add(spans, 0, length, TokenKind::Comment);
+            return state;
+        }
+        add(spans, 0, end + 2, TokenKind::Comment);
+        pos = end + 2;
+        break;
+    }
+    case LexState::LineComment:
+        add(spans, 0, length, TokenKind::Comment);
+        return ends_with_backslash(text, length) ? state : LexState();
+    case LexState::String:
+        pos = scan_quoted(text, length, 0, '"', continued);
+        add(spans, 0, pos, TokenKind::String);
+        if (continued) {
+            return state;
+        }
+        break;
+    case LexState::RawString: {
+        size_t end = find_raw_end(text, length, 0, state);
+        if (end == npos) {
+            add(spans, 0, length, TokenKind::String);
+            return state;
+        }
+        add(spans, 0, end, TokenKind::String);
+        pos = end;
+        break;
+    }
+    case LexState::Preprocessor:
+        directive = true;
+        break;
+    case LexState::Normal:
+        while (pos < length && is_space(text[pos])) ++pos;
+        directive = pos < length && text[pos] == '#';
+        break;
+    }
+    state = LexState();
+
+    if (directive) {
+        // A directive is one span up to any comment on the line.
+        size_t begin = pos;
+        size_t line_comment = find(text, length, pos, "//", 2);
+        size_t block_comment = find(text, length, pos, "/*", 2);
+        size_t end = std::min(std::min(line_comment, block_comment), length);
+        add(spans, begin, end, TokenKind::Preprocessor);
+        if (end == length) {
+            if (ends_with_backslash(text, length)) {
+                state.kind = LexState::Preprocessor;
+            }
+            return state;
+        }
+        pos = end;
+    }
+
+    while (pos < length) {
+        char c = text[pos];
+        char next = pos + 1 < length ? text[pos + 1] : '\0';
+        if (c == '/' && next == '/') {
+            add(spans, pos, length, TokenKind::Comment);
+            if (ends_with_backslash(text, length)) {
+                state.kind = LexState::LineComment;
+            }
+            return state;
+        }
+        if (c == '/' && next == '*') {
+            size_t end = find(text, length, pos + 2, "*/", 2);
+            if (end == npos) {
+                add(spans, pos, length, TokenKind::Comment);
+                state.kind = LexState::BlockComment;
+                return state;
+            }
+            add(spans, pos, end + 2, TokenKind::Comment);
+            pos = end + 2;
+            continue;
+        }
+        if (is_digit(c) || (c == '.' && is_digit(next))) {
+            size_t begin = pos++;
+            while (pos < length) {
+                char d = text[pos];
+                char previous = text[pos - 1];
+                bool exponent_sign = (d == '+' || d == '-') &&
+                                     (previous == 'e' || previous == 'E' || previous == 'p' || previous == 'P');
+                if (!is_ident(d) && d != '.' && d != '\'' && !exponent_sign) {
+                    break;
+                }
+                ++pos;
+            }
+            add(spans, begin, pos, TokenKind::Number);
+            continue;
+        }
+        if (is_ident_start(c)) {
+            size_t begin = pos;
+            while (pos < length && is_ident(text[pos])) ++pos;
+            std::string_view word(text + begin, pos - begin);
+            char quote = pos < length ? text[pos] : '\0';
+            if (quote == '"' && is_raw_prefix(word)) {
+                // R"delimiter( ... )delimiter"
+                size_t open = pos + 1;
+                size_t paren = open;
+                while (paren < length && paren - open <= LexState::kMaxDelimiter && text[paren] != '(' &&
+                       !is_space(text[paren]) && text[paren] != ')' && text[paren] != '\\') {
+                    ++paren;
+                }
+                if (paren < length && text[paren] == '(' && paren - open <= LexState::kMaxDelimiter) {
+                    LexState raw;
+                    raw.kind = LexState::RawString;
+                    raw.delimiter_length = static_cast<uint8_t>(paren - open);
+                    std::memcpy(raw.delimiter, text + open, raw.delimiter_length);
+                    size_t end = find_raw_end(text, length, paren + 1, raw);
+                    if (end == npos) {
+                        add(spans, begin, length, TokenKind::String);
+                        return raw;
+                    }
+                    add(spans, begin, end, TokenKind::String);
+                    pos = end;
+                    continue;
+                }
+            }
+            if ((quote == '"' || quote == '\'') && (is_literal_prefix(word) || is_raw_prefix(word))) {
+                pos = scan_quoted(text, length, pos + 1, quote, continued);
+                add(spans, begin, pos, quote == '"' ? TokenKind::String : TokenKind::Char);
+                if (continued && quote == '"') {
+                    state.kind = LexState::String;
+                    return state;
+                }
+                continue;
+            }
+            bool highlighted;
+            TokenKind kind = classify(word, highlighted);
+            if (highlighted) {
+                add(spans, begin, pos, kind);
+            }
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            size_t begin = pos;
+            pos = scan_quoted(text, length, pos + 1, c, continued);
+            add(spans, begin, pos, c == '"' ? TokenKind::String : TokenKind::Char);
+            if (continued && c == '"') {
+                state.kind = LexState::String;
+                return state;
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return state;
+}
+
+} // namespace Neurodeck
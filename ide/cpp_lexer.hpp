@@ -0,0 +1,56 @@
+#ifndef IDE_CPP_LEXER_HPP
+#define IDE_CPP_LEXER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+enum class TokenKind : uint8_t {
+    Keyword,
+    Type,
+    Number,
+    String,
+    Char,
+    Comment,
+    Preprocessor,
+};
+
+// A highlighted run within one line. Text not covered by a span (names,
+// operators, whitespace) is drawn plainly.
+struct TokenSpan {
+    uint32_t column;
+    uint32_t length;
+    TokenKind kind;
+};
+
+// What the lexer carries from the end of one line to the start of the next.
+// Two lines lexed from equal states produce equal spans, which is what lets
+// the highlighter stop re-lexing once states match again after an edit.
+struct LexState {
+    enum Kind : uint8_t {
+        Normal,
+        BlockComment,
+        LineComment,  // A // comment continued with a trailing backslash
+        String,       // A "..." literal continued with a trailing backslash
+        RawString,    // Inside R"delimiter( ... )delimiter"
+        Preprocessor, // A directive continued with a trailing backslash
+    };
+    static constexpr size_t kMaxDelimiter = 16; // The standard's limit for raw strings.
+
+    Kind kind = Normal;
+    uint8_t delimiter_length = 0;
+    char delimiter[kMaxDelimiter] = {};
+
+    bool operator==(const LexState& other) const;
+    bool operator!=(const LexState& other) const { return !(*this == other); }
+};
+
+// Lexes one line of C++ (without its newline) starting in `state`. Appends
+// its spans to `spans` and returns the state at the end of the line.
+LexState lex_cpp_line(const char* text, size_t length, LexState state, std::vector<TokenSpan>& spans);
+
+} // namespace Neurodeck
+
+#endif // IDE_CPP_LEXER_HPP
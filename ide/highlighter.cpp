@@ -0,0 +1,97 @@
+#include "highlighter.hpp"
+#include <algorithm>
+#include <string>
+
+namespace Neurodeck {
+
+namespace {
+
+const uint64_t kBatchLines = 256; // Lines fetched from the document per read.
+
+} // namespace
+
+Highlighter::Highlighter(const PieceTable& document) : document_(document) {
+    reset();
+}
+
+void Highlighter::reset() {
+    lines_.assign(document_.line_count(), Line());
+    valid_ = 0;
+    advance(viewport_last_);
+}
+
+void Highlighter::edit(uint64_t first_line, uint64_t removed_lines, uint64_t inserted_lines) {
+    if (first_line >= lines_.size() || removed_lines == 0 || inserted_lines == 0) {
+        reset();
+        return;
+    }
+    removed_lines = std::min<uint64_t>(removed_lines, lines_.size() - first_line);
+    // The edited line still starts in the same state: nothing before it
+    // changed.
+    LexState start = lines_[first_line].start;
+    auto at = lines_.begin() + static_cast<std::ptrdiff_t>(first_line);
+    if (inserted_lines > removed_lines) {
+        lines_.insert(at + static_cast<std::ptrdiff_t>(removed_lines), inserted_lines - removed_lines, Line());
+    } else if (inserted_lines < removed_lines) {
+        lines_.erase(at + static_cast<std::ptrdiff_t>(inserted_lines), at + static_cast<std::ptrdiff_t>(removed_lines));
+    }
+    for (uint64_t line = first_line; line < first_line + inserted_lines; ++line) {
+        lines_[line].lexed = false;
+        lines_[line].spans.clear();
+    }
+    lines_[first_line].start = start;
+    valid_ = std::min(valid_, first_line);
+    advance(viewport_last_);
+}
+
+void Highlighter::set_viewport(uint64_t first, uint64_t last) {
+    viewport_last_ = std::max(first, last);
+    advance(viewport_last_);
+}
+
+bool Highlighter::background_step(size_t max_lines) {
+    advance(valid_ + max_lines);
+    return valid_ < lines_.size();
+}
+
+const std::vector<TokenSpan>* Highlighter::spans(uint64_t line) const {
+    return line < valid_ ? &lines_[line].spans : nullptr;
+}
+
+void Highlighter::advance(uint64_t limit) {
+    limit = std::min<uint64_t>(limit, lines_.size());
+    std::string text;
+    while (valid_ < limit) {
+        uint64_t batch_end = std::min(limit, valid_ + kBatchLines);
+        uint64_t begin = document_.line_start(valid_);
+        text = document_.text(begin, document_.line_start(batch_end) - begin);
+        size_t pos = 0;
+        for (uint64_t line = valid_; line < batch_end; ++line) {
+            size_t newline = text.find('\n', pos);
+            size_t end = newline == std::string::npos ? text.size() : newline;
+            Line& current = lines_[line];
+            current.spans.clear();
+            LexState state = lex_cpp_line(text.data() + pos, end - pos, current.start, current.spans);
+            current.lexed = true;
+            ++lexed_;
+            pos = end + 1;
+            valid_ = line + 1;
+            if (valid_ == lines_.size()) {
+                break;
+            }
+            Line& next = lines_[valid_];
+            if (next.lexed && next.start == state) {
+                // Converged: the lines that follow were lexed from the same
+                // state as before and their text has not changed since.
+                while (valid_ < lines_.size() && lines_[valid_].lexed) {
+                    ++valid_;
+                }
+                break;
+            }
+            next.start = state;
+            next.lexed = false;
+        }
+    }
+}
+
+} // namespace Neurodeck
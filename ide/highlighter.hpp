@@ -0,0 +1,71 @@
+#ifndef IDE_HIGHLIGHTER_HPP
+#define IDE_HIGHLIGHTER_HPP
+
+#include "cpp_lexer.hpp"
+#include "piece_table.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Neurodeck {
+
+// Incremental syntax highlighting of a PieceTable holding C++.
+//
+// For every line the highlighter keeps the lexer state at its start and the
+// spans from its last lex. Lines [0, valid_lines()) are known to be current.
+// An edit moves that frontier back to the edited line and re-lexes from
+// there, but only through the viewport: re-lexing stops as soon as a line
+// ends in the same state that the next, unchanged line was previously lexed
+// from, because everything after it would come out the same. Lines past the
+// viewport that still need work are left to background_step(), which the
+// editor calls from its idle loop; the PieceTable is not thread-safe, so this
+// work is sliced rather than run on another thread.
+class Highlighter {
+public:
+    explicit Highlighter(const PieceTable& document);
+
+    // Starts over after the whole document changed (e.g. a file was opened).
+    void reset();
+
+    // Call after each edit: lines [first_line, first_line + removed_lines) of
+    // the old document became [first_line, first_line + inserted_lines) of
+    // the new one. Both counts include the edited line itself, so typing a
+    // character is (line, 1, 1) and splitting a line is (line, 1, 2).
+    void edit(uint64_t first_line, uint64_t removed_lines, uint64_t inserted_lines);
+
+    // Sets the visible lines [first, last) and highlights them now.
+    void set_viewport(uint64_t first, uint64_t last);
+
+    // Lexes up to `max_lines` lines past the frontier. Returns true while
+    // some of the document is still not highlighted.
+    bool background_step(size_t max_lines);
+
+    // Spans of `line`, or nullptr if it has not been highlighted since it
+    // last changed.
+    const std::vector<TokenSpan>* spans(uint64_t line) const;
+
+    uint64_t line_count() const { return lines_.size(); }
+    uint64_t valid_lines() const { return valid_; }
+    // Total lines lexed so far, for measuring how much work edits cause.
+    uint64_t lexed_lines() const { return lexed_; }
+
+private:
+    struct Line {
+        LexState start;
+        bool lexed = false; // `spans` match `start` and the line's text
+        std::vector<TokenSpan> spans;
+    };
+
+    // Highlights until the frontier reaches `limit` or the end.
+    void advance(uint64_t limit);
+
+    const PieceTable& document_;
+    std::vector<Line> lines_;
+    uint64_t valid_ = 0;
+    uint64_t viewport_last_ = 0;
+    uint64_t lexed_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // IDE_HIGHLIGHTER_HPP
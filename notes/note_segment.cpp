@@ -0,0 +1,241 @@
+#include "note_segment.hpp"
+#include <algorithm>
+#include <cstdio>     // For std::rename()
+#include <cstring>
+#include <fcntl.h>    // For open()
+#include <unistd.h>   // For write(), fsync(), close()
+
+namespace Neurodeck {
+
+namespace {
+
+// "NDSEG001": identifies the file and its on-disk format version.
+const char kSegmentMagic[8] = {'N', 'D', 'S', 'E', 'G', '0', '0', '1'};
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t doc_count;
+    uint32_t term_count;
+    uint64_t total_length;
+    uint64_t docs_offset;
+    uint64_t terms_offset;
+    uint64_t strings_offset;
+    uint64_t postings_offset;
+    uint64_t file_size;
+};
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader layout is part of the file format");
+
+void put_varint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool get_varint(const char*& p, const char* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+inline bool is_term_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+} // namespace
+
+void tokenize_note(const char* text, size_t size, std::vector<std::string>& terms) {
+    terms.clear();
+    size_t i = 0;
+    while (i < size) {
+        while (i < size && !is_term_byte(static_cast<unsigned char>(text[i]))) ++i;
+        size_t start = i;
+        while (i < size && is_term_byte(static_cast<unsigned char>(text[i]))) ++i;
+        if (i == start) {
+            break;
+        }
+        std::string term(text + start, std::min(i - start, kMaxTermLength));
+        for (char& c : term) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        terms.push_back(std::move(term));
+    }
+}
+
+bool PostingReader::next(uint32_t& ordinal, uint32_t& tf) {
+    uint32_t code;
+    if (p_ >= end_ || !get_varint(p_, end_, code)) {
+        return false;
+    }
+    tf = 1;
+    if (!(code & 1) && !get_varint(p_, end_, tf)) {
+        return false;
+    }
+    ordinal_ = first_ ? (code >> 1) : ordinal_ + (code >> 1);
+    first_ = false;
+    ordinal = ordinal_;
+    return true;
+}
+
+void SegmentBuilder::add_doc(uint32_t id, uint32_t length, uint64_t record_offset) {
+    docs_.push_back(SegmentDoc{id, length, record_offset});
+    total_length_ += length;
+}
+
+void SegmentBuilder::begin_term(std::string_view term) {
+    SegmentTerm entry;
+    entry.string_offset = static_cast<uint32_t>(strings_.size());
+    entry.string_length = static_cast<uint32_t>(term.size());
+    entry.doc_freq = 0;
+    entry.postings_length = 0;
+    entry.postings_offset = postings_.size();
+    terms_.push_back(entry);
+    strings_.append(term.data(), term.size());
+}
+
+void SegmentBuilder::add_posting(uint32_t ordinal, uint32_t tf) {
+    SegmentTerm& entry = terms_.back();
+    uint32_t delta = entry.doc_freq == 0 ? ordinal : ordinal - last_ordinal_;
+    put_varint(postings_, (delta << 1) | (tf == 1 ? 1u : 0u));
+    if (tf != 1) {
+        put_varint(postings_, tf);
+    }
+    last_ordinal_ = ordinal;
+    ++entry.doc_freq;
+}
+
+void SegmentBuilder::end_term() {
+    SegmentTerm& entry = terms_.back();
+    entry.postings_length = static_cast<uint32_t>(postings_.size() - entry.postings_offset);
+    if (entry.doc_freq == 0) {
+        strings_.resize(entry.string_offset);
+        terms_.pop_back();
+    }
+}
+
+bool SegmentBuilder::write(const std::string& path) const {
+    SegmentHeader header;
+    std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header.doc_count = static_cast<uint32_t>(docs_.size());
+    header.term_count = static_cast<uint32_t>(terms_.size());
+    header.total_length = total_length_;
+    header.docs_offset = sizeof(SegmentHeader);
+    header.terms_offset = header.docs_offset + docs_.size() * sizeof(SegmentDoc);
+    header.strings_offset = header.terms_offset + terms_.size() * sizeof(SegmentTerm);
+    header.postings_offset = align8(header.strings_offset + strings_.size());
+    header.file_size = header.postings_offset + postings_.size();
+
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    static const char kPadding[8] = {};
+    size_t padding = header.postings_offset - (header.strings_offset + strings_.size());
+    bool ok = write_all(fd, &header, sizeof(header)) &&
+              write_all(fd, docs_.data(), docs_.size() * sizeof(SegmentDoc)) &&
+              write_all(fd, terms_.data(), terms_.size() * sizeof(SegmentTerm)) &&
+              write_all(fd, strings_.data(), strings_.size()) &&
+              write_all(fd, kPadding, padding) &&
+              write_all(fd, postings_.data(), postings_.size()) &&
+              fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool NoteSegment::open(const std::string& path) {
+    if (!file_.open(path) || file_.size() < sizeof(SegmentHeader)) {
+        return false;
+    }
+    SegmentHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+        header.file_size != file_.size() ||
+        header.terms_offset != header.docs_offset + uint64_t(header.doc_count) * sizeof(SegmentDoc) ||
+        header.strings_offset != header.terms_offset + uint64_t(header.term_count) * sizeof(SegmentTerm) ||
+        header.docs_offset < sizeof(SegmentHeader) || header.docs_offset > header.strings_offset ||
+        header.postings_offset < header.strings_offset || header.postings_offset > header.file_size) {
+        file_.close();
+        return false;
+    }
+    const char* base = file_.data();
+    // Lookups trust the dictionary, so every entry is checked once here
+    // against the areas it points into.
+    const uint64_t strings_size = header.postings_offset - header.strings_offset;
+    const uint64_t postings_size = header.file_size - header.postings_offset;
+    for (uint32_t i = 0; i < header.term_count; ++i) {
+        SegmentTerm term;
+        std::memcpy(&term, base + header.terms_offset + uint64_t(i) * sizeof(SegmentTerm), sizeof(term));
+        if (uint64_t(term.string_offset) + term.string_length > strings_size ||
+            term.postings_offset > postings_size || term.postings_length > postings_size - term.postings_offset) {
+            file_.close();
+            return false;
+        }
+    }
+    path_ = path;
+    docs_ = reinterpret_cast<const SegmentDoc*>(base + header.docs_offset);
+    terms_ = reinterpret_cast<const SegmentTerm*>(base + header.terms_offset);
+    strings_ = base + header.strings_offset;
+    postings_ = base + header.postings_offset;
+    doc_count_ = header.doc_count;
+    term_count_ = header.term_count;
+    total_length_ = header.total_length;
+    return true;
+}
+
+std::string_view NoteSegment::term_text(uint32_t index) const {
+    return std::string_view(strings_ + terms_[index].string_offset, terms_[index].string_length);
+}
+
+uint32_t NoteSegment::lower_bound(std::string_view term) const {
+    uint32_t low = 0;
+    uint32_t high = term_count_;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (term_text(mid) < term) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+uint32_t NoteSegment::find(std::string_view term) const {
+    uint32_t index = lower_bound(term);
+    return index < term_count_ && term_text(index) == term ? index : term_count_;
+}
+
+PostingReader NoteSegment::postings(uint32_t index) const {
+    return PostingReader(postings_ + terms_[index].postings_offset, terms_[index].postings_length);
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,113 @@
+#ifndef NOTES_NOTE_SEGMENT_HPP
+#define NOTES_NOTE_SEGMENT_HPP
+
+#include "mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Neurodeck {
+
+// Splits note text into index terms: runs of ASCII letters and digits
+// (lower-cased) and non-ASCII bytes, so UTF-8 words stay whole. Terms longer
+// than kMaxTermLength are cut to that length.
+static const size_t kMaxTermLength = 64;
+void tokenize_note(const char* text, size_t size, std::vector<std::string>& terms);
+
+// One note version inside a segment. Postings refer to notes by their
+// ordinal in the segment's sorted doc table rather than by id.
+struct SegmentDoc {
+    uint32_t id;
+    uint32_t length;        // Number of terms, for length normalisation.
+    uint64_t record_offset; // Log record this version was indexed from.
+};
+static_assert(sizeof(SegmentDoc) == 16, "SegmentDoc layout is part of the file format");
+
+// Dictionary entry; the term bytes and its postings live in separate areas.
+struct SegmentTerm {
+    uint32_t string_offset;
+    uint32_t string_length;
+    uint32_t doc_freq;
+    uint32_t postings_length;
+    uint64_t postings_offset;
+};
+static_assert(sizeof(SegmentTerm) == 24, "SegmentTerm layout is part of the file format");
+
+// Decodes one posting list: (ordinal delta << 1 | tf == 1) as a varint,
+// followed by tf as a varint when it is not 1.
+class PostingReader {
+public:
+    PostingReader(const char* data, size_t size) : p_(data), end_(data + size) {}
+    bool next(uint32_t& ordinal, uint32_t& tf);
+
+private:
+    const char* p_;
+    const char* end_;
+    uint32_t ordinal_ = 0;
+    bool first_ = true;
+};
+
+// Builds an immutable segment in memory and writes it out in one go. Terms
+// must be added in byte order and each term's postings in ordinal order.
+class SegmentBuilder {
+public:
+    void add_doc(uint32_t id, uint32_t length, uint64_t record_offset);
+    void begin_term(std::string_view term);
+    void add_posting(uint32_t ordinal, uint32_t tf);
+    void end_term();
+
+    uint32_t doc_count() const { return static_cast<uint32_t>(docs_.size()); }
+
+    // Writes to a temporary file and renames it into place, so readers never
+    // see a partial segment.
+    bool write(const std::string& path) const;
+
+private:
+    std::vector<SegmentDoc> docs_;
+    std::vector<SegmentTerm> terms_;
+    std::string strings_;
+    std::string postings_;
+    uint64_t total_length_ = 0;
+    uint32_t last_ordinal_ = 0;
+};
+
+// Read-only view of a segment file through a shared mapping. Lookups binary
+// search the fixed-width dictionary in place; nothing is loaded up front.
+//
+// Layout: header, SegmentDoc[doc_count] in log order,
+// SegmentTerm[term_count] sorted by term, term bytes, postings.
+class NoteSegment {
+public:
+    bool open(const std::string& path);
+    const std::string& path() const { return path_; }
+
+    uint32_t doc_count() const { return doc_count_; }
+    uint64_t total_length() const { return total_length_; }
+    const SegmentDoc& doc(uint32_t ordinal) const { return docs_[ordinal]; }
+
+    uint32_t term_count() const { return term_count_; }
+    const SegmentTerm& term(uint32_t index) const { return terms_[index]; }
+    std::string_view term_text(uint32_t index) const;
+    // Index of the first term not less than `term` (term_count() if none).
+    uint32_t lower_bound(std::string_view term) const;
+    // Index of `term`, or term_count() if absent.
+    uint32_t find(std::string_view term) const;
+    PostingReader postings(uint32_t index) const;
+
+private:
+    std::string path_;
+    MappedFile file_;
+    const SegmentDoc* docs_ = nullptr;
+    const SegmentTerm* terms_ = nullptr;
+    const char* strings_ = nullptr;
+    const char* postings_ = nullptr;
+    uint32_t doc_count_ = 0;
+    uint32_t term_count_ = 0;
+    uint64_t total_length_ = 0;
+};
+
+} // namespace Neurodeck
+
+#endif // NOTES_NOTE_SEGMENT_HPP
@@ -0,0 +1,724 @@
+#include "note_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <fcntl.h>    // For open()
+#include <sys/file.h> // For flock()
+#include <sys/stat.h> // For mkdir(), fstat()
+#include <unistd.h>   // For write(), pread(), ftruncate(), fsync(), close()
+
+namespace Neurodeck {
+
+namespace {
+
+// "NDNOTE01": identifies the log and its on-disk format version.
+const char kLogMagic[8] = {'N', 'D', 'N', 'O', 'T', 'E', '0', '1'};
+const size_t kLogHeaderSize = sizeof(kLogMagic);
+const uint32_t kRecordMagic = 0x524e444e; // "NDNR" in little-endian byte order
+const uint32_t kRecordDeleted = 1;
+const uint64_t kNoRecord = UINT64_MAX;
+const char kManifestHeader[] = "NDNOTES 1";
+
+// A prefix query term expands to at most this many indexed terms.
+const size_t kMaxPrefixExpansion = 256;
+
+// BM25 parameters.
+const double kK1 = 1.2;
+const double kB = 0.75;
+
+// Fixed header in front of every log record, padded to 8 bytes like the
+// history log so headers stay aligned.
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;      // Header + text + padding
+    uint32_t id;
+    uint32_t flags;
+    int64_t timestamp;
+    uint32_t text_length;
+    uint32_t checksum;    // FNV-1a over the text
+};
+static_assert(sizeof(RecordHeader) == 32, "RecordHeader layout is part of the file format");
+
+uint32_t fnv1a(const char* data, size_t length, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int64_t now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Collects the query's distinct terms; `prefix` marks those typed with a
+// trailing '*'.
+void parse_query(const std::string& query, std::vector<std::string>& terms, std::vector<bool>& prefix) {
+    std::istringstream words(query);
+    std::string word;
+    std::vector<std::string> tokens;
+    while (words >> word) {
+        tokenize_note(word.data(), word.size(), tokens);
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            bool is_prefix = i + 1 == tokens.size() && word.back() == '*';
+            auto it = std::find(terms.begin(), terms.end(), tokens[i]);
+            if (it == terms.end()) {
+                terms.push_back(tokens[i]);
+                prefix.push_back(is_prefix);
+            } else if (!is_prefix) {
+                prefix[it - terms.begin()] = false;
+            }
+        }
+    }
+}
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Min-heap on score so the weakest of the best `limit` hits is on top; ties
+// prefer newer notes.
+bool better_hit(const NoteStore::Hit& a, const NoteStore::Hit& b) {
+    return a.score != b.score ? a.score > b.score : a.id > b.id;
+}
+
+void offer_hit(std::vector<NoteStore::Hit>& heap, size_t limit, NoteStore::Hit hit) {
+    if (heap.size() < limit) {
+        heap.push_back(hit);
+        std::push_heap(heap.begin(), heap.end(), better_hit);
+    } else if (better_hit(hit, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), better_hit);
+        heap.back() = hit;
+        std::push_heap(heap.begin(), heap.end(), better_hit);
+    }
+}
+
+} // namespace
+
+NoteStore::NoteStore() : NoteStore(Options()) {}
+
+NoteStore::NoteStore(const Options& options) : options_(options) {
+    if (options_.flush_threshold == 0) options_.flush_threshold = 1;
+    if (options_.merge_factor < 2) options_.merge_factor = 2;
+}
+
+NoteStore::~NoteStore() {
+    close();
+}
+
+bool NoteStore::open(const std::string& directory) {
+    close();
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        return false;
+    }
+    directory_ = directory;
+    std::string log_path = directory + "/notes.log";
+    log_fd_ = ::open(log_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (log_fd_ < 0) {
+        return false;
+    }
+    // One process owns the index at a time; a second shell session gets a
+    // clean failure instead of racing on segment files.
+    struct stat st;
+    if (flock(log_fd_, LOCK_EX | LOCK_NB) != 0 || fstat(log_fd_, &st) != 0) {
+        close();
+        return false;
+    }
+    if (st.st_size == 0 &&
+        ::write(log_fd_, kLogMagic, kLogHeaderSize) != static_cast<ssize_t>(kLogHeaderSize)) {
+        close();
+        return false;
+    }
+    char magic[kLogHeaderSize];
+    if (pread(log_fd_, magic, kLogHeaderSize, 0) != static_cast<ssize_t>(kLogHeaderSize) ||
+        std::memcmp(magic, kLogMagic, kLogHeaderSize) != 0) {
+        close();
+        return false;
+    }
+
+    uint64_t indexed_through = kLogHeaderSize;
+    if (!load_manifest(indexed_through)) {
+        // Missing or damaged segments: rebuild the whole index from the log.
+        segments_.clear();
+        indexed_through = kLogHeaderSize;
+    }
+    if (!scan_log(indexed_through)) {
+        close();
+        return false;
+    }
+    indexed_through_ = indexed_through;
+
+    stopping_ = false;
+    if (options_.background_merge) {
+        merge_thread_ = std::thread(&NoteStore::merge_worker, this);
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    schedule_merges_locked(lock);
+    return true;
+}
+
+void NoteStore::close() {
+    if (log_fd_ < 0) {
+        return;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        flush_locked(lock);
+        stopping_ = true;
+    }
+    merge_cv_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+    segments_.clear();
+    memory_ = MemorySegment();
+    current_.clear();
+    live_count_ = 0;
+    merge_requested_ = false;
+    merge_running_ = false;
+    ::close(log_fd_);
+    log_fd_ = -1;
+    log_size_ = 0;
+    log_torn_ = false;
+    indexed_through_ = 0;
+    next_segment_ = 1;
+}
+
+bool NoteStore::load_manifest(uint64_t& indexed_through) {
+    std::ifstream in(directory_ + "/MANIFEST");
+    if (!in) {
+        return true; // Fresh store.
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != kManifestHeader) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key, value;
+        fields >> key >> value;
+        if (key == "next") {
+            next_segment_ = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else if (key == "indexed") {
+            indexed_through = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "segment") {
+            auto segment = std::make_shared<Segment>();
+            if (!segment->data.open(directory_ + "/" + value)) {
+                return false;
+            }
+            segments_.push_back(std::move(segment));
+        }
+    }
+    return true;
+}
+
+bool NoteStore::write_manifest_locked() const {
+    std::string text = std::string(kManifestHeader) + "\n";
+    text += "next " + std::to_string(next_segment_) + "\n";
+    text += "indexed " + std::to_string(indexed_through_) + "\n";
+    for (const auto& segment : segments_) {
+        const std::string& path = segment->data.path();
+        text += "segment " + path.substr(path.rfind('/') + 1) + "\n";
+    }
+    std::string path = directory_ + "/MANIFEST";
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    // Synced before the rename, as segments are, so a crash cannot leave an
+    // empty MANIFEST in place of the old one.
+    bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size()) && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string NoteStore::next_segment_path() {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/seg-%08x.ndx", next_segment_++);
+    return directory_ + name;
+}
+
+bool NoteStore::scan_log(uint64_t indexed_through) {
+    MappedFile log;
+    if (!log.open(directory_ + "/notes.log")) {
+        return false;
+    }
+    current_.assign(1, kNoRecord); // Ids start at 1.
+    live_count_ = 0;
+    const char* data = log.data();
+    uint64_t size = log.size();
+    uint64_t offset = kLogHeaderSize;
+    uint64_t valid_end = offset;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        bool framed = header.magic == kRecordMagic && header.length >= sizeof(RecordHeader) &&
+                      header.length % 8 == 0 && offset + header.length <= size &&
+                      sizeof(RecordHeader) + uint64_t(header.text_length) <= header.length;
+        const char* text = data + offset + sizeof(RecordHeader);
+        if (!framed || fnv1a(text, header.text_length) != header.checksum || header.id == 0 ||
+            header.id > current_.size()) {
+            // A torn write left garbage behind; resynchronise on the next
+            // aligned record header.
+            offset += 8;
+            continue;
+        }
+        if (header.id == current_.size()) {
+            current_.push_back(kNoRecord);
+        }
+        bool was_live = current_[header.id] != kNoRecord;
+        if (header.flags & kRecordDeleted) {
+            current_[header.id] = kNoRecord;
+            live_count_ -= was_live ? 1 : 0;
+        } else {
+            current_[header.id] = offset;
+            live_count_ += was_live ? 0 : 1;
+            if (offset >= indexed_through) {
+                index_note(header.id, offset, text, header.text_length);
+            }
+        }
+        offset += header.length;
+        valid_end = offset;
+    }
+    // Drop a torn tail so that new records start on an aligned boundary.
+    if (valid_end < size && ftruncate(log_fd_, static_cast<off_t>(valid_end)) != 0) {
+        return false;
+    }
+    log_size_ = valid_end;
+    return true;
+}
+
+void NoteStore::index_note(uint32_t id, uint64_t offset, const char* text, size_t size) {
+    std::vector<std::string> terms;
+    tokenize_note(text, size, terms);
+    uint32_t ordinal = static_cast<uint32_t>(memory_.docs.size());
+    memory_.docs.push_back(SegmentDoc{id, static_cast<uint32_t>(terms.size()), offset});
+    memory_.total_length += terms.size();
+    std::sort(terms.begin(), terms.end());
+    for (size_t i = 0; i < terms.size();) {
+        size_t j = i + 1;
+        while (j < terms.size() && terms[j] == terms[i]) ++j;
+        memory_.terms[terms[i]].emplace_back(ordinal, static_cast<uint32_t>(j - i));
+        i = j;
+    }
+}
+
+bool NoteStore::append_record(uint32_t id, uint32_t flags, const std::string& text, uint64_t& offset) {
+    size_t length = (sizeof(RecordHeader) + text.size() + 7) & ~static_cast<size_t>(7);
+    if (log_fd_ < 0 || log_torn_ || length > UINT32_MAX) {
+        return false;
+    }
+    RecordHeader header;
+    header.magic = kRecordMagic;
+    header.length = static_cast<uint32_t>(length);
+    header.id = id;
+    header.flags = flags;
+    header.timestamp = now_seconds();
+    header.text_length = static_cast<uint32_t>(text.size());
+    header.checksum = fnv1a(text.data(), text.size());
+
+    std::string record(length, '\0');
+    std::memcpy(&record[0], &header, sizeof(header));
+    std::memcpy(&record[sizeof(header)], text.data(), text.size());
+    size_t written = 0;
+    while (written < record.size()) {
+        ssize_t n = ::write(log_fd_, record.data() + written, record.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Cut off whatever part of the record made it, so the next
+            // append starts on a record boundary. If even that fails, stop
+            // appending: the partial record stays the log's torn tail, which
+            // the next open() trims.
+            if (ftruncate(log_fd_, static_cast<off_t>(log_size_)) != 0) {
+                log_torn_ = true;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    offset = log_size_;
+    log_size_ += length;
+    return true;
+}
+
+bool NoteStore::read_record(uint64_t offset, Note& out) const {
+    RecordHeader header;
+    if (pread(log_fd_, &header, sizeof(header), static_cast<off_t>(offset)) != sizeof(header) ||
+        header.magic != kRecordMagic) {
+        return false;
+    }
+    out.id = header.id;
+    out.timestamp = header.timestamp;
+    out.text.resize(header.text_length);
+    return header.text_length == 0 ||
+           pread(log_fd_, &out.text[0], header.text_length,
+                 static_cast<off_t>(offset + sizeof(header))) == static_cast<ssize_t>(header.text_length);
+}
+
+uint32_t NoteStore::add(const std::string& text) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    uint32_t id = static_cast<uint32_t>(current_.size());
+    uint64_t offset;
+    if (!append_record(id, 0, text, offset)) {
+        return 0;
+    }
+    current_.push_back(offset);
+    ++live_count_;
+    index_note(id, offset, text.data(), text.size());
+    if (memory_.docs.size() >= options_.flush_threshold) {
+        flush_locked(lock);
+    }
+    return id;
+}
+
+bool NoteStore::update(uint32_t id, const std::string& text) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    uint64_t offset;
+    if (id == 0 || id >= current_.size() || current_[id] == kNoRecord ||
+        !append_record(id, 0, text, offset)) {
+        return false;
+    }
+    current_[id] = offset;
+    index_note(id, offset, text.data(), text.size());
+    if (memory_.docs.size() >= options_.flush_threshold) {
+        flush_locked(lock);
+    }
+    return true;
+}
+
+bool NoteStore::remove(uint32_t id) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    uint64_t offset;
+    if (id == 0 || id >= current_.size() || current_[id] == kNoRecord ||
+        !append_record(id, kRecordDeleted, std::string(), offset)) {
+        return false;
+    }
+    current_[id] = kNoRecord;
+    --live_count_;
+    return true;
+}
+
+bool NoteStore::get(uint32_t id, Note& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id != 0 && id < current_.size() && current_[id] != kNoRecord &&
+           read_record(current_[id], out);
+}
+
+size_t NoteStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return live_count_;
+}
+
+size_t NoteStore::segment_count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return segments_.size();
+}
+
+bool NoteStore::flush() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return flush_locked(lock);
+}
+
+bool NoteStore::flush_locked(std::unique_lock<std::shared_mutex>& lock) {
+    if (memory_.docs.empty()) {
+        return true;
+    }
+    SegmentBuilder builder;
+    for (const SegmentDoc& doc : memory_.docs) {
+        builder.add_doc(doc.id, doc.length, doc.record_offset);
+    }
+    for (const auto& term : memory_.terms) {
+        builder.begin_term(term.first);
+        for (const auto& posting : term.second) {
+            builder.add_posting(posting.first, posting.second);
+        }
+        builder.end_term();
+    }
+    auto segment = std::make_shared<Segment>();
+    std::string path = next_segment_path();
+    if (!builder.write(path) || !segment->data.open(path)) {
+        return false;
+    }
+    segments_.push_back(std::move(segment));
+    memory_ = MemorySegment();
+    indexed_through_ = log_size_;
+    bool ok = write_manifest_locked();
+    schedule_merges_locked(lock);
+    return ok;
+}
+
+void NoteStore::schedule_merges_locked(std::unique_lock<std::shared_mutex>& lock) {
+    if (options_.background_merge) {
+        merge_requested_ = true;
+        merge_cv_.notify_all();
+        return;
+    }
+    // A failed merge leaves its run in place; the next flush retries it.
+    size_t first, count;
+    while (pick_merge_locked(first, count) && merge(first, count, lock)) {
+    }
+}
+
+// Segments are bucketed into levels by size: level 0 holds up to
+// flush_threshold notes and each level above holds merge_factor times more.
+// Any run of merge_factor adjacent segments on one level becomes a single
+// segment on the next, so every note is rewritten O(log n) times in total.
+bool NoteStore::pick_merge_locked(size_t& first, size_t& count) {
+    auto level = [this](uint32_t docs) {
+        int result = 0;
+        for (uint64_t cap = options_.flush_threshold; docs > cap; cap *= options_.merge_factor) {
+            ++result;
+        }
+        return result;
+    };
+    count = options_.merge_factor;
+    for (first = 0; first + count <= segments_.size(); ++first) {
+        int run_level = level(segments_[first]->data.doc_count());
+        bool ok = true;
+        for (size_t i = first; i < first + count && ok; ++i) {
+            ok = !segments_[i]->merging && level(segments_[i]->data.doc_count()) == run_level;
+        }
+        if (ok) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NoteStore::merge(size_t first, size_t count, std::unique_lock<std::shared_mutex>& lock) {
+    std::vector<std::shared_ptr<Segment>> inputs(segments_.begin() + first,
+                                                 segments_.begin() + first + count);
+    // Renumber the versions that are still current; stale ones are dropped.
+    const uint32_t kDropped = UINT32_MAX;
+    SegmentBuilder builder;
+    std::vector<std::vector<uint32_t>> remap(inputs.size());
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        inputs[k]->merging = true;
+        const NoteSegment& segment = inputs[k]->data;
+        remap[k].resize(segment.doc_count(), kDropped);
+        for (uint32_t ordinal = 0; ordinal < segment.doc_count(); ++ordinal) {
+            const SegmentDoc& doc = segment.doc(ordinal);
+            if (is_current(doc)) {
+                remap[k][ordinal] = builder.doc_count();
+                builder.add_doc(doc.id, doc.length, doc.record_offset);
+            }
+        }
+    }
+    std::string path = next_segment_path();
+    lock.unlock();
+
+    // K-way merge of the sorted dictionaries. Inputs are in log order, so
+    // renumbered ordinals stay ascending within each merged posting list.
+    std::vector<uint32_t> cursor(inputs.size(), 0);
+    while (true) {
+        std::string_view smallest;
+        bool any = false;
+        for (size_t k = 0; k < inputs.size(); ++k) {
+            const NoteSegment& segment = inputs[k]->data;
+            if (cursor[k] < segment.term_count() &&
+                (!any || segment.term_text(cursor[k]) < smallest)) {
+                smallest = segment.term_text(cursor[k]);
+                any = true;
+            }
+        }
+        if (!any) {
+            break;
+        }
+        builder.begin_term(smallest);
+        for (size_t k = 0; k < inputs.size(); ++k) {
+            const NoteSegment& segment = inputs[k]->data;
+            if (cursor[k] >= segment.term_count() || segment.term_text(cursor[k]) != smallest) {
+                continue;
+            }
+            PostingReader reader = segment.postings(cursor[k]);
+            uint32_t ordinal, tf;
+            while (reader.next(ordinal, tf)) {
+                if (ordinal < remap[k].size() && remap[k][ordinal] != kDropped) {
+                    builder.add_posting(remap[k][ordinal], tf);
+                }
+            }
+        }
+        builder.end_term();
+        for (size_t k = 0; k < inputs.size(); ++k) {
+            const NoteSegment& segment = inputs[k]->data;
+            if (cursor[k] < segment.term_count() && segment.term_text(cursor[k]) == smallest) {
+                ++cursor[k];
+            }
+        }
+    }
+
+    auto merged = std::make_shared<Segment>();
+    bool written = builder.write(path) && merged->data.open(path);
+    lock.lock();
+    // Flushes only append, so the inputs are still adjacent.
+    auto it = std::find(segments_.begin(), segments_.end(), inputs[0]);
+    if (!written || it == segments_.end()) {
+        for (auto& input : inputs) input->merging = false;
+        std::remove(path.c_str());
+        return false;
+    }
+    it = segments_.erase(it, it + count);
+    segments_.insert(it, std::move(merged));
+    write_manifest_locked();
+    // Mappings stay valid after unlink until the last reference goes away.
+    for (auto& input : inputs) {
+        std::remove(input->data.path().c_str());
+    }
+    return true;
+}
+
+void NoteStore::merge_worker() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    while (!stopping_) {
+        if (!merge_requested_) {
+            merge_cv_.wait(lock);
+            continue;
+        }
+        merge_requested_ = false;
+        merge_running_ = true;
+        size_t first, count;
+        while (!stopping_ && pick_merge_locked(first, count) && merge(first, count, lock)) {
+        }
+        merge_running_ = false;
+        merge_cv_.notify_all();
+    }
+}
+
+void NoteStore::wait_for_merges() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    merge_cv_.wait(lock, [this] {
+        return !options_.background_merge || stopping_ || (!merge_requested_ && !merge_running_);
+    });
+}
+
+std::vector<NoteStore::Hit> NoteStore::search(const std::string& query, size_t limit) const {
+    std::vector<std::string> query_terms;
+    std::vector<bool> prefix;
+    parse_query(query, query_terms, prefix);
+    std::vector<Hit> heap;
+    if (limit == 0 || query_terms.empty()) {
+        return heap;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // Expand prefixes into the indexed terms they cover.
+    std::set<std::string, std::less<>> terms;
+    for (size_t i = 0; i < query_terms.size(); ++i) {
+        if (!prefix[i]) {
+            terms.insert(query_terms[i]);
+            continue;
+        }
+        size_t expanded = 0;
+        for (const auto& segment : segments_) {
+            const NoteSegment& data = segment->data;
+            for (uint32_t t = data.lower_bound(query_terms[i]);
+                 t < data.term_count() && starts_with(data.term_text(t), query_terms[i]) &&
+                 expanded < kMaxPrefixExpansion; ++t, ++expanded) {
+                terms.emplace(data.term_text(t));
+            }
+        }
+        for (auto it = memory_.terms.lower_bound(query_terms[i]);
+             it != memory_.terms.end() && starts_with(it->first, query_terms[i]) &&
+             expanded < kMaxPrefixExpansion; ++it, ++expanded) {
+            terms.insert(it->first);
+        }
+    }
+
+    // Collection statistics include superseded versions still sitting in
+    // segments; merges keep the difference small.
+    double documents = static_cast<double>(memory_.docs.size());
+    double total_length = static_cast<double>(memory_.total_length);
+    for (const auto& segment : segments_) {
+        documents += segment->data.doc_count();
+        total_length += static_cast<double>(segment->data.total_length());
+    }
+    if (documents == 0) {
+        return heap;
+    }
+    double average_length = std::max(1.0, total_length / documents);
+
+    std::vector<std::pair<std::string, double>> weighted;
+    for (const std::string& term : terms) {
+        uint64_t doc_freq = 0;
+        for (const auto& segment : segments_) {
+            uint32_t index = segment->data.find(term);
+            if (index < segment->data.term_count()) doc_freq += segment->data.term(index).doc_freq;
+        }
+        auto it = memory_.terms.find(term);
+        if (it != memory_.terms.end()) doc_freq += it->second.size();
+        if (doc_freq > 0) {
+            double idf = std::log(1.0 + (documents - doc_freq + 0.5) / (doc_freq + 0.5));
+            weighted.emplace_back(term, idf);
+        }
+    }
+
+    auto term_score = [&](double idf, uint32_t tf, uint32_t length) {
+        double norm = kK1 * (1.0 - kB + kB * length / average_length);
+        return idf * tf * (kK1 + 1.0) / (tf + norm);
+    };
+
+    // Score one segment at a time into a dense accumulator indexed by
+    // ordinal, then keep only the best `limit` current notes.
+    std::vector<float> scores;
+    for (const auto& segment : segments_) {
+        const NoteSegment& data = segment->data;
+        bool touched = false;
+        for (const auto& term : weighted) {
+            uint32_t index = data.find(term.first);
+            if (index >= data.term_count()) continue;
+            if (!touched) {
+                scores.assign(data.doc_count(), 0.0f);
+                touched = true;
+            }
+            PostingReader reader = data.postings(index);
+            uint32_t ordinal, tf;
+            while (reader.next(ordinal, tf)) {
+                if (ordinal < scores.size()) {
+                    scores[ordinal] += static_cast<float>(term_score(term.second, tf, data.doc(ordinal).length));
+                }
+            }
+        }
+        for (uint32_t ordinal = 0; touched && ordinal < scores.size(); ++ordinal) {
+            if (scores[ordinal] > 0.0f && is_current(data.doc(ordinal))) {
+                offer_hit(heap, limit, Hit{data.doc(ordinal).id, scores[ordinal]});
+            }
+        }
+    }
+    if (!memory_.docs.empty()) {
+        scores.assign(memory_.docs.size(), 0.0f);
+        for (const auto& term : weighted) {
+            auto it = memory_.terms.find(term.first);
+            if (it == memory_.terms.end()) continue;
+            for (const auto& posting : it->second) {
+                scores[posting.first] += static_cast<float>(
+                    term_score(term.second, posting.second, memory_.docs[posting.first].length));
+            }
+        }
+        for (uint32_t ordinal = 0; ordinal < scores.size(); ++ordinal) {
+            if (scores[ordinal] > 0.0f && is_current(memory_.docs[ordinal])) {
+                offer_hit(heap, limit, Hit{memory_.docs[ordinal].id, scores[ordinal]});
+            }
+        }
+    }
+
+    std::sort(heap.begin(), heap.end(), better_hit);
+    return heap;
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,137 @@
+#ifndef NOTES_NOTE_STORE_HPP
+#define NOTES_NOTE_STORE_HPP
+
+#include "note_segment.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Neurodeck {
+
+// Note storage with an incrementally maintained full-text index.
+//
+// Notes live in an append-only log (notes.log); adding, editing or deleting a
+// note appends one record. New notes are indexed into an in-memory segment
+// that is written out as a small immutable segment file once it holds
+// flush_threshold notes, so an add never rewrites existing index data. A
+// background thread merges runs of merge_factor similar-sized segments into
+// one, keeping the segment count logarithmic in the number of notes. The
+// MANIFEST names the live segments and how much of the log they cover; on
+// open, anything past that point is re-indexed from the log.
+//
+// Segments are never modified, so edits and deletes are resolved at query
+// time: an indexed note version counts only while it is still the note's
+// current log record. Merges drop versions that are no longer current.
+class NoteStore {
+public:
+    struct Options {
+        uint32_t flush_threshold = 4096; // Notes per freshly written segment.
+        uint32_t merge_factor = 8;       // Segments merged together per level.
+        bool background_merge = true;    // Merge on a worker thread (else inline).
+    };
+
+    struct Note {
+        uint32_t id = 0;
+        int64_t timestamp = 0; // Seconds since the Unix epoch of the last change.
+        std::string text;
+    };
+
+    struct Hit {
+        uint32_t id;
+        double score;
+    };
+
+    NoteStore();
+    explicit NoteStore(const Options& options);
+    ~NoteStore();
+
+    NoteStore(const NoteStore&) = delete;
+    NoteStore& operator=(const NoteStore&) = delete;
+
+    // Opens (creating if needed) the store in `directory`. Returns false if
+    // it cannot be created, is not a note store, or is open in another
+    // process.
+    bool open(const std::string& directory);
+    // Flushes the in-memory segment and waits for running merges.
+    void close();
+    bool is_open() const { return log_fd_ >= 0; }
+
+    // Returns the new note's id, or 0 on failure.
+    uint32_t add(const std::string& text);
+    bool update(uint32_t id, const std::string& text);
+    bool remove(uint32_t id);
+    bool get(uint32_t id, Note& out) const;
+    size_t size() const;
+
+    // BM25-ranked notes matching any query term, best first. A term ending
+    // in '*' matches every indexed term with that prefix.
+    std::vector<Hit> search(const std::string& query, size_t limit) const;
+
+    // Writes the in-memory segment to disk now.
+    bool flush();
+    // Blocks until no merge is pending or running.
+    void wait_for_merges();
+    size_t segment_count() const;
+
+private:
+    struct Segment {
+        NoteSegment data;
+        bool merging = false;
+    };
+    // Postings of notes not yet written to a segment file.
+    struct MemorySegment {
+        std::vector<SegmentDoc> docs;
+        std::map<std::string, std::vector<std::pair<uint32_t, uint32_t>>, std::less<>> terms;
+        uint64_t total_length = 0;
+    };
+
+    bool append_record(uint32_t id, uint32_t flags, const std::string& text, uint64_t& offset);
+    bool read_record(uint64_t offset, Note& out) const;
+    bool scan_log(uint64_t indexed_through);
+    void index_note(uint32_t id, uint64_t offset, const char* text, size_t size);
+    bool flush_locked(std::unique_lock<std::shared_mutex>& lock);
+    bool write_manifest_locked() const;
+    bool load_manifest(uint64_t& indexed_through);
+    std::string next_segment_path();
+    void schedule_merges_locked(std::unique_lock<std::shared_mutex>& lock);
+    bool pick_merge_locked(size_t& first, size_t& count);
+    // False if the merged segment could not be written; its inputs stay.
+    bool merge(size_t first, size_t count, std::unique_lock<std::shared_mutex>& lock);
+    void merge_worker();
+    bool is_current(const SegmentDoc& doc) const {
+        return doc.id < current_.size() && current_[doc.id] == doc.record_offset;
+    }
+
+    Options options_;
+    std::string directory_;
+    int log_fd_ = -1;
+    uint64_t log_size_ = 0;
+    bool log_torn_ = false; // A partial record could not be trimmed.
+    uint64_t indexed_through_ = 0; // Log prefix covered by segment files.
+    uint32_t next_segment_ = 1;
+
+    // current_[id] is the log offset of the note's live record, or
+    // kNoRecord once deleted. Guarded by mutex_ like the rest of the state.
+    std::vector<uint64_t> current_;
+    size_t live_count_ = 0;
+    std::vector<std::shared_ptr<Segment>> segments_;
+    MemorySegment memory_;
+    mutable std::shared_mutex mutex_;
+
+    std::thread merge_thread_;
+    std::condition_variable_any merge_cv_;
+    bool merge_requested_ = false;
+    bool merge_running_ = false;
+    bool stopping_ = false;
+};
+
+} // namespace Neurodeck
+
+#endif // NOTES_NOTE_STORE_HPP
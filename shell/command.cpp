@@ -10,6 +10,10 @@ extern std::unique_ptr<Command> make_clear();
 extern std::unique_ptr<Command> make_help();
 extern std::unique_ptr<Command> make_exit();
 extern std::unique_ptr<Command> make_open();
+extern std::unique_ptr<Command> make_stats();
+extern std::unique_ptr<Command> make_search();
+extern std::unique_ptr<Command> make_notes();
+extern std::unique_ptr<Command> make_export();
 
 using CmdPtr = std::unique_ptr<Command>;
 using Registry = std::unordered_map<std::string, CmdPtr>;
@@ -22,5 +26,9 @@ Registry build_registry() {
     add(make_help());
     add(make_exit());
     add(make_open());
+    add(make_stats());
+    add(make_search());
+    add(make_notes());
+    add(make_export());
     return reg;
 }
\ No newline at end of file
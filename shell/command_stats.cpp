@@ -0,0 +1,256 @@
+#include "command_stats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Single-writer increment: no read-modify-write instruction needed.
+inline void bump(std::atomic<uint64_t>& counter, uint64_t by = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+std::string format_ns(uint64_t ns) {
+    char buf[32];
+    if (ns < 1000) {
+        std::snprintf(buf, sizeof(buf), "%lluns", static_cast<unsigned long long>(ns));
+    } else if (ns < 1000000) {
+        std::snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+    } else if (ns < 1000000000) {
+        std::snprintf(buf, sizeof(buf), "%.1fms", ns / 1e6);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+    }
+    return buf;
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void write_histogram_json(std::ostream& out, const char* name, const HistogramSnapshot& h) {
+    out << "\"" << name << "\":{"
+        << "\"count\":" << h.total
+        << ",\"sum\":" << h.sum
+        << ",\"mean\":" << h.mean()
+        << ",\"p50\":" << h.percentile(50)
+        << ",\"p90\":" << h.percentile(90)
+        << ",\"p99\":" << h.percentile(99)
+        << ",\"max\":" << h.max << "}";
+}
+
+} // namespace
+
+int LatencyHistogram::bucket_for(uint64_t value) {
+    if (value < 32) return static_cast<int>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - 4; // Keeps the top five bits: a sub-bucket in [16, 32).
+    return 32 + (shift - 1) * 16 + static_cast<int>((value >> shift) - 16);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int bucket) {
+    if (bucket < 32) return static_cast<uint64_t>(bucket);
+    int shift = (bucket - 32) / 16 + 1;
+    uint64_t sub = static_cast<uint64_t>((bucket - 32) % 16 + 16);
+    if (sub + 1 == 32 && shift == 59) return UINT64_MAX;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    bump(buckets_[bucket_for(value)]);
+    bump(count_);
+    bump(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::clear() {
+    for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add_to(std::vector<uint64_t>& counts, uint64_t& total, uint64_t& sum, uint64_t& max) const {
+    for (int i = 0; i < kBucketCount; ++i) {
+        counts[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+    total += count_.load(std::memory_order_relaxed);
+    sum += sum_.load(std::memory_order_relaxed);
+    max = std::max(max, max_.load(std::memory_order_relaxed));
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(LatencyHistogram::bucket_upper_bound(i), max);
+    }
+    return max;
+}
+
+const char* const CommandStats::kUnknownCommand = "<unknown>";
+
+CommandStats& CommandStats::instance() {
+    static CommandStats stats;
+    return stats;
+}
+
+CommandStats::Shard& CommandStats::local_shard() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        shards_.push_back(std::make_unique<Shard>());
+        shard = shards_.back().get();
+    }
+    return *shard;
+}
+
+void CommandStats::record(const std::string& command, uint64_t lookup_ns, uint64_t run_ns, uint64_t output_bytes) {
+    Shard& shard = local_shard();
+    // Only this thread inserts into its shard, so the lookup needs no lock;
+    // the insert takes one to keep concurrent readers consistent.
+    auto it = shard.commands.find(command);
+    if (it == shard.commands.end()) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        it = shard.commands.emplace(command, std::make_unique<Counters>()).first;
+    }
+    Counters& counters = *it->second;
+    bump(counters.calls);
+    counters.lookup_ns.record(lookup_ns);
+    counters.run_ns.record(run_ns);
+    counters.output_bytes.record(output_bytes);
+}
+
+std::vector<CommandStatsSnapshot> CommandStats::snapshot() const {
+    std::unordered_map<std::string, CommandStatsSnapshot> merged;
+    std::lock_guard<std::mutex> lock(shards_mutex_);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        for (const auto& entry : shard->commands) {
+            CommandStatsSnapshot& snap = merged[entry.first];
+            snap.command = entry.first;
+            const Counters& c = *entry.second;
+            snap.calls += c.calls.load(std::memory_order_relaxed);
+            c.lookup_ns.add_to(snap.lookup_ns.counts, snap.lookup_ns.total, snap.lookup_ns.sum, snap.lookup_ns.max);
+            c.run_ns.add_to(snap.run_ns.counts, snap.run_ns.total, snap.run_ns.sum, snap.run_ns.max);
+            c.output_bytes.add_to(snap.output_bytes.counts, snap.output_bytes.total, snap.output_bytes.sum,
+                                  snap.output_bytes.max);
+        }
+    }
+
+    std::vector<CommandStatsSnapshot> result;
+    result.reserve(merged.size());
+    for (auto& entry : merged) {
+        if (entry.second.calls > 0) result.push_back(std::move(entry.second));
+    }
+    std::sort(result.begin(), result.end(), [](const CommandStatsSnapshot& a, const CommandStatsSnapshot& b) {
+        if (a.run_ns.sum != b.run_ns.sum) return a.run_ns.sum > b.run_ns.sum;
+        return a.command < b.command;
+    });
+    return result;
+}
+
+void CommandStats::write_table(std::ostream& out) const {
+    auto rows = snapshot();
+    if (rows.empty()) {
+        out << "No commands recorded yet.\n";
+        return;
+    }
+    out << std::left << std::setw(12) << "command" << std::right
+        << std::setw(8) << "calls"
+        << std::setw(10) << "run p50"
+        << std::setw(10) << "run p99"
+        << std::setw(10) << "run max"
+        << std::setw(12) << "lookup p50"
+        << std::setw(12) << "out bytes" << "\n";
+    for (const auto& row : rows) {
+        out << std::left << std::setw(12) << row.command << std::right
+            << std::setw(8) << row.calls
+            << std::setw(10) << format_ns(row.run_ns.percentile(50))
+            << std::setw(10) << format_ns(row.run_ns.percentile(99))
+            << std::setw(10) << format_ns(row.run_ns.max)
+            << std::setw(12) << format_ns(row.lookup_ns.percentile(50))
+            << std::setw(12) << row.output_bytes.sum << "\n";
+    }
+}
+
+void CommandStats::write_json(std::ostream& out) const {
+    auto rows = snapshot();
+    out << "{\"commands\":[";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const auto& row = rows[i];
+        if (i) out << ",";
+        out << "{\"command\":\"" << json_escape(row.command) << "\",\"calls\":" << row.calls << ",";
+        write_histogram_json(out, "lookup_ns", row.lookup_ns);
+        out << ",";
+        write_histogram_json(out, "run_ns", row.run_ns);
+        out << ",";
+        write_histogram_json(out, "output_bytes", row.output_bytes);
+        out << "}";
+    }
+    out << "]}\n";
+}
+
+bool CommandStats::dump_to_file(const std::string& filename) const {
+    std::ostringstream json;
+    write_json(json);
+    std::ofstream file(filename, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << json.str();
+    file.close();
+    return !file.fail();
+}
+
+void CommandStats::reset() {
+    std::lock_guard<std::mutex> lock(shards_mutex_);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        for (auto& entry : shard->commands) {
+            entry.second->calls.store(0, std::memory_order_relaxed);
+            entry.second->lookup_ns.clear();
+            entry.second->run_ns.clear();
+            entry.second->output_bytes.clear();
+        }
+    }
+}
+
+CountingStreambuf::int_type CountingStreambuf::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    ++count_;
+    return target_->sputc(traits_type::to_char_type(ch));
+}
+
+std::streamsize CountingStreambuf::xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = target_->sputn(s, n);
+    count_ += static_cast<uint64_t>(written);
+    return written;
+}
+
+int CountingStreambuf::sync() {
+    return target_->pubsync();
+}
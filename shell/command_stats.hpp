@@ -0,0 +1,123 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Log-linear histogram in the style of HdrHistogram: values below 32 get
+// exact buckets, larger values share 16 buckets per power of two, so any
+// recorded value is reported within ~6% of its true magnitude.
+//
+// Each histogram has a single writer (the thread that owns it). Buckets are
+// atomics so that readers on other threads can take snapshots while it is
+// being updated, but the writer never uses a locked instruction.
+class LatencyHistogram {
+public:
+    static constexpr int kBucketCount = 32 + 59 * 16;
+
+    void record(uint64_t value);
+    void clear();
+    // Adds this histogram's counts into a plain snapshot.
+    void add_to(std::vector<uint64_t>& counts, uint64_t& total, uint64_t& sum, uint64_t& max) const;
+
+    static int bucket_for(uint64_t value);
+    // Largest value that falls into `bucket`.
+    static uint64_t bucket_upper_bound(int bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Merged, read-only view of one histogram across all threads.
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts = std::vector<uint64_t>(LatencyHistogram::kBucketCount, 0);
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    // Value at percentile p (0-100); 0 when nothing was recorded.
+    uint64_t percentile(double p) const;
+    uint64_t mean() const { return total ? sum / total : 0; }
+};
+
+// Per-command dispatch counters: how long the registry lookup and the
+// command itself took (nanoseconds) and how much it printed (bytes).
+struct CommandStatsSnapshot {
+    std::string command;
+    uint64_t calls = 0;
+    HistogramSnapshot lookup_ns;
+    HistogramSnapshot run_ns;
+    HistogramSnapshot output_bytes;
+};
+
+// Process-wide command statistics.
+//
+// Every thread that records gets its own shard, created on first use. The
+// hot path touches only the calling thread's shard: one hash lookup and a
+// handful of relaxed atomic stores. Locks are taken only when a shard sees
+// a command for the first time and when a report is generated.
+class CommandStats {
+public:
+    // Name under which lookups of commands that do not exist are recorded.
+    static const char* const kUnknownCommand;
+
+    static CommandStats& instance();
+
+    void record(const std::string& command, uint64_t lookup_ns, uint64_t run_ns, uint64_t output_bytes);
+
+    // Merges all shards; sorted by total run time, slowest first.
+    std::vector<CommandStatsSnapshot> snapshot() const;
+
+    void write_table(std::ostream& out) const;
+    void write_json(std::ostream& out) const;
+
+    // Writes the JSON report to a file. Returns false if it cannot be written.
+    bool dump_to_file(const std::string& filename) const;
+
+    // Discards everything recorded so far (all threads).
+    void reset();
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> calls{0};
+        LatencyHistogram lookup_ns;
+        LatencyHistogram run_ns;
+        LatencyHistogram output_bytes;
+    };
+    struct Shard {
+        std::mutex mutex; // Guards the map's structure, not the counters.
+        std::unordered_map<std::string, std::unique_ptr<Counters>> commands;
+    };
+
+    CommandStats() = default;
+    Shard& local_shard();
+
+    mutable std::mutex shards_mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// Stream buffer that forwards to another one while counting the bytes that
+// pass through; installed on std::cout around each command.
+class CountingStreambuf : public std::streambuf {
+public:
+    explicit CountingStreambuf(std::streambuf* target) : target_(target) {}
+    uint64_t count() const { return count_; }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    std::streambuf* target_;
+    uint64_t count_ = 0;
+};
@@ -0,0 +1,41 @@
+#include "export.hpp"
+#include "../command.hpp" // Base class is still needed
+#include "../environment.hpp"
+#include <iostream>
+#include <memory>
+#include <vector> // For std::vector in run method signature
+
+std::string ExportCommand::name() const {
+    return "export";
+}
+
+// export                  - list exported variables
+// export NAME=value ...   - set and export
+// export NAME ...         - export a shell variable (an unset one as empty)
+void ExportCommand::run(const std::vector<std::string>& args) {
+    Environment& env = Environment::instance();
+    if (args.size() < 2) {
+        for (const auto& variable : env.exported()) {
+            std::cout << variable.first << '=' << variable.second << '\n';
+        }
+        return;
+    }
+    for (size_t i = 1; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        if (!Environment::is_valid_name(name)) {
+            std::cerr << "export: '" << name << "': not a valid identifier\n";
+            continue;
+        }
+        if (equals != std::string::npos) {
+            env.set_exported(name, std::string_view(arg).substr(equals + 1));
+        } else if (!env.export_variable(name)) {
+            env.set_exported(name, "");
+        }
+    }
+}
+
+std::unique_ptr<Command> make_export() {
+    return std::make_unique<ExportCommand>();
+}
@@ -17,7 +17,11 @@ void HelpCommand::run(const std::vector<std::string>& args) {
               << " clear - Clear the screen\n"
               << " open <filename> - Open a file\n"
               << " exit - Exit the shell\n"
-              << " help - Show this help message\n";
+              << " help - Show this help message\n"
+              << " stats [--json | reset] - Show per-command timing statistics\n"
+              << " search [-iFl] <pattern> [path...] - Search file contents recursively\n"
+              << " notes add|show|edit|rm|find ... - Manage and search notes\n"
+              << " export [NAME[=value] ...] - Set and export variables\n";
 }
 
 std::unique_ptr<Command> make_help() {
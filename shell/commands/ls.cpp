@@ -1,5 +1,6 @@
 #include "ls.hpp" // Added this include
 #include "../command.hpp" // Base class is still needed
+#include "../dir_listing.hpp"
 #include <iostream>
 #include <memory>
 #include <vector> // For std::vector in run method signature
@@ -10,13 +11,22 @@ std::string LsCommand::name() const {
     return "ls";
 }
 
+// ls [-alrStU1] [path...]
 void LsCommand::run(const std::vector<std::string>& args) {
-    // args is unused as per the command's behavior
-    std::cout << "Available modules/apps:\n"
-              << " notes  - textual note manager\n"
-              << " calendar - calendar and event manager\n"
-              << " ide - integrated development environment\n"
-              << " calculator - simple calculator\n";
+    LsOptions options;
+    std::vector<std::string> paths;
+    std::string error;
+    if (!parse_ls_args(args, options, paths, error)) {
+        std::cerr << "ls: " << error << "\n"
+                  << "Usage: ls [-alrStU1] [path...]\n";
+        return;
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (paths.size() > 1) std::cout << (i ? "\n" : "") << paths[i] << ":\n";
+        if (!list_path(paths[i], options, std::cout, error)) {
+            std::cerr << "ls: " << error << "\n";
+        }
+    }
 }
 
 std::unique_ptr<Command> make_ls() {
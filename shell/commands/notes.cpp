@@ -0,0 +1,97 @@
+#include "notes.hpp"
+#include "../command.hpp" // Base class is still needed
+#include "note_store.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector> // For std::vector in run method signature
+
+namespace {
+
+// NEURODECK_NOTES overrides the store location.
+std::string notes_path() {
+    if (const char* path = std::getenv("NEURODECK_NOTES")) return path;
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.neurodeck_notes";
+    return "";
+}
+
+std::string join_from(const std::vector<std::string>& args, size_t first) {
+    std::string text;
+    for (size_t i = first; i < args.size(); ++i) {
+        if (i > first) text += ' ';
+        text += args[i];
+    }
+    return text;
+}
+
+bool parse_id(const std::string& text, uint32_t& id) {
+    char* end = nullptr;
+    unsigned long value = std::strtoul(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || value == 0 || value > UINT32_MAX) {
+        return false;
+    }
+    id = static_cast<uint32_t>(value);
+    return true;
+}
+
+// First line of a note, shortened for result lists.
+std::string summary(const std::string& text) {
+    std::string line = text.substr(0, text.find('\n'));
+    return line.size() > 72 ? line.substr(0, 69) + "..." : line;
+}
+
+const char kUsage[] =
+    "Usage: notes add <text> | notes show <id> | notes edit <id> <text> | notes rm <id> | notes find <query>\n";
+
+} // namespace
+
+NotesCommand::NotesCommand() = default;
+NotesCommand::~NotesCommand() = default;
+
+std::string NotesCommand::name() const {
+    return "notes";
+}
+
+void NotesCommand::run(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        std::cout << kUsage;
+        return;
+    }
+    if (!store_) {
+        auto store = std::make_unique<Neurodeck::NoteStore>();
+        std::string path = notes_path();
+        if (path.empty() || !store->open(path)) {
+            std::cerr << "notes: cannot open note store '" << path << "'\n";
+            return;
+        }
+        store_ = std::move(store);
+    }
+
+    const std::string& action = args[1];
+    uint32_t id = 0;
+    Neurodeck::NoteStore::Note note;
+    if (action == "add" && args.size() > 2) {
+        id = store_->add(join_from(args, 2));
+        if (id) std::cout << "Added note " << id << ".\n";
+        else std::cerr << "notes: could not save note\n";
+    } else if (action == "show" && args.size() == 3 && parse_id(args[2], id)) {
+        if (store_->get(id, note)) std::cout << note.text << "\n";
+        else std::cerr << "notes: no note " << id << "\n";
+    } else if (action == "edit" && args.size() > 3 && parse_id(args[2], id)) {
+        if (!store_->update(id, join_from(args, 3))) std::cerr << "notes: no note " << id << "\n";
+    } else if (action == "rm" && args.size() == 3 && parse_id(args[2], id)) {
+        if (!store_->remove(id)) std::cerr << "notes: no note " << id << "\n";
+    } else if (action == "find" && args.size() > 2) {
+        for (const auto& hit : store_->search(join_from(args, 2), 20)) {
+            if (store_->get(hit.id, note)) {
+                std::cout << hit.id << "\t" << summary(note.text) << "\n";
+            }
+        }
+    } else {
+        std::cout << kUsage;
+    }
+}
+
+std::unique_ptr<Command> make_notes() {
+    return std::make_unique<NotesCommand>();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../command.hpp" // Base class is still needed
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+class NoteStore;
+}
+
+class NotesCommand : public Command {
+public:
+    NotesCommand();
+    ~NotesCommand() override;
+    std::string name() const override;
+    void run(const std::vector<std::string>& args) override;
+
+private:
+    // Opened on first use and kept open (and locked) for the session.
+    std::unique_ptr<Neurodeck::NoteStore> store_;
+};
+
+// Factory function
+std::unique_ptr<Command> make_notes();
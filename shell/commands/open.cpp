@@ -1,7 +1,10 @@
 #include "open.hpp" // Added this include
 #include "../command.hpp" // Base class is still needed
-#include <iostream> // Not strictly needed for current open logic, but often included
+#include "../pager.hpp"
+#include "mapped_file.hpp"
+#include <iostream>
 #include <memory>
+#include <unistd.h> // For isatty()
 #include <vector>   // For std::vector in run method signature
 
 // Class definition is now in the header, ensure implementation matches
@@ -10,10 +13,29 @@ std::string OpenCommand::name() const {
     return "open";
 }
 
+// open <file> - page through a file. When the shell is not on a terminal
+// the file is copied to standard output instead.
 void OpenCommand::run(const std::vector<std::string>& args) {
-    // Currently, the open command does nothing directly in its run method.
-    // It's a stub.
-    // (void)args; // Suppress unused parameter warning if desired
+    if (args.size() != 2) {
+        std::cout << "Usage: open <file>\n";
+        return;
+    }
+    if (isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)) {
+        std::cout.flush();
+        Pager pager;
+        if (!pager.open(args[1])) {
+            std::cerr << "open: cannot open '" << args[1] << "'\n";
+            return;
+        }
+        pager.run();
+        return;
+    }
+    Neurodeck::MappedFile file;
+    if (!file.open(args[1])) {
+        std::cerr << "open: cannot open '" << args[1] << "'\n";
+        return;
+    }
+    std::cout.write(file.data(), static_cast<std::streamsize>(file.size()));
 }
 
 std::unique_ptr<Command> make_open() {
@@ -0,0 +1,28 @@
+#include "search.hpp"
+#include "../command.hpp" // Base class is still needed
+#include "../content_search.hpp"
+#include <iostream>
+#include <memory>
+#include <vector> // For std::vector in run method signature
+
+std::string SearchCommand::name() const {
+    return "search";
+}
+
+// search [-iFl] [--hidden] [--no-ignore] [-j N] <pattern> [path...]
+void SearchCommand::run(const std::vector<std::string>& args) {
+    SearchOptions options;
+    std::vector<std::string> paths;
+    std::string error;
+    if (!parse_search_args(args, options, paths, error)) {
+        std::cerr << "search: " << error << "\n"
+                  << "Usage: search [-iFl] [--hidden] [--no-ignore] [-j N] <pattern> [path...]\n";
+        return;
+    }
+    ContentSearch search(options);
+    search.run(paths, std::cout, std::cerr);
+}
+
+std::unique_ptr<Command> make_search() {
+    return std::make_unique<SearchCommand>();
+}
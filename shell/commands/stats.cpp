@@ -0,0 +1,30 @@
+#include "stats.hpp"
+#include "../command.hpp" // Base class is still needed
+#include "../command_stats.hpp"
+#include <iostream>
+#include <memory>
+#include <vector> // For std::vector in run method signature
+
+std::string StatsCommand::name() const {
+    return "stats";
+}
+
+// stats          - table of per-command latency and output size
+// stats --json   - the same data as JSON
+// stats reset    - discard what has been recorded so far
+void StatsCommand::run(const std::vector<std::string>& args) {
+    if (args.size() > 1 && args[1] == "--json") {
+        CommandStats::instance().write_json(std::cout);
+    } else if (args.size() > 1 && args[1] == "reset") {
+        CommandStats::instance().reset();
+        std::cout << "Statistics reset.\n";
+    } else if (args.size() > 1) {
+        std::cout << "Usage: stats [--json | reset]\n";
+    } else {
+        CommandStats::instance().write_table(std::cout);
+    }
+}
+
+std::unique_ptr<Command> make_stats() {
+    return std::make_unique<StatsCommand>();
+}
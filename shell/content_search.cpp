@@ -0,0 +1,640 @@
+#include "content_search.hpp"
+#include "dir_listing.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Files at least this large are mapped; smaller ones are read into a reused
+// per-worker buffer, which is cheaper than setting up a mapping.
+const size_t kMmapThreshold = 1 << 20;
+// A NUL byte in this many leading bytes marks a file as binary.
+const size_t kBinaryProbe = 8192;
+// Upper bound for -j; more workers than this only add contention.
+const unsigned long kMaxThreads = 256;
+// Needles at least this long use Boyer-Moore-Horspool.
+const size_t kHorspoolMinLength = 16;
+
+const char kRegexMeta[] = ".^$|()[]{}*+?\\";
+
+inline unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + 32) : c;
+}
+
+bool has_regex_meta(const std::string& pattern) {
+    return pattern.find_first_of(kRegexMeta) != std::string::npos;
+}
+
+// Longest run of literal characters that every match of `pattern` must
+// contain. Gives up (returns "") on alternation and groups, where a run may be
+// optional.
+std::string required_literal(const std::string& pattern) {
+    if (pattern.find_first_of("|(") != std::string::npos) return "";
+    std::string best, run;
+    auto flush = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '{') {
+            // The preceding character is optional or repeated.
+            if (!run.empty()) run.pop_back();
+            flush();
+            if (c == '{') {
+                size_t close = pattern.find('}', i);
+                i = close == std::string::npos ? pattern.size() : close;
+            }
+        } else if (c == '+') {
+            flush();
+        } else if (c == '\\' && i + 1 < pattern.size()) {
+            char next = pattern[i + 1];
+            if (std::strchr(kRegexMeta, next) || next == '/' || next == '-') {
+                run += next;
+            } else {
+                flush(); // \d, \w, \b ...
+            }
+            ++i;
+        } else if (c == '[') {
+            flush();
+            size_t close = pattern.find(']', i + 2);
+            i = close == std::string::npos ? pattern.size() : close;
+        } else if (std::strchr(kRegexMeta, c)) {
+            flush();
+        } else {
+            run += c;
+        }
+    }
+    flush();
+    return best;
+}
+
+bool glob_class(const char*& p, char c) {
+    // p points at '['; on success it is left on the closing ']'.
+    const char* q = p + 1;
+    bool negate = *q == '!' || *q == '^';
+    if (negate) ++q;
+    bool matched = false;
+    bool first = true;
+    while (*q && (*q != ']' || first)) {
+        first = false;
+        char low = *q;
+        if (q[1] == '-' && q[2] && q[2] != ']') {
+            if (c >= low && c <= q[2]) matched = true;
+            q += 3;
+        } else {
+            if (c == low) matched = true;
+            ++q;
+        }
+    }
+    if (*q != ']') return c == '['; // Unterminated: a literal '['.
+    p = q;
+    return matched != negate;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// LiteralMatcher
+
+LiteralMatcher::LiteralMatcher(const std::string& needle, bool ignore_case)
+    : needle_(needle), ignore_case_(ignore_case) {
+    if (ignore_case_) {
+        for (char& c : needle_) c = static_cast<char>(fold(static_cast<unsigned char>(c)));
+    }
+    size_t k = needle_.size();
+    for (size_t& skip : skip_) skip = k ? k : 1;
+    for (size_t j = 0; j + 1 < k; ++j) {
+        unsigned char c = static_cast<unsigned char>(needle_[j]);
+        skip_[c] = k - 1 - j;
+        if (ignore_case_ && c >= 'a' && c <= 'z') skip_[c - 32] = k - 1 - j;
+    }
+}
+
+bool LiteralMatcher::equal_at(const char* text, size_t from, size_t to) const {
+    if (!ignore_case_) return std::memcmp(text + from, needle_.data() + from, to - from) == 0;
+    for (size_t i = from; i < to; ++i) {
+        if (fold(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(needle_[i])) return false;
+    }
+    return true;
+}
+
+size_t LiteralMatcher::find(const char* data, size_t size) const {
+    size_t k = needle_.size();
+    if (k == 0) return 0;
+    if (size < k) return npos;
+    if (k == 1 && !ignore_case_) {
+        const void* hit = std::memchr(data, needle_[0], size);
+        return hit ? static_cast<size_t>(static_cast<const char*>(hit) - data) : npos;
+    }
+    return k >= kHorspoolMinLength ? find_horspool(data, size) : find_short(data, size);
+}
+
+size_t LiteralMatcher::find_short(const char* data, size_t size) const {
+    size_t k = needle_.size();
+    size_t i = 0;
+#ifdef __SSE2__
+    unsigned char first = static_cast<unsigned char>(needle_[0]);
+    unsigned char last = static_cast<unsigned char>(needle_[k - 1]);
+    // With ignore_case the upper-case variants are compared as well; for
+    // non-letters they equal the lower-case ones and the extra compare is a
+    // no-op.
+    unsigned char first_alt = (ignore_case_ && first >= 'a' && first <= 'z') ? first - 32 : first;
+    unsigned char last_alt = (ignore_case_ && last >= 'a' && last <= 'z') ? last - 32 : last;
+    const __m128i vfirst = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i vlast = _mm_set1_epi8(static_cast<char>(last));
+    const __m128i vfirst_alt = _mm_set1_epi8(static_cast<char>(first_alt));
+    const __m128i vlast_alt = _mm_set1_epi8(static_cast<char>(last_alt));
+    for (; i + 16 + k - 1 <= size; i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + k - 1));
+        __m128i eq_first = _mm_or_si128(_mm_cmpeq_epi8(block_first, vfirst), _mm_cmpeq_epi8(block_first, vfirst_alt));
+        __m128i eq_last = _mm_or_si128(_mm_cmpeq_epi8(block_last, vlast), _mm_cmpeq_epi8(block_last, vlast_alt));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last)));
+        while (mask) {
+            size_t candidate = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (equal_at(data + candidate, 1, k - 1)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + k <= size; ++i) {
+        if (equal_at(data + i, 0, k)) return i;
+    }
+    return npos;
+}
+
+size_t LiteralMatcher::find_horspool(const char* data, size_t size) const {
+    size_t k = needle_.size();
+    unsigned char last = static_cast<unsigned char>(needle_[k - 1]);
+    for (size_t i = 0; i + k <= size;) {
+        unsigned char c = static_cast<unsigned char>(data[i + k - 1]);
+        if ((ignore_case_ ? fold(c) : c) == last && equal_at(data + i, 0, k - 1)) return i;
+        i += skip_[c];
+    }
+    return npos;
+}
+
+// ---------------------------------------------------------------------------
+// Ignore files
+
+bool glob_match(const char* p, const char* t) {
+    while (*p) {
+        if (p[0] == '*' && p[1] == '*') {
+            if (p[2] == '\0') return true;
+            if (p[2] == '/') {
+                // "**/" matches zero or more leading directories.
+                for (const char* s = t;;) {
+                    if (glob_match(p + 3, s)) return true;
+                    s = std::strchr(s, '/');
+                    if (!s) return false;
+                    ++s;
+                }
+            }
+            for (const char* s = t;; ++s) {
+                if (glob_match(p + 2, s)) return true;
+                if (!*s) return false;
+            }
+        }
+        if (*p == '*') {
+            ++p;
+            for (const char* s = t;; ++s) {
+                if (glob_match(p, s)) return true;
+                if (!*s || *s == '/') return false;
+            }
+        }
+        if (!*t) return false;
+        if (*p == '?') {
+            if (*t == '/') return false;
+        } else if (*p == '[') {
+            if (*t == '/' || !glob_class(p, *t)) return false;
+        } else {
+            if (*p == '\\' && p[1]) ++p;
+            if (*p != *t) return false;
+        }
+        ++p;
+        ++t;
+    }
+    return !*t;
+}
+
+void IgnoreRules::parse(const std::string& text) {
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        while (!line.empty() && line.back() == ' ' && (line.size() < 2 || line[line.size() - 2] != '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') continue;
+
+        Rule rule;
+        if (line[0] == '!') {
+            rule.negate = true;
+            line.erase(0, 1);
+        } else if (line[0] == '\\') {
+            line.erase(0, 1); // "\#" and "\!" start literal patterns.
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.dir_only = true;
+            line.pop_back();
+        }
+        rule.anchored = line.find('/') != std::string::npos;
+        if (!line.empty() && line[0] == '/') line.erase(0, 1);
+        if (line.empty()) continue;
+        rule.pattern = line;
+        rules_.push_back(rule);
+    }
+}
+
+int IgnoreRules::match(const std::string& path, bool is_dir) const {
+    size_t slash = path.rfind('/');
+    const char* base = path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    for (auto it = rules_.rbegin(); it != rules_.rend(); ++it) {
+        if (it->dir_only && !is_dir) continue;
+        if (glob_match(it->pattern.c_str(), it->anchored ? path.c_str() : base)) {
+            return it->negate ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Argument parsing
+
+bool parse_search_args(const std::vector<std::string>& args, SearchOptions& options,
+                       std::vector<std::string>& paths, std::string& error) {
+    bool have_pattern = false;
+    bool flags_done = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (flags_done || arg.size() < 2 || arg[0] != '-') {
+            if (!have_pattern) {
+                options.pattern = arg;
+                have_pattern = true;
+            } else {
+                paths.push_back(arg);
+            }
+        } else if (arg == "--") {
+            flags_done = true;
+        } else if (arg == "--hidden") {
+            options.hidden = true;
+        } else if (arg == "--no-ignore") {
+            options.use_ignore_files = false;
+        } else if (arg == "-j") {
+            if (i + 1 >= args.size()) {
+                error = "option -j needs a thread count";
+                return false;
+            }
+            const std::string& count = args[++i];
+            char* end = nullptr;
+            errno = 0;
+            unsigned long threads = std::strtoul(count.c_str(), &end, 10);
+            if (count.empty() || count[0] == '-' || *end != '\0' || errno != 0 || threads == 0 ||
+                threads > kMaxThreads) {
+                error = "invalid thread count '" + count + "'";
+                return false;
+            }
+            options.threads = static_cast<unsigned>(threads);
+        } else if (arg[1] == '-') {
+            error = "unknown option " + arg;
+            return false;
+        } else {
+            for (size_t j = 1; j < arg.size(); ++j) {
+                switch (arg[j]) {
+                case 'i': options.ignore_case = true; break;
+                case 'F': options.fixed_strings = true; break;
+                case 'l': options.files_with_matches = true; break;
+                default:
+                    error = std::string("invalid option -- '") + arg[j] + "'";
+                    return false;
+                }
+            }
+        }
+    }
+    if (!have_pattern) {
+        error = "missing pattern";
+        return false;
+    }
+    if (paths.empty()) paths.push_back(".");
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ContentSearch
+
+// Ignore rules in effect for a directory: its own files' rules on top of its
+// ancestors'. `base` is the display path of the directory holding the rules,
+// with a trailing '/' (or empty for ".").
+struct ContentSearch::IgnoreChain {
+    std::shared_ptr<const IgnoreChain> parent;
+    std::string base;
+    IgnoreRules rules;
+
+    bool ignored(const std::string& path, bool is_dir) const {
+        for (const IgnoreChain* level = this; level; level = level->parent.get()) {
+            int verdict = level->rules.match(path.substr(level->base.size()), is_dir);
+            if (verdict) return verdict > 0;
+        }
+        return false;
+    }
+};
+
+struct ContentSearch::Node {
+    std::string path; // As displayed, and as opened.
+    bool is_dir = false;
+    std::shared_ptr<const IgnoreChain> ignore; // Rules inherited from the ancestors.
+    std::vector<std::unique_ptr<Node>> children;
+    std::string output;
+    std::string error;
+    std::atomic<bool> ready{false};
+};
+
+ContentSearch::ContentSearch(const SearchOptions& options) : options_(options) {
+    use_regex_ = !options_.fixed_strings && has_regex_meta(options_.pattern);
+    if (!use_regex_) {
+        literal_ = LiteralMatcher(options_.pattern, options_.ignore_case);
+        return;
+    }
+    try {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (options_.ignore_case) flags |= std::regex::icase;
+        regex_ = std::regex(options_.pattern, flags);
+    } catch (const std::regex_error& e) {
+        valid_ = false;
+        error_ = std::string("invalid regular expression: ") + e.what();
+        return;
+    }
+    literal_ = LiteralMatcher(required_literal(options_.pattern), options_.ignore_case);
+}
+
+ContentSearch::~ContentSearch() = default;
+
+bool ContentSearch::line_matches(const char* begin, const char* end) const {
+    return std::regex_search(begin, end, regex_);
+}
+
+uint64_t ContentSearch::search_buffer(const char* data, size_t size, const std::string& path, std::string& out) const {
+    uint64_t matches = 0;
+    uint64_t line_number = 1;
+    const char* counted = data; // Newlines before this point are in line_number.
+    const char* end = data + size;
+    const char* pos = data;     // Always the start of a line.
+
+    while (pos < end) {
+        const char* line_start = pos;
+        if (!literal_.empty()) {
+            size_t hit = literal_.find(pos, static_cast<size_t>(end - pos));
+            if (hit == LiteralMatcher::npos) break;
+            const void* newline = hit ? memrchr(pos, '\n', hit) : nullptr;
+            line_start = newline ? static_cast<const char*>(newline) + 1 : pos;
+        }
+        const char* newline = static_cast<const char*>(std::memchr(line_start, '\n', static_cast<size_t>(end - line_start)));
+        const char* line_end = newline ? newline : end;
+        pos = line_end + 1;
+        if (use_regex_ && !line_matches(line_start, line_end)) continue;
+
+        for (const char* p = counted; (p = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(line_start - p))));) {
+            ++line_number;
+            ++p;
+        }
+        counted = line_start;
+        ++matches;
+        if (options_.files_with_matches) {
+            out += path;
+            out += '\n';
+            return 1;
+        }
+        if (line_end > line_start && line_end[-1] == '\r') --line_end;
+        out += path;
+        out += ':';
+        out += std::to_string(line_number);
+        out += ':';
+        out.append(line_start, static_cast<size_t>(line_end - line_start));
+        out += '\n';
+    }
+    return matches;
+}
+
+void ContentSearch::push(unsigned id, Node* node) {
+    outstanding_.fetch_add(1);
+    WorkQueue& queue = *queues_[id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(node);
+}
+
+ContentSearch::Node* ContentSearch::pop(unsigned id) {
+    {
+        WorkQueue& own = *queues_[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            Node* node = own.tasks.back();
+            own.tasks.pop_back();
+            return node;
+        }
+    }
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        WorkQueue& victim = *queues_[(id + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            Node* node = victim.tasks.front();
+            victim.tasks.pop_front();
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+void ContentSearch::finish(Node* node) {
+    node->ready.store(true, std::memory_order_release);
+    // Taking the lock orders the store before the printer's predicate check,
+    // so the notification cannot be lost.
+    { std::lock_guard<std::mutex> lock(ready_mutex_); }
+    ready_.notify_one();
+}
+
+void ContentSearch::process_directory(Node* node, unsigned id) {
+    DirectoryReader reader;
+    if (!reader.open(node->path)) {
+        node->error = "cannot read directory '" + node->path + "': " + std::strerror(errno);
+        finish(node);
+        return;
+    }
+    std::string prefix = node->path == "." ? "" : node->path + "/";
+
+    std::shared_ptr<const IgnoreChain> rules = node->ignore;
+    if (options_.use_ignore_files) {
+        auto chain = std::make_shared<IgnoreChain>();
+        for (const char* name : {".gitignore", ".ignore"}) {
+            int fd = openat(reader.fd(), name, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) continue;
+            std::string text;
+            char chunk[4096];
+            ssize_t n;
+            while ((n = read(fd, chunk, sizeof(chunk))) > 0) text.append(chunk, static_cast<size_t>(n));
+            close(fd);
+            chain->rules.parse(text);
+        }
+        if (!chain->rules.empty()) {
+            chain->parent = node->ignore;
+            chain->base = prefix;
+            rules = chain;
+        }
+    }
+
+    DirectoryListing listing;
+    int status;
+    while ((status = reader.read_batch(listing, options_.hidden)) > 0) {
+    }
+    for (uint32_t index : listing.order(LsSort::Name, false)) {
+        const char* name = listing.name(index);
+        if (std::strcmp(name, ".git") == 0) continue;
+        uint8_t type = listing.entry(index).type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(reader.fd(), name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if (type != DT_DIR && type != DT_REG) continue; // Symlinks, devices, sockets...
+
+        auto child = std::make_unique<Node>();
+        child->path = prefix + name;
+        child->is_dir = type == DT_DIR;
+        if (rules && rules->ignored(child->path, child->is_dir)) continue;
+        child->ignore = rules;
+        node->children.push_back(std::move(child));
+    }
+    // Pushed in reverse so that this worker, popping from the back, takes
+    // them in output order.
+    for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) push(id, it->get());
+    finish(node);
+}
+
+void ContentSearch::process_file(Node* node, std::vector<char>& buffer) {
+    files_searched_.fetch_add(1, std::memory_order_relaxed);
+    int fd = open(node->path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        node->error = "cannot open '" + node->path + "': " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        finish(node);
+        return;
+    }
+
+    const char* data = nullptr;
+    size_t size = 0;
+    Neurodeck::MappedFile mapped;
+    if (static_cast<size_t>(st.st_size) >= kMmapThreshold) {
+        close(fd);
+        if (!mapped.open(node->path)) {
+            node->error = "cannot map '" + node->path + "': " + std::strerror(errno);
+            finish(node);
+            return;
+        }
+        data = mapped.data();
+        size = static_cast<size_t>(mapped.size());
+    } else {
+        buffer.resize(static_cast<size_t>(st.st_size) + 1);
+        ssize_t n;
+        while ((n = read(fd, buffer.data() + size, buffer.size() - size)) > 0) {
+            size += static_cast<size_t>(n);
+            if (size == buffer.size()) buffer.resize(buffer.size() * 2); // Grew while reading.
+        }
+        close(fd);
+        data = buffer.data();
+    }
+
+    // A mapped file truncated mid-search reads as zeros rather than faulting.
+    if (mapped.is_open()) mapped.begin_access();
+    if (data && !std::memchr(data, '\0', std::min(size, kBinaryProbe))) {
+        matches_.fetch_add(search_buffer(data, size, node->path, node->output), std::memory_order_relaxed);
+    }
+    if (mapped.is_open() && !mapped.end_access()) {
+        node->error = "'" + node->path + "' was truncated while it was searched";
+    }
+    finish(node);
+}
+
+void ContentSearch::worker(unsigned id) {
+    std::vector<char> buffer;
+    int idle = 0;
+    while (true) {
+        Node* node = pop(id);
+        if (!node) {
+            if (outstanding_.load() == 0) return;
+            // Others are still producing work; back off gently.
+            if (++idle < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+        idle = 0;
+        if (node->is_dir) process_directory(node, id);
+        else process_file(node, buffer);
+        outstanding_.fetch_sub(1);
+    }
+}
+
+void ContentSearch::print(Node* node, std::ostream& out, std::ostream& err) {
+    if (!node->ready.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(ready_mutex_);
+        ready_.wait(lock, [node] { return node->ready.load(std::memory_order_acquire); });
+    }
+    if (!node->error.empty()) err << "search: " << node->error << "\n";
+    if (!node->output.empty()) out.write(node->output.data(), static_cast<std::streamsize>(node->output.size()));
+    for (auto& child : node->children) {
+        print(child.get(), out, err);
+        child.reset(); // Printed; release its buffered output.
+    }
+}
+
+uint64_t ContentSearch::run(const std::vector<std::string>& paths, std::ostream& out, std::ostream& err) {
+    if (!valid_) {
+        err << "search: " << error_ << "\n";
+        return 0;
+    }
+    unsigned threads = options_.threads ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+    queues_.clear();
+    for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<WorkQueue>());
+    matches_.store(0);
+
+    std::vector<std::unique_ptr<Node>> roots;
+    for (const std::string& path : paths) {
+        auto root = std::make_unique<Node>();
+        root->path = path;
+        while (root->path.size() > 1 && root->path.back() == '/') root->path.pop_back();
+        struct stat st;
+        if (stat(root->path.c_str(), &st) != 0) {
+            root->error = "cannot access '" + path + "': " + std::strerror(errno);
+            root->ready.store(true);
+        } else {
+            root->is_dir = S_ISDIR(st.st_mode);
+        }
+        roots.push_back(std::move(root));
+    }
+    for (size_t i = roots.size(); i-- > 0;) {
+        if (!roots[i]->ready.load()) push(0, roots[i].get());
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(&ContentSearch::worker, this, i);
+    for (auto& root : roots) print(root.get(), out, err);
+    for (auto& worker : workers) worker.join();
+    out.flush();
+    return matches_.load();
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Substring search for one fixed needle.
+//
+// Short needles use an SSE2 filter that compares the needle's first and last
+// bytes against 16 haystack positions at once and verifies only the
+// candidates; long needles use Boyer-Moore-Horspool, whose skips grow with
+// the needle. Without SSE2 the short path falls back to a scalar loop.
+class LiteralMatcher {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    LiteralMatcher(const std::string& needle = std::string(), bool ignore_case = false);
+
+    // Offset of the first occurrence in [data, data + size), or npos.
+    size_t find(const char* data, size_t size) const;
+    bool empty() const { return needle_.empty(); }
+
+private:
+    bool equal_at(const char* text, size_t from, size_t to) const;
+    size_t find_short(const char* data, size_t size) const;
+    size_t find_horspool(const char* data, size_t size) const;
+
+    std::string needle_; // Lower-cased when ignore_case_.
+    bool ignore_case_;
+    size_t skip_[256];
+};
+
+// Rules from one .gitignore/.ignore file: globs with '*', '?', '[...]' and
+// '**', '!' to re-include, a trailing '/' for directories only and a '/'
+// anywhere else to anchor the pattern to the file's directory.
+class IgnoreRules {
+public:
+    void parse(const std::string& text);
+    bool empty() const { return rules_.empty(); }
+
+    // For `path` relative to the ignore file's directory: 1 if the last
+    // matching rule ignores it, -1 if it re-includes it, 0 if none matches.
+    int match(const std::string& path, bool is_dir) const;
+
+private:
+    struct Rule {
+        std::string pattern;
+        bool negate = false;
+        bool dir_only = false;
+        bool anchored = false;
+    };
+    std::vector<Rule> rules_;
+};
+
+// Glob match of `text` against `pattern`; '*' and '?' do not cross '/', '**'
+// does.
+bool glob_match(const char* pattern, const char* text);
+
+struct SearchOptions {
+    std::string pattern;
+    bool ignore_case = false;        // -i
+    bool fixed_strings = false;      // -F: never treat the pattern as a regex
+    bool files_with_matches = false; // -l: print only the names of matching files
+    bool hidden = false;             // --hidden: also search dot files and directories
+    bool use_ignore_files = true;    // --no-ignore turns .gitignore/.ignore off
+    unsigned threads = 0;            // -j N; 0 uses the hardware concurrency
+};
+
+// Parses `search` arguments (args[0] is the command name). Returns false and
+// sets `error` on a bad flag or a missing pattern.
+bool parse_search_args(const std::vector<std::string>& args, SearchOptions& options,
+                       std::vector<std::string>& paths, std::string& error);
+
+// Parallel recursive content search.
+//
+// Worker threads walk the tree with per-worker deques: each pops its newest
+// task and steals the oldest from others when it runs dry. Each directory
+// becomes a node whose children are sorted by name, and each searched file
+// keeps its formatted results in its node. The calling thread prints nodes
+// depth-first and waits only for the node it needs next, so output follows
+// the traversal order while the workers run ahead.
+class ContentSearch {
+public:
+    explicit ContentSearch(const SearchOptions& options);
+    ~ContentSearch();
+
+    // False if the pattern is an invalid regular expression; see error().
+    bool valid() const { return valid_; }
+    const std::string& error() const { return error_; }
+
+    // Searches `paths`, writing matches to `out` and problems to `err`.
+    // Returns the number of matching lines (files with -l).
+    uint64_t run(const std::vector<std::string>& paths, std::ostream& out, std::ostream& err);
+
+    // Searches one buffer, appending "path:line:text" lines to `out`.
+    // Returns the number of matching lines.
+    uint64_t search_buffer(const char* data, size_t size, const std::string& path, std::string& out) const;
+
+    uint64_t files_searched() const { return files_searched_.load(); }
+
+private:
+    struct IgnoreChain;
+    struct Node;
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Node*> tasks;
+    };
+
+    bool line_matches(const char* begin, const char* end) const;
+    void worker(unsigned id);
+    void push(unsigned id, Node* node);
+    Node* pop(unsigned id);
+    void process_directory(Node* node, unsigned id);
+    void process_file(Node* node, std::vector<char>& buffer);
+    void finish(Node* node);
+    void print(Node* node, std::ostream& out, std::ostream& err);
+
+    SearchOptions options_;
+    bool valid_ = true;
+    std::string error_;
+    bool use_regex_ = false;
+    std::regex regex_;
+    // Literal needle, or for a regex a literal every match must contain
+    // (empty if none could be extracted).
+    LiteralMatcher literal_;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::atomic<uint64_t> outstanding_{0};
+    std::atomic<uint64_t> files_searched_{0};
+    std::atomic<uint64_t> matches_{0};
+    std::mutex ready_mutex_;
+    std::condition_variable ready_;
+};
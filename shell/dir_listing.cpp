@@ -0,0 +1,444 @@
+#include "dir_listing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <numeric>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Entries per statx worker; below this, starting a thread costs more than
+// it saves.
+const size_t kEntriesPerThread = 2048;
+// Formatted output is handed to the stream in chunks of about this size.
+const size_t kFlushThreshold = 64 * 1024;
+
+// Layout of struct linux_dirent64, which glibc does not export.
+const size_t kDirentReclen = 16;
+const size_t kDirentType = 18;
+const size_t kDirentName = 19;
+
+struct SortKey {
+    uint64_t key;
+    uint32_t index;
+};
+
+// LSD radix sort on the 64-bit key, one byte per pass. Passes in which every
+// key has the same byte are skipped, so short or clustered keys cost less.
+void radix_sort(std::vector<SortKey>& keys) {
+    if (keys.size() < 256) {
+        std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) { return a.key < b.key; });
+        return;
+    }
+    std::vector<SortKey> scratch(keys.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const SortKey& k : keys) ++counts[(k.key >> shift) & 0xff];
+        if (counts[(keys[0].key >> shift) & 0xff] == keys.size()) continue;
+        size_t position = 0;
+        for (size_t& count : counts) {
+            size_t n = count;
+            count = position;
+            position += n;
+        }
+        for (const SortKey& k : keys) scratch[counts[(k.key >> shift) & 0xff]++] = k;
+        keys.swap(scratch);
+    }
+}
+
+// First eight bytes of a name, big-endian, so that comparing keys compares
+// the names' prefixes byte by byte.
+uint64_t name_prefix(const char* name, size_t length) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        key <<= 8;
+        if (i < length) key |= static_cast<unsigned char>(name[i]);
+    }
+    return key;
+}
+
+char file_type_char(uint32_t mode) {
+    switch (mode & S_IFMT) {
+    case S_IFDIR: return 'd';
+    case S_IFLNK: return 'l';
+    case S_IFCHR: return 'c';
+    case S_IFBLK: return 'b';
+    case S_IFIFO: return 'p';
+    case S_IFSOCK: return 's';
+    default: return '-';
+    }
+}
+
+void append_mode(std::string& out, uint32_t mode) {
+    out += file_type_char(mode);
+    const char* rwx = "rwxrwxrwx";
+    for (int i = 0; i < 9; ++i) {
+        out += (mode & (0400u >> i)) ? rwx[i] : '-';
+    }
+    if (mode & S_ISUID) out[out.size() - 7] = (mode & S_IXUSR) ? 's' : 'S';
+    if (mode & S_ISGID) out[out.size() - 4] = (mode & S_IXGRP) ? 's' : 'S';
+    if (mode & S_ISVTX) out[out.size() - 1] = (mode & S_IXOTH) ? 't' : 'T';
+}
+
+void append_padded(std::string& out, const std::string& text, int width, bool left) {
+    int pad = width - static_cast<int>(text.size());
+    if (!left && pad > 0) out.append(static_cast<size_t>(pad), ' ');
+    out += text;
+    if (left && pad > 0) out.append(static_cast<size_t>(pad), ' ');
+}
+
+int digits(uint64_t value) {
+    int n = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++n;
+    }
+    return n;
+}
+
+} // namespace
+
+bool parse_ls_args(const std::vector<std::string>& args, LsOptions& options,
+                   std::vector<std::string>& paths, std::string& error) {
+    bool flags_done = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (flags_done || arg.size() < 2 || arg[0] != '-') {
+            paths.push_back(arg);
+            continue;
+        }
+        if (arg == "--") {
+            flags_done = true;
+            continue;
+        }
+        for (size_t j = 1; j < arg.size(); ++j) {
+            switch (arg[j]) {
+            case 'a': options.all = true; break;
+            case 'l': options.long_format = true; break;
+            case 'S': options.sort = LsSort::Size; break;
+            case 't': options.sort = LsSort::Time; break;
+            case 'U': options.sort = LsSort::None; break;
+            case 'r': options.reverse = true; break;
+            case '1': break;
+            default:
+                error = std::string("invalid option -- '") + arg[j] + "'";
+                return false;
+            }
+        }
+    }
+    if (paths.empty()) paths.push_back(".");
+    return true;
+}
+
+unsigned ls_metadata_mask(const LsOptions& options) {
+    unsigned mask = 0;
+    if (options.long_format) {
+        mask |= STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME;
+    }
+    if (options.sort == LsSort::Size) mask |= STATX_SIZE;
+    if (options.sort == LsSort::Time) mask |= STATX_MTIME;
+    return mask;
+}
+
+void DirectoryListing::add(const char* name, size_t length, uint8_t type) {
+    Entry entry;
+    entry.name_offset = static_cast<uint32_t>(names_.size());
+    entry.name_length = static_cast<uint32_t>(length);
+    entry.type = type;
+    names_.append(name, length);
+    names_ += '\0';
+    entries_.push_back(entry);
+}
+
+void DirectoryListing::clear() {
+    names_.clear();
+    entries_.clear();
+}
+
+void DirectoryListing::fetch_metadata(int dirfd, unsigned mask, unsigned max_threads, size_t first) {
+    if (first >= entries_.size()) return;
+    size_t count = entries_.size() - first;
+    auto work = [this, dirfd, mask](size_t begin, size_t end) {
+        struct statx stx;
+        for (size_t i = begin; i < end; ++i) {
+            Entry& e = entries_[i];
+            // AT_STATX_DONT_SYNC: network filesystems may answer from cache.
+            if (statx(dirfd, name(i), AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC, mask, &stx) != 0) {
+                e.has_stat = false;
+                continue;
+            }
+            e.has_stat = true;
+            e.mode = stx.stx_mode;
+            e.nlink = stx.stx_nlink;
+            e.uid = stx.stx_uid;
+            e.gid = stx.stx_gid;
+            e.size = stx.stx_size;
+            e.mtime_sec = stx.stx_mtime.tv_sec;
+            e.mtime_nsec = stx.stx_mtime.tv_nsec;
+        }
+    };
+
+    unsigned limit = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t wanted = (count + kEntriesPerThread - 1) / kEntriesPerThread;
+    unsigned threads = static_cast<unsigned>(std::min<size_t>(limit, wanted));
+    if (threads <= 1) {
+        work(first, entries_.size());
+    } else {
+        std::vector<std::thread> workers;
+        size_t chunk = (count + threads - 1) / threads;
+        for (unsigned t = 1; t < threads; ++t) {
+            size_t begin = first + t * chunk;
+            size_t end = std::min(entries_.size(), begin + chunk);
+            if (begin < end) workers.emplace_back(work, begin, end);
+        }
+        work(first, std::min(entries_.size(), first + chunk));
+        for (auto& worker : workers) worker.join();
+    }
+    stat_calls_ += count;
+}
+
+std::vector<uint32_t> DirectoryListing::order(LsSort sort, bool reverse) const {
+    std::vector<uint32_t> result(entries_.size());
+    if (sort == LsSort::None) {
+        std::iota(result.begin(), result.end(), 0u);
+        if (reverse) std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    // Sort compact (key, index) pairs rather than the entries themselves;
+    // names are only consulted for keys that tie.
+    std::vector<SortKey> keys(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const Entry& e = entries_[i];
+        uint64_t key;
+        if (sort == LsSort::Size) {
+            key = ~e.size;
+        } else if (sort == LsSort::Time) {
+            uint64_t ns = static_cast<uint64_t>(e.mtime_sec * 1000000000LL + e.mtime_nsec) ^ (1ULL << 63);
+            key = ~ns;
+        } else {
+            key = name_prefix(name(i), e.name_length);
+        }
+        keys[i] = {key, static_cast<uint32_t>(i)};
+    }
+    radix_sort(keys);
+
+    auto name_less = [this](const SortKey& a, const SortKey& b) {
+        const Entry& ea = entries_[a.index];
+        const Entry& eb = entries_[b.index];
+        int c = std::memcmp(name(a.index), name(b.index), std::min(ea.name_length, eb.name_length));
+        return c != 0 ? c < 0 : ea.name_length < eb.name_length;
+    };
+    size_t run = 0;
+    for (size_t i = 1; i <= keys.size(); ++i) {
+        if (i == keys.size() || keys[i].key != keys[run].key) {
+            if (i - run > 1) std::sort(keys.begin() + run, keys.begin() + i, name_less);
+            run = i;
+        }
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) result[i] = keys[i].index;
+    if (reverse) std::reverse(result.begin(), result.end());
+    return result;
+}
+
+DirectoryReader::~DirectoryReader() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool DirectoryReader::open(const std::string& path) {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return fd_ >= 0;
+}
+
+int DirectoryReader::read_batch(DirectoryListing& listing, bool include_hidden) {
+    if (fd_ < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (buffer_.empty()) buffer_.resize(kBufferSize);
+    long n = syscall(SYS_getdents64, fd_, buffer_.data(), buffer_.size());
+    if (n < 0) return -1;
+    if (n == 0) return 0;
+
+    size_t offset = 0;
+    while (offset < static_cast<size_t>(n)) {
+        const char* record = buffer_.data() + offset;
+        unsigned short reclen;
+        std::memcpy(&reclen, record + kDirentReclen, sizeof(reclen));
+        uint8_t type = static_cast<uint8_t>(record[kDirentType]);
+        const char* name = record + kDirentName;
+        offset += reclen;
+
+        if (name[0] == '.') {
+            if (!include_hidden) continue;
+            if (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')) continue;
+        }
+        listing.add(name, std::strlen(name), type);
+    }
+    return 1;
+}
+
+ListingPrinter::ListingPrinter(std::ostream& out, const LsOptions& options)
+    : out_(out), options_(options), now_(static_cast<int64_t>(std::time(nullptr))) {
+    buffer_.reserve(kFlushThreshold + 4096);
+}
+
+ListingPrinter::~ListingPrinter() {
+    flush();
+}
+
+const std::string& ListingPrinter::user_name(uint32_t uid) {
+    auto it = users_.find(uid);
+    if (it != users_.end()) return it->second;
+    struct passwd pw;
+    struct passwd* result = nullptr;
+    char buf[1024];
+    std::string name = (getpwuid_r(uid, &pw, buf, sizeof(buf), &result) == 0 && result)
+                           ? std::string(result->pw_name)
+                           : std::to_string(uid);
+    return users_.emplace(uid, name).first->second;
+}
+
+const std::string& ListingPrinter::group_name(uint32_t gid) {
+    auto it = groups_.find(gid);
+    if (it != groups_.end()) return it->second;
+    struct group gr;
+    struct group* result = nullptr;
+    char buf[1024];
+    std::string name = (getgrgid_r(gid, &gr, buf, sizeof(buf), &result) == 0 && result)
+                           ? std::string(result->gr_name)
+                           : std::to_string(gid);
+    return groups_.emplace(gid, name).first->second;
+}
+
+void ListingPrinter::measure(const DirectoryListing& listing, const std::vector<uint32_t>& indices) {
+    if (!options_.long_format) return;
+    auto visit = [&](uint32_t i) {
+        const DirectoryListing::Entry& e = listing.entry(i);
+        if (!e.has_stat) return;
+        nlink_width_ = std::max(nlink_width_, digits(e.nlink));
+        user_width_ = std::max(user_width_, static_cast<int>(user_name(e.uid).size()));
+        group_width_ = std::max(group_width_, static_cast<int>(group_name(e.gid).size()));
+        size_width_ = std::max(size_width_, digits(e.size));
+    };
+    if (indices.empty()) {
+        for (size_t i = 0; i < listing.size(); ++i) visit(static_cast<uint32_t>(i));
+    } else {
+        for (uint32_t i : indices) visit(i);
+    }
+}
+
+void ListingPrinter::print(const DirectoryListing& listing, uint32_t index, int dirfd) {
+    const DirectoryListing::Entry& e = listing.entry(index);
+    const char* name = listing.name(index);
+    if (options_.long_format) {
+        if (!e.has_stat) {
+            buffer_ += "?????????? ? ? ? ? ? ";
+        } else {
+            append_mode(buffer_, e.mode);
+            buffer_ += ' ';
+            append_padded(buffer_, std::to_string(e.nlink), nlink_width_, false);
+            buffer_ += ' ';
+            append_padded(buffer_, user_name(e.uid), user_width_, true);
+            buffer_ += ' ';
+            append_padded(buffer_, group_name(e.gid), group_width_, true);
+            buffer_ += ' ';
+            append_padded(buffer_, std::to_string(e.size), size_width_, false);
+            buffer_ += ' ';
+
+            // Like ls: the time of day for recent files, the year otherwise.
+            char when[32];
+            time_t mtime = static_cast<time_t>(e.mtime_sec);
+            struct tm local;
+            localtime_r(&mtime, &local);
+            const int64_t six_months = 6 * 30 * 24 * 3600LL;
+            bool recent = e.mtime_sec > now_ - six_months && e.mtime_sec <= now_ + 3600;
+            std::strftime(when, sizeof(when), recent ? "%b %e %H:%M" : "%b %e  %Y", &local);
+            buffer_ += when;
+            buffer_ += ' ';
+        }
+        buffer_.append(name, e.name_length);
+        if (e.has_stat && S_ISLNK(e.mode)) {
+            char target[4096];
+            ssize_t n = readlinkat(dirfd, name, target, sizeof(target));
+            if (n > 0) {
+                buffer_ += " -> ";
+                buffer_.append(target, static_cast<size_t>(n));
+            }
+        }
+    } else {
+        buffer_.append(name, e.name_length);
+    }
+    buffer_ += '\n';
+    if (buffer_.size() >= kFlushThreshold) flush();
+}
+
+void ListingPrinter::flush() {
+    if (buffer_.empty()) return;
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+bool list_path(const std::string& path, const LsOptions& options, std::ostream& out, std::string& error) {
+    unsigned mask = ls_metadata_mask(options);
+    ListingPrinter printer(out, options);
+    DirectoryReader reader;
+
+    if (!reader.open(path)) {
+        if (errno != ENOTDIR) {
+            error = "cannot access '" + path + "': " + std::strerror(errno);
+            return false;
+        }
+        // A plain file: show the path itself.
+        DirectoryListing single;
+        single.add(path.c_str(), path.size(), DT_UNKNOWN);
+        if (mask) single.fetch_metadata(AT_FDCWD, mask, 1);
+        printer.measure(single, {});
+        printer.print(single, 0, AT_FDCWD);
+        return true;
+    }
+
+    DirectoryListing listing;
+    if (options.sort == LsSort::None && !options.reverse) {
+        // Unsorted: print each getdents batch as soon as it is read, keeping
+        // memory bounded by the batch size. Column widths are per batch.
+        for (;;) {
+            listing.clear();
+            int status = reader.read_batch(listing, options.all);
+            if (status < 0) {
+                error = "reading directory '" + path + "': " + std::strerror(errno);
+                return false;
+            }
+            if (mask) listing.fetch_metadata(reader.fd(), mask, options.max_threads);
+            printer.measure(listing, {});
+            for (size_t i = 0; i < listing.size(); ++i) {
+                printer.print(listing, static_cast<uint32_t>(i), reader.fd());
+            }
+            printer.flush();
+            if (status == 0) return true;
+        }
+    }
+
+    int status;
+    while ((status = reader.read_batch(listing, options.all)) > 0) {
+    }
+    if (status < 0) {
+        error = "reading directory '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    if (mask) listing.fetch_metadata(reader.fd(), mask, options.max_threads);
+    std::vector<uint32_t> order = listing.order(options.sort, options.reverse);
+    printer.measure(listing, order);
+    for (uint32_t index : order) printer.print(listing, index, reader.fd());
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class LsSort { Name, Size, Time, None };
+
+struct LsOptions {
+    bool all = false;           // -a: include entries starting with '.'
+    bool long_format = false;   // -l
+    LsSort sort = LsSort::Name; // -S size, -t modification time, -U directory order
+    bool reverse = false;       // -r
+    unsigned max_threads = 0;   // statx fan-out; 0 uses the hardware concurrency
+};
+
+// Parses `ls` arguments (args[0] is the command name). Everything that is not
+// a flag is a path; with no paths, "." is listed. Returns false and sets
+// `error` on an unknown flag.
+bool parse_ls_args(const std::vector<std::string>& args, LsOptions& options,
+                   std::vector<std::string>& paths, std::string& error);
+
+// statx mask with just the fields `options` needs to sort and print; 0 when
+// the names alone are enough.
+unsigned ls_metadata_mask(const LsOptions& options);
+
+// Entries of one directory, stored compactly: names sit back to back in one
+// NUL-separated arena and each entry holds only fixed-size fields, so millions
+// of entries stay cheap to sort and walk.
+class DirectoryListing {
+public:
+    struct Entry {
+        uint32_t name_offset = 0;
+        uint32_t name_length = 0;
+        uint8_t type = 0; // DT_* from getdents64
+        bool has_stat = false;
+        uint32_t mode = 0;
+        uint32_t nlink = 0;
+        uint32_t uid = 0;
+        uint32_t gid = 0;
+        uint64_t size = 0;
+        int64_t mtime_sec = 0;
+        uint32_t mtime_nsec = 0;
+    };
+
+    void add(const char* name, size_t length, uint8_t type);
+    void clear();
+
+    size_t size() const { return entries_.size(); }
+    const Entry& entry(size_t i) const { return entries_[i]; }
+    Entry& entry(size_t i) { return entries_[i]; }
+    const char* name(size_t i) const { return names_.data() + entries_[i].name_offset; }
+
+    // statx()s entries [first, size()) relative to `dirfd`, asking only for
+    // `mask`. Large batches are split across up to `max_threads` threads.
+    void fetch_metadata(int dirfd, unsigned mask, unsigned max_threads, size_t first = 0);
+    uint64_t stat_calls() const { return stat_calls_; }
+
+    // Indices in display order. Name order compares raw bytes; size and time
+    // put the largest/newest first and break ties by name.
+    std::vector<uint32_t> order(LsSort sort, bool reverse) const;
+
+private:
+    std::string names_;
+    std::vector<Entry> entries_;
+    uint64_t stat_calls_ = 0;
+};
+
+// Reads a directory with getdents64 into a large buffer, one batch per call.
+class DirectoryReader {
+public:
+    static const size_t kBufferSize = 1 << 20;
+
+    DirectoryReader() = default;
+    ~DirectoryReader();
+    DirectoryReader(const DirectoryReader&) = delete;
+    DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+    // Returns false and sets errno if `path` cannot be opened as a directory.
+    bool open(const std::string& path);
+    int fd() const { return fd_; }
+
+    // Appends the next batch to `listing` ("." and "..", and other dot files
+    // unless `include_hidden`, are skipped). Returns 1 when entries may
+    // follow, 0 at the end of the directory and -1 on error (errno is set).
+    int read_batch(DirectoryListing& listing, bool include_hidden);
+
+private:
+    int fd_ = -1;
+    std::vector<char> buffer_;
+};
+
+// Formats entries, buffering output and caching user/group names.
+class ListingPrinter {
+public:
+    ListingPrinter(std::ostream& out, const LsOptions& options);
+    ~ListingPrinter();
+
+    // Sizes the long-format columns for `indices` (all entries when empty).
+    void measure(const DirectoryListing& listing, const std::vector<uint32_t>& indices);
+    void print(const DirectoryListing& listing, uint32_t index, int dirfd);
+    void flush();
+
+private:
+    const std::string& user_name(uint32_t uid);
+    const std::string& group_name(uint32_t gid);
+
+    std::ostream& out_;
+    LsOptions options_;
+    std::string buffer_;
+    std::unordered_map<uint32_t, std::string> users_;
+    std::unordered_map<uint32_t, std::string> groups_;
+    int nlink_width_ = 1;
+    int user_width_ = 1;
+    int group_width_ = 1;
+    int size_width_ = 1;
+    int64_t now_ = 0;
+};
+
+// Lists one path: a directory's entries, or the path itself if it is not a
+// directory. With LsSort::None entries are printed batch by batch as they are
+// read instead of being collected first. Returns false and sets `error` if
+// the path cannot be read.
+bool list_path(const std::string& path, const LsOptions& options, std::ostream& out, std::string& error);
@@ -0,0 +1,249 @@
+#include "environment.hpp"
+#include <algorithm>
+#include <cstring>
+
+extern char** environ;
+
+struct Environment::Node {
+    std::string entry;  // "NAME=value"
+    size_t name_length;
+    int height;
+    NodePtr left;
+    NodePtr right;
+
+    std::string_view name() const { return std::string_view(entry.data(), name_length); }
+    std::string_view value() const { return std::string_view(entry).substr(name_length + 1); }
+};
+
+// A built envp array and the tree it points into.
+struct Environment::Block {
+    NodePtr root;
+    std::vector<char*> pointers;
+};
+
+namespace {
+
+template <typename Ptr>
+int height(const Ptr& node) {
+    return node ? node->height : 0;
+}
+
+} // namespace
+
+Environment::NodePtr Environment::make(std::string entry, size_t name_length, NodePtr left, NodePtr right) {
+    int h = 1 + std::max(height(left), height(right));
+    return std::make_shared<const Node>(Node{std::move(entry), name_length, h, std::move(left), std::move(right)});
+}
+
+Environment::NodePtr Environment::rebuild(const Node& node, NodePtr left, NodePtr right) {
+    return make(node.entry, node.name_length, std::move(left), std::move(right));
+}
+
+// Copies `node` with new children, rotating once or twice if their heights
+// differ by more than one.
+Environment::NodePtr Environment::balance(const Node& node, NodePtr left, NodePtr right) {
+    if (height(left) > height(right) + 1) {
+        if (height(left->right) > height(left->left)) {
+            const Node& pivot = *left->right;
+            return rebuild(pivot, rebuild(*left, left->left, pivot.left), rebuild(node, pivot.right, right));
+        }
+        return rebuild(*left, left->left, rebuild(node, left->right, right));
+    }
+    if (height(right) > height(left) + 1) {
+        if (height(right->left) > height(right->right)) {
+            const Node& pivot = *right->left;
+            return rebuild(pivot, rebuild(node, left, pivot.left), rebuild(*right, pivot.right, right->right));
+        }
+        return rebuild(*right, rebuild(node, left, right->left), right->right);
+    }
+    return rebuild(node, std::move(left), std::move(right));
+}
+
+const Environment::Node* Environment::find(const Node* node, std::string_view name) {
+    while (node) {
+        int order = name.compare(node->name());
+        if (order == 0) {
+            return node;
+        }
+        node = order < 0 ? node->left.get() : node->right.get();
+    }
+    return nullptr;
+}
+
+Environment::NodePtr Environment::insert(const NodePtr& node, std::string_view name, std::string_view value,
+                                         bool& added) {
+    if (!node) {
+        added = true;
+        std::string entry;
+        entry.reserve(name.size() + 1 + value.size());
+        entry.append(name).append(1, '=').append(value);
+        return make(std::move(entry), name.size(), nullptr, nullptr);
+    }
+    int order = name.compare(node->name());
+    if (order == 0) {
+        added = false;
+        std::string entry = node->entry.substr(0, node->name_length + 1);
+        entry.append(value);
+        return make(std::move(entry), node->name_length, node->left, node->right);
+    }
+    if (order < 0) {
+        return balance(*node, insert(node->left, name, value, added), node->right);
+    }
+    return balance(*node, node->left, insert(node->right, name, value, added));
+}
+
+Environment::NodePtr Environment::erase_min(const NodePtr& node, NodePtr& min) {
+    if (!node->left) {
+        min = node;
+        return node->right;
+    }
+    return balance(*node, erase_min(node->left, min), node->right);
+}
+
+Environment::NodePtr Environment::erase(const NodePtr& node, std::string_view name, bool& removed) {
+    if (!node) {
+        removed = false;
+        return node;
+    }
+    int order = name.compare(node->name());
+    if (order < 0) {
+        NodePtr left = erase(node->left, name, removed);
+        return removed ? balance(*node, std::move(left), node->right) : node;
+    }
+    if (order > 0) {
+        NodePtr right = erase(node->right, name, removed);
+        return removed ? balance(*node, node->left, std::move(right)) : node;
+    }
+    removed = true;
+    if (!node->right) {
+        return node->left;
+    }
+    NodePtr successor;
+    NodePtr right = erase_min(node->right, successor);
+    return balance(*successor, node->left, std::move(right));
+}
+
+Environment Environment::from_process() {
+    Environment env;
+    for (char** entry = environ; entry && *entry; ++entry) {
+        const char* equals = std::strchr(*entry, '=');
+        if (equals) {
+            env.set_exported(std::string_view(*entry, equals - *entry), equals + 1);
+        }
+    }
+    return env;
+}
+
+Environment& Environment::instance() {
+    static Environment env;
+    return env;
+}
+
+bool Environment::is_valid_name(std::string_view name) {
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+    for (char c : name) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Environment::get(std::string_view name, std::string_view& value) const {
+    const Node* node = find(exported_.get(), name);
+    if (!node) {
+        node = find(shell_.get(), name);
+    }
+    if (!node) {
+        return false;
+    }
+    value = node->value();
+    return true;
+}
+
+bool Environment::is_exported(std::string_view name) const {
+    return find(exported_.get(), name) != nullptr;
+}
+
+void Environment::set(std::string_view name, std::string_view value) {
+    bool added;
+    if (find(exported_.get(), name)) {
+        exported_ = insert(exported_, name, value, added);
+    } else {
+        shell_ = insert(shell_, name, value, added);
+        shell_count_ += added;
+    }
+}
+
+void Environment::set_exported(std::string_view name, std::string_view value) {
+    bool changed;
+    shell_ = erase(shell_, name, changed);
+    shell_count_ -= changed;
+    exported_ = insert(exported_, name, value, changed);
+    exported_count_ += changed;
+}
+
+bool Environment::export_variable(std::string_view name) {
+    if (find(exported_.get(), name)) {
+        return true;
+    }
+    const Node* node = find(shell_.get(), name);
+    if (!node) {
+        return false;
+    }
+    std::string value(node->value());
+    set_exported(name, value);
+    return true;
+}
+
+void Environment::unset(std::string_view name) {
+    bool removed;
+    exported_ = erase(exported_, name, removed);
+    exported_count_ -= removed;
+    shell_ = erase(shell_, name, removed);
+    shell_count_ -= removed;
+}
+
+std::vector<std::pair<std::string, std::string>> Environment::exported() const {
+    std::vector<std::pair<std::string, std::string>> out;
+    out.reserve(exported_count_);
+    for (char* const* entry = envp(); *entry; ++entry) {
+        const char* equals = std::strchr(*entry, '=');
+        out.emplace_back(std::string(*entry, equals - *entry), equals + 1);
+    }
+    return out;
+}
+
+char* const* Environment::envp() const {
+    if (!block_ || block_->root != exported_) {
+        auto block = std::make_shared<Block>();
+        block->root = exported_;
+        block->pointers.reserve(exported_count_ + 1);
+        // In-order walk with an explicit stack; the tree is at most ~1.44
+        // log2(n) deep.
+        std::vector<const Node*> stack;
+        const Node* node = exported_.get();
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = node->left.get();
+            }
+            node = stack.back();
+            stack.pop_back();
+            block->pointers.push_back(const_cast<char*>(node->entry.c_str()));
+            node = node->right.get();
+        }
+        block->pointers.push_back(nullptr);
+        block_ = std::move(block);
+    }
+    return block_->pointers.data();
+}
+
+void Environment::install() const {
+    static std::shared_ptr<const Block> installed;
+    char* const* pointers = envp();
+    installed = block_;
+    environ = const_cast<char**>(pointers);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Shell and environment variables.
+//
+// Variables live in two persistent AVL trees keyed by name, one for exported
+// variables and one for the shell's own. Every change copies only the path
+// to the changed node, so copying an Environment is O(1) and a copy with a
+// few per-command overrides (FOO=1 cmd) costs O(log n) per override while
+// sharing everything else with the original.
+//
+// Each node holds its variable as a ready-made "NAME=value" string, so the
+// envp array for exec (and for getenv() once install()ed) is just pointers
+// into the exported tree. It is built on first use after the exported
+// variables change and shared between copies until one of them changes;
+// setting a shell variable such as $? leaves it alone.
+class Environment {
+public:
+    // The process environment at startup, everything exported.
+    static Environment from_process();
+    // The shell's current variables.
+    static Environment& instance();
+
+    // Letters, digits and '_', not starting with a digit.
+    static bool is_valid_name(std::string_view name);
+
+    // Returns false if `name` is not set. `value` stays valid until the
+    // variable is changed or this Environment and its copies are gone.
+    bool get(std::string_view name, std::string_view& value) const;
+    bool is_exported(std::string_view name) const;
+
+    // Sets `name`, keeping it exported if it already was.
+    void set(std::string_view name, std::string_view value);
+    void set_exported(std::string_view name, std::string_view value);
+    // Exports a variable that is already set. Returns false if it is not.
+    bool export_variable(std::string_view name);
+    void unset(std::string_view name);
+
+    size_t size() const { return exported_count_ + shell_count_; }
+    // Exported variables in name order.
+    std::vector<std::pair<std::string, std::string>> exported() const;
+
+    // Null-terminated "NAME=value" array of the exported variables.
+    char* const* envp() const;
+    // Points the process environment at envp(), so that getenv() and
+    // exec'd children see these variables. The array is kept alive until
+    // the next install().
+    void install() const;
+
+private:
+    struct Node;
+    struct Block;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static NodePtr make(std::string entry, size_t name_length, NodePtr left, NodePtr right);
+    static NodePtr rebuild(const Node& node, NodePtr left, NodePtr right);
+    static NodePtr balance(const Node& node, NodePtr left, NodePtr right);
+    static const Node* find(const Node* node, std::string_view name);
+    static NodePtr insert(const NodePtr& node, std::string_view name, std::string_view value, bool& added);
+    static NodePtr erase(const NodePtr& node, std::string_view name, bool& removed);
+    static NodePtr erase_min(const NodePtr& node, NodePtr& min);
+
+    NodePtr exported_;
+    NodePtr shell_;
+    size_t exported_count_ = 0;
+    size_t shell_count_ = 0;
+    mutable std::shared_ptr<const Block> block_; // envp cache for exported_
+};
@@ -0,0 +1,441 @@
+#include "glob.hpp"
+#include "tokenize.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ---------------------------------------------------------------------------
+// GlobMatcher
+
+GlobMatcher::GlobMatcher(std::string_view pattern) {
+    // Tokenize everything first, then peel literal characters off both ends.
+    std::vector<Token> all;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '\\' && i + 1 < pattern.size()) {
+            all.push_back({Op::Char, static_cast<uint8_t>(pattern[++i]), 0});
+        } else if (c == '?') {
+            all.push_back({Op::Any, 0, 0});
+        } else if (c == '*') {
+            if (all.empty() || all.back().op != Op::Star) all.push_back({Op::Star, 0, 0});
+        } else if (c == '[') {
+            // Same syntax as glob_class() in content_search.cpp.
+            size_t q = i + 1;
+            bool negate = q < pattern.size() && (pattern[q] == '!' || pattern[q] == '^');
+            if (negate) ++q;
+            uint64_t bits[4] = {0, 0, 0, 0};
+            bool first = true;
+            while (q < pattern.size() && (pattern[q] != ']' || first)) {
+                first = false;
+                if (pattern[q] == '\\' && q + 1 < pattern.size()) ++q;
+                uint8_t low = static_cast<uint8_t>(pattern[q]);
+                uint8_t high = low;
+                if (q + 2 < pattern.size() && pattern[q + 1] == '-' && pattern[q + 2] != ']') {
+                    high = static_cast<uint8_t>(pattern[q + 2]);
+                    q += 3;
+                } else {
+                    ++q;
+                }
+                for (unsigned b = low; b <= high; ++b) bits[b >> 6] |= uint64_t(1) << (b & 63);
+            }
+            if (q >= pattern.size()) {
+                all.push_back({Op::Char, '[', 0}); // Unterminated: a literal '['.
+                continue;
+            }
+            if (negate) {
+                for (uint64_t& word : bits) word = ~word;
+            }
+            all.push_back({Op::Class, 0, static_cast<uint16_t>(sets_.size() / 4)});
+            sets_.insert(sets_.end(), bits, bits + 4);
+            i = q;
+        } else {
+            all.push_back({Op::Char, static_cast<uint8_t>(c), 0});
+        }
+    }
+
+    dot_ = !all.empty() && all[0].op == Op::Char && all[0].c == '.';
+    size_t begin = 0;
+    while (begin < all.size() && all[begin].op == Op::Char) prefix_ += static_cast<char>(all[begin++].c);
+    if (begin == all.size()) return; // No wildcards.
+    literal_ = false;
+    size_t end = all.size();
+    while (end > begin && all[end - 1].op == Op::Char) --end;
+    for (size_t i = end; i < all.size(); ++i) suffix_ += static_cast<char>(all[i].c);
+    tokens_.assign(all.begin() + begin, all.begin() + end);
+
+    min_length_ = prefix_.size() + suffix_.size();
+    for (const Token& token : tokens_) min_length_ += token.op != Op::Star;
+    star_only_ = tokens_.size() == 1 && tokens_[0].op == Op::Star;
+}
+
+bool GlobMatcher::matches(std::string_view name) const {
+    if (name.size() < min_length_) return false;
+    if (literal_) return name.size() == prefix_.size() && std::memcmp(name.data(), prefix_.data(), prefix_.size()) == 0;
+    if (std::memcmp(name.data(), prefix_.data(), prefix_.size()) != 0) return false;
+    if (std::memcmp(name.data() + name.size() - suffix_.size(), suffix_.data(), suffix_.size()) != 0) return false;
+    if (star_only_) return true;
+    return match_tokens(name.data() + prefix_.size(), name.size() - prefix_.size() - suffix_.size());
+}
+
+bool GlobMatcher::match_tokens(const char* name, size_t length) const {
+    // Every token but '*' consumes one character, so on a mismatch it is
+    // enough to let the most recent '*' swallow one more character.
+    const size_t none = static_cast<size_t>(-1);
+    size_t t = 0;
+    size_t n = 0;
+    size_t star = none;
+    size_t star_n = 0;
+    while (n < length) {
+        if (t < tokens_.size()) {
+            const Token& token = tokens_[t];
+            uint8_t c = static_cast<uint8_t>(name[n]);
+            if (token.op == Op::Star) {
+                star = ++t;
+                star_n = n;
+                continue;
+            }
+            bool ok = token.op == Op::Any || (token.op == Op::Char && token.c == c) ||
+                      (token.op == Op::Class && (sets_[token.set * 4 + (c >> 6)] >> (c & 63)) & 1);
+            if (ok) {
+                ++t;
+                ++n;
+                continue;
+            }
+        }
+        if (star == none) return false;
+        t = star;
+        n = ++star_n;
+    }
+    while (t < tokens_.size() && tokens_[t].op == Op::Star) ++t;
+    return t == tokens_.size();
+}
+
+// ---------------------------------------------------------------------------
+// Pattern text
+
+void expand_braces(const std::string& pattern, std::vector<std::string>& out) {
+    for (size_t open = 0; open < pattern.size(); ++open) {
+        if (pattern[open] == '\\') {
+            ++open;
+            continue;
+        }
+        if (pattern[open] != '{') continue;
+        std::vector<size_t> commas;
+        size_t close = std::string::npos;
+        int depth = 0;
+        for (size_t i = open; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c == '\\') {
+                ++i;
+            } else if (c == '{') {
+                ++depth;
+            } else if (c == '}' && --depth == 0) {
+                close = i;
+                break;
+            } else if (c == ',' && depth == 1) {
+                commas.push_back(i);
+            }
+        }
+        if (close == std::string::npos || commas.empty()) continue; // A literal '{'.
+        commas.push_back(close);
+        size_t start = open + 1;
+        for (size_t comma : commas) {
+            std::string word = pattern.substr(0, open);
+            word.append(pattern, start, comma - start);
+            word.append(pattern, close + 1, std::string::npos);
+            expand_braces(word, out);
+            start = comma + 1;
+        }
+        return;
+    }
+    out.push_back(pattern);
+}
+
+bool has_wildcards(std::string_view pattern) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '\\') ++i;
+        else if (c == '*' || c == '?' || c == '[') return true;
+    }
+    return false;
+}
+
+std::string unescape_glob(std::string_view pattern) {
+    std::string out;
+    out.reserve(pattern.size());
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\' && i + 1 < pattern.size()) ++i;
+        out += pattern[i];
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// GlobExpander
+
+// One directory's entries: names back to back plus 12 bytes per entry, so a
+// walk over a large tree stays small even though nothing is dropped.
+struct GlobExpander::Directory {
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        uint8_t type; // DT_*
+    };
+
+    std::string names;
+    std::vector<Entry> entries;
+
+    std::string_view name(size_t i) const {
+        return std::string_view(names.data() + entries[i].offset, entries[i].length);
+    }
+};
+
+struct GlobExpander::Component {
+    enum class Kind { Literal, Match, Recursive };
+    Kind kind;
+    GlobMatcher matcher;
+};
+
+namespace {
+
+bool is_directory(uint8_t type, const std::string& path, bool follow) {
+    if (type == DT_DIR) return true;
+    if (type != DT_UNKNOWN && (type != DT_LNK || !follow)) return false;
+    struct stat st;
+    int rc = follow ? ::stat(path.c_str(), &st) : ::lstat(path.c_str(), &st);
+    return rc == 0 && S_ISDIR(st.st_mode);
+}
+
+} // namespace
+
+GlobExpander::GlobExpander(unsigned max_threads)
+    : max_threads_(max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency())) {
+}
+
+GlobExpander::~GlobExpander() = default;
+
+void GlobExpander::read_directory(DirectoryReader& reader, DirectoryListing& scratch, const std::string& path,
+                                  Directory& dir) {
+    if (!reader.open(path.empty() ? "." : path)) return; // Unreadable: no entries.
+    scratch.clear();
+    while (reader.read_batch(scratch, true) > 0) {
+    }
+    dir.entries.reserve(scratch.size());
+    for (size_t i = 0; i < scratch.size(); ++i) {
+        const DirectoryListing::Entry& entry = scratch.entry(i);
+        dir.entries.push_back({static_cast<uint32_t>(dir.names.size()), entry.name_length, entry.type});
+        dir.names.append(scratch.name(i), entry.name_length);
+    }
+}
+
+const GlobExpander::Directory& GlobExpander::directory(const std::string& path) {
+    std::unique_ptr<Directory>& slot = directories_[path];
+    if (!slot) {
+        slot.reset(new Directory);
+        ++directories_read_;
+        read_directory(reader_, scratch_, path, *slot);
+    }
+    return *slot;
+}
+
+void GlobExpander::read_tree(const std::string& root) {
+    for (const std::string& done : trees_read_) {
+        if (done.empty() ? root.empty() : root.compare(0, done.size(), done) == 0) return;
+    }
+    trees_read_.push_back(root);
+
+    // Workers take directories from a shared stack and push the
+    // subdirectories "**" would walk into. More workers are started while
+    // there is a backlog, so small trees stay on the calling thread.
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::string> pending{root};
+    size_t busy = 0;
+    std::vector<std::thread> workers;
+    std::function<void()> work = [&] {
+        DirectoryReader reader;
+        DirectoryListing scratch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return !pending.empty() || busy == 0; });
+            if (pending.empty()) break;
+            std::string path = std::move(pending.back());
+            pending.pop_back();
+            auto cached = directories_.find(path);
+            const Directory* dir = cached != directories_.end() ? cached->second.get() : nullptr;
+            ++busy;
+            lock.unlock();
+
+            std::unique_ptr<Directory> fresh;
+            if (!dir) {
+                fresh.reset(new Directory);
+                read_directory(reader, scratch, path, *fresh);
+                dir = fresh.get();
+            }
+            std::vector<std::string> children;
+            std::string child;
+            for (size_t i = 0; i < dir->entries.size(); ++i) {
+                std::string_view name = dir->name(i);
+                uint8_t type = dir->entries[i].type;
+                if (name[0] == '.' || (type != DT_DIR && type != DT_UNKNOWN)) continue;
+                child = path;
+                child.append(name.data(), name.size());
+                if (is_directory(type, child, false)) children.push_back(child + '/');
+            }
+
+            lock.lock();
+            for (std::string& c : children) pending.push_back(std::move(c));
+            if (fresh) {
+                directories_.emplace(std::move(path), std::move(fresh));
+                ++directories_read_;
+            }
+            if (pending.size() > 1 && workers.size() + 1 < max_threads_) workers.emplace_back(work);
+            --busy;
+            wake.notify_all();
+        }
+    };
+    work();
+    for (std::thread& worker : workers) worker.join();
+}
+
+bool GlobExpander::exists(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string parent = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    auto it = directories_.find(parent);
+    if (it != directories_.end()) {
+        std::string_view name = std::string_view(path).substr(parent.size());
+        const Directory& dir = *it->second;
+        for (size_t i = 0; i < dir.entries.size(); ++i) {
+            if (dir.name(i) == name) return true;
+        }
+        return name == "." || name == "..";
+    }
+    struct stat st;
+    return ::lstat(path.c_str(), &st) == 0;
+}
+
+// `path` is empty for the working directory and otherwise ends in '/'.
+void GlobExpander::walk(const std::vector<Component>& components, size_t index, std::string& path,
+                        std::vector<std::string>& out, bool within_tree) {
+    const Component& component = components[index];
+    const bool last = index + 1 == components.size();
+    const size_t mark = path.size();
+
+    if (component.kind == Component::Kind::Literal) {
+        path += component.matcher.literal();
+        if (!last) {
+            path += '/';
+            walk(components, index + 1, path, out, false);
+        } else if (exists(path)) {
+            out.push_back(path);
+        }
+        path.resize(mark);
+        return;
+    }
+
+    if (component.kind == Component::Kind::Recursive) {
+        if (!within_tree) read_tree(path);
+        if (!last) walk(components, index + 1, path, out, false); // "**" as no directories at all.
+    }
+    const Directory& dir = directory(path);
+    for (size_t i = 0; i < dir.entries.size(); ++i) {
+        std::string_view name = dir.name(i);
+        if (name[0] == '.' && !component.matcher.matches_hidden()) continue;
+        if (component.kind == Component::Kind::Match && !component.matcher.matches(name)) continue;
+        uint8_t type = dir.entries[i].type;
+        if (component.kind == Component::Kind::Recursive && !last && type != DT_DIR && type != DT_UNKNOWN) continue;
+        path.append(name.data(), name.size());
+        if (component.kind == Component::Kind::Recursive) {
+            // A trailing "**" matches everything below; otherwise it only
+            // descends.
+            if (last) out.push_back(path);
+            if (is_directory(type, path, false)) {
+                path += '/';
+                walk(components, index, path, out, true);
+            }
+        } else if (last) {
+            out.push_back(path);
+        } else if (is_directory(type, path, true)) {
+            path += '/';
+            walk(components, index + 1, path, out, false);
+        }
+        path.resize(mark);
+    }
+}
+
+size_t GlobExpander::expand(const std::string& pattern, std::vector<std::string>& out) {
+    std::vector<std::string> words;
+    expand_braces(pattern, words);
+    size_t matched = 0;
+    for (const std::string& word : words) {
+        if (!has_wildcards(word)) {
+            out.push_back(unescape_glob(word));
+            continue;
+        }
+        // Split into components. A trailing '/' keeps only directories,
+        // which is the same as matching "." inside them.
+        std::vector<Component> components;
+        std::string path;
+        size_t start = 0;
+        if (word[0] == '/') {
+            path = "/";
+            start = 1;
+        }
+        while (start <= word.size()) {
+            size_t slash = word.find('/', start);
+            if (slash == std::string::npos) slash = word.size();
+            std::string_view part = std::string_view(word).substr(start, slash - start);
+            if (!part.empty()) {
+                if (part == "**") {
+                    components.push_back({Component::Kind::Recursive, GlobMatcher()});
+                } else {
+                    GlobMatcher matcher(part);
+                    auto kind = matcher.is_literal() ? Component::Kind::Literal : Component::Kind::Match;
+                    components.push_back({kind, std::move(matcher)});
+                }
+            } else if (slash == word.size() && slash > 0) {
+                components.push_back({Component::Kind::Literal, GlobMatcher(".")});
+            }
+            start = slash + 1;
+        }
+
+        size_t first = out.size();
+        walk(components, 0, path, out, false);
+        if (word.back() == '/') {
+            // "dir/." -> "dir/"; "**/" matching no directories at all gives
+            // "." -> "", which is dropped.
+            for (size_t i = first; i < out.size(); ++i) out[i].pop_back();
+            out.erase(std::remove(out.begin() + first, out.end(), std::string()), out.end());
+        }
+        std::sort(out.begin() + first, out.end());
+        out.erase(std::unique(out.begin() + first, out.end()), out.end());
+        if (out.size() == first) {
+            out.push_back(unescape_glob(word));
+        } else {
+            matched += out.size() - first;
+        }
+    }
+    return matched;
+}
+
+void expand_globs(CommandLine& line, GlobExpander& expander) {
+    bool any = false;
+    for (const std::string& pattern : line.patterns) any = any || !pattern.empty();
+    if (!any) return;
+    std::vector<std::string> words;
+    words.reserve(line.words.size());
+    for (size_t i = 0; i < line.words.size(); ++i) {
+        if (line.patterns[i].empty()) {
+            words.push_back(std::move(line.words[i]));
+        } else {
+            expander.expand(line.patterns[i], words);
+        }
+    }
+    line.words = std::move(words);
+    line.patterns.assign(line.words.size(), std::string());
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "dir_listing.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct CommandLine;
+
+// One path component of a glob: '*', '?', '[...]' (ranges, '!' or '^' to
+// negate, a leading ']' is literal) and backslash escapes.
+//
+// The pattern is compiled once. Literal text at either end becomes a prefix
+// and suffix compared with memcmp, so "*.cpp" and "test_*" never reach the
+// general matcher; what is left in between runs as a token list that only
+// ever backtracks to the last '*' it passed.
+class GlobMatcher {
+public:
+    explicit GlobMatcher(std::string_view pattern = std::string_view());
+
+    bool matches(std::string_view name) const;
+
+    // True if the pattern has no wildcards; literal() is then the name it
+    // matches, with escapes removed.
+    bool is_literal() const { return literal_; }
+    const std::string& literal() const { return prefix_; }
+    // Names starting with '.' only match patterns that start with one.
+    bool matches_hidden() const { return dot_; }
+
+private:
+    enum class Op : uint8_t { Char, Any, Star, Class };
+    struct Token {
+        Op op;
+        uint8_t c;
+        uint16_t set; // Index into sets_ for Op::Class.
+    };
+
+    bool match_tokens(const char* name, size_t length) const;
+
+    std::string prefix_;
+    std::string suffix_;
+    std::vector<Token> tokens_;      // What lies between prefix_ and suffix_.
+    std::vector<uint64_t> sets_;     // Four words (256 bits) per class.
+    size_t min_length_ = 0;          // Shortest name that can match.
+    bool literal_ = true;
+    bool star_only_ = false;         // tokens_ is a single '*'.
+    bool dot_ = false;
+};
+
+// Appends the words `pattern` brace-expands to: "a{b,c{d,e}}f" gives abf,
+// acdf and acef, in that order. Braces without a top-level comma and escaped
+// braces stay as they are.
+void expand_braces(const std::string& pattern, std::vector<std::string>& out);
+
+// True if `pattern` has an unescaped '*', '?' or '['.
+bool has_wildcards(std::string_view pattern);
+
+// `pattern` with its escapes removed.
+std::string unescape_glob(std::string_view pattern);
+
+// Expands glob patterns against the file system.
+//
+// Every directory a pattern needs is read once with getdents64 and kept, in
+// a compact form, for the lifetime of the expander, so one expander per
+// command line reads each directory once however many patterns touch it.
+// Directories are only read to match wildcards: literal components are
+// appended to the path without a read ("src/**/*.cpp" starts the walk in
+// src/), and a literal last component is looked up in its directory's
+// listing if that was read anyway, or checked with one lstat if not. "**"
+// stands for any number of directories, not hidden ones and not through
+// symlinks. The first time a walk reaches a "**", everything below it is
+// read on up to `max_threads` threads (0 uses the hardware concurrency), so
+// the walk itself then runs from memory.
+class GlobExpander {
+public:
+    explicit GlobExpander(unsigned max_threads = 0);
+    ~GlobExpander();
+    GlobExpander(const GlobExpander&) = delete;
+    GlobExpander& operator=(const GlobExpander&) = delete;
+
+    // Appends the sorted paths matching each word of `pattern`'s brace
+    // expansion to `out`. A word that matches nothing is appended as it is,
+    // unescaped. Returns the number of paths that matched.
+    size_t expand(const std::string& pattern, std::vector<std::string>& out);
+
+    size_t directories_read() const { return directories_read_; }
+
+private:
+    struct Directory;
+    struct Component;
+
+    static void read_directory(DirectoryReader& reader, DirectoryListing& scratch, const std::string& path,
+                               Directory& dir);
+    const Directory& directory(const std::string& path);
+    void read_tree(const std::string& root);
+    bool exists(const std::string& path);
+    void walk(const std::vector<Component>& components, size_t index, std::string& path,
+              std::vector<std::string>& out, bool within_tree);
+
+    std::unordered_map<std::string, std::unique_ptr<Directory>> directories_;
+    DirectoryReader reader_;
+    DirectoryListing scratch_;
+    std::vector<std::string> trees_read_;
+    unsigned max_threads_;
+    size_t directories_read_ = 0;
+};
+
+// Replaces every word of `line` that has a glob pattern with its expansion.
+void expand_globs(CommandLine& line, GlobExpander& expander);
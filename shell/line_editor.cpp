@@ -0,0 +1,793 @@
+#include "line_editor.hpp"
+#include "history_store.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+// Key codes above the byte range for keys that arrive as escape sequences.
+enum Key {
+    kKeyNone = -1,
+    kKeyEscape = 256,
+    kKeyAltEnter,
+    kKeyLeft,
+    kKeyRight,
+    kKeyUp,
+    kKeyDown,
+    kKeyHome,
+    kKeyEnd,
+    kKeyDelete,
+    kKeyWordLeft,
+    kKeyWordRight,
+    kKeyKillWordForward,
+    kKeyPasteStart,
+};
+
+constexpr int ctrl(char c) { return c & 0x1f; }
+
+const char kPasteEnd[] = "\x1b[201~";
+const char kContinuationPrompt[] = "> ";
+const char kHintStart[] = "\x1b[90m"; // Grey
+const char kHintEnd[] = "\x1b[39m";   // Default colour
+
+bool is_continuation(unsigned char c) { return (c & 0xc0) == 0x80; }
+
+size_t utf8_length(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xe0) == 0xc0) return 2;
+    if ((lead & 0xf0) == 0xe0) return 3;
+    if ((lead & 0xf8) == 0xf0) return 4;
+    return 1;
+}
+
+int cell_count(const std::string& row, size_t end) {
+    int cells = 0;
+    for (size_t i = 0; i < end; ++i) {
+        if (row[i] == '\x1b') {
+            // The colour escapes of hint cells take no room.
+            while (i < end && row[i] != 'm') ++i;
+        } else if (!is_continuation(static_cast<unsigned char>(row[i]))) {
+            ++cells;
+        }
+    }
+    return cells;
+}
+
+// Offset just past the cell that starts at row[pos].
+size_t next_cell(const std::string& row, size_t pos) {
+    bool hint = row.compare(pos, sizeof(kHintStart) - 1, kHintStart) == 0;
+    if (hint) pos += sizeof(kHintStart) - 1;
+    if (pos < row.size()) pos += std::min(utf8_length(static_cast<unsigned char>(row[pos])), row.size() - pos);
+    if (hint && row.compare(pos, sizeof(kHintEnd) - 1, kHintEnd) == 0) pos += sizeof(kHintEnd) - 1;
+    return pos;
+}
+
+// Offset of the first byte of the cell containing row[pos], or pos itself
+// if a cell starts there.
+size_t cell_start(const std::string& row, size_t pos) {
+    size_t start = 0;
+    size_t next = 0;
+    while (next < pos) {
+        start = next;
+        next = next_cell(row, next);
+    }
+    return next == pos ? pos : start;
+}
+
+// Offset of the first byte of the logical line containing pos.
+size_t line_start_of(const std::string& text, size_t pos) {
+    if (pos == 0) return 0;
+    size_t newline = text.rfind('\n', pos - 1);
+    return newline == std::string::npos ? 0 : newline + 1;
+}
+
+bool is_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+// Puts the terminal into raw mode for the lifetime of the object and turns
+// on bracketed paste. Does nothing when the descriptor is not a terminal.
+class RawMode {
+public:
+    RawMode(int in_fd, int out_fd) : in_fd_(in_fd), out_fd_(out_fd) {
+        if (!isatty(in_fd_) || tcgetattr(in_fd_, &saved_) != 0) return;
+        struct termios raw = saved_;
+        raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+        raw.c_oflag &= ~(OPOST);
+        raw.c_cflag |= CS8;
+        raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        // TCSANOW, not TCSAFLUSH: keys typed ahead of the prompt are kept.
+        if (tcsetattr(in_fd_, TCSANOW, &raw) == 0) {
+            active_ = true;
+            write_all("\x1b[?2004h");
+        }
+    }
+    ~RawMode() {
+        if (!active_) return;
+        write_all("\x1b[?2004l");
+        tcsetattr(in_fd_, TCSANOW, &saved_);
+    }
+
+private:
+    void write_all(const char* s) {
+        ssize_t unused = ::write(out_fd_, s, std::strlen(s));
+        (void)unused;
+    }
+
+    int in_fd_;
+    int out_fd_;
+    bool active_ = false;
+    struct termios saved_;
+};
+
+} // namespace
+
+LineLayout layout_line(const std::string& prompt, const std::string& text, size_t cursor, int width,
+                       const std::string& hint) {
+    if (width < 4) width = 4;
+    LineLayout layout;
+    layout.rows.emplace_back();
+    int col = 0;
+    bool wrapped = false; // The current (empty) row was opened by a soft wrap.
+
+    auto put = [&](const char* cell, size_t length, int cells) {
+        if (col + cells > width) {
+            layout.rows.emplace_back();
+            col = 0;
+        }
+        layout.rows.back().append(cell, length);
+        col += cells;
+        wrapped = false;
+        if (col == width) {
+            // Wrap eagerly so the cursor never sits in the terminal's
+            // pending-wrap column.
+            layout.rows.emplace_back();
+            col = 0;
+            wrapped = true;
+        }
+    };
+    auto put_text = [&](const std::string& s) {
+        for (size_t i = 0; i < s.size();) {
+            size_t length = std::min(utf8_length(static_cast<unsigned char>(s[i])), s.size() - i);
+            put(&s[i], length, 1);
+            i += length;
+        }
+    };
+
+    put_text(prompt);
+    for (size_t i = 0;; ) {
+        if (i == cursor) {
+            layout.cursor_row = static_cast<int>(layout.rows.size()) - 1;
+            layout.cursor_col = col;
+        }
+        if (i >= text.size()) break;
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\n') {
+            if (!wrapped) layout.rows.emplace_back();
+            col = 0;
+            put_text(kContinuationPrompt);
+            ++i;
+        } else if (c < 0x20 || c == 0x7f) {
+            char caret[2] = {'^', static_cast<char>(c == 0x7f ? '?' : c + '@')};
+            put(caret, 2, 2);
+            ++i;
+        } else {
+            size_t length = std::min(utf8_length(c), text.size() - i);
+            put(&text[i], length, 1);
+            i += length;
+        }
+    }
+    // The hint stops at the first control character so that it never adds
+    // rows of its own beyond wrapping.
+    for (size_t i = 0; i < hint.size();) {
+        unsigned char c = static_cast<unsigned char>(hint[i]);
+        if (c < 0x20 || c == 0x7f) break;
+        size_t length = std::min(utf8_length(c), hint.size() - i);
+        std::string cell = kHintStart + hint.substr(i, length) + kHintEnd;
+        put(cell.data(), cell.size(), 1);
+        i += length;
+    }
+    return layout;
+}
+
+std::string diff_layouts(const LineLayout& prev, const LineLayout& next, int width) {
+    std::string out;
+    int row = prev.cursor_row;
+    int col = prev.cursor_col;
+    // Rows below the last one we have drawn do not exist yet; reaching them
+    // needs a newline (which may scroll) rather than a cursor-down.
+    int drawn = std::max<int>(1, static_cast<int>(prev.rows.size()));
+
+    auto csi = [&](int n, char op) {
+        out += "\x1b[";
+        out += std::to_string(n);
+        out += op;
+    };
+    auto move_to = [&](int r, int c) {
+        if (r > row) {
+            int existing = std::min(r, drawn - 1) - row;
+            if (existing > 0) {
+                csi(existing, 'B');
+                row += existing;
+            }
+            while (row < r) {
+                out += "\r\n";
+                ++row;
+                col = 0;
+            }
+            drawn = std::max(drawn, r + 1);
+        } else if (r < row) {
+            csi(row - r, 'A');
+            row = r;
+        }
+        if (c == col) return;
+        if (c == 0) {
+            out += '\r';
+        } else if (c > col) {
+            csi(c - col, 'C');
+        } else {
+            csi(col - c, 'D');
+        }
+        col = c;
+    };
+
+    static const std::string empty;
+    for (size_t r = 0; r < next.rows.size(); ++r) {
+        const std::string& now = next.rows[r];
+        bool existed = r < prev.rows.size();
+        const std::string& before = existed ? prev.rows[r] : empty;
+        if (existed && now == before) continue;
+
+        size_t same = 0;
+        size_t limit = std::min(now.size(), before.size());
+        while (same < limit && now[same] == before[same]) ++same;
+        same = std::min(cell_start(now, same), cell_start(before, same));
+
+        int start = cell_count(now, same);
+        int now_cells = cell_count(now, now.size());
+        if (same == now.size() && same == before.size()) continue;
+        move_to(static_cast<int>(r), start);
+        out.append(now, same, std::string::npos);
+        col = now_cells;
+        if (cell_count(before, before.size()) > now_cells && now_cells < width) {
+            out += "\x1b[K";
+        }
+        if (col >= width) {
+            out += '\r'; // Leave the pending-wrap state at a known column.
+            col = 0;
+        }
+    }
+
+    if (prev.rows.size() > next.rows.size()) {
+        move_to(static_cast<int>(next.rows.size()), 0);
+        out += "\x1b[J";
+    }
+    move_to(next.cursor_row, next.cursor_col);
+    return out;
+}
+
+LineEditor::LineEditor(int in_fd, int out_fd) : in_fd_(in_fd), out_fd_(out_fd) {}
+
+int LineEditor::terminal_width() const {
+    if (fixed_width_ > 0) return fixed_width_;
+    struct winsize ws;
+    if (ioctl(out_fd_, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    return 80;
+}
+
+void LineEditor::write_out(const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(out_fd_, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+bool LineEditor::read_line(const std::string& prompt, std::string& line) {
+    RawMode raw(in_fd_, out_fd_);
+
+    prompt_ = prompt;
+    text_.clear();
+    cursor_ = 0;
+    last_was_kill_ = false;
+    done_ = false;
+    eof_ = false;
+    in_paste_ = false;
+    paste_.clear();
+    mode_ = Mode::Edit;
+    saved_text_.clear();
+    if (history_) {
+        history_->refresh();
+        history_pos_ = history_->end_id();
+    }
+    screen_ = LineLayout();
+    screen_width_ = terminal_width();
+    refresh();
+
+    // Input read along with the previous line, such as the rest of a
+    // pasted block, comes first.
+    if (!pending_.empty()) {
+        process_input();
+        if (!done_) refresh();
+    }
+    char buf[4096];
+    while (!done_) {
+        ssize_t n = ::read(in_fd_, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (!text_.empty()) break; // Input ended mid-line: accept what we have.
+            eof_ = true;
+            break;
+        }
+        pending_.append(buf, static_cast<size_t>(n));
+        process_input();
+        // One redraw per batch of input, and none at all while a paste is
+        // still streaming in.
+        if (!done_ && !in_paste_) refresh();
+    }
+
+    if (in_paste_) insert(paste_);
+    if (mode_ == Mode::Search) leave_search(true);
+    cursor_ = text_.size();
+    refresh();
+    write_out("\r\n");
+    screen_ = LineLayout();
+    line = text_;
+    return !eof_;
+}
+
+void LineEditor::process_input() {
+    size_t pos = 0;
+    while (pos < pending_.size() && !done_) {
+        if (in_paste_) {
+            size_t end = pending_.find(kPasteEnd, pos);
+            if (end == std::string::npos) {
+                // Keep a possible partial end marker for the next read.
+                size_t keep = std::min(pending_.size() - pos, sizeof(kPasteEnd) - 2);
+                paste_.append(pending_, pos, pending_.size() - pos - keep);
+                pos = pending_.size() - keep;
+                break;
+            }
+            paste_.append(pending_, pos, end - pos);
+            pos = end + sizeof(kPasteEnd) - 1;
+            in_paste_ = false;
+            std::replace(paste_.begin(), paste_.end(), '\r', '\n');
+            if (mode_ == Mode::Search) leave_search(true);
+            insert(paste_);
+            paste_.clear();
+            continue;
+        }
+
+        unsigned char c = static_cast<unsigned char>(pending_[pos]);
+        if (c >= 0x20 && c != 0x7f) {
+            // Consume the whole run of printable bytes at once so that pastes
+            // without bracketed-paste support are still a single insertion.
+            size_t end = pos;
+            while (end < pending_.size()) {
+                unsigned char b = static_cast<unsigned char>(pending_[end]);
+                if (b < 0x20 || b == 0x7f) break;
+                ++end;
+            }
+            std::string run = pending_.substr(pos, end - pos);
+            pos = end;
+            if (mode_ == Mode::Search) {
+                search_query_ += run;
+                search_update(search_match_ + 1); // The current match may still fit.
+            } else {
+                insert(run);
+            }
+            continue;
+        }
+
+        int key = kKeyNone;
+        size_t used = parse_key(pos, true, key);
+        if (used == 0) {
+            // Incomplete escape sequence: wait briefly for the rest of it,
+            // otherwise treat the ESC as a key press of its own.
+            struct pollfd pfd = {in_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 50) > 0) break;
+            used = parse_key(pos, false, key);
+        }
+        pos += used;
+        if (key == kKeyPasteStart) {
+            in_paste_ = true;
+        } else if (key != kKeyNone) {
+            if (mode_ == Mode::Search) {
+                handle_search_key(key);
+            } else {
+                handle_key(key);
+            }
+        }
+    }
+    pending_.erase(0, pos);
+}
+
+// Decodes one key at pending_[pos]. Returns the number of bytes consumed, or
+// 0 if allow_partial is set and the escape sequence is not complete yet.
+size_t LineEditor::parse_key(size_t pos, bool allow_partial, int& key) {
+    unsigned char c = static_cast<unsigned char>(pending_[pos]);
+    if (c != 0x1b) {
+        key = c;
+        return 1;
+    }
+    size_t avail = pending_.size() - pos;
+    if (avail < 2) {
+        key = kKeyEscape;
+        return allow_partial ? 0 : 1;
+    }
+    char next = pending_[pos + 1];
+    if (next == '\r' || next == '\n') { key = kKeyAltEnter; return 2; }
+    if (next == 'b') { key = kKeyWordLeft; return 2; }
+    if (next == 'f') { key = kKeyWordRight; return 2; }
+    if (next == 'd') { key = kKeyKillWordForward; return 2; }
+    if (next == 'O') {
+        if (avail < 3) { key = kKeyEscape; return allow_partial ? 0 : 1; }
+        switch (pending_[pos + 2]) {
+            case 'H': key = kKeyHome; break;
+            case 'F': key = kKeyEnd; break;
+            case 'C': key = kKeyRight; break;
+            case 'D': key = kKeyLeft; break;
+            default: key = kKeyNone; break;
+        }
+        return 3;
+    }
+    if (next != '[') {
+        key = kKeyEscape;
+        return 1;
+    }
+
+    // CSI: parameter bytes, then one final byte in 0x40..0x7e.
+    size_t end = pos + 2;
+    while (end < pending_.size() &&
+           !(pending_[end] >= 0x40 && pending_[end] <= 0x7e)) {
+        ++end;
+    }
+    if (end >= pending_.size()) {
+        key = kKeyEscape;
+        return allow_partial ? 0 : 1;
+    }
+    std::string params = pending_.substr(pos + 2, end - pos - 2);
+    char final_byte = pending_[end];
+    size_t used = end - pos + 1;
+    bool ctrl_mod = params.find(";5") != std::string::npos;
+    switch (final_byte) {
+        case 'A': key = kKeyUp; break;
+        case 'B': key = kKeyDown; break;
+        case 'C': key = ctrl_mod ? kKeyWordRight : kKeyRight; break;
+        case 'D': key = ctrl_mod ? kKeyWordLeft : kKeyLeft; break;
+        case 'H': key = kKeyHome; break;
+        case 'F': key = kKeyEnd; break;
+        case '~':
+            if (params == "1" || params == "7") key = kKeyHome;
+            else if (params == "4" || params == "8") key = kKeyEnd;
+            else if (params == "3") key = kKeyDelete;
+            else if (params == "200") key = kKeyPasteStart;
+            else key = kKeyNone;
+            break;
+        default: key = kKeyNone; break;
+    }
+    return used;
+}
+
+void LineEditor::insert(const std::string& text) {
+    text_.insert(cursor_, text);
+    cursor_ += text.size();
+    last_was_kill_ = false;
+}
+
+// Removes [from, to) into the kill buffer. Consecutive kills accumulate, so
+// a series of Ctrl-W presses can be yanked back as one piece.
+void LineEditor::kill(size_t from, size_t to, bool prepend) {
+    if (from >= to) return;
+    std::string killed = text_.substr(from, to - from);
+    if (!last_was_kill_) kill_buffer_.clear();
+    kill_buffer_ = prepend ? killed + kill_buffer_ : kill_buffer_ + killed;
+    text_.erase(from, to - from);
+    cursor_ = from;
+    last_was_kill_ = true;
+}
+
+void LineEditor::handle_key(int key) {
+    // At the end of the line, moving right takes the suggestion instead.
+    if (suggester_ && cursor_ == text_.size() &&
+        (key == ctrl('F') || key == kKeyRight || key == ctrl('E') || key == kKeyEnd || key == kKeyWordRight)) {
+        std::string rest = hint();
+        if (!rest.empty()) {
+            size_t length = rest.size();
+            if (key == kKeyWordRight) {
+                length = 0;
+                while (length < rest.size() && !is_word_char(rest[length])) ++length;
+                while (length < rest.size() && is_word_char(rest[length])) ++length;
+            }
+            insert(rest.substr(0, length));
+            return;
+        }
+    }
+
+    bool killed = false;
+    size_t line_start = line_start_of(text_, cursor_);
+    size_t line_end = text_.find('\n', cursor_);
+    if (line_end == std::string::npos) line_end = text_.size();
+
+    switch (key) {
+        case '\r':
+        case '\n':
+            if (cursor_ == text_.size() && !text_.empty() && text_.back() == '\\') {
+                // Trailing backslash continues the command on a new line.
+                text_.back() = '\n';
+                break;
+            }
+            done_ = true;
+            break;
+        case kKeyAltEnter:
+            insert("\n");
+            break;
+        case ctrl('A'):
+        case kKeyHome:
+            cursor_ = line_start;
+            break;
+        case ctrl('E'):
+        case kKeyEnd:
+            cursor_ = line_end;
+            break;
+        case ctrl('B'):
+        case kKeyLeft:
+            while (cursor_ > 0) {
+                --cursor_;
+                if (!is_continuation(static_cast<unsigned char>(text_[cursor_]))) break;
+            }
+            break;
+        case ctrl('F'):
+        case kKeyRight:
+            if (cursor_ < text_.size()) {
+                cursor_ += std::min(utf8_length(static_cast<unsigned char>(text_[cursor_])), text_.size() - cursor_);
+            }
+            break;
+        case kKeyWordLeft:
+            while (cursor_ > 0 && !is_word_char(text_[cursor_ - 1])) --cursor_;
+            while (cursor_ > 0 && is_word_char(text_[cursor_ - 1])) --cursor_;
+            break;
+        case kKeyWordRight:
+            while (cursor_ < text_.size() && !is_word_char(text_[cursor_])) ++cursor_;
+            while (cursor_ < text_.size() && is_word_char(text_[cursor_])) ++cursor_;
+            break;
+        case kKeyUp:
+            move_vertical(-1);
+            break;
+        case kKeyDown:
+            move_vertical(1);
+            break;
+        case ctrl('P'):
+            history_step(-1);
+            break;
+        case ctrl('N'):
+            history_step(1);
+            break;
+        case 0x7f:
+        case ctrl('H'):
+            if (cursor_ > 0) {
+                size_t from = cursor_ - 1;
+                while (from > 0 && is_continuation(static_cast<unsigned char>(text_[from]))) --from;
+                text_.erase(from, cursor_ - from);
+                cursor_ = from;
+            }
+            break;
+        case ctrl('D'):
+            if (text_.empty()) {
+                eof_ = true;
+                done_ = true;
+                break;
+            }
+            [[fallthrough]];
+        case kKeyDelete:
+            if (cursor_ < text_.size()) {
+                text_.erase(cursor_, std::min(utf8_length(static_cast<unsigned char>(text_[cursor_])),
+                                              text_.size() - cursor_));
+            }
+            break;
+        case ctrl('K'):
+            kill(cursor_, line_end == cursor_ && line_end < text_.size() ? line_end + 1 : line_end, false);
+            killed = true;
+            break;
+        case ctrl('U'):
+            kill(line_start, cursor_, true);
+            killed = true;
+            break;
+        case ctrl('W'): {
+            size_t from = cursor_;
+            while (from > 0 && std::isspace(static_cast<unsigned char>(text_[from - 1]))) --from;
+            while (from > 0 && !std::isspace(static_cast<unsigned char>(text_[from - 1]))) --from;
+            kill(from, cursor_, true);
+            killed = true;
+            break;
+        }
+        case kKeyKillWordForward: {
+            size_t to = cursor_;
+            while (to < text_.size() && !is_word_char(text_[to])) ++to;
+            while (to < text_.size() && is_word_char(text_[to])) ++to;
+            kill(cursor_, to, false);
+            killed = true;
+            break;
+        }
+        case ctrl('Y'):
+            insert(kill_buffer_);
+            break;
+        case ctrl('C'):
+            write_out("^C");
+            text_.clear();
+            cursor_ = 0;
+            done_ = true;
+            break;
+        case ctrl('L'):
+            write_out("\x1b[H\x1b[2J");
+            screen_ = LineLayout();
+            break;
+        case ctrl('R'):
+            if (history_) {
+                history_->refresh();
+                mode_ = Mode::Search;
+                saved_text_ = text_;
+                search_query_.clear();
+                search_failed_ = false;
+                search_match_ = history_->end_id();
+            }
+            break;
+        case '\t':
+            insert("\t");
+            break;
+        default:
+            break;
+    }
+    last_was_kill_ = killed;
+}
+
+void LineEditor::move_vertical(int direction) {
+    size_t line_start = line_start_of(text_, cursor_);
+    size_t column = cursor_ - line_start;
+
+    if (direction < 0) {
+        if (line_start == 0) {
+            history_step(-1);
+            return;
+        }
+        size_t prev_start = line_start_of(text_, line_start - 1);
+        cursor_ = std::min(prev_start + column, line_start - 1);
+    } else {
+        size_t line_end = text_.find('\n', cursor_);
+        if (line_end == std::string::npos) {
+            history_step(1);
+            return;
+        }
+        size_t next_end = text_.find('\n', line_end + 1);
+        if (next_end == std::string::npos) next_end = text_.size();
+        cursor_ = std::min(line_end + 1 + column, next_end);
+    }
+    while (cursor_ > 0 && cursor_ < text_.size() && is_continuation(static_cast<unsigned char>(text_[cursor_]))) {
+        --cursor_;
+    }
+}
+
+void LineEditor::history_step(int direction) {
+    if (!history_) return;
+    uint32_t end = history_->end_id();
+    if (direction < 0) {
+        if (history_pos_ <= history_->first_id()) return;
+        if (history_pos_ >= end) saved_text_ = text_;
+        --history_pos_;
+    } else {
+        if (history_pos_ >= end) return;
+        ++history_pos_;
+    }
+    Neurodeck::HistoryStore::Entry entry;
+    if (history_pos_ < end && history_->get(history_pos_, entry)) {
+        text_ = entry.command;
+    } else {
+        history_pos_ = end;
+        text_ = saved_text_;
+    }
+    cursor_ = text_.size();
+}
+
+void LineEditor::search_update(uint32_t before_id) {
+    Neurodeck::HistoryStore::Entry entry;
+    if (history_->find_previous(search_query_, before_id, entry)) {
+        search_match_ = entry.id;
+        search_failed_ = false;
+        text_ = entry.command;
+        size_t at = text_.find(search_query_);
+        cursor_ = at == std::string::npos ? 0 : at;
+    } else {
+        search_failed_ = true;
+    }
+}
+
+void LineEditor::leave_search(bool keep_match) {
+    mode_ = Mode::Edit;
+    if (!keep_match) {
+        text_ = saved_text_;
+        cursor_ = text_.size();
+    }
+}
+
+void LineEditor::handle_search_key(int key) {
+    switch (key) {
+        case ctrl('R'):
+            if (search_failed_) break;
+            search_update(search_match_);
+            break;
+        case 0x7f:
+        case ctrl('H'):
+            if (!search_query_.empty()) {
+                size_t from = search_query_.size() - 1;
+                while (from > 0 && is_continuation(static_cast<unsigned char>(search_query_[from]))) --from;
+                search_query_.erase(from);
+                text_ = saved_text_;
+                cursor_ = text_.size();
+                search_update(history_->end_id());
+            }
+            break;
+        case ctrl('G'):
+        case ctrl('C'):
+            leave_search(false);
+            break;
+        case kKeyEscape:
+            leave_search(true);
+            break;
+        default:
+            // Any other key ends the search on the current match and then
+            // takes its normal effect (Enter runs it, arrows start editing).
+            leave_search(true);
+            handle_key(key);
+            break;
+    }
+}
+
+// The untyped rest of the suggested line, while the cursor is at the end.
+std::string LineEditor::hint() const {
+    if (!suggester_ || mode_ != Mode::Edit || done_ || cursor_ != text_.size()) return std::string();
+    std::string line = suggester_(text_);
+    if (line.size() <= text_.size() || line.compare(0, text_.size(), text_) != 0) return std::string();
+    return line.substr(text_.size());
+}
+
+void LineEditor::refresh(bool full) {
+    int width = terminal_width();
+    if (width != screen_width_) {
+        full = true;
+        screen_width_ = width;
+    }
+
+    std::string out;
+    if (full && !screen_.rows.empty()) {
+        if (screen_.cursor_row > 0) out += "\x1b[" + std::to_string(screen_.cursor_row) + "A";
+        out += "\r\x1b[J";
+        screen_ = LineLayout();
+    }
+
+    LineLayout next;
+    if (mode_ == Mode::Search) {
+        std::string prompt = search_failed_ ? "(failed reverse-i-search)`" : "(reverse-i-search)`";
+        prompt += search_query_ + "': ";
+        next = layout_line(prompt, text_, cursor_, width);
+    } else {
+        next = layout_line(prompt_, text_, cursor_, width, hint());
+    }
+    out += diff_layouts(screen_, next, width);
+    screen_ = std::move(next);
+    if (!out.empty()) {
+        write_out(out);
+        ++redraws_;
+    }
+}
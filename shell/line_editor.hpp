@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Neurodeck { class HistoryStore; }
+
+// Screen image of the prompt plus the line being edited, split into
+// terminal rows. Each cell holds one UTF-8 code point.
+struct LineLayout {
+    std::vector<std::string> rows;
+    int cursor_row = 0;
+    int cursor_col = 0;
+};
+
+// Lays out prompt + text for a terminal `width` columns wide. Embedded
+// newlines start a new row behind a "> " continuation prompt; other control
+// characters are shown in caret notation. `cursor` is a byte offset into text.
+// A non-empty `hint` follows the text in grey, each of its cells wrapped in
+// its own colour escapes so that any suffix of a row can be redrawn alone.
+LineLayout layout_line(const std::string& prompt, const std::string& text, size_t cursor, int width,
+                       const std::string& hint = std::string());
+
+// Returns the escape sequence stream that turns `prev` (currently on screen,
+// with the terminal cursor at prev's cursor) into `next`. Unchanged rows and
+// the unchanged prefix of changed rows are skipped entirely.
+std::string diff_layouts(const LineLayout& prev, const LineLayout& next, int width);
+
+// Interactive line editor for a terminal in raw mode: cursor motion, kill and
+// yank, multi-line input, bracketed paste, history navigation, Ctrl-R
+// reverse search and inline suggestions. All input that is already available is processed before
+// the screen is updated, and each update is a single write() of the cells
+// that changed.
+class LineEditor {
+public:
+    explicit LineEditor(int in_fd = 0, int out_fd = 1);
+
+    // Reads one line. Returns false on end of input (Ctrl-D on an empty line).
+    bool read_line(const std::string& prompt, std::string& line);
+
+    // Enables Up/Down history navigation and Ctrl-R search.
+    void set_history(Neurodeck::HistoryStore* history) { history_ = history; }
+
+    // Enables inline suggestions. `suggester` maps the text typed so far to
+    // a whole line starting with it, or "" for none. While the cursor is at
+    // the end, the rest of that line is shown after it; Right, End, Ctrl-F
+    // or Ctrl-E accept it and Alt-F accepts one word of it.
+    void set_suggester(std::function<std::string(const std::string&)> suggester) {
+        suggester_ = std::move(suggester);
+    }
+
+    // Overrides the terminal width (normally queried with TIOCGWINSZ).
+    void set_width(int columns) { fixed_width_ = columns; }
+
+    // Number of screen updates issued so far.
+    size_t redraw_count() const { return redraws_; }
+
+private:
+    enum class Mode { Edit, Search };
+
+    void process_input();
+    size_t parse_key(size_t pos, bool allow_partial, int& key);
+    void handle_key(int key);
+    void handle_search_key(int key);
+    void insert(const std::string& text);
+    void kill(size_t from, size_t to, bool prepend);
+    void move_vertical(int direction);
+    void history_step(int direction);
+    void search_update(uint32_t before_id);
+    void leave_search(bool keep_match);
+    std::string hint() const;
+    void refresh(bool full = false);
+    void write_out(const std::string& data);
+    int terminal_width() const;
+
+    int in_fd_;
+    int out_fd_;
+    int fixed_width_ = 0;
+    Neurodeck::HistoryStore* history_ = nullptr;
+    std::function<std::string(const std::string&)> suggester_;
+
+    std::string prompt_;
+    std::string text_;
+    size_t cursor_ = 0;
+    std::string kill_buffer_;
+    bool last_was_kill_ = false;
+    bool done_ = false;
+    bool eof_ = false;
+
+    std::string pending_;      // Raw input bytes not yet turned into keys.
+    bool in_paste_ = false;
+    std::string paste_;
+
+    Mode mode_ = Mode::Edit;
+    std::string search_query_;
+    uint32_t search_match_ = 0;
+    bool search_failed_ = false;
+    std::string saved_text_;   // Line being edited before history/search took over.
+    uint32_t history_pos_ = 0;
+
+    LineLayout screen_;        // What is currently displayed.
+    int screen_width_ = 0;
+    size_t redraws_ = 0;
+};
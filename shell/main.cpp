@@ -3,35 +3,185 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <unordered_map>
 #include <memory>
+#include <unistd.h> // For getcwd(), isatty()
 #include "command.hpp"
 #include "tokenize.hpp"
+#include "environment.hpp"
+#include "glob.hpp"
+#include "history_store.hpp"
+#include "suggestion_model.hpp"
+#include "line_editor.hpp"
+#include "command_stats.hpp"
+#ifdef NEURODECK_ALLOC_TRACKING
+#include <fstream>
+#include "alloc_tracker.hpp"
+#endif
 
 // ------- registry builder (declared in command.cpp) -------------------------
 std::unordered_map<std::string, std::unique_ptr<Command>> build_registry();
 
+// History is shared by all sessions; NEURODECK_HISTORY overrides the location.
+static std::string history_path() {
+    if (const char* path = std::getenv("NEURODECK_HISTORY")) return path;
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.neurodeck_history";
+    return "";
+}
 
+static std::string current_directory() {
+    char buf[4096];
+    return getcwd(buf, sizeof(buf)) ? std::string(buf) : std::string();
+}
 
 int main(){
     auto commands = build_registry();
+    Environment& env = Environment::instance();
+    env = Environment::from_process();
+    env.install();
+    Neurodeck::HistoryStore history;
+    std::string history_file = history_path();
+    if(!history_file.empty() && !history.open(history_file)){
+        std::cerr << "Warning: could not open history file " << history_file << "\n";
+    }
+
+    // Suggestions are learned from history and kept next to it. A new model
+    // starts from the history that already exists.
+    Neurodeck::SuggestionModel suggestions;
+    Neurodeck::SuggestionModel::Context context;
+    context.cwd = current_directory();
+    if(history.is_open() && suggestions.open(history_file + ".model")){
+        if(suggestions.observed() == 0 && history.size() > 0) suggestions.rebuild(history);
+    }
+
+    // Interactive sessions get the line editor; pipes and scripts keep the
+    // plain line-at-a-time reader.
+    std::unique_ptr<LineEditor> editor;
+    if(isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)){
+        editor = std::make_unique<LineEditor>();
+        if(history.is_open()) editor->set_history(&history);
+        if(suggestions.is_open()){
+            editor->set_suggester([&](const std::string& typed){
+                auto best = suggestions.suggest(context, typed, 1);
+                return best.empty() ? std::string() : best[0].text;
+            });
+        }
+    }
+    auto read_input = [&](std::string& line) -> bool {
+        if(!editor){
+            std::cout << "neurodeck> ";
+            return static_cast<bool>(std::getline(std::cin, line));
+        }
+        std::cout.flush();
+        return editor->read_line("neurodeck> ", line);
+    };
+
     std::cout << "Welcome to Neurodeck shell! Type 'help' for a list of commands.\n";
     std::string input;
 
+    // Every line that did something is recorded in history and taught to
+    // the suggestion model, which also tracks what came before it.
+    auto remember = [&](int status, int64_t elapsed){
+        history.append(input, context.cwd, status, elapsed);
+        suggestions.observe(context, input, status);
+        if(suggestions.full()){
+            history.refresh();
+            suggestions.rebuild(history);
+        }
+        context.before_previous = std::move(context.previous);
+        context.previous = input;
+        context.previous_status = status;
+        context.cwd = current_directory();
+    };
+
     bool running = true;
-    while(running && std::cout<< "neurodeck> " && std::getline(std::cin, input)){
-        auto tokens = tokenize(input);
-        if(tokens.empty()) continue;
+    while(running && read_input(input)){
+#ifdef NEURODECK_ALLOC_TRACKING
+        CommandLine line;
+        {
+            Neurodeck::AllocScope alloc_scope("tokenize");
+            line = lex_command_line(input, env);
+        }
+#else
+        CommandLine line = lex_command_line(input, env);
+#endif
+        {
+            // A fresh expander per line: directories are read once per
+            // command, never served stale from an earlier one.
+            GlobExpander globs;
+            expand_globs(line, globs);
+        }
+        const std::vector<std::string>& tokens = line.words;
+        if(tokens.empty()){
+            if(line.assignments.empty()) continue;
+            // A line of assignments only sets shell variables.
+            for(const auto& assignment : line.assignments) env.set(assignment.first, assignment.second);
+            env.set("?", "0");
+            env.install();
+            remember(0, 0);
+            continue;
+        }
+        // NAME=value words before a command are exported to it alone.
+        if(!line.assignments.empty()){
+            Environment scoped = env;
+            for(const auto& assignment : line.assignments) scoped.set_exported(assignment.first, assignment.second);
+            scoped.install();
+        }
 
-        
+        // Dispatch is timed in two parts (registry lookup, command run) and
+        // the bytes the command prints are counted for `stats`.
+        auto started = std::chrono::steady_clock::now();
+        int status = 0;
         auto it = commands.find(tokens[0]);
+        auto looked_up = std::chrono::steady_clock::now();
+        CountingStreambuf counter(std::cout.rdbuf());
+        std::streambuf* original = std::cout.rdbuf(&counter);
         if(it != commands.end()){
+#ifdef NEURODECK_ALLOC_TRACKING
+            Neurodeck::AllocScope alloc_scope(it->first.c_str());
+#endif
             if(tokens[0] == "exit") running = false;
             else it->second->run(tokens);
         } else {
             std::cout << "Unknown command: " << tokens[0] << "\n";
+            status = 127;
         }
+        std::cout.rdbuf(original);
+        env.set("?", std::to_string(status));
+        env.install();
+        auto finished = std::chrono::steady_clock::now();
+        CommandStats::instance().record(
+            it != commands.end() ? it->first : CommandStats::kUnknownCommand,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(looked_up - started).count(),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(finished - looked_up).count(),
+            counter.count());
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count();
+#ifdef NEURODECK_ALLOC_TRACKING
+        Neurodeck::AllocScope alloc_scope("history");
+#endif
+        remember(status, elapsed);
     }
     std::cout << "Exiting Neurodeck shell. Goodbye!\n";
+
+    // NEURODECK_STATS_FILE=<path> keeps a JSON copy of `stats --json` for
+    // sessions that are not watched interactively.
+    if(const char* stats_file = std::getenv("NEURODECK_STATS_FILE")){
+        if(!CommandStats::instance().dump_to_file(stats_file)){
+            std::cerr << "Warning: could not write statistics to " << stats_file << "\n";
+        }
+    }
+
+#ifdef NEURODECK_ALLOC_TRACKING
+    // Allocation counts per command (and for tokenizing/history), written to
+    // NEURODECK_ALLOC_REPORT or stderr.
+    if(const char* report_file = std::getenv("NEURODECK_ALLOC_REPORT")){
+        std::ofstream report(report_file);
+        Neurodeck::AllocTracker::write_report(report);
+    } else {
+        Neurodeck::AllocTracker::write_report(std::cerr);
+    }
+#endif
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,437 @@
+#include "pager.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+// Backward search reads the mapping in windows of this size.
+const uint64_t kSearchChunk = 1 << 20;
+// Wake-up interval for index progress and file growth while idle.
+const int kPollIntervalMs = 200;
+const int kTabWidth = 8;
+
+constexpr int ctrl(char c) { return c & 0x1f; }
+
+// Raw keyboard input (no echo, no line buffering) for the pager's lifetime.
+class RawMode {
+public:
+    explicit RawMode(int fd) : fd_(fd) {
+        if (!isatty(fd_) || tcgetattr(fd_, &saved_) != 0) return;
+        struct termios raw = saved_;
+        raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+        raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        active_ = tcsetattr(fd_, TCSANOW, &raw) == 0;
+    }
+    ~RawMode() {
+        if (active_) tcsetattr(fd_, TCSANOW, &saved_);
+    }
+
+private:
+    int fd_;
+    bool active_ = false;
+    struct termios saved_;
+};
+
+// Decodes one key from `input` at `pos`. Returns the bytes used, or 0 if
+// the rest of `input` holds only the start of an escape sequence.
+size_t parse_key(const std::string& input, size_t pos, int& key) {
+    unsigned char c = static_cast<unsigned char>(input[pos]);
+    if (c != 0x1b) {
+        key = c;
+        return 1;
+    }
+    if (pos + 1 == input.size()) {
+        key = Pager::kKeyEscape;
+        return 1;
+    }
+    if (input[pos + 1] != '[' && input[pos + 1] != 'O') {
+        key = Pager::kKeyEscape;
+        return 1;
+    }
+    size_t end = pos + 2;
+    while (end < input.size() && !(input[end] >= 0x40 && input[end] <= 0x7e)) ++end;
+    if (end == input.size()) return 0;
+    std::string params = input.substr(pos + 2, end - pos - 2);
+    switch (input[end]) {
+    case 'A': key = Pager::kKeyUp; break;
+    case 'B': key = Pager::kKeyDown; break;
+    case 'H': key = Pager::kKeyHome; break;
+    case 'F': key = Pager::kKeyEnd; break;
+    case '~':
+        if (params == "5") key = Pager::kKeyPageUp;
+        else if (params == "6") key = Pager::kKeyPageDown;
+        else if (params == "1" || params == "7") key = Pager::kKeyHome;
+        else if (params == "4" || params == "8") key = Pager::kKeyEnd;
+        else key = -1;
+        break;
+    default: key = -1; break;
+    }
+    return end + 1 - pos;
+}
+
+// Renders up to `width` cells of one file line: tabs expanded, control
+// characters in caret notation, a trailing CR dropped.
+std::string display_text(const char* line, size_t length, int width) {
+    if (length > 0 && line[length - 1] == '\r') --length;
+    std::string out;
+    int cells = 0;
+    for (size_t i = 0; i < length && cells < width; ++i) {
+        unsigned char c = static_cast<unsigned char>(line[i]);
+        if (c == '\t') {
+            int spaces = kTabWidth - cells % kTabWidth;
+            out.append(static_cast<size_t>(spaces), ' ');
+            cells += spaces;
+        } else if (c < 0x20 || c == 0x7f) {
+            out += '^';
+            out += static_cast<char>(c ^ 0x40);
+            cells += 2;
+        } else {
+            out += static_cast<char>(c);
+            if ((c & 0xc0) != 0x80) ++cells;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+Pager::Pager(int in_fd, int out_fd) : in_fd_(in_fd), out_fd_(out_fd), screen_(out_fd, 80, 24) {}
+
+bool Pager::open(const std::string& filename) {
+    if (!file_.open(filename)) {
+        return false;
+    }
+    filename_ = filename;
+    top_offset_ = 0;
+    top_line_ = 0;
+    top_line_known_ = true;
+    pending_jump_ = kNoJump;
+    index_.start(filename, true);
+    return true;
+}
+
+void Pager::set_size(int width, int height) {
+    if (width != screen_.width() || height != screen_.height()) {
+        screen_.resize(width, height);
+    }
+}
+
+uint64_t Pager::next_line_start(uint64_t offset) const {
+    if (offset >= file_.size()) return file_.size();
+    const char* base = file_.data();
+    const void* newline = std::memchr(base + offset, '\n', file_.size() - offset);
+    return newline ? static_cast<uint64_t>(static_cast<const char*>(newline) - base) + 1 : file_.size();
+}
+
+uint64_t Pager::previous_line_start(uint64_t offset) const {
+    if (offset == 0) return 0;
+    // offset - 1 is the newline ending the previous line; look before it.
+    const char* base = file_.data();
+    const void* newline = offset > 1 ? memrchr(base, '\n', offset - 1) : nullptr;
+    return newline ? static_cast<uint64_t>(static_cast<const char*>(newline) - base) + 1 : 0;
+}
+
+uint64_t Pager::last_page_offset() const {
+    uint64_t end = file_.size();
+    if (end == 0) return 0;
+    if (file_.data()[end - 1] == '\n') --end; // The final newline does not start a line.
+    const char* base = file_.data();
+    uint64_t start = 0;
+    for (int row = 0; row < content_rows(); ++row) {
+        const void* newline = end > 0 ? memrchr(base, '\n', end) : nullptr;
+        start = newline ? static_cast<uint64_t>(static_cast<const char*>(newline) - base) + 1 : 0;
+        if (start == 0) break;
+        end = start - 1;
+    }
+    return start;
+}
+
+bool Pager::top_line(uint64_t& line) {
+    if (!top_line_known_) {
+        uint64_t checkpoint_line, checkpoint_offset;
+        if (!index_.seek_offset(top_offset_, checkpoint_line, checkpoint_offset)) {
+            return false;
+        }
+        // At most stride - 1 newlines separate the checkpoint from the top.
+        uint64_t count = 0;
+        const char* p = file_.data() + checkpoint_offset;
+        const char* end = file_.data() + top_offset_;
+        while (p < end && (p = static_cast<const char*>(std::memchr(p, '\n', end - p)))) {
+            ++count;
+            ++p;
+        }
+        top_line_ = checkpoint_line + count;
+        top_line_known_ = true;
+    }
+    line = top_line_;
+    return true;
+}
+
+void Pager::scroll(int64_t lines) {
+    if (lines > 0) {
+        uint64_t limit = last_page_offset();
+        for (int64_t i = 0; i < lines && top_offset_ < limit; ++i) {
+            top_offset_ = next_line_start(top_offset_);
+            ++top_line_;
+        }
+    } else {
+        follow_ = false;
+        for (int64_t i = 0; i > lines && top_offset_ > 0; --i) {
+            top_offset_ = previous_line_start(top_offset_);
+            --top_line_;
+        }
+    }
+}
+
+void Pager::jump_to_end() {
+    top_offset_ = last_page_offset();
+    top_line_known_ = false;
+}
+
+void Pager::jump_to_line(uint64_t line) {
+    uint64_t checkpoint_line, checkpoint_offset;
+    if (!index_.seek_line(line, checkpoint_line, checkpoint_offset)) {
+        pending_jump_ = line;
+        message_ = "Indexing...";
+        return;
+    }
+    pending_jump_ = kNoJump;
+    follow_ = false;
+    uint64_t offset = std::min(checkpoint_offset, file_.size());
+    uint64_t current = checkpoint_line;
+    uint64_t limit = last_page_offset();
+    while (current < line && offset < limit) {
+        offset = next_line_start(offset);
+        ++current;
+    }
+    top_offset_ = std::min(offset, limit);
+    top_line_ = current;
+    top_line_known_ = top_offset_ == offset;
+}
+
+bool Pager::try_pending_jump() {
+    if (pending_jump_ == kNoJump) return false;
+    uint64_t checkpoint_line, checkpoint_offset;
+    if (!index_.seek_line(pending_jump_, checkpoint_line, checkpoint_offset)) return false;
+    jump_to_line(pending_jump_);
+    message_.clear();
+    return true;
+}
+
+bool Pager::search(const std::string& pattern, bool forward) {
+    if (pattern.empty() || file_.size() == 0) return false;
+    const char* base = file_.data();
+    const char* found = nullptr;
+    if (forward) {
+        uint64_t start = next_line_start(top_offset_);
+        if (start < file_.size()) {
+            found = static_cast<const char*>(
+                memmem(base + start, file_.size() - start, pattern.data(), pattern.size()));
+        }
+    } else {
+        // Scan windows backwards from the top line, keeping the last match
+        // that starts before it.
+        uint64_t high = top_offset_;
+        while (!found && high > 0) {
+            uint64_t low = high > kSearchChunk ? high - kSearchChunk : 0;
+            uint64_t window_end = std::min<uint64_t>(high + pattern.size() - 1, file_.size());
+            const char* p = base + low;
+            while (const char* q = static_cast<const char*>(
+                       memmem(p, static_cast<size_t>(base + window_end - p), pattern.data(), pattern.size()))) {
+                if (q >= base + high) break;
+                found = q;
+                p = q + 1;
+            }
+            high = low;
+        }
+    }
+    if (!found) {
+        message_ = "Pattern not found";
+        return false;
+    }
+    follow_ = false;
+    uint64_t offset = static_cast<uint64_t>(found - base);
+    const void* newline = offset > 0 ? memrchr(base, '\n', offset) : nullptr;
+    top_offset_ = newline ? static_cast<uint64_t>(static_cast<const char*>(newline) - base) + 1 : 0;
+    top_line_known_ = false;
+    return true;
+}
+
+bool Pager::poll_file() {
+    bool changed = false;
+    if (file_.refresh()) {
+        changed = true;
+        if (top_offset_ > file_.size()) {
+            top_offset_ = 0;
+            top_line_ = 0;
+            top_line_known_ = true;
+        }
+        if (follow_) jump_to_end();
+    }
+    return try_pending_jump() || changed;
+}
+
+void Pager::run_prompt() {
+    char kind = prompt_kind_;
+    prompt_kind_ = 0;
+    if (kind == ':') {
+        char* end = nullptr;
+        unsigned long long line = std::strtoull(prompt_.c_str(), &end, 10);
+        if (prompt_.empty() || *end != '\0') {
+            message_ = "Not a line number: " + prompt_;
+            return;
+        }
+        jump_to_line(line > 0 ? line - 1 : 0);
+    } else {
+        if (!prompt_.empty()) last_search_ = prompt_;
+        last_search_forward_ = kind == '/';
+        search(last_search_, last_search_forward_);
+    }
+}
+
+void Pager::handle_key(int key) {
+    if (prompt_kind_) {
+        if (key == '\r' || key == '\n') {
+            run_prompt();
+        } else if (key == kKeyEscape || key == ctrl('c') || key == ctrl('g')) {
+            prompt_kind_ = 0;
+        } else if (key == 127 || key == ctrl('h')) {
+            if (prompt_.empty()) prompt_kind_ = 0;
+            else prompt_.pop_back();
+        } else if (key >= 0x20 && key < 256) {
+            prompt_ += static_cast<char>(key);
+        }
+        return;
+    }
+
+    message_.clear();
+    int page = content_rows();
+    switch (key) {
+    case 'q': case 'Q': quit_ = true; break;
+    case 'j': case 'e': case '\r': case '\n': case kKeyDown: scroll(1); break;
+    case 'k': case 'y': case kKeyUp: scroll(-1); break;
+    case ' ': case 'f': case kKeyPageDown: scroll(page); break;
+    case 'b': case kKeyPageUp: scroll(-page); break;
+    case 'd': scroll(page / 2); break;
+    case 'u': scroll(-(page / 2)); break;
+    case 'g': case '<': case kKeyHome:
+        follow_ = false;
+        pending_jump_ = kNoJump;
+        top_offset_ = 0;
+        top_line_ = 0;
+        top_line_known_ = true;
+        break;
+    case 'G': case '>': case kKeyEnd: jump_to_end(); break;
+    case 'F':
+        follow_ = !follow_;
+        if (follow_) jump_to_end();
+        break;
+    case '/': case '?': case ':':
+        prompt_kind_ = static_cast<char>(key);
+        prompt_.clear();
+        break;
+    case 'n': search(last_search_, last_search_forward_); break;
+    case 'N': search(last_search_, !last_search_forward_); break;
+    default: break;
+    }
+}
+
+std::string Pager::status_line() {
+    std::string status = filename_;
+    uint64_t line;
+    status += top_line(line) ? "  line " + std::to_string(line + 1) : std::string("  line ?");
+    if (index_.at_end() && file_.size() == index_.indexed_bytes()) {
+        uint64_t total = index_.newline_count();
+        if (file_.size() > 0 && file_.data()[file_.size() - 1] != '\n') ++total;
+        status += "/" + std::to_string(total);
+    } else {
+        status += "  (indexing " + std::to_string(index_.newline_count()) + " lines)";
+    }
+    if (file_.size() > 0) {
+        status += "  " + std::to_string(top_offset_ * 100 / file_.size()) + "%";
+    }
+    if (follow_) status += "  [following]";
+    return status;
+}
+
+void Pager::render() {
+    Neurodeck::ScreenBuffer& buffer = screen_.back();
+    buffer.clear();
+    Neurodeck::Cell dim;
+    dim.attrs = Neurodeck::kAttrDim;
+
+    uint64_t offset = top_offset_;
+    for (int row = 0; row < content_rows(); ++row) {
+        if (offset >= file_.size()) {
+            buffer.put_text(0, row, "~", dim);
+            continue;
+        }
+        const char* line = file_.data() + offset;
+        uint64_t end = next_line_start(offset);
+        size_t length = static_cast<size_t>(end - offset);
+        if (length > 0 && line[length - 1] == '\n') --length;
+        buffer.put_text(0, row, display_text(line, length, buffer.width()));
+        offset = end;
+    }
+
+    Neurodeck::Cell reverse;
+    reverse.attrs = Neurodeck::kAttrReverse;
+    int status_row = screen_.height() - 1;
+    if (prompt_kind_) {
+        std::string text = std::string(1, prompt_kind_) + prompt_;
+        int x = buffer.put_text(0, status_row, text);
+        screen_.set_cursor(std::min(x, buffer.width() - 1), status_row, true);
+    } else {
+        buffer.put_text(0, status_row, message_.empty() ? status_line() : message_, reverse);
+        screen_.set_cursor(0, status_row, false);
+    }
+}
+
+void Pager::run() {
+    RawMode raw(in_fd_);
+    screen_.enter_fullscreen();
+    std::string input;
+    char chunk[256];
+    while (!quit_) {
+        struct winsize ws;
+        if (ioctl(out_fd_, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 1) {
+            set_size(ws.ws_col, ws.ws_row);
+        }
+        poll_file();
+        // The file can still be truncated between the poll and the draw. A
+        // faulted draw read zeros, so it is redone from the refreshed file.
+        file_.begin_access();
+        render();
+        if (!file_.end_access()) continue;
+        screen_.present();
+
+        struct pollfd pfd = {in_fd_, POLLIN, 0};
+        int timeout = screen_.has_pending_frame() ? screen_.milliseconds_until_next_frame() : kPollIntervalMs;
+        if (poll(&pfd, 1, timeout) > 0) {
+            ssize_t n = read(in_fd_, chunk, sizeof(chunk));
+            if (n <= 0) break;
+            input.append(chunk, static_cast<size_t>(n));
+            size_t pos = 0;
+            // Scrolling and search read the mapping too; a fault there is
+            // picked up by the next pass's poll.
+            file_.begin_access();
+            while (pos < input.size() && !quit_) {
+                int key;
+                size_t used = parse_key(input, pos, key);
+                if (used == 0) break;
+                pos += used;
+                if (key >= 0) handle_key(key);
+            }
+            file_.end_access();
+            input.erase(0, pos);
+        }
+    }
+    screen_.leave_fullscreen();
+}
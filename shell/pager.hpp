@@ -0,0 +1,95 @@
+#pragma once
+#include "line_index.hpp"
+#include "mapped_file.hpp"
+#include "terminal_screen.hpp"
+#include <cstdint>
+#include <string>
+
+// Full-screen file viewer behind `open <file>`.
+//
+// The file is mapped, so the first screen is drawn straight from the mapping
+// without reading anything else. A LineIndex builds sparse line offsets in the
+// background. Jumps to a line number use it once the scan has got that far;
+// scrolling, end-of-file and search work directly on the mapping and never
+// wait for it. The file is re-checked periodically and growth is followed.
+class Pager {
+public:
+    // Keys for the sequences handle_key() understands; plain bytes are
+    // passed as themselves.
+    enum Key {
+        kKeyUp = 256,
+        kKeyDown,
+        kKeyPageUp,
+        kKeyPageDown,
+        kKeyHome,
+        kKeyEnd,
+        kKeyEscape,
+    };
+
+    Pager(int in_fd = 0, int out_fd = 1);
+
+    // Maps `filename` and starts indexing it. Returns false if it cannot be
+    // opened.
+    bool open(const std::string& filename);
+
+    // Interactive loop on a terminal; returns when the user quits.
+    void run();
+
+    void set_size(int width, int height);
+    void handle_key(int key);
+    // Draws the current view into the screen's back buffer.
+    void render();
+    // Picks up file growth (or truncation). Returns true if the view changed.
+    bool poll_file();
+
+    void jump_to_line(uint64_t line);
+    void jump_to_end();
+    // Moves the view to the next (or previous) line containing `pattern`.
+    bool search(const std::string& pattern, bool forward);
+    void scroll(int64_t lines);
+
+    uint64_t top_offset() const { return top_offset_; }
+    // Line number of the top line, resolved through the index; false while
+    // the index has not reached it.
+    bool top_line(uint64_t& line);
+    bool quit_requested() const { return quit_; }
+    bool following() const { return follow_; }
+    bool jump_pending() const { return pending_jump_ != kNoJump; }
+    const std::string& message() const { return message_; }
+
+    Neurodeck::LineIndex& index() { return index_; }
+    Neurodeck::TerminalScreen& screen() { return screen_; }
+
+private:
+    static const uint64_t kNoJump = UINT64_MAX;
+
+    int content_rows() const { return screen_.height() > 1 ? screen_.height() - 1 : 1; }
+    uint64_t next_line_start(uint64_t offset) const;
+    uint64_t previous_line_start(uint64_t offset) const;
+    uint64_t last_page_offset() const;
+    bool try_pending_jump();
+    void run_prompt();
+    std::string status_line();
+
+    int in_fd_;
+    int out_fd_;
+    std::string filename_;
+    Neurodeck::MappedFile file_;
+    Neurodeck::LineIndex index_;
+    Neurodeck::TerminalScreen screen_;
+
+    uint64_t top_offset_ = 0;
+    // Cached line number of top_offset_, valid when top_line_known_.
+    uint64_t top_line_ = 0;
+    bool top_line_known_ = true;
+    uint64_t pending_jump_ = kNoJump;
+    bool follow_ = false;
+    bool quit_ = false;
+
+    // ':' (go to line) and '/' or '?' (search) read their argument here.
+    char prompt_kind_ = 0;
+    std::string prompt_;
+    std::string last_search_;
+    bool last_search_forward_ = true;
+    std::string message_;
+};
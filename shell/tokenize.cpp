@@ -1,5 +1,7 @@
 #include "tokenize.hpp"
+#include "environment.hpp"
 #include <sstream>
+#include <string_view>
 
 std::vector<std::string> tokenize(const std::string& line) {
     std::istringstream ss(line);
@@ -8,3 +10,123 @@ std::vector<std::string> tokenize(const std::string& line) {
     while (ss >> tok) out.push_back(tok);
     return out;
 }
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool is_name_char(char c, bool first) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+}
+
+// Characters with a meaning in glob patterns, and those that start one.
+bool is_glob_special(char c) {
+    return c == '*' || c == '?' || c == '[' || c == ']' || c == '{' || c == '}' || c == ',' || c == '\\';
+}
+
+bool starts_glob(char c) {
+    return c == '*' || c == '?' || c == '[' || c == '{';
+}
+
+// Appends text that must match literally to a glob pattern.
+void append_quoted(std::string& pattern, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (is_glob_special(data[i])) pattern += '\\';
+        pattern += data[i];
+    }
+}
+
+// Lexes one word starting at line[pos] into `out`, expanding variables, and
+// into `pattern` as a glob in which only the unescaped wildcards typed on the
+// line are special. Sets `glob` if there are any. Returns true if the word
+// had any literal text, i.e. should be kept even when it expanded to nothing.
+bool lex_word(const std::string& line, size_t& pos, const Environment& env, std::string& out,
+              std::string& pattern, bool& glob) {
+    bool literal = false;
+    glob = false;
+    while (pos < line.size() && !is_space(line[pos])) {
+        char c = line[pos];
+        if (c == '\\' && pos + 1 < line.size() && (line[pos + 1] == '$' || is_glob_special(line[pos + 1]))) {
+            out += line[pos + 1];
+            append_quoted(pattern, &line[pos + 1], 1);
+            literal = true;
+            pos += 2;
+            continue;
+        }
+        if (c != '$' || pos + 1 == line.size()) {
+            out += c;
+            if (c == '\\') pattern += '\\'; // Not escaping anything, so itself.
+            pattern += c;
+            glob = glob || starts_glob(c);
+            literal = true;
+            ++pos;
+            continue;
+        }
+        std::string_view name;
+        size_t end = pos + 1;
+        if (line[end] == '?') {
+            name = std::string_view(&line[end], 1);
+            ++end;
+        } else if (line[end] == '{') {
+            size_t close = line.find('}', end + 1);
+            if (close != std::string::npos) {
+                name = std::string_view(&line[end + 1], close - end - 1);
+                if (name == "?" || Environment::is_valid_name(name)) end = close + 1;
+                else name = std::string_view();
+            }
+        } else {
+            while (end < line.size() && is_name_char(line[end], end == pos + 1)) ++end;
+            name = std::string_view(&line[pos + 1], end - pos - 1);
+        }
+        if (name.empty()) {
+            out += '$'; // Not a variable reference after all.
+            pattern += '$';
+            literal = true;
+            ++pos;
+            continue;
+        }
+        std::string_view value;
+        if (env.get(name, value)) {
+            out.append(value.data(), value.size());
+            append_quoted(pattern, value.data(), value.size());
+        }
+        pos = end;
+    }
+    return literal;
+}
+
+} // namespace
+
+CommandLine lex_command_line(const std::string& line, const Environment& env) {
+    CommandLine result;
+    size_t pos = 0;
+    std::string word;
+    std::string pattern;
+    bool glob;
+    while (true) {
+        while (pos < line.size() && is_space(line[pos])) ++pos;
+        if (pos == line.size()) break;
+
+        if (result.words.empty()) {
+            size_t name_end = pos;
+            while (name_end < line.size() && is_name_char(line[name_end], name_end == pos)) ++name_end;
+            if (name_end > pos && name_end < line.size() && line[name_end] == '=') {
+                std::string name = line.substr(pos, name_end - pos);
+                pos = name_end + 1;
+                word.clear();
+                lex_word(line, pos, env, word, pattern, glob);
+                result.assignments.emplace_back(std::move(name), word);
+                continue;
+            }
+        }
+        word.clear();
+        pattern.clear();
+        if (lex_word(line, pos, env, word, pattern, glob) || !word.empty()) {
+            result.words.push_back(word);
+            result.patterns.push_back(glob ? pattern : std::string());
+        }
+    }
+    return result;
+}
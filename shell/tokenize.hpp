@@ -1,5 +1,25 @@
 #pragma once
 #include <string>
+#include <utility>
 #include <vector>
 
+class Environment;
+
 std::vector<std::string> tokenize(const std::string& line);
+
+// A command line split into words like tokenize(), with variables expanded
+// in the same pass: $NAME, ${NAME} and $? are replaced by their values (the
+// result is not split again), \$ is a literal '$', and a word that was
+// nothing but unset variables disappears. NAME=value words before the first
+// other word are collected as assignments instead.
+//
+// Words typed with an unescaped *, ?, [ or { also get a glob pattern for
+// expand_globs() (glob.hpp). Backslash escapes those characters, and text
+// that came from variables is matched literally.
+struct CommandLine {
+    std::vector<std::pair<std::string, std::string>> assignments;
+    std::vector<std::string> words;
+    std::vector<std::string> patterns; // One per word; empty if not a glob.
+};
+
+CommandLine lex_command_line(const std::string& line, const Environment& env);
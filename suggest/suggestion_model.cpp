@@ -0,0 +1,529 @@
+#include "suggestion_model.hpp"
+#include "history_store.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>     // For std::rename(), std::remove()
+#include <cstdlib>    // For mkstemp()
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+#include <unordered_set>
+#include <fcntl.h>    // For open()
+#include <sys/file.h> // For flock()
+#include <sys/mman.h> // For mmap()
+#include <sys/stat.h> // For fstat()
+#include <unistd.h>   // For ftruncate(), pwrite(), close()
+
+namespace Neurodeck {
+
+namespace {
+
+// "NDSUGG01": identifies the file and its on-disk format version.
+const char kFileMagic[8] = {'N', 'D', 'S', 'U', 'G', 'G', '0', '1'};
+
+const size_t kBucketEntries = 8; // Candidates kept per context.
+const uint32_t kMaxProbe = 8;    // Buckets searched for a context's key.
+const float kHalfLife = 200.0f;  // Commands after which a count weighs half.
+const int kNotFound = 127;       // Exit status of an unknown command.
+const int64_t kSessionGap = 3600; // Seconds of silence that end a session in history.
+
+// Contexts a candidate can be counted under; part of every bucket key.
+enum ContextKind : uint64_t {
+    kAfterTwo = 1,        // Previous two commands -> next command.
+    kAfterOne,            // Previous command and whether it failed -> next command.
+    kInDirectory,         // Working directory -> command.
+    kOverall,             // -> command.
+    kArgument,            // Command name and preceding tokens -> next token.
+    kArgumentInDirectory, // The same within one working directory.
+};
+
+// How much each context counts when ranking whole lines; token completions
+// are scaled down so a matching line from a strong context wins.
+const float kAfterTwoWeight = 4.0f;
+const float kAfterOneWeight = 3.0f;
+const float kInDirectoryWeight = 2.0f;
+const float kOverallWeight = 1.0f;
+const float kArgumentWeight = 0.5f;
+const float kArgumentInDirectoryWeight = 0.75f;
+
+uint64_t fnv1a(const char* data, size_t length, uint64_t hash = 14695981039346656037ull) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t context_key(ContextKind kind, std::initializer_list<std::string_view> parts, uint64_t extra = 0) {
+    uint64_t hash = fnv1a(reinterpret_cast<const char*>(&kind), sizeof(kind));
+    for (std::string_view part : parts) {
+        hash = fnv1a(part.data(), part.size(), hash);
+        hash = (hash ^ 0xff) * 1099511628211ull; // 0xff never occurs in UTF-8.
+    }
+    hash ^= extra;
+    // splitmix64 finalizer: the low bits pick the bucket.
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash == 0 ? 1 : hash;
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::vector<std::string_view> split(const std::string& line) {
+    std::vector<std::string_view> tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        while (pos < line.size() && is_space(line[pos])) ++pos;
+        size_t begin = pos;
+        while (pos < line.size() && !is_space(line[pos])) ++pos;
+        if (pos > begin) tokens.emplace_back(line.data() + begin, pos - begin);
+    }
+    return tokens;
+}
+
+// Key of the token that follows tokens[0, count): the command name and up
+// to two tokens just before the position, plus the position itself capped
+// at 3 so that long lines share statistics.
+uint64_t argument_key(ContextKind kind, const std::vector<std::string_view>& tokens, size_t count,
+                      std::string_view cwd) {
+    std::string_view name = count > 0 ? tokens[0] : std::string_view();
+    std::string_view before_last = count > 2 ? tokens[count - 2] : std::string_view();
+    std::string_view last = count > 1 ? tokens[count - 1] : std::string_view();
+    return context_key(kind, {cwd, name, before_last, last}, std::min<size_t>(count, 3));
+}
+
+} // namespace
+
+// File layout: Header, bucket_count Buckets, string_slot_count StringSlots,
+// then the string heap. Heap records are a uint16_t length and the bytes;
+// offset 0 is never a record, so 0 means "no string" everywhere.
+struct SuggestionModel::Header {
+    char magic[8];
+    uint32_t bucket_count;
+    uint32_t string_slot_count;
+    uint32_t heap_capacity;
+    uint32_t heap_used;
+    uint32_t string_count;
+    uint32_t tick; // Commands observed; the clock that weights decay by.
+    uint32_t reserved[8];
+};
+
+struct SuggestionModel::Entry {
+    uint32_t string; // Heap offset of the candidate.
+    uint32_t tick;   // When weight was last brought up to date.
+    float weight;
+};
+
+struct SuggestionModel::Bucket {
+    uint64_t key; // 0 = unused
+    Entry entries[kBucketEntries];
+};
+
+struct SuggestionModel::StringSlot {
+    uint32_t hash;
+    uint32_t offset; // 0 = unused
+};
+
+SuggestionModel::SuggestionModel(uint32_t buckets) {
+    static_assert(sizeof(Header) == 64, "Header layout is part of the file format");
+    static_assert(sizeof(Bucket) == 104, "Bucket layout is part of the file format");
+    bucket_count_ = 16;
+    while (bucket_count_ < buckets && bucket_count_ < (1u << 24)) bucket_count_ <<= 1;
+    string_slot_count_ = bucket_count_ * 2;
+    heap_capacity_ = bucket_count_ * 64;
+}
+
+SuggestionModel::~SuggestionModel() {
+    close();
+}
+
+bool SuggestionModel::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size = sizeof(Header) + static_cast<size_t>(bucket_count_) * sizeof(Bucket) +
+                  static_cast<size_t>(string_slot_count_) * sizeof(StringSlot) + heap_capacity_;
+
+    // Two sessions may race to create the file; the lock makes sure only one
+    // of them sizes it and writes the header.
+    flock(fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0) {
+        Header header = {};
+        std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        header.bucket_count = bucket_count_;
+        header.string_slot_count = string_slot_count_;
+        header.heap_capacity = heap_capacity_;
+        header.heap_used = 1;
+        ok = ftruncate(fd, static_cast<off_t>(size)) == 0 &&
+             pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    } else if (ok) {
+        ok = static_cast<size_t>(st.st_size) == size;
+    }
+    flock(fd, LOCK_UN);
+
+    void* map = ok ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    Header* header = static_cast<Header*>(map);
+    if (std::memcmp(header->magic, kFileMagic, sizeof(kFileMagic)) != 0 || header->bucket_count != bucket_count_ ||
+        header->string_slot_count != string_slot_count_ || header->heap_capacity != heap_capacity_) {
+        munmap(map, size);
+        ::close(fd);
+        return false;
+    }
+
+    path_ = filename;
+    fd_ = fd;
+    map_ = static_cast<char*>(map);
+    map_size_ = size;
+    header_ = header;
+    buckets_ = reinterpret_cast<Bucket*>(map_ + sizeof(Header));
+    string_slots_ = reinterpret_cast<StringSlot*>(buckets_ + bucket_count_);
+    heap_ = reinterpret_cast<char*>(string_slots_ + string_slot_count_);
+    return true;
+}
+
+void SuggestionModel::close() {
+    if (map_) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    map_size_ = 0;
+    header_ = nullptr;
+    buckets_ = nullptr;
+    string_slots_ = nullptr;
+    heap_ = nullptr;
+}
+
+uint32_t SuggestionModel::observed() const {
+    return header_ ? header_->tick : 0;
+}
+
+bool SuggestionModel::full() const {
+    return header_ && (header_->heap_used > heap_capacity_ - heap_capacity_ / 16 ||
+                       header_->string_count * 20 >= string_slot_count_ * 13);
+}
+
+bool SuggestionModel::observe(const Context& context, const std::string& command, int status) {
+    if (!is_open()) {
+        return false;
+    }
+    // Another session may have rebuilt the model since we mapped it.
+    struct stat ours;
+    struct stat current;
+    if (fstat(fd_, &ours) == 0 && stat(path_.c_str(), &current) == 0 &&
+        (ours.st_ino != current.st_ino || ours.st_dev != current.st_dev)) {
+        std::string path = path_;
+        if (!open(path)) {
+            return false;
+        }
+    }
+    flock(fd_, LOCK_EX);
+    learn(context, command, status);
+    flock(fd_, LOCK_UN);
+    return true;
+}
+
+void SuggestionModel::learn(const Context& context, const std::string& command, int status) {
+    std::vector<std::string_view> tokens = split(command);
+    if (tokens.empty() || command.size() > kMaxCommandLength || status == kNotFound) {
+        return;
+    }
+    float amount = status == 0 ? 1.0f : 0.5f;
+    if (uint32_t line = intern(command.data(), command.size())) {
+        bump(context_key(kAfterTwo, {context.before_previous, context.previous}), line, amount);
+        bump(context_key(kAfterOne, {context.previous}, context.previous_status != 0), line, amount);
+        bump(context_key(kInDirectory, {context.cwd}), line, amount);
+        bump(context_key(kOverall, {}), line, amount);
+    }
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (uint32_t token = intern(tokens[i].data(), tokens[i].size())) {
+            bump(argument_key(kArgument, tokens, i, std::string_view()), token, amount);
+            bump(argument_key(kArgumentInDirectory, tokens, i, context.cwd), token, amount);
+        }
+    }
+    ++header_->tick;
+}
+
+uint32_t SuggestionModel::intern(const char* data, size_t length) {
+    if (length == 0 || length > kMaxCommandLength) {
+        return 0;
+    }
+    uint32_t hash = static_cast<uint32_t>(fnv1a(data, length));
+    uint32_t mask = string_slot_count_ - 1;
+    for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        StringSlot& s = string_slots_[slot];
+        if (s.offset == 0) {
+            // New string; the load limit keeps some slot empty, so probing
+            // always ends.
+            if (header_->string_count * 10 >= string_slot_count_ * 7 ||
+                header_->heap_used + 2 + length > heap_capacity_) {
+                return 0;
+            }
+            uint32_t offset = header_->heap_used;
+            uint16_t stored = static_cast<uint16_t>(length);
+            std::memcpy(heap_ + offset, &stored, sizeof(stored));
+            std::memcpy(heap_ + offset + 2, data, length);
+            header_->heap_used = offset + 2 + static_cast<uint32_t>(length);
+            s.hash = hash;
+            s.offset = offset;
+            ++header_->string_count;
+            return offset;
+        }
+        const char* existing;
+        size_t existing_length;
+        if (s.hash == hash && string_at(s.offset, existing, existing_length) && existing_length == length &&
+            std::memcmp(existing, data, length) == 0) {
+            return s.offset;
+        }
+    }
+}
+
+// Bounds-checked against the heap so that a record another session is
+// writing right now can never send a reader out of the mapping.
+bool SuggestionModel::string_at(uint32_t offset, const char*& data, size_t& length) const {
+    uint32_t used = std::min(header_->heap_used, heap_capacity_);
+    if (offset == 0 || offset + 2 > used) {
+        return false;
+    }
+    uint16_t stored;
+    std::memcpy(&stored, heap_ + offset, sizeof(stored));
+    if (offset + 2 + stored > used) {
+        return false;
+    }
+    data = heap_ + offset + 2;
+    length = stored;
+    return true;
+}
+
+float SuggestionModel::effective(float weight, uint32_t tick) const {
+    uint32_t age = header_->tick - tick;
+    return weight * std::exp2(-static_cast<float>(age) / kHalfLife);
+}
+
+const SuggestionModel::Bucket* SuggestionModel::find_bucket(uint64_t key) const {
+    uint32_t mask = bucket_count_ - 1;
+    for (uint32_t probe = 0; probe < kMaxProbe; ++probe) {
+        const Bucket& bucket = buckets_[(key + probe) & mask];
+        if (bucket.key == key) {
+            return &bucket;
+        }
+        if (bucket.key == 0) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the bucket for `key`, taking an unused one or recycling the one
+// with the least total weight among those it could live in.
+SuggestionModel::Bucket* SuggestionModel::claim_bucket(uint64_t key) {
+    uint32_t mask = bucket_count_ - 1;
+    Bucket* victim = nullptr;
+    float victim_weight = 0.0f;
+    for (uint32_t probe = 0; probe < kMaxProbe; ++probe) {
+        Bucket& bucket = buckets_[(key + probe) & mask];
+        if (bucket.key == key) {
+            return &bucket;
+        }
+        if (bucket.key == 0) {
+            bucket.key = key;
+            return &bucket;
+        }
+        float total = 0.0f;
+        for (const Entry& entry : bucket.entries) {
+            if (entry.string) total += effective(entry.weight, entry.tick);
+        }
+        if (!victim || total < victim_weight) {
+            victim = &bucket;
+            victim_weight = total;
+        }
+    }
+    std::memset(victim->entries, 0, sizeof(victim->entries));
+    victim->key = key;
+    return victim;
+}
+
+void SuggestionModel::bump(uint64_t key, uint32_t string, float amount) {
+    Bucket* bucket = claim_bucket(key);
+    uint32_t now = header_->tick;
+    Entry* slot = nullptr;
+    float slot_weight = 0.0f;
+    for (Entry& entry : bucket->entries) {
+        if (entry.string == string) {
+            entry.weight = effective(entry.weight, entry.tick) + amount;
+            entry.tick = now;
+            return;
+        }
+        float weight = entry.string ? effective(entry.weight, entry.tick) : -1.0f;
+        if (!slot || weight < slot_weight) {
+            slot = &entry;
+            slot_weight = weight;
+        }
+    }
+    // A new candidate takes the place of the weakest one.
+    slot->string = string;
+    slot->tick = now;
+    slot->weight = amount;
+}
+
+std::vector<SuggestionModel::Suggestion> SuggestionModel::suggest(const Context& context, const std::string& typed,
+                                                                  size_t max_results) const {
+    std::vector<Suggestion> results;
+    if (!is_open() || max_results == 0) {
+        return results;
+    }
+    auto add = [&results](std::string text, float score) {
+        for (Suggestion& existing : results) {
+            if (existing.text == text) {
+                existing.score += score;
+                return;
+            }
+        }
+        results.push_back(Suggestion{std::move(text), score});
+    };
+    // Calls visit(data, length, share) for each candidate of `key`, where
+    // share is its weight relative to the bucket total (plus one, so that a
+    // context seen once or twice does not look certain).
+    auto each_candidate = [this](uint64_t key, auto visit) {
+        const Bucket* bucket = find_bucket(key);
+        if (!bucket) {
+            return;
+        }
+        float weights[kBucketEntries];
+        float total = 1.0f;
+        for (size_t i = 0; i < kBucketEntries; ++i) {
+            const Entry& entry = bucket->entries[i];
+            weights[i] = entry.string ? effective(entry.weight, entry.tick) : 0.0f;
+            total += weights[i];
+        }
+        for (size_t i = 0; i < kBucketEntries; ++i) {
+            const char* data;
+            size_t length;
+            if (weights[i] > 0.0f && string_at(bucket->entries[i].string, data, length)) {
+                visit(data, length, weights[i] / total);
+            }
+        }
+    };
+
+    // Whole lines that extend what has been typed.
+    const std::pair<uint64_t, float> lines[] = {
+        {context_key(kAfterTwo, {context.before_previous, context.previous}), kAfterTwoWeight},
+        {context_key(kAfterOne, {context.previous}, context.previous_status != 0), kAfterOneWeight},
+        {context_key(kInDirectory, {context.cwd}), kInDirectoryWeight},
+        {context_key(kOverall, {}), kOverallWeight},
+    };
+    for (const auto& line : lines) {
+        each_candidate(line.first, [&](const char* data, size_t length, float share) {
+            if (length > typed.size() && std::memcmp(data, typed.data(), typed.size()) == 0) {
+                add(std::string(data, length), line.second * share);
+            }
+        });
+    }
+
+    // The token under the cursor, completed from what usually comes next.
+    if (!typed.empty()) {
+        std::vector<std::string_view> tokens = split(typed);
+        std::string_view partial;
+        if (!tokens.empty() && !is_space(typed.back())) {
+            partial = tokens.back();
+            tokens.pop_back();
+        }
+        std::string prefix = typed.substr(0, typed.size() - partial.size());
+        const std::pair<uint64_t, float> arguments[] = {
+            {argument_key(kArgument, tokens, tokens.size(), std::string_view()), kArgumentWeight},
+            {argument_key(kArgumentInDirectory, tokens, tokens.size(), context.cwd), kArgumentInDirectoryWeight},
+        };
+        for (const auto& argument : arguments) {
+            each_candidate(argument.first, [&](const char* data, size_t length, float share) {
+                if (length > partial.size() && std::memcmp(data, partial.data(), partial.size()) == 0) {
+                    add(prefix + std::string(data, length), argument.second * share);
+                }
+            });
+        }
+    }
+
+    std::sort(results.begin(), results.end(), [](const Suggestion& a, const Suggestion& b) {
+        return a.score != b.score ? a.score > b.score : a.text < b.text;
+    });
+    if (results.size() > max_results) {
+        results.resize(max_results);
+    }
+    return results;
+}
+
+bool SuggestionModel::rebuild(const HistoryStore& history) {
+    if (path_.empty()) {
+        return false;
+    }
+
+    // Walk back from the newest entry while the distinct strings seen so far
+    // fit in half of the heap and the string table, leaving room to learn.
+    uint32_t first = history.end_id();
+    size_t heap_bytes = 1;
+    std::unordered_set<std::string> seen;
+    HistoryStore::Entry entry;
+    while (first > history.first_id() && history.get(first - 1, entry)) {
+        size_t added = 0;
+        if (seen.insert(entry.command).second) added += 2 + entry.command.size();
+        for (std::string_view token : split(entry.command)) {
+            if (seen.emplace(token).second) added += 2 + token.size();
+        }
+        if (heap_bytes + added > heap_capacity_ / 2 || seen.size() * 20 > string_slot_count_ * 7) {
+            break;
+        }
+        heap_bytes += added;
+        --first;
+    }
+
+    // A name of its own, so that sessions rebuilding at the same time never
+    // write into each other's file or rename a half-built one into place.
+    std::string tmp = path_ + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    SuggestionModel fresh(bucket_count_);
+    if (!fresh.open(tmp)) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    Context context;
+    int64_t last_time = 0;
+    for (uint32_t id = first; id < history.end_id() && history.get(id, entry); ++id) {
+        if (entry.timestamp - last_time > kSessionGap) {
+            context = Context();
+        }
+        context.cwd = entry.cwd;
+        fresh.learn(context, entry.command, entry.exit_status);
+        context.before_previous = std::move(context.previous);
+        context.previous = entry.command;
+        context.previous_status = entry.exit_status;
+        last_time = entry.timestamp;
+    }
+    fresh.close();
+
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    std::string path = path_;
+    return open(path);
+}
+
+} // namespace Neurodeck
@@ -0,0 +1,109 @@
+#ifndef SUGGEST_SUGGESTION_MODEL_HPP
+#define SUGGEST_SUGGESTION_MODEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Neurodeck {
+
+class HistoryStore;
+
+// On-device command suggestions learned from shell history.
+//
+// The model counts which command lines follow which in a handful of
+// contexts: the previous two commands, the previous command together with
+// whether it failed, the working directory, and overall. For arguments it
+// counts which token follows the command name and the tokens just before
+// it, overall and per directory. Counts decay with age (measured in
+// commands run), so recent habits outrank old ones.
+//
+// Everything lives in one fixed-size file that is mapped shared and updated
+// in place under flock, so every shell session learns from the others and
+// nothing has to be loaded at startup. Each context is a bucket of a few
+// weighted candidates in an open-addressed table; when the table is crowded
+// the weakest bucket nearby is recycled. Strings are interned in an
+// append-only heap in the same file. Once that heap fills up, full() turns
+// true and the caller rebuilds the model from history, which also drops
+// strings no bucket refers to any more.
+class SuggestionModel {
+public:
+    // What the shell knows about the line being typed.
+    struct Context {
+        std::string cwd;
+        std::string previous;        // Last command of this session, if any.
+        std::string before_previous; // The one before that.
+        int previous_status = 0;
+    };
+
+    struct Suggestion {
+        std::string text; // The whole line, starting with what was typed.
+        float score;
+    };
+
+    static constexpr uint32_t kDefaultBuckets = 1u << 15; // About 6 MB of file.
+    static constexpr size_t kMaxCommandLength = 1024;     // Longer lines are not learned.
+
+    explicit SuggestionModel(uint32_t buckets = kDefaultBuckets);
+    ~SuggestionModel();
+
+    SuggestionModel(const SuggestionModel&) = delete;
+    SuggestionModel& operator=(const SuggestionModel&) = delete;
+
+    // Opens (creating if needed) the model file. Returns false if it cannot
+    // be created or is not a model of this size.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return map_ != nullptr; }
+
+    // Learns that `command` was run in `context` and exited with `status`.
+    // Commands that were not found are not learned; failed ones count less.
+    bool observe(const Context& context, const std::string& command, int status);
+
+    // Replaces the model with one trained on the newest history entries that
+    // fit in about half of the string heap. Sessions that have the old file
+    // open switch over on their next observe().
+    bool rebuild(const HistoryStore& history);
+
+    // Ranked completions of `typed`: whole command lines first predicted by
+    // the context, then the current token completed from argument counts.
+    // An empty `typed` predicts the next command.
+    std::vector<Suggestion> suggest(const Context& context, const std::string& typed, size_t max_results) const;
+
+    // Commands learned so far.
+    uint32_t observed() const;
+    // True once new strings no longer fit; see rebuild().
+    bool full() const;
+
+private:
+    struct Header;
+    struct Entry;
+    struct Bucket;
+    struct StringSlot;
+
+    void learn(const Context& context, const std::string& command, int status);
+    uint32_t intern(const char* data, size_t length);
+    bool string_at(uint32_t offset, const char*& data, size_t& length) const;
+    const Bucket* find_bucket(uint64_t key) const;
+    Bucket* claim_bucket(uint64_t key);
+    void bump(uint64_t key, uint32_t string, float amount);
+    float effective(float weight, uint32_t tick) const;
+
+    uint32_t bucket_count_;
+    uint32_t string_slot_count_;
+    uint32_t heap_capacity_;
+
+    std::string path_;
+    int fd_ = -1;
+    char* map_ = nullptr;
+    size_t map_size_ = 0;
+    Header* header_ = nullptr;
+    Bucket* buckets_ = nullptr;
+    StringSlot* string_slots_ = nullptr;
+    char* heap_ = nullptr;
+};
+
+} // namespace Neurodeck
+
+#endif // SUGGEST_SUGGESTION_MODEL_HPP
@@ -0,0 +1,18 @@
+#pragma once
+#include "gtest/gtest.h"
+#include "../core/alloc_tracker.hpp"
+
+// Assertions on heap activity, backed by core_alloc_tracking (linked into
+// runTests). Only allocations made by the current thread while `statement`
+// runs are counted.
+#define EXPECT_ALLOCATIONS_AT_MOST(limit, statement)                                       \
+    do {                                                                                   \
+        Neurodeck::AllocScope nd_alloc_scope_("test");                                     \
+        statement;                                                                         \
+        Neurodeck::AllocCounts nd_alloc_counts_ = nd_alloc_scope_.counts();                \
+        EXPECT_LE(nd_alloc_counts_.allocations, static_cast<uint64_t>(limit))              \
+            << #statement << " allocated " << nd_alloc_counts_.bytes << " bytes in "       \
+            << nd_alloc_counts_.allocations << " allocations";                             \
+    } while (0)
+
+#define EXPECT_NO_ALLOCATIONS(statement) EXPECT_ALLOCATIONS_AT_MOST(0, statement)
@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+#include "alloc_assertions.hpp"
+#include "command.hpp"
+#include "command_stats.hpp"
+#include "tokenize.hpp"
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern std::unordered_map<std::string, std::unique_ptr<Command>> build_registry();
+
+namespace {
+
+// Swallows everything written to it, so output does not reach a buffer that
+// might grow.
+class NullStreambuf : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+} // namespace
+
+// Redirects std::cout for dispatch tests.
+class AllocTrackerTest : public ::testing::Test {
+protected:
+    NullStreambuf null_buffer_;
+    std::streambuf* original_cout_ = nullptr;
+
+    void SetUp() override {
+        original_cout_ = std::cout.rdbuf(&null_buffer_);
+    }
+
+    void TearDown() override {
+        std::cout.rdbuf(original_cout_);
+    }
+};
+
+TEST_F(AllocTrackerTest, CountsAllocationsInScope) {
+    Neurodeck::AllocScope scope("alloc_test_counts");
+    auto block = std::make_unique<char[]>(100);
+    Neurodeck::AllocCounts counts = scope.counts();
+    EXPECT_EQ(counts.allocations, 1u);
+    EXPECT_GE(counts.bytes, 100u);
+    block.reset();
+    EXPECT_EQ(scope.counts().deallocations, 1u);
+}
+
+TEST_F(AllocTrackerTest, AttributesToInnermostTag) {
+    Neurodeck::AllocTracker::reset_tags();
+    {
+        Neurodeck::AllocScope outer("alloc_test_outer");
+        auto a = std::make_unique<int>(1);
+        {
+            Neurodeck::AllocScope inner("alloc_test_inner");
+            auto b = std::make_unique<int>(2);
+            auto c = std::make_unique<int>(3);
+        }
+        auto d = std::make_unique<int>(4);
+    }
+    EXPECT_EQ(Neurodeck::AllocTracker::tag_counts("alloc_test_outer").allocations, 2u);
+    EXPECT_EQ(Neurodeck::AllocTracker::tag_counts("alloc_test_inner").allocations, 2u);
+    EXPECT_EQ(Neurodeck::AllocTracker::tag_counts("alloc_test_unused").allocations, 0u);
+}
+
+TEST_F(AllocTrackerTest, TokenizeAllocates) {
+    Neurodeck::AllocScope scope("alloc_test_tokenize");
+    auto tokens = tokenize("open a-rather-long-file-name.txt --force");
+    EXPECT_EQ(tokens.size(), 3u);
+    EXPECT_GT(scope.counts().allocations, 0u);
+}
+
+TEST_F(AllocTrackerTest, DispatchingHelpDoesNotAllocate) {
+    auto registry = build_registry();
+    const std::vector<std::string> tokens = {"help"};
+    // Warm up once so lazily initialised state is not counted.
+    registry.find(tokens[0])->second->run(tokens);
+    EXPECT_NO_ALLOCATIONS({
+        auto it = registry.find(tokens[0]);
+        ASSERT_NE(it, registry.end());
+        it->second->run(tokens);
+    });
+}
+
+TEST_F(AllocTrackerTest, RecordingKnownCommandDoesNotAllocate) {
+    CommandStats::instance().record("alloc_test_command", 1, 2, 3);
+    const std::string command = "alloc_test_command";
+    EXPECT_NO_ALLOCATIONS(CommandStats::instance().record(command, 10, 20, 30));
+    CommandStats::instance().reset();
+}
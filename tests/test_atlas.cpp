@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "../desktop/atlas.hpp"
+#include <random>
+#include <vector>
+
+using Neurodeck::AtlasAllocator;
+using Neurodeck::Rect;
+
+TEST(AtlasAllocatorTest, PacksWithoutOverlap) {
+    AtlasAllocator atlas(256, 256);
+    std::mt19937 rng(11);
+    std::vector<Rect> slots;
+    std::vector<int> owner(256 * 256, -1);
+    for (int round = 0; round < 2000; ++round) {
+        if (!slots.empty() && rng() % 3 == 0) {
+            size_t victim = rng() % slots.size();
+            const Rect slot = slots[victim];
+            for (int y = slot.y; y < slot.bottom(); ++y) {
+                for (int x = slot.x; x < slot.right(); ++x) owner[y * 256 + x] = -1;
+            }
+            atlas.release(slot);
+            slots.erase(slots.begin() + victim);
+            continue;
+        }
+        Rect slot;
+        if (!atlas.allocate(1 + rng() % 48, 1 + rng() % 48, slot)) continue;
+        ASSERT_TRUE((Rect{0, 0, 256, 256}).contains(slot));
+        for (int y = slot.y; y < slot.bottom(); ++y) {
+            for (int x = slot.x; x < slot.right(); ++x) {
+                ASSERT_EQ(owner[y * 256 + x], -1) << "overlap at " << x << "," << y;
+                owner[y * 256 + x] = round;
+            }
+        }
+        slots.push_back(slot);
+    }
+    int64_t used = 0;
+    for (const Rect& slot : slots) used += slot.area();
+    EXPECT_EQ(atlas.used(), used);
+
+    // With everything released the whole atlas is free again.
+    for (const Rect& slot : slots) atlas.release(slot);
+    EXPECT_EQ(atlas.used(), 0);
+    Rect slot;
+    EXPECT_TRUE(atlas.allocate(256, 256, slot));
+    EXPECT_EQ(slot, (Rect{0, 0, 256, 256}));
+}
+
+TEST(AtlasAllocatorTest, SharesShelvesBetweenSimilarHeights) {
+    AtlasAllocator atlas(64, 64);
+    Rect cursor, tooltip, panel, too_big;
+    ASSERT_TRUE(atlas.allocate(16, 16, cursor));
+    ASSERT_TRUE(atlas.allocate(24, 12, tooltip)); // Rounds up to the same shelf.
+    EXPECT_EQ(tooltip, (Rect{16, 0, 24, 12}));
+    ASSERT_TRUE(atlas.allocate(64, 40, panel)); // Too tall for it: a new shelf.
+    EXPECT_EQ(panel.y, 16);
+    EXPECT_FALSE(atlas.allocate(65, 1, too_big));
+    EXPECT_FALSE(atlas.allocate(8, 17, too_big)); // Only 8 rows are left.
+
+    // Space freed on a shelf is reused, merged with what is next to it.
+    atlas.release(cursor);
+    atlas.release(tooltip);
+    ASSERT_TRUE(atlas.allocate(40, 16, cursor));
+    EXPECT_EQ(cursor, (Rect{0, 0, 40, 16}));
+}
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include "program.hpp"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Neurodeck;
+
+namespace {
+
+double eval(const std::string& source, const std::vector<std::string>& names = {},
+            const std::vector<double>& values = {}) {
+    Program program;
+    std::string error;
+    EXPECT_TRUE(program.compile(source, names, &error)) << source << ": " << error;
+    return program.evaluate(values.data());
+}
+
+bool same_bits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof a) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+} // namespace
+
+TEST(CalculatorTest, PrecedenceAndFunctions) {
+    EXPECT_DOUBLE_EQ(eval("1 + 2 * 3"), 7);
+    EXPECT_DOUBLE_EQ(eval("(1 + 2) * 3"), 9);
+    EXPECT_DOUBLE_EQ(eval("-2 ^ 2"), -4);
+    EXPECT_DOUBLE_EQ(eval("2 ^ 3 ^ 2"), 512);
+    EXPECT_DOUBLE_EQ(eval("2 ^ -1"), 0.5);
+    EXPECT_DOUBLE_EQ(eval("10 - 4 - 3"), 3);
+    EXPECT_DOUBLE_EQ(eval("7 % 4 + mod(9, 5)"), 7);
+    EXPECT_DOUBLE_EQ(eval("max(1, x, 3) + min(y, 2)", {"x", "y"}, {5, -1}), 4);
+    EXPECT_DOUBLE_EQ(eval("sqrt(16) + abs(-2) + floor(2.7) + ceil(2.1)"), 11);
+    EXPECT_DOUBLE_EQ(eval("1.5e3 + .5 + 2E-1"), 1500.7);
+    EXPECT_DOUBLE_EQ(eval("cos(pi) + log(e)"), 0);
+}
+
+TEST(CalculatorTest, ReportsErrorsWithColumn) {
+    Program program;
+    std::string error;
+    EXPECT_FALSE(program.compile("1 + * 2", {}, &error));
+    EXPECT_EQ(error, "unexpected '*' at column 5");
+    EXPECT_FALSE(program.compile("(1 + 2", {}, &error));
+    EXPECT_EQ(error, "expected ')' at column 7");
+    EXPECT_FALSE(program.compile("a + bee", {"a"}, &error));
+    EXPECT_EQ(error, "unknown variable 'bee' at column 5");
+    EXPECT_FALSE(program.compile("frob(1)", {}, &error));
+    EXPECT_EQ(error, "unknown function 'frob' at column 1");
+    EXPECT_FALSE(program.compile("sqrt(1, 2)", {}, &error));
+    EXPECT_FALSE(program.compile("1e+", {}, &error));
+    EXPECT_FALSE(program.compile(std::string(10000, '(') + "1" + std::string(10000, ')'), {}, &error));
+    EXPECT_EQ(error.compare(0, 28, "expression nested too deeply"), 0);
+    EXPECT_FALSE(program.compile("", {}, &error));
+    EXPECT_TRUE(std::isnan(program.evaluate(nullptr)));
+}
+
+TEST(CalculatorTest, FoldsConstantsAndSharesSubexpressions) {
+    Program program;
+    ASSERT_TRUE(program.compile("2 * 3 + sqrt(16) * x", {"x"}));
+    // 6 + 4 * x: the constant parts are folded away.
+    EXPECT_EQ(program.instructions().size(), 2u);
+
+    ASSERT_TRUE(program.compile("(a * b + c) / (b * a - c) + sqrt(a * b)", {"a", "b", "c"}));
+    // a * b (either order) is computed once.
+    EXPECT_EQ(program.instructions().size(), 6u) << program.disassemble();
+    double values[] = {2, 3, 1};
+    EXPECT_DOUBLE_EQ(program.evaluate(values), 7.0 / 5.0 + std::sqrt(6.0));
+
+    ASSERT_TRUE(program.compile("x * 1 + y ^ 2 - 0 + --z", {"x", "y", "z"}));
+    EXPECT_EQ(program.disassemble(),
+              "r0 = var 0\n"
+              "r1 = var 1\n"
+              "r2 = var 2\n"
+              "r3 = mul r1 r1\n"
+              "r4 = add r0 r3\n"
+              "r3 = add r4 r2\n"
+              "ret r3\n");
+    EXPECT_EQ(program.register_count(), 5u);
+}
+
+TEST(CalculatorTest, ColumnsMatchScalarEvaluation) {
+    const std::vector<std::string> names = {"a", "b", "c"};
+    const char* formulas[] = {
+        "a",
+        "42",
+        "a * b + c",
+        "(a - b) / (a + b) * (a - b) + max(a, b, c) - min(a, c)",
+        "sqrt(abs(a)) + exp(-b * b) + log(c * c + 1) + sin(a) * cos(b) + tan(c / 8)",
+        "floor(a * 3) % 4 + ceil(b) ^ 2 + pow(abs(c), 0.5) / 4",
+    };
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> value(-100, 100);
+    const size_t block = Program::kBlockRows;
+    for (size_t rows : {size_t(0), size_t(1), block - 1, block, 5 * block + 17}) {
+        std::vector<double> columns[3];
+        for (auto& column : columns) {
+            for (size_t r = 0; r < rows; ++r) column.push_back(value(rng));
+        }
+        const double* inputs[] = {columns[0].data(), columns[1].data(), columns[2].data()};
+        for (const char* formula : formulas) {
+            Program program;
+            ASSERT_TRUE(program.compile(formula, names));
+            std::vector<double> out(rows, -1);
+            program.evaluate_columns(inputs, rows, out.data());
+            for (size_t r = 0; r < rows; ++r) {
+                double row[] = {columns[0][r], columns[1][r], columns[2][r]};
+                ASSERT_TRUE(same_bits(out[r], program.evaluate(row))) << formula << " row " << r;
+            }
+        }
+    }
+}
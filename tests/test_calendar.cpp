@@ -0,0 +1,221 @@
+#include "gtest/gtest.h"
+#include "calendar.hpp"
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace Neurodeck;
+
+namespace {
+
+int64_t at(int64_t year, unsigned month, unsigned day, int hour = 0, int minute = 0) {
+    return days_from_civil(year, month, day) * kSecondsPerDay + hour * 3600 + minute * 60;
+}
+
+// Reference expansion: tests every day from the first occurrence onwards
+// against the rule.
+std::vector<int64_t> naive_expand(int64_t first_start, int64_t duration, const RecurrenceRule& rule,
+                                  int64_t begin, int64_t end, int days) {
+    int64_t first_day = floor_div(first_start, kSecondsPerDay);
+    int64_t time_of_day = first_start - first_day * kSecondsPerDay;
+    auto weekday = [](int64_t day) { return static_cast<int>(((day + 3) % 7 + 7) % 7); };
+    auto month_index = [](int64_t day) {
+        int64_t y;
+        unsigned m, d;
+        civil_from_days(day, y, m, d);
+        return y * 12 + m - 1;
+    };
+    int64_t first_y;
+    unsigned first_m, first_dom;
+    civil_from_days(first_day, first_y, first_m, first_dom);
+    uint8_t weekdays = rule.weekdays ? rule.weekdays : static_cast<uint8_t>(1u << weekday(first_day));
+    uint32_t interval = rule.interval ? rule.interval : 1;
+
+    std::vector<int64_t> result;
+    uint32_t seen = 0;
+    for (int64_t day = first_day; day < first_day + days; ++day) {
+        int64_t y;
+        unsigned m, dom;
+        civil_from_days(day, y, m, dom);
+        bool hit = false;
+        switch (rule.frequency) {
+        case Frequency::Daily:
+            hit = (day - first_day) % interval == 0;
+            break;
+        case Frequency::Weekly: {
+            int64_t weeks = ((day - weekday(day)) - (first_day - weekday(first_day))) / 7;
+            hit = weeks % interval == 0 && (weekdays & (1u << weekday(day)));
+            break;
+        }
+        case Frequency::Monthly:
+            hit = dom == first_dom && (month_index(day) - month_index(first_day)) % interval == 0;
+            break;
+        case Frequency::Yearly:
+            hit = dom == first_dom && m == first_m && (y - first_y) % interval == 0;
+            break;
+        }
+        int64_t start = day * kSecondsPerDay + time_of_day;
+        if (!hit || start < first_start) continue;
+        if (start > rule.until || (rule.count && seen >= rule.count)) break;
+        ++seen;
+        if (start < end && start + duration > begin) result.push_back(start);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(IntervalTreeTest, MatchesBruteForce) {
+    std::mt19937 rng(3);
+    IntervalTree tree;
+    std::vector<IntervalTree::Interval> live;
+    for (uint32_t id = 1; id <= 3000; ++id) {
+        if (!live.empty() && rng() % 3 == 0) {
+            size_t victim = rng() % live.size();
+            ASSERT_TRUE(tree.erase(live[victim].start, live[victim].id));
+            live.erase(live.begin() + victim);
+        }
+        int64_t start = rng() % 100000;
+        int64_t end = start + 1 + rng() % (rng() % 10 == 0 ? 20000 : 200);
+        tree.insert(start, end, id);
+        live.push_back({start, end, id});
+    }
+    EXPECT_FALSE(tree.erase(5, 999999));
+    ASSERT_EQ(tree.size(), live.size());
+
+    for (int q = 0; q < 500; ++q) {
+        int64_t begin = rng() % 110000;
+        int64_t end = begin + 1 + rng() % 2000;
+        std::vector<std::tuple<int64_t, uint32_t>> expected, actual;
+        for (const auto& interval : live) {
+            if (interval.start < end && interval.end > begin) expected.emplace_back(interval.start, interval.id);
+        }
+        std::sort(expected.begin(), expected.end());
+        tree.query(begin, end, [&](const IntervalTree::Interval& interval) {
+            actual.emplace_back(interval.start, interval.id);
+        });
+        EXPECT_EQ(actual, expected);
+        EXPECT_EQ(tree.overlaps(begin, end), !expected.empty());
+    }
+}
+
+TEST(RecurrenceTest, CivilDatesRoundTrip) {
+    EXPECT_EQ(days_from_civil(1970, 1, 1), 0);
+    EXPECT_EQ(days_from_civil(2000, 3, 1), 11017);
+    EXPECT_EQ(days_from_civil(1969, 12, 31), -1);
+    for (int64_t day = -800000; day < 800000; day += 997) {
+        int64_t year;
+        unsigned month, dom;
+        civil_from_days(day, year, month, dom);
+        ASSERT_EQ(days_from_civil(year, month, dom), day);
+    }
+    EXPECT_EQ(days_in_month(2024, 2), 29u);
+    EXPECT_EQ(days_in_month(1900, 2), 28u);
+    EXPECT_EQ(days_in_month(2000, 2), 29u);
+}
+
+TEST(RecurrenceTest, LazyExpansionMatchesReference) {
+    std::mt19937 rng(11);
+    const int kDays = 3 * 366;
+    for (int trial = 0; trial < 200; ++trial) {
+        RecurrenceRule rule;
+        rule.frequency = static_cast<Frequency>(trial % 4);
+        rule.interval = 1 + rng() % 3;
+        if (rule.frequency == Frequency::Weekly && rng() % 2) rule.weekdays = static_cast<uint8_t>(rng() & 0x7f);
+        if (rng() % 4 == 0) rule.count = 1 + rng() % 40;
+        int64_t first = at(2023, 1 + rng() % 12, 1 + rng() % 31 % 28 + (rng() % 5 == 0 ? 3 : 0), rng() % 24,
+                           rng() % 4 * 15);
+        if (rng() % 4 == 0) rule.until = first + static_cast<int64_t>(rng() % 500) * kSecondsPerDay;
+        int64_t duration = static_cast<int64_t>(1 + rng() % 48) * 1800;
+        Recurrence recurrence(first, duration, rule);
+
+        for (int window = 0; window < 10; ++window) {
+            int64_t begin = first + (static_cast<int64_t>(rng() % 900) - 30) * kSecondsPerDay +
+                            static_cast<int64_t>(rng() % 86400);
+            int64_t end = begin + static_cast<int64_t>(1 + rng() % 40) * 3600 * 6;
+            std::vector<int64_t> actual;
+            recurrence.expand(begin, end, [&](int64_t start) { actual.push_back(start); });
+            ASSERT_EQ(actual, naive_expand(first, duration, rule, begin, end, kDays))
+                << "trial " << trial << " window " << window;
+        }
+    }
+}
+
+TEST(RecurrenceTest, SkipsMissingDaysAndHonoursExclusions) {
+    RecurrenceRule monthly;
+    monthly.frequency = Frequency::Monthly;
+    Recurrence end_of_month(at(2024, 1, 31, 9), 3600, monthly);
+    std::vector<int64_t> starts;
+    end_of_month.expand(at(2024, 1, 1), at(2024, 6, 1), [&](int64_t start) { starts.push_back(start); });
+    EXPECT_EQ(starts, (std::vector<int64_t>{at(2024, 1, 31, 9), at(2024, 3, 31, 9), at(2024, 5, 31, 9)}));
+
+    RecurrenceRule yearly;
+    yearly.frequency = Frequency::Yearly;
+    yearly.count = 3;
+    Recurrence leap_day(at(2024, 2, 29), kSecondsPerDay, yearly);
+    EXPECT_EQ(leap_day.last_start(), at(2032, 2, 29));
+
+    RecurrenceRule weekly;
+    weekly.weekdays = 0x15; // Monday, Wednesday, Friday
+    Recurrence standup(at(2024, 5, 6, 10), 900, weekly); // A Monday
+    standup.exclude(at(2024, 5, 8, 10));
+    starts.clear();
+    standup.expand(at(2024, 5, 6), at(2024, 5, 13), [&](int64_t start) { starts.push_back(start); });
+    EXPECT_EQ(starts, (std::vector<int64_t>{at(2024, 5, 6, 10), at(2024, 5, 10, 10)}));
+}
+
+TEST(CalendarTest, WeekViewConflictsAndRemoval) {
+    Calendar calendar;
+    RecurrenceRule weekdays;
+    weekdays.weekdays = 0x1f; // Monday to Friday
+    uint32_t standup = calendar.add_series(at(2020, 1, 6, 9), at(2020, 1, 6, 9, 15), weekdays, "standup");
+    uint32_t review = calendar.add_event(at(2024, 5, 8, 9, 10), at(2024, 5, 8, 10), "review");
+    uint32_t lunch = calendar.add_event(at(2024, 5, 9, 12), at(2024, 5, 9, 13), "lunch");
+    calendar.add_event(at(2023, 5, 9, 12), at(2023, 5, 9, 13), "last year");
+    EXPECT_EQ(*calendar.title(standup), "standup");
+    EXPECT_EQ(calendar.event_count(), 3u);
+    EXPECT_EQ(calendar.series_count(), 1u);
+
+    auto week = calendar.occurrences(at(2024, 5, 6), at(2024, 5, 13));
+    ASSERT_EQ(week.size(), 7u);
+    EXPECT_EQ(week[0].id, standup);
+    EXPECT_EQ(week[0].start, at(2024, 5, 6, 9));
+    EXPECT_EQ(week[2].id, standup);
+    EXPECT_EQ(week[3].id, review);
+    EXPECT_EQ(week[5].id, lunch);
+
+    auto clashes = calendar.conflicts(at(2024, 5, 6), at(2024, 5, 13));
+    ASSERT_EQ(clashes.size(), 1u);
+    EXPECT_EQ(clashes[0].first.id, standup);
+    EXPECT_EQ(clashes[0].second.id, review);
+
+    EXPECT_TRUE(calendar.is_busy(at(2024, 5, 10, 9, 5), at(2024, 5, 10, 9, 6)));
+    EXPECT_FALSE(calendar.is_busy(at(2024, 5, 11, 9), at(2024, 5, 11, 10))); // Saturday
+    EXPECT_TRUE(calendar.exclude(standup, at(2024, 5, 8, 9)));
+    EXPECT_FALSE(calendar.exclude(review, at(2024, 5, 8, 9)));
+    EXPECT_TRUE(calendar.conflicts(at(2024, 5, 6), at(2024, 5, 13)).empty());
+
+    EXPECT_TRUE(calendar.remove(standup));
+    EXPECT_FALSE(calendar.remove(standup));
+    EXPECT_EQ(calendar.title(standup), nullptr);
+    EXPECT_EQ(calendar.occurrences(at(2024, 5, 6), at(2024, 5, 13)).size(), 2u);
+}
+
+TEST(CalendarTest, LargeWindowsComeBackOrdered) {
+    Calendar calendar;
+    RecurrenceRule daily;
+    daily.frequency = Frequency::Daily;
+    std::mt19937 rng(5);
+    for (int i = 0; i < 300; ++i) {
+        int64_t start = at(2024, 1, 1 + rng() % 20, rng() % 23, rng() % 60); // Ends before midnight
+        calendar.add_series(start, start + 1800, daily);
+        calendar.add_event(start + 3600, start + 7200);
+    }
+    auto week = calendar.occurrences(at(2024, 2, 1), at(2024, 2, 8));
+    EXPECT_EQ(week.size(), 300u * 7);
+    for (size_t i = 1; i < week.size(); ++i) {
+        ASSERT_TRUE(week[i - 1].start < week[i].start ||
+                    (week[i - 1].start == week[i].start && week[i - 1].id < week[i].id));
+    }
+}
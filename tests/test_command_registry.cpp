@@ -44,6 +44,18 @@ std::unique_ptr<Command> make_exit() {
 std::unique_ptr<Command> make_open() { 
     return std::make_unique<StubCommand>("open"); 
 }
+std::unique_ptr<Command> make_stats() {
+    return std::make_unique<StubCommand>("stats");
+}
+std::unique_ptr<Command> make_search() {
+    return std::make_unique<StubCommand>("search");
+}
+std::unique_ptr<Command> make_notes() {
+    return std::make_unique<StubCommand>("notes");
+}
+std::unique_ptr<Command> make_export() {
+    return std::make_unique<StubCommand>("export");
+}
 
 // 3. Test Cases
 class CommandRegistryTest : public ::testing::Test {
@@ -56,12 +68,12 @@ TEST_F(CommandRegistryTest, BuildRegistryPopulatesCorrectly) {
     auto registry = build_registry();
 
     // Expected number of commands
-    const size_t expected_command_count = 5;
+    const size_t expected_command_count = 9;
     ASSERT_EQ(registry.size(), expected_command_count) 
         << "Registry does not contain the expected number of commands.";
 
     // List of expected command names
-    const std::vector<std::string> expected_commands = {"ls", "clear", "help", "exit", "open"};
+    const std::vector<std::string> expected_commands = {"ls", "clear", "help", "exit", "open", "stats", "search", "notes", "export"};
 
     for (const auto& cmd_name : expected_commands) {
         auto it = registry.find(cmd_name);
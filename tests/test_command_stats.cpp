@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "command_stats.hpp"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LatencyHistogramTest, SmallValuesHaveExactBuckets) {
+    for (uint64_t v = 0; v < 32; ++v) {
+        EXPECT_EQ(LatencyHistogram::bucket_for(v), static_cast<int>(v));
+        EXPECT_EQ(LatencyHistogram::bucket_upper_bound(static_cast<int>(v)), v);
+    }
+}
+
+TEST(LatencyHistogramTest, BucketsBoundRelativeError) {
+    for (uint64_t v : std::vector<uint64_t>{32, 33, 1000, 123456789, 1ull << 40, UINT64_MAX}) {
+        int bucket = LatencyHistogram::bucket_for(v);
+        ASSERT_LT(bucket, LatencyHistogram::kBucketCount);
+        uint64_t upper = LatencyHistogram::bucket_upper_bound(bucket);
+        EXPECT_GE(upper, v);
+        EXPECT_LE(static_cast<double>(upper - v), static_cast<double>(v) / 16.0) << v;
+        if (bucket > 0) {
+            EXPECT_LT(LatencyHistogram::bucket_upper_bound(bucket - 1), v);
+        }
+    }
+}
+
+TEST(LatencyHistogramTest, PercentilesFromSnapshot) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 100; ++v) histogram.record(v * 1000);
+    HistogramSnapshot snap;
+    histogram.add_to(snap.counts, snap.total, snap.sum, snap.max);
+    EXPECT_EQ(snap.total, 100u);
+    EXPECT_EQ(snap.max, 100000u);
+    EXPECT_EQ(snap.mean(), 50500u);
+    EXPECT_NEAR(static_cast<double>(snap.percentile(50)), 50000.0, 50000.0 / 16);
+    EXPECT_NEAR(static_cast<double>(snap.percentile(99)), 99000.0, 99000.0 / 16);
+    EXPECT_EQ(snap.percentile(100), 100000u);
+}
+
+TEST(CommandStatsTest, MergesPerThreadShards) {
+    CommandStats& stats = CommandStats::instance();
+    stats.reset();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&stats] {
+            for (int i = 0; i < 250; ++i) stats.record("test-merge", 10, 2000, 5);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    stats.record("test-other", 10, 10, 0);
+
+    auto rows = stats.snapshot();
+    ASSERT_GE(rows.size(), 2u);
+    EXPECT_EQ(rows[0].command, "test-merge"); // Largest total run time first
+    EXPECT_EQ(rows[0].calls, 1000u);
+    EXPECT_EQ(rows[0].run_ns.total, 1000u);
+    EXPECT_EQ(rows[0].output_bytes.sum, 5000u);
+}
+
+TEST(CommandStatsTest, ReportsTableAndJson) {
+    CommandStats& stats = CommandStats::instance();
+    stats.reset();
+    stats.record("help", 80, 12000, 42);
+
+    std::ostringstream table;
+    stats.write_table(table);
+    EXPECT_NE(table.str().find("command"), std::string::npos);
+    EXPECT_NE(table.str().find("help"), std::string::npos);
+    EXPECT_NE(table.str().find("12.0us"), std::string::npos) << table.str();
+
+    std::ostringstream json;
+    stats.write_json(json);
+    EXPECT_EQ(json.str().rfind("{\"commands\":[{\"command\":\"help\",\"calls\":1,", 0), 0u) << json.str();
+    EXPECT_NE(json.str().find("\"output_bytes\":{\"count\":1,\"sum\":42"), std::string::npos);
+
+    stats.reset();
+    std::ostringstream empty;
+    stats.write_table(empty);
+    EXPECT_EQ(empty.str(), "No commands recorded yet.\n");
+}
+
+TEST(CountingStreambufTest, CountsForwardedBytes) {
+    std::ostringstream sink;
+    CountingStreambuf counter(sink.rdbuf());
+    std::ostream out(&counter);
+    out << "hello" << ' ' << 42 << "\n";
+    out.flush();
+    EXPECT_EQ(sink.str(), "hello 42\n");
+    EXPECT_EQ(counter.count(), 9u);
+}
@@ -0,0 +1,190 @@
+#include "gtest/gtest.h"
+#include "../shell/content_search.hpp"
+#include <cstdio>  // For std::remove
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+TEST(LiteralMatcherTest, AgreesWithStringFind) {
+    std::mt19937 rng(7);
+    std::string haystack;
+    for (int i = 0; i < 5000; ++i) haystack += static_cast<char>('a' + rng() % 4);
+    for (size_t length : {1, 2, 3, 7, 15, 16, 17, 40}) {
+        for (int trial = 0; trial < 20; ++trial) {
+            std::string needle = haystack.substr(rng() % (haystack.size() - length), length);
+            if (trial % 2) needle[length / 2] = 'z'; // Usually absent.
+            LiteralMatcher matcher(needle);
+            size_t expected = haystack.find(needle);
+            size_t found = matcher.find(haystack.data(), haystack.size());
+            EXPECT_EQ(found, expected == std::string::npos ? LiteralMatcher::npos : expected)
+                << "needle " << needle;
+        }
+    }
+}
+
+TEST(LiteralMatcherTest, IgnoreCase) {
+    const std::string text = "first line\nSome ERROR happened in the Connection Manager\n";
+    EXPECT_EQ(LiteralMatcher("error", true).find(text.data(), text.size()), text.find("ERROR"));
+    EXPECT_EQ(LiteralMatcher("connection manager", true).find(text.data(), text.size()), text.find("Connection"));
+    EXPECT_EQ(LiteralMatcher("error", false).find(text.data(), text.size()), LiteralMatcher::npos);
+}
+
+TEST(IgnoreRulesTest, GlobsAnchorsAndNegation) {
+    EXPECT_TRUE(glob_match("*.o", "main.o"));
+    EXPECT_FALSE(glob_match("*.o", "dir/main.o"));
+    EXPECT_TRUE(glob_match("**/*.o", "dir/sub/main.o"));
+    EXPECT_TRUE(glob_match("**/*.o", "main.o"));
+    EXPECT_TRUE(glob_match("build/**", "build/x/y"));
+    EXPECT_TRUE(glob_match("file[0-9].txt", "file7.txt"));
+    EXPECT_FALSE(glob_match("file[!0-9].txt", "file7.txt"));
+
+    IgnoreRules rules;
+    rules.parse("# comment\n*.log\n!keep.log\n/build/\ndocs/*.tmp\n");
+    EXPECT_EQ(rules.match("debug.log", false), 1);
+    EXPECT_EQ(rules.match("sub/trace.log", false), 1);
+    EXPECT_EQ(rules.match("keep.log", false), -1);
+    EXPECT_EQ(rules.match("build", true), 1);
+    EXPECT_EQ(rules.match("build", false), 0);
+    EXPECT_EQ(rules.match("src/build", true), 0);
+    EXPECT_EQ(rules.match("docs/a.tmp", false), 1);
+    EXPECT_EQ(rules.match("main.cpp", false), 0);
+}
+
+TEST(ContentSearchTest, SearchBufferReportsLineNumbers) {
+    SearchOptions options;
+    options.pattern = "needle";
+    ContentSearch search(options);
+    const std::string text = "hay\nneedle one\nhay\nhay\r\nneedle two\r\n";
+    std::string out;
+    EXPECT_EQ(search.search_buffer(text.data(), text.size(), "f.txt", out), 2u);
+    EXPECT_EQ(out, "f.txt:2:needle one\nf.txt:5:needle two\n");
+}
+
+TEST(ContentSearchTest, RegexFallbackAndInvalidPattern) {
+    SearchOptions options;
+    options.pattern = "^v[0-9]+\\.[0-9]+$";
+    ContentSearch search(options);
+    ASSERT_TRUE(search.valid());
+    const std::string text = "v1.2\nversion v3.4\nv10.20\n";
+    std::string out;
+    EXPECT_EQ(search.search_buffer(text.data(), text.size(), "t", out), 2u);
+    EXPECT_EQ(out, "t:1:v1.2\nt:3:v10.20\n");
+
+    options.pattern = "a(b";
+    EXPECT_FALSE(ContentSearch(options).valid());
+    options.fixed_strings = true;
+    EXPECT_TRUE(ContentSearch(options).valid());
+}
+
+TEST(ContentSearchTest, ParsesArguments) {
+    SearchOptions options;
+    std::vector<std::string> paths;
+    std::string error;
+    ASSERT_TRUE(parse_search_args({"search", "-il", "--hidden", "-j", "3", "todo", "src", "tests"},
+                                  options, paths, error));
+    EXPECT_EQ(options.pattern, "todo");
+    EXPECT_TRUE(options.ignore_case);
+    EXPECT_TRUE(options.files_with_matches);
+    EXPECT_TRUE(options.hidden);
+    EXPECT_EQ(options.threads, 3u);
+    EXPECT_EQ(paths, (std::vector<std::string>{"src", "tests"}));
+    EXPECT_FALSE(parse_search_args({"search"}, options, paths, error));
+    EXPECT_EQ(error, "missing pattern");
+    for (const char* count : {"x", "3x", "", "0", "-2", "100000"}) {
+        EXPECT_FALSE(parse_search_args({"search", "-j", count, "todo"}, options, paths, error)) << count;
+        EXPECT_EQ(error, std::string("invalid thread count '") + count + "'");
+    }
+}
+
+// Test fixture building a small tree to walk.
+class ContentSearchTreeTest : public ::testing::Test {
+protected:
+    const std::string root_ = "temp_search_tree";
+    std::vector<std::string> files_;
+    std::vector<std::string> dirs_;
+
+    void SetUp() override {
+        make_dir("");
+        make_dir("/src");
+        make_dir("/src/deep");
+        make_dir("/build");
+        make_dir("/.hidden");
+        write("/.gitignore", "build/\n*.log\n");
+        write("/a.txt", "match here\nnothing\n");
+        write("/src/b.cpp", "int match = 1;\n");
+        write("/src/deep/c.cpp", "// no\n// match\n");
+        write("/src/deep/d.log", "match in ignored file\n");
+        write("/build/out.txt", "match in ignored dir\n");
+        write("/.hidden/e.txt", "match in hidden dir\n");
+        write("/z.bin", std::string("match\0binary", 12));
+        for (int i = 0; i < 50; ++i) write("/src/f" + std::to_string(100 + i) + ".txt", "match " + std::to_string(i) + "\n");
+    }
+
+    void TearDown() override {
+        for (const auto& file : files_) std::remove(file.c_str());
+        for (auto it = dirs_.rbegin(); it != dirs_.rend(); ++it) rmdir(it->c_str());
+    }
+
+    void make_dir(const std::string& path) {
+        ASSERT_EQ(mkdir((root_ + path).c_str(), 0755), 0);
+        dirs_.push_back(root_ + path);
+    }
+
+    void write(const std::string& path, const std::string& contents) {
+        std::ofstream(root_ + path, std::ios::binary) << contents;
+        files_.push_back(root_ + path);
+    }
+
+    std::string run(SearchOptions options, uint64_t* matches = nullptr) {
+        options.pattern = "match";
+        ContentSearch search(options);
+        std::stringstream out, err;
+        uint64_t count = search.run({root_}, out, err);
+        if (matches) *matches = count;
+        EXPECT_EQ(err.str(), "");
+        return out.str();
+    }
+};
+
+TEST_F(ContentSearchTreeTest, OutputIsInTraversalOrderAndRespectsIgnores) {
+    SearchOptions options;
+    options.threads = 1;
+    uint64_t matches = 0;
+    std::string expected = root_ + "/a.txt:1:match here\n";
+    for (int i = 0; i < 50; ++i) {
+        expected += root_ + "/src/f" + std::to_string(100 + i) + ".txt:1:match " + std::to_string(i) + "\n";
+    }
+    expected = root_ + "/a.txt:1:match here\n" + root_ + "/src/b.cpp:1:int match = 1;\n" +
+               root_ + "/src/deep/c.cpp:2:// match\n" + expected.substr(expected.find('\n') + 1);
+    EXPECT_EQ(run(options, &matches), expected);
+    EXPECT_EQ(matches, 53u);
+
+    // Many workers must produce byte-identical output.
+    options.threads = 4;
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(run(options), expected);
+}
+
+TEST_F(ContentSearchTreeTest, HiddenNoIgnoreAndFileNames) {
+    SearchOptions options;
+    options.hidden = true;
+    options.use_ignore_files = false;
+    options.files_with_matches = true;
+    std::string out = run(options);
+    EXPECT_NE(out.find(root_ + "/.hidden/e.txt\n"), std::string::npos);
+    EXPECT_NE(out.find(root_ + "/build/out.txt\n"), std::string::npos);
+    EXPECT_NE(out.find(root_ + "/src/deep/d.log\n"), std::string::npos);
+    EXPECT_EQ(out.find("z.bin"), std::string::npos); // Binary files are skipped.
+}
+
+TEST_F(ContentSearchTreeTest, MissingPathIsReported) {
+    SearchOptions options;
+    options.pattern = "x";
+    ContentSearch search(options);
+    std::stringstream out, err;
+    search.run({root_ + "/missing"}, out, err);
+    EXPECT_EQ(err.str(), "search: cannot access '" + root_ + "/missing': No such file or directory\n");
+}
@@ -0,0 +1,195 @@
+#include "gtest/gtest.h"
+#include "../desktop/backend.hpp"
+#include "../desktop/blend.hpp"
+#include "../desktop/cpu_renderer.hpp"
+#include <cstring>
+#include <functional>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using Neurodeck::Backend;
+using Neurodeck::BlendPath;
+using Neurodeck::CpuRenderer;
+using Neurodeck::Rect;
+using Neurodeck::Region;
+using Neurodeck::Scene;
+using Neurodeck::ShmBuffer;
+using Neurodeck::ShmFormat;
+using Neurodeck::ShmPool;
+
+namespace {
+
+// A width x height buffer in its own pool, as a client would attach it.
+ShmBuffer make_buffer(int32_t width, int32_t height, const std::function<uint32_t(int32_t, int32_t)>& colour,
+                      ShmFormat format = ShmFormat::ARGB8888) {
+    size_t size = size_t(width) * height * 4;
+    int fd = memfd_create("test_cpu_renderer", MFD_CLOEXEC);
+    EXPECT_EQ(ftruncate(fd, size), 0);
+    uint32_t* data = static_cast<uint32_t*>(mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0));
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) data[y * width + x] = colour(x, y);
+    }
+    munmap(data, size);
+    ShmBuffer buffer;
+    buffer.pool = ShmPool::create(fd, int32_t(size));
+    close(fd);
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = width * 4;
+    buffer.format = format;
+    return buffer;
+}
+
+ShmBuffer make_buffer(int32_t width, int32_t height, uint32_t colour, ShmFormat format = ShmFormat::ARGB8888) {
+    return make_buffer(width, height, [colour](int32_t, int32_t) { return colour; }, format);
+}
+
+// Maps a surface showing `buffer` at (x, y) and uploads it.
+Scene::SurfaceId show(Scene& scene, CpuRenderer& renderer, const ShmBuffer& buffer, int32_t x, int32_t y) {
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, buffer.width, buffer.height);
+    scene.commit(id);
+    scene.set_position(id, x, y);
+    EXPECT_TRUE(renderer.upload(id, buffer, scene.surface(id)->buffer_damage));
+    return id;
+}
+
+} // namespace
+
+TEST(BlendTest, SimdPathsMatchScalar) {
+    std::mt19937 rng(7);
+    // Premultiplied pixels, with runs of opaque and transparent ones so the
+    // block fast paths are taken too.
+    std::vector<uint32_t> src(1027), dst(src.size());
+    for (size_t i = 0; i < src.size(); ++i) {
+        uint32_t alpha = rng() % 256;
+        if ((i / 16) % 4 == 1) alpha = 255;
+        uint32_t pixel = alpha << 24;
+        for (int shift = 0; shift < 24; shift += 8) pixel |= (rng() % (alpha + 1)) << shift;
+        src[i] = (i / 16) % 4 == 2 ? 0 : pixel;
+        dst[i] = rng();
+    }
+    for (BlendPath path : {BlendPath::Sse2, BlendPath::Avx2}) {
+        // Every offset and length, so unaligned heads and scalar tails are
+        // covered.
+        for (size_t offset = 0; offset < 9; ++offset) {
+            std::vector<uint32_t> out = dst;
+            std::vector<uint32_t> want = dst;
+            Neurodeck::blend_row(want.data() + offset, src.data() + offset, src.size() - offset - offset % 3,
+                                 BlendPath::Scalar);
+            Neurodeck::blend_row(out.data() + offset, src.data() + offset, src.size() - offset - offset % 3, path);
+            ASSERT_EQ(out, want) << Neurodeck::blend_path_name(path) << " at offset " << offset;
+        }
+    }
+
+    // Spot checks of the arithmetic itself.
+    uint32_t pixel = 0xff204060;
+    uint32_t half = 0x80402010;
+    Neurodeck::blend_row(&pixel, &half, 1, BlendPath::Scalar);
+    EXPECT_EQ(pixel, 0xff504040u); // src + dst * 127 / 255 per channel.
+    pixel = 0xff204060;
+    uint32_t transparent = 0;
+    Neurodeck::blend_row(&pixel, &transparent, 1);
+    EXPECT_EQ(pixel, 0xff204060u);
+}
+
+TEST(CpuRendererTest, CompositesOnlyTheDamage) {
+    Scene scene(64, 48);
+    CpuRenderer renderer(64, 48);
+    show(scene, renderer, make_buffer(16, 16, 0xff0000ff), 4, 4);  // Opaque blue.
+    show(scene, renderer, make_buffer(16, 16, 0x80008000), 12, 4); // Half green.
+    // White, with the undefined alpha byte of XRGB8888 left at zero.
+    show(scene, renderer, make_buffer(8, 8, 0x00ffffff, ShmFormat::XRGB8888), 40, 30);
+    renderer.draw(scene, scene.take_damage());
+
+    EXPECT_EQ(renderer.pixel(0, 0), CpuRenderer::kBackground);
+    EXPECT_EQ(renderer.pixel(5, 5), 0xff0000ffu);
+    EXPECT_EQ(renderer.pixel(14, 5), 0xff00807fu); // Green over blue.
+    EXPECT_EQ(renderer.pixel(24, 5), 0xff7f8000u); // Green over red.
+    EXPECT_EQ(renderer.pixel(41, 31), 0xffffffffu);
+
+    // A new buffer for the blue surface, damaged in one corner: only that
+    // corner is redrawn, so pixels outside the damage keep their colour
+    // even though the whole buffer changed.
+    Scene::SurfaceId blue = scene.stacking()[0];
+    ShmBuffer white = make_buffer(16, 16, 0xffffffff);
+    scene.attach(blue, 16, 16);
+    scene.damage_buffer(blue, Rect{0, 0, 2, 2});
+    scene.commit(blue);
+    ASSERT_TRUE(renderer.upload(blue, white, scene.surface(blue)->buffer_damage));
+    Region damage = scene.take_damage();
+    EXPECT_EQ(damage.bounds(), (Rect{4, 4, 2, 2}));
+    renderer.draw(scene, damage);
+    EXPECT_EQ(renderer.pixel(4, 4), 0xffffffffu);
+    EXPECT_EQ(renderer.pixel(6, 6), 0xff0000ffu);
+
+    // Removing a surface uncovers the background on the next redraw.
+    scene.destroy_surface(blue);
+    renderer.remove(blue);
+    renderer.draw(scene, scene.take_damage());
+    EXPECT_EQ(renderer.pixel(5, 5), CpuRenderer::kBackground);
+    EXPECT_EQ(renderer.pixel(14, 5), 0xff7f8000u);
+}
+
+TEST(CpuRendererTest, ScalesAndClipsToTheOutput) {
+    Scene scene(32, 32);
+    CpuRenderer renderer(32, 32, BlendPath::Scalar);
+    // A 2x buffer, left half black and right half white, hanging off the
+    // bottom right corner.
+    ShmBuffer buffer = make_buffer(16, 16, [](int32_t x, int32_t) { return x < 8 ? 0xff000000 : 0xffffffff; });
+    Scene::SurfaceId id = scene.create_surface();
+    scene.set_buffer_scale(id, 2);
+    scene.attach(id, 16, 16);
+    scene.commit(id);
+    scene.set_position(id, 26, 26);
+    ASSERT_TRUE(renderer.upload(id, buffer, scene.surface(id)->buffer_damage));
+    renderer.draw(scene, scene.take_damage());
+
+    EXPECT_EQ(renderer.pixel(25, 25), CpuRenderer::kBackground);
+    EXPECT_EQ(renderer.pixel(29, 26), 0xff000000u); // Buffer column 6.
+    EXPECT_EQ(renderer.pixel(30, 26), 0xffffffffu); // Buffer column 8.
+    EXPECT_EQ(renderer.pixel(31, 31), 0xffffffffu);
+}
+
+TEST(CpuRendererTest, HeadlessBackendRunsFrameHook) {
+    std::unique_ptr<Backend> backend = Neurodeck::create_headless_backend(8, 4);
+    EXPECT_STREQ(backend->name(), "headless");
+    Scene scene(8, 4);
+    scene.damage_all();
+    int frames = 0;
+    backend->set_frame_hook([&](const std::vector<uint32_t>& pixels, int32_t width, int32_t height) {
+        ++frames;
+        EXPECT_EQ(width, 8);
+        EXPECT_EQ(height, 4);
+        ASSERT_EQ(pixels.size(), 32u);
+        EXPECT_EQ(pixels[31], CpuRenderer::kBackground);
+    });
+    backend->repaint(scene, scene.take_damage());
+    EXPECT_EQ(frames, 1);
+}
+
+TEST(CpuRendererTest, SkipsWhatOpaqueSurfacesHide) {
+    // The same stack drawn twice, once with the top surface's opaque region
+    // declared: the output is the same, though far less is composited.
+    std::vector<uint32_t> expected;
+    for (bool declared : {false, true}) {
+        Scene scene(32, 32);
+        CpuRenderer renderer(32, 32);
+        for (uint32_t colour : {0x40100000u, 0x80200000u, 0xc0300000u, 0xff400000u}) {
+            show(scene, renderer, make_buffer(32, 32, colour), 0, 0);
+        }
+        // Opaque in the middle, translucent around it.
+        Scene::SurfaceId top = show(scene, renderer, make_buffer(16, 16, [](int32_t x, int32_t y) {
+            return x >= 4 && x < 12 && y >= 4 && y < 12 ? 0xff00ff00 : 0x80000080;
+        }), 8, 8);
+        if (declared) {
+            scene.set_opaque_region(top, Region(Rect{4, 4, 8, 8}));
+            scene.commit(top);
+        }
+        renderer.draw(scene, scene.take_damage());
+        if (!declared) expected = renderer.pixels();
+        else EXPECT_EQ(renderer.pixels(), expected);
+        EXPECT_EQ(renderer.pixel(15, 15), 0xff00ff00u);
+    }
+}
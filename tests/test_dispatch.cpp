@@ -12,4 +12,8 @@ TEST(Dispatch, ContainsBuiltins) {
     EXPECT_TRUE(reg.find("help")  != reg.end());
     EXPECT_TRUE(reg.find("open") != reg.end());
     EXPECT_TRUE(reg.find("exit") != reg.end());
+    EXPECT_TRUE(reg.find("stats") != reg.end());
+    EXPECT_TRUE(reg.find("search") != reg.end());
+    EXPECT_TRUE(reg.find("notes") != reg.end());
+    EXPECT_TRUE(reg.find("export") != reg.end());
 }
@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "../shell/environment.hpp"
+#include "../shell/tokenize.hpp"
+#include <algorithm>
+#include <cstdlib>  // For getenv
+#include <string>
+#include <vector>
+
+static std::string value_of(const Environment& env, const std::string& name) {
+    std::string_view value;
+    return env.get(name, value) ? std::string(value) : std::string("<unset>");
+}
+
+TEST(EnvironmentTest, CopiesShareUntilChanged) {
+    Environment env;
+    for (int i = 0; i < 100; ++i) {
+        env.set_exported("VAR" + std::to_string(i), std::to_string(i));
+    }
+    env.set("LOCAL", "shell only");
+    EXPECT_EQ(env.size(), 101u);
+    EXPECT_TRUE(env.is_exported("VAR7"));
+    EXPECT_FALSE(env.is_exported("LOCAL"));
+
+    // The envp array is cached, sorted and leaves out shell variables.
+    char* const* envp = env.envp();
+    EXPECT_EQ(env.envp(), envp);
+    std::vector<std::string> names;
+    for (char* const* entry = envp; *entry; ++entry) {
+        names.push_back(std::string(*entry).substr(0, std::string(*entry).find('=')));
+    }
+    ASSERT_EQ(names.size(), 100u);
+    EXPECT_STREQ(envp[0], "VAR0=0");
+    EXPECT_TRUE(std::is_sorted(names.begin(), names.end()));
+    env.set("?", "1");
+    EXPECT_EQ(env.envp(), envp);
+
+    // A per-command override changes the copy only.
+    Environment scoped = env;
+    EXPECT_EQ(scoped.envp(), envp);
+    scoped.set_exported("VAR7", "seven");
+    scoped.set_exported("EXTRA", "1");
+    EXPECT_NE(scoped.envp(), envp);
+    EXPECT_EQ(value_of(scoped, "VAR7"), "seven");
+    EXPECT_EQ(value_of(env, "VAR7"), "7");
+    EXPECT_EQ(value_of(env, "EXTRA"), "<unset>");
+    EXPECT_EQ(env.envp(), envp);
+
+    // set() keeps a variable exported; export_variable() moves it over.
+    env.set("VAR7", "again");
+    EXPECT_TRUE(env.is_exported("VAR7"));
+    EXPECT_TRUE(env.export_variable("LOCAL"));
+    EXPECT_TRUE(env.is_exported("LOCAL"));
+    EXPECT_FALSE(env.export_variable("MISSING"));
+    for (int i = 0; i < 100; i += 2) {
+        env.unset("VAR" + std::to_string(i));
+    }
+    EXPECT_EQ(env.size(), 52u);
+    EXPECT_EQ(env.exported().size(), 51u);
+    EXPECT_EQ(value_of(env, "VAR4"), "<unset>");
+    EXPECT_EQ(value_of(env, "VAR5"), "5");
+}
+
+TEST(EnvironmentTest, LexerExpandsVariables) {
+    Environment env;
+    env.set("NAME", "world");
+    env.set("SPACED", "a b");
+    env.set("?", "3");
+
+    CommandLine line = lex_command_line("echo hello $NAME ${NAME}s $? $SPACED \\$NAME", env);
+    EXPECT_TRUE(line.assignments.empty());
+    ASSERT_EQ(line.words.size(), 7u);
+    EXPECT_EQ(line.words[2], "world");
+    EXPECT_EQ(line.words[3], "worlds");
+    EXPECT_EQ(line.words[4], "3");
+    EXPECT_EQ(line.words[5], "a b"); // Expanded values are not split again.
+    EXPECT_EQ(line.words[6], "$NAME");
+
+    // A word that expands to nothing is dropped.
+    line = lex_command_line("ls $UNSET dir", env);
+    ASSERT_EQ(line.words.size(), 2u);
+    EXPECT_EQ(line.words[1], "dir");
+
+    // Leading assignments are split off and expanded too.
+    line = lex_command_line("A=1 B=$NAME ls C=2", env);
+    ASSERT_EQ(line.assignments.size(), 2u);
+    EXPECT_EQ(line.assignments[1].first, "B");
+    EXPECT_EQ(line.assignments[1].second, "world");
+    ASSERT_EQ(line.words.size(), 2u);
+    EXPECT_EQ(line.words[1], "C=2");
+}
+
+TEST(EnvironmentTest, InstallSetsProcessEnvironment) {
+    Environment env = Environment::from_process();
+    env.set_exported("NEURODECK_TEST", "1");
+    env.set("NEURODECK_LOCAL", "1");
+    env.install();
+    const char* value = std::getenv("NEURODECK_TEST");
+    ASSERT_NE(value, nullptr);
+    EXPECT_STREQ(value, "1");
+    EXPECT_EQ(std::getenv("NEURODECK_LOCAL"), nullptr);
+
+    // Like FOO=2 cmd: the override is visible while it is installed only.
+    {
+        Environment scoped = env;
+        scoped.set_exported("NEURODECK_TEST", "2");
+        scoped.install();
+    }
+    EXPECT_STREQ(std::getenv("NEURODECK_TEST"), "2");
+    env.install();
+    EXPECT_STREQ(std::getenv("NEURODECK_TEST"), "1");
+
+    Environment::from_process().install();
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include "../desktop/frame_scheduler.hpp"
+#include <vector>
+
+using Neurodeck::FrameScheduler;
+
+namespace {
+
+// Distinct listener tokens; the scheduler never dereferences them.
+int listeners[8];
+
+} // namespace
+
+TEST(FrameSchedulerTest, PacesFramesToTheRefreshGrid) {
+    FrameScheduler scheduler(1000);
+    EXPECT_FALSE(scheduler.scheduled());
+    EXPECT_EQ(scheduler.next_refresh(0), 0);
+    EXPECT_EQ(scheduler.next_refresh(1), 1000);
+    EXPECT_EQ(scheduler.next_refresh(2500), 3000);
+
+    scheduler.schedule();
+    ASSERT_TRUE(scheduler.scheduled());
+    scheduler.dispatch();
+    EXPECT_FALSE(scheduler.scheduled());
+    FrameScheduler::Frame frame = scheduler.present(3004);
+    EXPECT_EQ(frame.sequence, 3u);
+    EXPECT_EQ(frame.presented_nsec, 3000);
+
+    // At most one frame per refresh, even when asked early.
+    EXPECT_EQ(scheduler.next_refresh(3001), 4000);
+    EXPECT_EQ(scheduler.next_refresh(2000), 4000);
+    EXPECT_EQ(scheduler.present(3500).sequence, 4u);
+    EXPECT_EQ(scheduler.present(9100).sequence, 9u);
+}
+
+TEST(FrameSchedulerTest, ListenersWaitForCommitAndFrame) {
+    FrameScheduler scheduler(1000);
+    scheduler.frame(1, &listeners[0]);
+    scheduler.feedback(1, &listeners[1]);
+    EXPECT_FALSE(scheduler.scheduled()); // Not before the commit.
+    EXPECT_TRUE(scheduler.commit(2).empty());
+    EXPECT_FALSE(scheduler.scheduled());
+
+    EXPECT_TRUE(scheduler.commit(1).empty());
+    ASSERT_TRUE(scheduler.scheduled());
+    scheduler.frame(1, &listeners[2]); // For the commit after.
+
+    scheduler.dispatch();
+    FrameScheduler::Frame frame = scheduler.present(5000);
+    EXPECT_EQ(frame.callbacks, std::vector<FrameScheduler::Listener>{&listeners[0]});
+    EXPECT_EQ(frame.feedback, std::vector<FrameScheduler::Listener>{&listeners[1]});
+    frame = scheduler.present(6000);
+    EXPECT_TRUE(frame.callbacks.empty());
+    EXPECT_FALSE(scheduler.scheduled());
+
+    scheduler.commit(1);
+    scheduler.dispatch();
+    EXPECT_EQ(scheduler.present(7000).callbacks, std::vector<FrameScheduler::Listener>{&listeners[2]});
+}
+
+TEST(FrameSchedulerTest, DiscardsSupersededAndForgottenListeners) {
+    FrameScheduler scheduler(1000);
+    scheduler.feedback(1, &listeners[0]);
+    scheduler.commit(1);
+    scheduler.feedback(1, &listeners[1]);
+    // The first commit is replaced before it is shown.
+    EXPECT_EQ(scheduler.commit(1), std::vector<FrameScheduler::Listener>{&listeners[0]});
+
+    scheduler.frame(2, &listeners[2]);
+    scheduler.frame(2, &listeners[3]);
+    scheduler.commit(2);
+    scheduler.forget(&listeners[2]);
+    scheduler.feedback(2, &listeners[4]);
+    EXPECT_EQ(scheduler.remove_surface(2), std::vector<FrameScheduler::Listener>{&listeners[4]});
+
+    scheduler.dispatch();
+    FrameScheduler::Frame frame = scheduler.present(1000);
+    EXPECT_EQ(frame.callbacks, std::vector<FrameScheduler::Listener>{&listeners[3]});
+    EXPECT_EQ(frame.feedback, std::vector<FrameScheduler::Listener>{&listeners[1]});
+}
+
+TEST(FrameSchedulerTest, CommitsDuringAFrameWaitForTheNext) {
+    FrameScheduler scheduler(1000);
+    scheduler.frame(1, &listeners[0]);
+    scheduler.commit(1);
+    scheduler.dispatch();
+
+    // Committed while that frame is drawn, so it cannot show them.
+    scheduler.frame(1, &listeners[1]);
+    scheduler.feedback(1, &listeners[2]);
+    scheduler.commit(1);
+    scheduler.frame(2, &listeners[3]);
+    scheduler.commit(2);
+    scheduler.forget(&listeners[3]);
+    FrameScheduler::Frame frame = scheduler.present(1000);
+    EXPECT_EQ(frame.callbacks, std::vector<FrameScheduler::Listener>{&listeners[0]});
+    EXPECT_TRUE(frame.feedback.empty());
+    EXPECT_TRUE(scheduler.scheduled());
+
+    scheduler.dispatch();
+    frame = scheduler.present(2000);
+    EXPECT_EQ(frame.callbacks, std::vector<FrameScheduler::Listener>{&listeners[1]});
+    EXPECT_EQ(frame.feedback, std::vector<FrameScheduler::Listener>{&listeners[2]});
+    EXPECT_FALSE(scheduler.scheduled());
+}
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include "../desktop/frame_stats.hpp"
+#include <sstream>
+
+using Neurodeck::FrameRecord;
+using Neurodeck::FrameStats;
+
+namespace {
+
+const int64_t kRefresh = 16000000;
+
+// A frame drawn for `sequence` and shown at that refresh.
+FrameRecord frame_at(uint64_t sequence) {
+    FrameRecord frame;
+    frame.sequence = sequence;
+    frame.presented_nsec = int64_t(sequence) * kRefresh;
+    frame.render_start_nsec = frame.presented_nsec - 2000000;
+    frame.render_wall_nsec = 1000000;
+    frame.render_cpu_nsec = 900000;
+    return frame;
+}
+
+} // namespace
+
+TEST(FrameStatsTest, AttributesWorkToTheFrameThatShowsIt) {
+    FrameStats stats;
+    stats.dispatched(300);
+    stats.committed(10 * kRefresh - 5000000);
+    stats.dispatched(200);
+    stats.committed(10 * kRefresh - 1000000);
+    stats.targeted(10 * kRefresh);
+    stats.targeted(11 * kRefresh); // Rescheduling keeps the first target.
+    stats.presented(frame_at(12), kRefresh); // Two refreshes late.
+    stats.targeted(13 * kRefresh);
+    stats.presented(frame_at(13), kRefresh);
+
+    std::vector<FrameRecord> frames = stats.frames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].dispatch_nsec, 500);
+    EXPECT_EQ(frames[0].dispatches, 2u);
+    EXPECT_EQ(frames[0].commits, 2u);
+    EXPECT_EQ(frames[0].latency_nsec, 2 * kRefresh + 5000000); // From the older commit.
+    EXPECT_EQ(frames[0].dropped, 2u);
+    EXPECT_EQ(frames[1].dispatch_nsec, 0);
+    EXPECT_EQ(frames[1].commits, 0u);
+    EXPECT_EQ(frames[1].latency_nsec, 0);
+    EXPECT_EQ(frames[1].dropped, 0u);
+    EXPECT_EQ(stats.total_dropped(), 2u);
+}
+
+TEST(FrameStatsTest, KeepsTheLastFramesAndExports) {
+    FrameStats stats(4);
+    for (uint64_t sequence = 1; sequence <= 6; ++sequence) {
+        stats.targeted(int64_t(sequence) * kRefresh);
+        stats.presented(frame_at(sequence), kRefresh);
+    }
+    std::vector<FrameRecord> frames = stats.frames();
+    ASSERT_EQ(frames.size(), 4u);
+    EXPECT_EQ(frames.front().sequence, 3u);
+    EXPECT_EQ(frames.back().sequence, 6u);
+    EXPECT_EQ(stats.total_frames(), 6u);
+
+    std::ostringstream json;
+    stats.write_json(json);
+    EXPECT_EQ(json.str().find("{\"total_frames\":6,\"total_dropped\":0,"), 0u);
+    EXPECT_NE(json.str().find("\"render_cpu_ns\":{\"p50\":900000,"), std::string::npos);
+    EXPECT_EQ(json.str().find("\"sequence\":2,"), std::string::npos);
+    EXPECT_NE(json.str().find("\"sequence\":6,"), std::string::npos);
+
+    std::ostringstream trace;
+    stats.write_chrome_trace(trace);
+    EXPECT_EQ(trace.str().find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{\"name\":\"render\",\"ph\":\"X\","), 0u);
+    // Frame 3 rendered from 46 ms for 1 ms.
+    EXPECT_NE(trace.str().find("\"ts\":46000.000,\"pid\":1,\"tid\":1,\"dur\":1000.000"), std::string::npos);
+    EXPECT_EQ(trace.str().find("\"dropped\""), std::string::npos);
+}
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include "../shell/glob.hpp"
+#include "../shell/environment.hpp"
+#include "../shell/tokenize.hpp"
+#include <algorithm>
+#include <cstdio>   // For std::remove
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Test fixture that builds a scratch tree to expand patterns in.
+class GlobExpanderTest : public ::testing::Test {
+protected:
+    const std::string dir_ = "temp_glob_dir";
+    std::vector<std::string> files_;
+    std::vector<std::string> dirs_;
+
+    void SetUp() override {
+        make_dir("");
+        for (const char* dir : {"src", "src/sub", "src/sub/deep", "docs", ".hidden"}) make_dir(dir);
+        for (const char* file : {"src/main.cpp", "src/util.cpp", "src/util.hpp", "src/sub/a.cpp",
+                                 "src/sub/deep/b.cpp", "src/sub/deep/CMakeLists.txt", "src/.dot.cpp",
+                                 "docs/guide.md", "docs/x1.md", "docs/x2.md", ".hidden/c.cpp", "README",
+                                 "src/CMakeLists.txt"}) {
+            make_file(file);
+        }
+    }
+
+    void TearDown() override {
+        for (const auto& name : files_) std::remove((dir_ + "/" + name).c_str());
+        for (auto it = dirs_.rbegin(); it != dirs_.rend(); ++it) rmdir((dir_ + "/" + *it).c_str());
+    }
+
+    void make_dir(const std::string& name) {
+        ASSERT_EQ(mkdir((dir_ + "/" + name).c_str(), 0755), 0);
+        dirs_.push_back(name);
+    }
+
+    void make_file(const std::string& name) {
+        int fd = open((dir_ + "/" + name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        files_.push_back(name);
+    }
+
+    std::vector<std::string> expand(GlobExpander& expander, const std::string& pattern) {
+        std::vector<std::string> out;
+        expander.expand(dir_ + "/" + pattern, out);
+        for (std::string& path : out) {
+            if (path.compare(0, dir_.size() + 1, dir_ + "/") == 0) path.erase(0, dir_.size() + 1);
+        }
+        return out;
+    }
+};
+
+TEST(GlobMatcherTest, AgreesWithFnmatch) {
+    const std::vector<std::string> fixed = {"*.cpp", "test_*", "*", "a?c", "[a-c]*", "[!a-c]*", "[]x]", "*x*y*",
+                                            "\\*", "a*b*c", "[^.]*", "*[0-9].md", "??", "x[", "lit"};
+    const std::vector<std::string> names = {"main.cpp", "test_a", "abc", "axc", "b", "d.cpp", "]", "xay",
+                                            "*", "aXbYc", "x9.md", "ab", "x[", "lit", "", "cpp"};
+    for (const auto& pattern : fixed) {
+        GlobMatcher matcher(pattern);
+        for (const auto& name : names) {
+            EXPECT_EQ(matcher.matches(name), fnmatch(pattern.c_str(), name.c_str(), 0) == 0)
+                << pattern << " vs " << name;
+        }
+    }
+
+    // Random patterns over a small alphabet exercise backtracking.
+    std::mt19937 rng(5);
+    const char pattern_chars[] = {'a', 'b', '*', '?', '*', 'a'};
+    for (int i = 0; i < 2000; ++i) {
+        std::string pattern;
+        std::string name;
+        for (int n = rng() % 7; n > 0; --n) pattern += pattern_chars[rng() % sizeof(pattern_chars)];
+        if (rng() % 4 == 0) pattern += "[ab]";
+        for (int n = rng() % 9; n > 0; --n) name += "ab"[rng() % 2];
+        EXPECT_EQ(GlobMatcher(pattern).matches(name), fnmatch(pattern.c_str(), name.c_str(), 0) == 0)
+            << pattern << " vs " << name;
+    }
+
+    GlobMatcher literal("a\\*b");
+    EXPECT_TRUE(literal.is_literal());
+    EXPECT_EQ(literal.literal(), "a*b");
+    EXPECT_FALSE(GlobMatcher("*").matches_hidden());
+    EXPECT_TRUE(GlobMatcher(".*").matches_hidden());
+}
+
+TEST(GlobMatcherTest, ExpandsBracesAndLexesPatterns) {
+    std::vector<std::string> words;
+    expand_braces("a{b,c{d,e}}f{}{x}\\{y,z}", words);
+    EXPECT_EQ(words, (std::vector<std::string>{"abf{}{x}\\{y,z}", "acdf{}{x}\\{y,z}", "acef{}{x}\\{y,z}"}));
+    EXPECT_TRUE(has_wildcards("src/*.cpp"));
+    EXPECT_FALSE(has_wildcards("src/\\*.cpp"));
+    EXPECT_EQ(unescape_glob("a\\*b\\\\c"), "a*b\\c");
+
+    // Only wildcards typed on the line are special.
+    Environment env;
+    env.set("STAR", "*");
+    CommandLine line = lex_command_line("ls *.cpp \\*.cpp $STAR plain src/{a,b}", env);
+    ASSERT_EQ(line.words.size(), 6u);
+    ASSERT_EQ(line.patterns.size(), 6u);
+    EXPECT_EQ(line.patterns[1], "*.cpp");
+    EXPECT_EQ(line.words[2], "*.cpp");
+    EXPECT_EQ(line.patterns[2], "");
+    EXPECT_EQ(line.words[3], "*");
+    EXPECT_EQ(line.patterns[3], "");
+    EXPECT_EQ(line.patterns[4], "");
+    EXPECT_EQ(line.patterns[5], "src/{a,b}");
+
+    GlobExpander expander;
+    expand_globs(line, expander);
+    EXPECT_EQ(line.words, (std::vector<std::string>{"ls", "*.cpp", "*.cpp", "*", "plain", "src/a", "src/b"}));
+    EXPECT_EQ(line.patterns.size(), line.words.size());
+}
+
+TEST_F(GlobExpanderTest, ExpandsAgainstTheFileSystem) {
+    GlobExpander expander;
+    EXPECT_EQ(expand(expander, "*"), (std::vector<std::string>{"README", "docs", "src"}));
+    EXPECT_EQ(expand(expander, "src/*.cpp"), (std::vector<std::string>{"src/main.cpp", "src/util.cpp"}));
+    EXPECT_EQ(expand(expander, "src/.*"), (std::vector<std::string>{"src/.dot.cpp"}));
+    EXPECT_EQ(expand(expander, "docs/x[0-9].md"), (std::vector<std::string>{"docs/x1.md", "docs/x2.md"}));
+    EXPECT_EQ(expand(expander, "*/"), (std::vector<std::string>{"docs/", "src/"}));
+    EXPECT_EQ(expand(expander, "{docs,src}/*u*"),
+              (std::vector<std::string>{"docs/guide.md", "src/sub", "src/util.cpp", "src/util.hpp"}));
+
+    // "**" spans zero or more directories but skips hidden ones.
+    EXPECT_EQ(expand(expander, "**/*.cpp"),
+              (std::vector<std::string>{"src/main.cpp", "src/sub/a.cpp", "src/sub/deep/b.cpp", "src/util.cpp"}));
+    EXPECT_EQ(expand(expander, "src/**/CMakeLists.txt"),
+              (std::vector<std::string>{"src/CMakeLists.txt", "src/sub/deep/CMakeLists.txt"}));
+    EXPECT_EQ(expand(expander, "src/sub/**"),
+              (std::vector<std::string>{"src/sub/a.cpp", "src/sub/deep", "src/sub/deep/CMakeLists.txt",
+                                        "src/sub/deep/b.cpp"}));
+    EXPECT_EQ(expand(expander, "*/*/deep"), (std::vector<std::string>{"src/sub/deep"}));
+
+    // Nothing matched: the word is kept, unescaped.
+    EXPECT_EQ(expand(expander, "*.none"), (std::vector<std::string>{"*.none"}));
+    EXPECT_EQ(expand(expander, "src/nope/*"), (std::vector<std::string>{"src/nope/*"}));
+
+    // Every directory was read once however many patterns needed it: the
+    // scratch root, src, sub, deep, docs and the missing src/nope.
+    EXPECT_EQ(expander.directories_read(), 6u);
+
+    // Reading the tree below "**" on several threads finds the same paths.
+    GlobExpander threaded(4);
+    EXPECT_EQ(expand(threaded, "**/*.cpp"), expand(expander, "**/*.cpp"));
+    EXPECT_EQ(expand(threaded, "src/**"), expand(expander, "src/**"));
+    EXPECT_EQ(threaded.directories_read(), 5u);
+}
@@ -28,7 +28,11 @@ protected:
         " clear - Clear the screen\n"
         " open <filename> - Open a file\n"
         " exit - Exit the shell\n"
-        " help - Show this help message\n";
+        " help - Show this help message\n"
+        " stats [--json | reset] - Show per-command timing statistics\n"
+        " search [-iFl] <pattern> [path...] - Search file contents recursively\n"
+        " notes add|show|edit|rm|find ... - Manage and search notes\n"
+        " export [NAME[=value] ...] - Set and export variables\n";
 };
 
 TEST_F(HelpCommandTest, NameIsCorrect) {
@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+#include "../ide/highlighter.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using Neurodeck::Highlighter;
+using Neurodeck::LexState;
+using Neurodeck::PieceTable;
+using Neurodeck::TokenKind;
+using Neurodeck::TokenSpan;
+
+namespace {
+
+// Renders spans as "kind:text" pairs so failures are readable.
+std::string describe(const std::string& line, const std::vector<TokenSpan>& spans) {
+    static const char* names[] = {"kw", "type", "num", "str", "chr", "cmt", "pp"};
+    std::string out;
+    for (const TokenSpan& span : spans) {
+        if (!out.empty()) out += ' ';
+        out += names[static_cast<int>(span.kind)];
+        out += ':';
+        out += line.substr(span.column, span.length);
+    }
+    return out;
+}
+
+std::string lex(const std::string& line, LexState& state) {
+    std::vector<TokenSpan> spans;
+    state = Neurodeck::lex_cpp_line(line.data(), line.size(), state, spans);
+    return describe(line, spans);
+}
+
+std::string lex(const std::string& line) {
+    LexState state;
+    return lex(line, state);
+}
+
+// Highlights `text` from scratch, one line after another.
+std::vector<std::string> reference_highlight(const std::string& text) {
+    std::vector<std::string> result;
+    LexState state;
+    size_t pos = 0;
+    while (true) {
+        size_t newline = text.find('\n', pos);
+        std::string line = text.substr(pos, newline == std::string::npos ? std::string::npos : newline - pos);
+        result.push_back(lex(line, state));
+        if (newline == std::string::npos) break;
+        pos = newline + 1;
+    }
+    return result;
+}
+
+void expect_matches_reference(Highlighter& highlighter, const PieceTable& table) {
+    while (highlighter.background_step(64)) {
+    }
+    std::vector<std::string> expected = reference_highlight(table.text());
+    ASSERT_EQ(highlighter.line_count(), expected.size());
+    for (uint64_t line = 0; line < expected.size(); ++line) {
+        const std::vector<TokenSpan>* spans = highlighter.spans(line);
+        ASSERT_NE(spans, nullptr) << "line " << line;
+        ASSERT_EQ(describe(table.line(line), *spans), expected[line]) << "line " << line;
+    }
+}
+
+} // namespace
+
+TEST(CppLexerTest, HighlightsTokens) {
+    EXPECT_EQ(lex("int main() { return 0x1F + 2.5e-3; }"), "type:int kw:return num:0x1F num:2.5e-3");
+    EXPECT_EQ(lex("  #include <vector> // note"), "pp:#include <vector>  cmt:// note");
+    EXPECT_EQ(lex("auto s = u8\"a\\\"b\" + 'x';"), "kw:auto str:u8\"a\\\"b\" chr:'x'");
+    EXPECT_EQ(lex("const char* r = R\"x(a \")\" b)x\";"), "kw:const type:char str:R\"x(a \")\" b)x\"");
+    EXPECT_EQ(lex("a /* b */ + uint64_t(1'000)"), "cmt:/* b */ type:uint64_t num:1'000");
+    EXPECT_EQ(lex("integer returns"), "");
+}
+
+TEST(CppLexerTest, CarriesStateAcrossLines) {
+    LexState state;
+    EXPECT_EQ(lex("x = 1; /* start", state), "num:1 cmt:/* start");
+    EXPECT_EQ(state.kind, LexState::BlockComment);
+    EXPECT_EQ(lex("int still comment", state), "cmt:int still comment");
+    EXPECT_EQ(lex("end */ int y;", state), "cmt:end */ type:int");
+    EXPECT_EQ(state.kind, LexState::Normal);
+
+    EXPECT_EQ(lex("auto q = R\"delim(", state), "kw:auto str:R\"delim(");
+    EXPECT_EQ(state.kind, LexState::RawString);
+    EXPECT_EQ(lex(")\" )other\" return", state), "str:)\" )other\" return");
+    EXPECT_EQ(lex(")delim\"; return", state), "str:)delim\" kw:return");
+    EXPECT_EQ(state.kind, LexState::Normal);
+
+    EXPECT_EQ(lex("#define F(x) \\", state), "pp:#define F(x) \\");
+    EXPECT_EQ(state.kind, LexState::Preprocessor);
+    EXPECT_EQ(lex("    (x + 1)", state), "pp:    (x + 1)");
+    EXPECT_EQ(state.kind, LexState::Normal);
+}
+
+TEST(HighlighterTest, RelexesOnlyWhatAnEditAffects) {
+    std::string text;
+    for (int i = 0; i < 1000; ++i) {
+        text += "int value" + std::to_string(i) + " = " + std::to_string(i) + "; // note\n";
+    }
+    PieceTable table;
+    table.assign(text);
+    Highlighter highlighter(table);
+    highlighter.set_viewport(0, 40);
+    EXPECT_EQ(highlighter.valid_lines(), 40u);
+    EXPECT_EQ(highlighter.spans(40), nullptr);
+
+    // Typing inside a line re-lexes that line alone.
+    uint64_t before = highlighter.lexed_lines();
+    table.insert(table.line_start(10) + 3, "x");
+    highlighter.edit(10, 1, 1);
+    EXPECT_EQ(highlighter.lexed_lines() - before, 1u);
+    EXPECT_EQ(highlighter.valid_lines(), 40u);
+
+    // Opening a comment changes every later line, but only the viewport is
+    // re-lexed now.
+    before = highlighter.lexed_lines();
+    table.insert(table.line_start(20), "/*");
+    highlighter.edit(20, 1, 1);
+    EXPECT_EQ(highlighter.lexed_lines() - before, 20u);
+    EXPECT_EQ(describe(table.line(30), *highlighter.spans(30)), "cmt:" + table.line(30));
+
+    // Closing it again converges as soon as the old states line up.
+    before = highlighter.lexed_lines();
+    table.insert(table.line_start(21), "*/");
+    highlighter.edit(21, 1, 1);
+    EXPECT_EQ(highlighter.lexed_lines() - before, 19u);
+    expect_matches_reference(highlighter, table);
+
+    // Now that everything is highlighted, an edit that changes nothing else
+    // leaves the whole document valid.
+    highlighter.set_viewport(490, 530);
+    before = highlighter.lexed_lines();
+    table.insert(table.line_start(500), "\n");
+    highlighter.edit(500, 1, 2);
+    EXPECT_EQ(highlighter.lexed_lines() - before, 2u);
+    EXPECT_EQ(highlighter.valid_lines(), highlighter.line_count());
+}
+
+TEST(HighlighterTest, MatchesFullRelexAfterRandomEdits) {
+    const std::vector<std::string> snippets = {
+        "/*", "*/", "\"", "R\"x(", ")x\"", "\\", "//", "#if 1", "\n", "\n\n", "int ", "'a'", "42", "return ", " ",
+    };
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += i % 7 == 0 ? "#define M(a) a \\\n" : "static int f" + std::to_string(i) + "() { return 1; }\n";
+    }
+    PieceTable table;
+    table.assign(text);
+    Highlighter highlighter(table);
+    highlighter.set_viewport(50, 80);
+
+    std::mt19937 rng(5);
+    for (int step = 0; step < 300; ++step) {
+        uint64_t offset = rng() % (table.size() + 1);
+        uint64_t first_line = table.line_of(offset);
+        if (rng() % 3 == 0 && offset < table.size()) {
+            uint64_t length = 1 + rng() % 12;
+            length = std::min(length, table.size() - offset);
+            uint64_t last_line = table.line_of(offset + length);
+            table.erase(offset, length);
+            highlighter.edit(first_line, last_line - first_line + 1, 1);
+        } else {
+            const std::string& snippet = snippets[rng() % snippets.size()];
+            table.insert(offset, snippet);
+            uint64_t added = std::count(snippet.begin(), snippet.end(), '\n');
+            highlighter.edit(first_line, 1, 1 + added);
+        }
+        ASSERT_EQ(highlighter.line_count(), table.line_count());
+        if (step % 5 == 0) {
+            highlighter.background_step(rng() % 100);
+        }
+        if (step % 50 == 0) {
+            expect_matches_reference(highlighter, table);
+        }
+    }
+    expect_matches_reference(highlighter, table);
+}
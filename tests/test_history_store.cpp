@@ -0,0 +1,190 @@
+#include "gtest/gtest.h"
+#include "../core/history_store.hpp"
+#include <cstdio>  // For std::remove
+#include <fstream>
+#include <string>
+
+// Test fixture for HistoryStore tests
+class HistoryStoreTest : public ::testing::Test {
+protected:
+    const std::string history_filename_ = "temp_test_history.log";
+
+    void SetUp() override {
+        std::remove(history_filename_.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(history_filename_.c_str());
+    }
+};
+
+TEST_F(HistoryStoreTest, AppendAndReadBack) {
+    Neurodeck::HistoryStore store;
+    ASSERT_TRUE(store.open(history_filename_));
+    EXPECT_EQ(store.size(), 0u);
+
+    ASSERT_TRUE(store.append("ls -l", "/home/user", 0, 1500, 1700000000));
+    ASSERT_TRUE(store.append("open notes.txt", "/tmp", 3, 42, 1700000005));
+    EXPECT_EQ(store.refresh(), 2u);
+    ASSERT_EQ(store.size(), 2u);
+
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(store.get(1, entry));
+    EXPECT_EQ(entry.id, 1u);
+    EXPECT_EQ(entry.command, "open notes.txt");
+    EXPECT_EQ(entry.cwd, "/tmp");
+    EXPECT_EQ(entry.exit_status, 3);
+    EXPECT_EQ(entry.duration_us, 42);
+    EXPECT_EQ(entry.timestamp, 1700000005);
+    EXPECT_FALSE(store.get(2, entry));
+}
+
+TEST_F(HistoryStoreTest, PersistsAcrossReopen) {
+    {
+        Neurodeck::HistoryStore store;
+        ASSERT_TRUE(store.open(history_filename_));
+        ASSERT_TRUE(store.append("help", "/", 0, 1));
+    }
+    Neurodeck::HistoryStore reopened;
+    ASSERT_TRUE(reopened.open(history_filename_));
+    ASSERT_EQ(reopened.size(), 1u);
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(reopened.get(0, entry));
+    EXPECT_EQ(entry.command, "help");
+}
+
+TEST_F(HistoryStoreTest, SessionsSeeEachOthersAppends) {
+    Neurodeck::HistoryStore first;
+    Neurodeck::HistoryStore second;
+    ASSERT_TRUE(first.open(history_filename_));
+    ASSERT_TRUE(second.open(history_filename_));
+
+    ASSERT_TRUE(first.append("clear", "/", 0, 1));
+    ASSERT_TRUE(second.append("calendar week", "/", 0, 1));
+    ASSERT_TRUE(first.append("ls", "/", 0, 1));
+
+    EXPECT_EQ(first.refresh(), 3u);
+    EXPECT_EQ(second.refresh(), 3u);
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(first.find_previous("calendar", first.end_id(), entry));
+    EXPECT_EQ(entry.id, 1u);
+}
+
+TEST_F(HistoryStoreTest, FindPreviousWalksBackwards) {
+    Neurodeck::HistoryStore store;
+    ASSERT_TRUE(store.open(history_filename_));
+    store.append("git status", "/", 0, 1);
+    store.append("make test", "/", 0, 1);
+    store.append("git commit -m wip", "/", 0, 1);
+    store.append("gitk", "/", 0, 1);
+    store.refresh();
+
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(store.find_previous("git ", store.end_id(), entry));
+    EXPECT_EQ(entry.command, "git commit -m wip");
+    ASSERT_TRUE(store.find_previous("git ", entry.id, entry));
+    EXPECT_EQ(entry.command, "git status");
+    EXPECT_FALSE(store.find_previous("git ", entry.id, entry));
+
+    // Queries shorter than a trigram still work.
+    ASSERT_TRUE(store.find_previous("k", store.end_id(), entry));
+    EXPECT_EQ(entry.command, "gitk");
+
+    // Every trigram present, but not adjacent: must not match.
+    EXPECT_FALSE(store.find_previous("makegit", store.end_id(), entry));
+    EXPECT_FALSE(store.find_previous("absent", store.end_id(), entry));
+}
+
+TEST_F(HistoryStoreTest, SearchReturnsDistinctCommandsNewestFirst) {
+    Neurodeck::HistoryStore store;
+    ASSERT_TRUE(store.open(history_filename_));
+    store.append("open a.txt", "/", 0, 1);
+    store.append("open b.txt", "/", 0, 1);
+    store.append("open a.txt", "/", 0, 1);
+    store.append("ls", "/", 0, 1);
+    store.refresh();
+
+    auto results = store.search("open", 10);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].command, "open a.txt");
+    EXPECT_EQ(results[0].id, 2u);
+    EXPECT_EQ(results[1].command, "open b.txt");
+
+    EXPECT_EQ(store.search("open", 1).size(), 1u);
+}
+
+TEST_F(HistoryStoreTest, IndexWindowIsBounded) {
+    Neurodeck::HistoryStore store(4);
+    ASSERT_TRUE(store.open(history_filename_));
+    for (int i = 0; i < 20; ++i) {
+        store.append("command number " + std::to_string(i), "/", 0, 1);
+    }
+    store.refresh();
+
+    EXPECT_EQ(store.size(), 4u);
+    EXPECT_EQ(store.first_id(), 16u);
+    EXPECT_EQ(store.end_id(), 20u);
+
+    Neurodeck::HistoryStore::Entry entry;
+    EXPECT_FALSE(store.find_previous("number 3", store.end_id(), entry));
+    ASSERT_TRUE(store.find_previous("number 17", store.end_id(), entry));
+    EXPECT_EQ(entry.id, 17u);
+    EXPECT_EQ(store.search("command", 100).size(), 4u);
+}
+
+TEST_F(HistoryStoreTest, RejectsForeignFile) {
+    std::ofstream outfile(history_filename_);
+    outfile << "this is not a history log";
+    outfile.close();
+
+    Neurodeck::HistoryStore store;
+    EXPECT_FALSE(store.open(history_filename_));
+    EXPECT_FALSE(store.is_open());
+    EXPECT_FALSE(store.append("ls", "/", 0, 1));
+}
+
+TEST_F(HistoryStoreTest, SkipsTornRecords) {
+    {
+        Neurodeck::HistoryStore store;
+        ASSERT_TRUE(store.open(history_filename_));
+        store.append("before", "/", 0, 1);
+    }
+    {
+        // Simulate a write that died halfway through.
+        std::ofstream outfile(history_filename_, std::ios::app | std::ios::binary);
+        outfile << "garbage!garbage!";
+    }
+    Neurodeck::HistoryStore store;
+    ASSERT_TRUE(store.open(history_filename_));
+    store.append("after", "/", 0, 1);
+    store.refresh();
+
+    ASSERT_EQ(store.size(), 2u);
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(store.get(1, entry));
+    EXPECT_EQ(entry.command, "after");
+}
+
+TEST_F(HistoryStoreTest, SkipsCorruptLengthsAndTornTails) {
+    Neurodeck::HistoryStore store;
+    ASSERT_TRUE(store.open(history_filename_));
+    store.append("before", "/", 0, 1);
+    EXPECT_EQ(store.refresh(), 1u);
+    {
+        // A header claiming 2 GiB, then one claiming a little more than is
+        // there, as if its writer died. Neither may hold up what follows.
+        std::ofstream outfile(history_filename_, std::ios::app | std::ios::binary);
+        const uint32_t huge[10] = {0x5248444e, 0x80000000u};
+        outfile.write(reinterpret_cast<const char*>(huge), sizeof(huge));
+        const uint32_t torn[10] = {0x5248444e, 4096};
+        outfile.write(reinterpret_cast<const char*>(torn), sizeof(torn));
+        outfile.write("half a comm", 11);
+    }
+    EXPECT_EQ(store.refresh(), 0u);
+    store.append("after", "/", 0, 1);
+    EXPECT_EQ(store.refresh(), 1u);
+
+    Neurodeck::HistoryStore::Entry entry;
+    ASSERT_TRUE(store.get(1, entry));
+    EXPECT_EQ(entry.command, "after");
+}
@@ -0,0 +1,216 @@
+#include "gtest/gtest.h"
+#include "line_editor.hpp"
+#include "../core/history_store.hpp"
+#include <cstdio>  // For std::remove
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+// Feeds scripted keystrokes to a LineEditor through temporary files, which
+// (unlike pipes) never block however much the editor writes back.
+class LineEditorTest : public ::testing::Test {
+protected:
+    const std::string input_filename_ = "temp_line_editor_in.txt";
+    const std::string output_filename_ = "temp_line_editor_out.txt";
+    int in_fd_ = -1;
+    int out_fd_ = -1;
+
+    void TearDown() override {
+        if (in_fd_ >= 0) close(in_fd_);
+        if (out_fd_ >= 0) close(out_fd_);
+        std::remove(input_filename_.c_str());
+        std::remove(output_filename_.c_str());
+    }
+
+    LineEditor make_editor(const std::string& keys) {
+        if (in_fd_ >= 0) close(in_fd_);
+        if (out_fd_ >= 0) close(out_fd_);
+        int fd = open(input_filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        EXPECT_EQ(write(fd, keys.data(), keys.size()), static_cast<ssize_t>(keys.size()));
+        close(fd);
+        in_fd_ = open(input_filename_.c_str(), O_RDONLY);
+        out_fd_ = open(output_filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        LineEditor editor(in_fd_, out_fd_);
+        editor.set_width(40);
+        return editor;
+    }
+
+    std::string edit(const std::string& keys) {
+        LineEditor editor = make_editor(keys);
+        std::string line;
+        EXPECT_TRUE(editor.read_line("> ", line));
+        return line;
+    }
+};
+
+TEST(LineLayoutTest, WrapsAtTerminalWidth) {
+    LineLayout layout = layout_line("$ ", "abcdefg", 7, 5);
+    ASSERT_EQ(layout.rows.size(), 2u);
+    EXPECT_EQ(layout.rows[0], "$ abc");
+    EXPECT_EQ(layout.rows[1], "defg");
+    EXPECT_EQ(layout.cursor_row, 1);
+    EXPECT_EQ(layout.cursor_col, 4);
+    // Cursor after a full row moves to the start of the next one.
+    LineLayout full = layout_line("$ ", "abc", 3, 5);
+    ASSERT_EQ(full.rows.size(), 2u);
+    EXPECT_EQ(full.cursor_row, 1);
+    EXPECT_EQ(full.cursor_col, 0);
+}
+
+TEST(LineLayoutTest, NewlinesUseContinuationPrompt) {
+    LineLayout layout = layout_line("$ ", "ls\nhelp", 4, 20);
+    ASSERT_EQ(layout.rows.size(), 2u);
+    EXPECT_EQ(layout.rows[0], "$ ls");
+    EXPECT_EQ(layout.rows[1], "> help");
+    EXPECT_EQ(layout.cursor_row, 1);
+    EXPECT_EQ(layout.cursor_col, 3);
+}
+
+TEST(LineLayoutTest, ControlCharactersUseCaretNotation) {
+    LineLayout layout = layout_line("", "a\tb", 3, 20);
+    EXPECT_EQ(layout.rows[0], "a^Ib");
+    EXPECT_EQ(layout.cursor_col, 4);
+}
+
+TEST(LineLayoutTest, DiffEmitsOnlyChangedCells) {
+    LineLayout before = layout_line("> ", "open notes", 10, 40);
+    LineLayout after = layout_line("> ", "open notes!", 11, 40);
+    EXPECT_EQ(diff_layouts(before, after, 40), "!");
+    EXPECT_EQ(diff_layouts(after, after, 40), "");
+}
+
+TEST(LineLayoutTest, DiffClearsRemovedCells) {
+    LineLayout before = layout_line("> ", "help me", 7, 40);
+    LineLayout after = layout_line("> ", "help", 4, 40);
+    EXPECT_EQ(diff_layouts(before, after, 40), "\x1b[3D\x1b[K");
+}
+
+TEST(LineLayoutTest, DiffClearsRowsThatDisappear) {
+    LineLayout before = layout_line("> ", "a\nb\nc", 5, 40);
+    LineLayout after = layout_line("> ", "a", 1, 40);
+    std::string out = diff_layouts(before, after, 40);
+    EXPECT_NE(out.find("\x1b[J"), std::string::npos);
+}
+
+TEST(LineLayoutTest, HintFollowsTextInGrey) {
+    LineLayout layout = layout_line("> ", "gi", 2, 40, "t");
+    EXPECT_EQ(layout.rows[0], "> gi\x1b[90mt\x1b[39m");
+    EXPECT_EQ(layout.cursor_col, 4);
+    // Typing the hinted character redraws just that cell, now uncoloured.
+    LineLayout typed = layout_line("> ", "git", 3, 40, "");
+    EXPECT_EQ(diff_layouts(layout, typed, 40), "t");
+    EXPECT_EQ(diff_layouts(typed, layout_line("> ", "git", 3, 40, " add"), 40),
+              "\x1b[90m \x1b[39m\x1b[90ma\x1b[39m\x1b[90md\x1b[39m\x1b[90md\x1b[39m\x1b[4D");
+}
+
+TEST_F(LineEditorTest, InsertsAtCursor) {
+    EXPECT_EQ(edit("abc\x1b[D\x1b[DX\r"), "aXbc");
+}
+
+TEST_F(LineEditorTest, HomeEndAndDelete) {
+    EXPECT_EQ(edit("bc\x01" "a\x05" "d\x1b[H\x1b[3~\r"), "bcd");
+}
+
+TEST_F(LineEditorTest, BackspaceRemovesWholeCodePoint) {
+    EXPECT_EQ(edit("caf\xc3\xa9\x7f" "e\r"), "cafe");
+}
+
+TEST_F(LineEditorTest, KillAndYank) {
+    EXPECT_EQ(edit("hello world\x17\x01\x19\r"), "worldhello ");
+    EXPECT_EQ(edit("one two\x01\x1b" "f\x0b\x19\x19\r"), "one two two");
+    EXPECT_EQ(edit("abc def\x15xyz\r"), "xyz");
+}
+
+TEST_F(LineEditorTest, ConsecutiveKillsAccumulate) {
+    EXPECT_EQ(edit("a b c\x17\x17\x19\r"), "a b c");
+}
+
+TEST_F(LineEditorTest, MultiLineEditing) {
+    EXPECT_EQ(edit("first\\\rsecond\r"), "first\nsecond");
+    EXPECT_EQ(edit("one\x1b\rtwo\x1b[A\x05!\r"), "one!\ntwo");
+}
+
+TEST_F(LineEditorTest, KeepsTypeaheadForTheNextLine) {
+    // Both lines arrive in one read, as an unbracketed paste would.
+    LineEditor editor = make_editor("echo one\rls -l\r");
+    std::string line;
+    ASSERT_TRUE(editor.read_line("> ", line));
+    EXPECT_EQ(line, "echo one");
+    ASSERT_TRUE(editor.read_line("> ", line));
+    EXPECT_EQ(line, "ls -l");
+    EXPECT_FALSE(editor.read_line("> ", line));
+}
+
+TEST_F(LineEditorTest, EndOfInputOnEmptyLine) {
+    LineEditor editor = make_editor("");
+    std::string line = "stale";
+    EXPECT_FALSE(editor.read_line("> ", line));
+    EXPECT_TRUE(line.empty());
+
+    LineEditor ctrl_d = make_editor("\x04");
+    EXPECT_FALSE(ctrl_d.read_line("> ", line));
+}
+
+TEST_F(LineEditorTest, LargePasteIsOneRedraw) {
+    std::string pasted;
+    for (int i = 0; pasted.size() < 100 * 1024; ++i) {
+        pasted += "line " + std::to_string(i) + "\r";
+    }
+    LineEditor editor = make_editor("\x1b[200~" + pasted + "\x1b[201~\r");
+    std::string line;
+    ASSERT_TRUE(editor.read_line("> ", line));
+
+    std::string expected = pasted;
+    for (char& c : expected) {
+        if (c == '\r') c = '\n';
+    }
+    EXPECT_EQ(line, expected);
+    // Prompt, pasted block, final cursor placement.
+    EXPECT_LE(editor.redraw_count(), 3u);
+}
+
+TEST_F(LineEditorTest, AcceptsSuggestionAtEndOfLine) {
+    auto suggester = [](const std::string& typed) {
+        return std::string("git commit -m wip").compare(0, typed.size(), typed) == 0 ? "git commit -m wip" : "";
+    };
+    LineEditor editor = make_editor("gi\x1b[C\r");
+    editor.set_suggester(suggester);
+    std::string line;
+    ASSERT_TRUE(editor.read_line("> ", line));
+    EXPECT_EQ(line, "git commit -m wip");
+
+    // Alt-F takes one word; Right in the middle of the line only moves.
+    LineEditor word = make_editor("git c\x1b" "f\x1b[D\x1b[C!\r");
+    word.set_suggester(suggester);
+    ASSERT_TRUE(word.read_line("> ", line));
+    EXPECT_EQ(line, "git commit!");
+
+    LineEditor middle = make_editor("gx\x1b[D\x1b[Ci\r");
+    middle.set_suggester(suggester);
+    ASSERT_TRUE(middle.read_line("> ", line));
+    EXPECT_EQ(line, "gxi");
+}
+
+TEST_F(LineEditorTest, ReverseSearchUsesHistory) {
+    const std::string history_filename = "temp_line_editor_history.log";
+    std::remove(history_filename.c_str());
+    Neurodeck::HistoryStore history;
+    ASSERT_TRUE(history.open(history_filename));
+    history.append("open notes.txt", "/", 0, 1);
+    history.append("calendar week", "/", 0, 1);
+    history.append("open todo.txt", "/", 0, 1);
+
+    LineEditor editor = make_editor("\x12open\x12\r");
+    editor.set_history(&history);
+    std::string line;
+    ASSERT_TRUE(editor.read_line("> ", line));
+    EXPECT_EQ(line, "open notes.txt");
+
+    LineEditor recall = make_editor("\x1b[A\x1b[A\r");
+    recall.set_history(&history);
+    ASSERT_TRUE(recall.read_line("> ", line));
+    EXPECT_EQ(line, "calendar week");
+
+    history.close();
+    std::remove(history_filename.c_str());
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include "../core/line_index.hpp"
+#include "../core/mapped_file.hpp"
+#include <cstdio>  // For std::remove
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Test fixture providing a scratch file.
+class LineIndexTest : public ::testing::Test {
+protected:
+    const std::string filename_ = "temp_line_index.txt";
+
+    void TearDown() override {
+        std::remove(filename_.c_str());
+    }
+
+    void write_lines(int count, std::ios::openmode mode = std::ios::trunc) {
+        std::ofstream file(filename_, std::ios::out | mode);
+        for (int i = 0; i < count; ++i) file << "line " << i << "\n";
+    }
+};
+
+TEST_F(LineIndexTest, MappedFileSeesGrowthAfterRefresh) {
+    write_lines(2);
+    Neurodeck::MappedFile file;
+    ASSERT_TRUE(file.open(filename_));
+    EXPECT_EQ(std::string(file.data(), file.size()), "line 0\nline 1\n");
+    EXPECT_FALSE(file.refresh());
+    write_lines(1, std::ios::app);
+    EXPECT_TRUE(file.refresh());
+    EXPECT_EQ(file.size(), 21u);
+    EXPECT_FALSE(file.open("temp_missing_file.txt"));
+}
+
+TEST_F(LineIndexTest, MappedFileSurvivesTruncationDuringAnAccess) {
+    write_lines(1000);
+    Neurodeck::MappedFile file;
+    ASSERT_TRUE(file.open(filename_));
+    uint64_t size = file.size();
+    write_lines(0);
+
+    file.begin_access();
+    char last = static_cast<const volatile char*>(file.data())[size - 1];
+    EXPECT_FALSE(file.end_access());
+    EXPECT_EQ(last, '\0');
+    EXPECT_TRUE(file.refresh());
+    EXPECT_EQ(file.size(), 0u);
+
+    // A read that faulted remaps even if the file is back at the same size.
+    write_lines(1000);
+    EXPECT_TRUE(file.refresh());
+    file.begin_access();
+    last = file.data()[size - 1];
+    EXPECT_TRUE(file.end_access());
+    EXPECT_EQ(last, '\n');
+}
+
+TEST_F(LineIndexTest, CheckpointsEveryStrideLines) {
+    write_lines(1000);
+    Neurodeck::LineIndex index(100);
+    ASSERT_TRUE(index.start(filename_, false));
+    ASSERT_TRUE(index.wait_until_end(5000));
+    EXPECT_EQ(index.newline_count(), 1000u);
+
+    Neurodeck::MappedFile file;
+    ASSERT_TRUE(file.open(filename_));
+    uint64_t line, offset;
+    ASSERT_TRUE(index.seek_line(456, line, offset));
+    EXPECT_EQ(line, 400u);
+    EXPECT_EQ(std::string(file.data() + offset, 9), "line 400\n");
+
+    ASSERT_TRUE(index.seek_offset(offset + 3, line, offset));
+    EXPECT_EQ(line, 400u);
+    ASSERT_TRUE(index.seek_offset(0, line, offset));
+    EXPECT_EQ(line, 0u);
+    EXPECT_EQ(offset, 0u);
+}
+
+TEST_F(LineIndexTest, FollowedFileIsIndexedAsItGrows) {
+    write_lines(10);
+    Neurodeck::LineIndex index(4);
+    ASSERT_TRUE(index.start(filename_, true));
+    ASSERT_TRUE(index.wait_until_end(5000));
+    EXPECT_EQ(index.newline_count(), 10u);
+
+    write_lines(20, std::ios::app);
+    for (int i = 0; i < 500 && index.newline_count() < 30; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(index.newline_count(), 30u);
+    uint64_t line, offset;
+    ASSERT_TRUE(index.seek_line(30, line, offset));
+    EXPECT_EQ(line, 28u);
+    index.stop();
+}
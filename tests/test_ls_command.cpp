@@ -1,30 +1,51 @@
 #include "gtest/gtest.h"
 #include "../shell/commands/ls.hpp" // Include the header for LsCommand
-#include <sstream> // For std::stringstream
-#include <iostream> // For std::cout, std::streambuf
-#include <vector>   // For std::vector
-#include <string>   // For std::string
+#include "../shell/dir_listing.hpp"
+#include <algorithm>
+#include <cstdio>   // For std::remove
+#include <fcntl.h>
 #include <memory>   // For std::unique_ptr
+#include <random>
+#include <sstream>  // For std::stringstream
+#include <string>   // For std::string
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>   // For std::vector
 
-// Test fixture for LsCommand tests
+// Test fixture that builds a scratch directory to list.
 class LsCommandTest : public ::testing::Test {
 protected:
-    std::stringstream captured_output_;
-    std::streambuf* original_cout_buf_;
-    std::string expected_ls_output_;
+    const std::string dir_ = "temp_ls_dir";
+    std::vector<std::string> created_;
 
     void SetUp() override {
-        original_cout_buf_ = std::cout.rdbuf(); // Save original cout buffer
-        std::cout.rdbuf(captured_output_.rdbuf()); // Redirect cout to stringstream
-        expected_ls_output_ = "Available modules/apps:\n"
-                              " notes  - textual note manager\n"
-                              " calendar - calendar and event manager\n"
-                              " ide - integrated development environment\n"
-                              " calculator - simple calculator\n";
+        ASSERT_EQ(mkdir(dir_.c_str(), 0755), 0);
     }
 
     void TearDown() override {
-        std::cout.rdbuf(original_cout_buf_); // Restore original cout buffer
+        for (const auto& name : created_) std::remove((dir_ + "/" + name).c_str());
+        rmdir(dir_.c_str());
+    }
+
+    void make_file(const std::string& name, size_t size = 0, time_t mtime = 0) {
+        std::string path = dir_ + "/" + name;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+        std::string data(size, 'x');
+        ASSERT_EQ(write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+        close(fd);
+        if (mtime) {
+            struct timespec times[2] = {{mtime, 0}, {mtime, 0}};
+            ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+        }
+        created_.push_back(name);
+    }
+
+    std::string list(const LsOptions& options) {
+        std::stringstream out;
+        std::string error;
+        EXPECT_TRUE(list_path(dir_, options, out, error)) << error;
+        return out.str();
     }
 };
 
@@ -34,22 +55,123 @@ TEST_F(LsCommandTest, NameIsCorrect) {
     EXPECT_EQ(cmd->name(), "ls");
 }
 
-TEST_F(LsCommandTest, RunOutputsModuleList) {
-    std::unique_ptr<Command> cmd = make_ls();
-    ASSERT_NE(cmd, nullptr);
-    
-    cmd->run({}); // Pass an empty vector for args
-    
-    std::string output = captured_output_.str();
-    EXPECT_EQ(output, expected_ls_output_);
+TEST_F(LsCommandTest, ParsesCombinedFlagsAndPaths) {
+    LsOptions options;
+    std::vector<std::string> paths;
+    std::string error;
+    ASSERT_TRUE(parse_ls_args({"ls", "-lar", "src", "-S", "--", "-odd"}, options, paths, error));
+    EXPECT_TRUE(options.long_format);
+    EXPECT_TRUE(options.all);
+    EXPECT_TRUE(options.reverse);
+    EXPECT_EQ(options.sort, LsSort::Size);
+    EXPECT_EQ(paths, (std::vector<std::string>{"src", "-odd"}));
+
+    LsOptions defaults;
+    paths.clear();
+    ASSERT_TRUE(parse_ls_args({"ls"}, defaults, paths, error));
+    EXPECT_EQ(paths, std::vector<std::string>{"."});
+    EXPECT_FALSE(parse_ls_args({"ls", "-z"}, defaults, paths, error));
+    EXPECT_EQ(error, "invalid option -- 'z'");
 }
 
-TEST_F(LsCommandTest, RunIgnoresArguments) {
-    std::unique_ptr<Command> cmd = make_ls();
-    ASSERT_NE(cmd, nullptr);
-    
-    cmd->run({"some", "args"}); // Pass some arguments
-    
-    std::string output = captured_output_.str();
-    EXPECT_EQ(output, expected_ls_output_);
+TEST_F(LsCommandTest, NameSortNeedsNoMetadata) {
+    make_file("beta");
+    make_file("Alpha");
+    make_file("alpha");
+    make_file(".hidden");
+    LsOptions options;
+    EXPECT_EQ(ls_metadata_mask(options), 0u);
+    EXPECT_EQ(list(options), "Alpha\nalpha\nbeta\n");
+
+    options.all = true;
+    EXPECT_EQ(list(options), ".hidden\nAlpha\nalpha\nbeta\n");
+    options.reverse = true;
+    EXPECT_EQ(list(options), "beta\nalpha\nAlpha\n.hidden\n");
+}
+
+TEST_F(LsCommandTest, SortsBySizeAndTime) {
+    make_file("small", 10, 1000000);
+    make_file("large", 300, 3000000);
+    make_file("medium", 100, 2000000);
+    make_file("tie", 100, 2000000);
+
+    LsOptions options;
+    options.sort = LsSort::Size;
+    EXPECT_EQ(list(options), "large\nmedium\ntie\nsmall\n");
+    options.sort = LsSort::Time;
+    EXPECT_EQ(list(options), "large\nmedium\ntie\nsmall\n");
+    options.reverse = true;
+    EXPECT_EQ(list(options), "small\ntie\nmedium\nlarge\n");
+}
+
+TEST_F(LsCommandTest, LongFormatShowsModeSizeAndName) {
+    make_file("data.txt", 1234);
+    chmod((dir_ + "/data.txt").c_str(), 0640);
+    LsOptions options;
+    options.long_format = true;
+    std::string out = list(options);
+    EXPECT_EQ(out.substr(0, 11), "-rw-r----- ");
+    EXPECT_NE(out.find(" 1234 "), std::string::npos) << out;
+    EXPECT_EQ(out.substr(out.size() - 9), "data.txt\n");
+}
+
+TEST_F(LsCommandTest, UnsortedOutputListsEveryEntry) {
+    for (int i = 0; i < 300; ++i) make_file("f" + std::to_string(i));
+    LsOptions options;
+    options.sort = LsSort::None;
+    std::stringstream in(list(options));
+    std::vector<std::string> names;
+    for (std::string line; std::getline(in, line);) names.push_back(line);
+    std::sort(names.begin(), names.end());
+    std::vector<std::string> expected = created_;
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(names, expected);
+}
+
+TEST_F(LsCommandTest, MetadataIsFetchedAcrossThreads) {
+    for (int i = 0; i < 5000; ++i) make_file("n" + std::to_string(i), i % 7);
+    DirectoryReader reader;
+    ASSERT_TRUE(reader.open(dir_));
+    DirectoryListing listing;
+    int status;
+    while ((status = reader.read_batch(listing, false)) > 0) {
+    }
+    ASSERT_EQ(status, 0);
+    ASSERT_EQ(listing.size(), 5000u);
+    listing.fetch_metadata(reader.fd(), STATX_SIZE, 4);
+    EXPECT_EQ(listing.stat_calls(), 5000u);
+    for (size_t i = 0; i < listing.size(); ++i) {
+        ASSERT_TRUE(listing.entry(i).has_stat);
+        EXPECT_EQ(listing.entry(i).size, static_cast<uint64_t>(std::stoi(listing.name(i) + 1) % 7));
+    }
+}
+
+TEST_F(LsCommandTest, RadixNameOrderMatchesByteOrder) {
+    // Many names share their first eight bytes, exercising the tie-break.
+    std::mt19937 rng(42);
+    std::vector<std::string> names;
+    DirectoryListing listing;
+    for (int i = 0; i < 4000; ++i) {
+        std::string name = (i % 3 == 0) ? "shared_prefix_" : "";
+        int length = 1 + static_cast<int>(rng() % 12);
+        for (int j = 0; j < length; ++j) name += static_cast<char>('0' + rng() % 75);
+        names.push_back(name);
+        listing.add(name.data(), name.size(), 0);
+    }
+    std::vector<uint32_t> order = listing.order(LsSort::Name, false);
+    std::vector<std::string> sorted;
+    for (uint32_t i : order) sorted.emplace_back(listing.name(i));
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(sorted, names);
+}
+
+TEST_F(LsCommandTest, PlainFileAndMissingPath) {
+    make_file("only");
+    std::stringstream out;
+    std::string error;
+    ASSERT_TRUE(list_path(dir_ + "/only", LsOptions(), out, error));
+    EXPECT_EQ(out.str(), dir_ + "/only\n");
+
+    EXPECT_FALSE(list_path(dir_ + "/missing", LsOptions(), out, error));
+    EXPECT_EQ(error, "cannot access '" + dir_ + "/missing': No such file or directory");
 }
@@ -0,0 +1,220 @@
+#include "gtest/gtest.h"
+#include "note_store.hpp"
+#include <cstddef> // For offsetof
+#include <cstdio>  // For std::remove
+#include <dirent.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using Neurodeck::NoteStore;
+
+// Test fixture giving each test an empty store directory.
+class NoteStoreTest : public ::testing::Test {
+protected:
+    const std::string dir_ = "temp_note_store";
+
+    void SetUp() override { remove_dir(); }
+    void TearDown() override { remove_dir(); }
+
+    void remove_dir() {
+        if (DIR* dir = opendir(dir_.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != "..") std::remove((dir_ + "/" + name).c_str());
+            }
+            closedir(dir);
+            rmdir(dir_.c_str());
+        }
+    }
+
+    static std::vector<uint32_t> ids(const std::vector<NoteStore::Hit>& hits) {
+        std::vector<uint32_t> result;
+        for (const auto& hit : hits) result.push_back(hit.id);
+        return result;
+    }
+};
+
+TEST_F(NoteStoreTest, TokenizesAndRoundTripsSegments) {
+    std::vector<std::string> terms;
+    const std::string text = "Buy MILK, eggs & 2 café-crèmes";
+    Neurodeck::tokenize_note(text.data(), text.size(), terms);
+    EXPECT_EQ(terms, (std::vector<std::string>{"buy", "milk", "eggs", "2", "café", "crèmes"}));
+
+    ASSERT_EQ(mkdir(dir_.c_str(), 0700), 0);
+    Neurodeck::SegmentBuilder builder;
+    for (uint32_t i = 0; i < 1000; ++i) builder.add_doc(i + 1, 10, 64 * i);
+    builder.begin_term("alpha");
+    builder.add_posting(0, 1);
+    builder.add_posting(3, 7);
+    builder.add_posting(999, 1);
+    builder.end_term();
+    builder.begin_term("empty"); // Dropped: no postings.
+    builder.end_term();
+    builder.begin_term("omega");
+    builder.add_posting(500, 300);
+    builder.end_term();
+    ASSERT_TRUE(builder.write(dir_ + "/seg.ndx"));
+
+    Neurodeck::NoteSegment segment;
+    ASSERT_TRUE(segment.open(dir_ + "/seg.ndx"));
+    EXPECT_EQ(segment.doc_count(), 1000u);
+    EXPECT_EQ(segment.total_length(), 10000u);
+    EXPECT_EQ(segment.doc(999).record_offset, 64u * 999);
+    ASSERT_EQ(segment.term_count(), 2u);
+    EXPECT_EQ(segment.find("empty"), segment.term_count());
+    EXPECT_EQ(segment.lower_bound("b"), 1u);
+
+    uint32_t index = segment.find("alpha");
+    ASSERT_LT(index, segment.term_count());
+    EXPECT_EQ(segment.term(index).doc_freq, 3u);
+    Neurodeck::PostingReader reader = segment.postings(index);
+    std::vector<std::pair<uint32_t, uint32_t>> postings;
+    uint32_t ordinal, tf;
+    while (reader.next(ordinal, tf)) postings.emplace_back(ordinal, tf);
+    EXPECT_EQ(postings, (std::vector<std::pair<uint32_t, uint32_t>>{{0, 1}, {3, 7}, {999, 1}}));
+    // Small deltas with tf 1 take a single byte each.
+    EXPECT_EQ(segment.term(index).postings_length, 1u + 2u + 2u);
+}
+
+TEST_F(NoteStoreTest, RejectsSegmentsWithTermsOutOfRange) {
+    ASSERT_EQ(mkdir(dir_.c_str(), 0700), 0);
+    Neurodeck::SegmentBuilder builder;
+    builder.add_doc(1, 1, 0);
+    builder.begin_term("alpha");
+    builder.add_posting(0, 1);
+    builder.end_term();
+    ASSERT_TRUE(builder.write(dir_ + "/seg.ndx"));
+
+    // The only term entry follows the 64-byte header and one doc; make its
+    // postings run past the end of the file.
+    const long term_offset = 64 + sizeof(Neurodeck::SegmentDoc);
+    const uint32_t length = 1u << 20;
+    std::fstream file(dir_ + "/seg.ndx", std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(term_offset + offsetof(Neurodeck::SegmentTerm, postings_length));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.close();
+    Neurodeck::NoteSegment segment;
+    EXPECT_FALSE(segment.open(dir_ + "/seg.ndx"));
+
+    // The same for its text.
+    ASSERT_TRUE(builder.write(dir_ + "/seg.ndx"));
+    file.open(dir_ + "/seg.ndx", std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(term_offset + offsetof(Neurodeck::SegmentTerm, string_offset));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.close();
+    EXPECT_FALSE(segment.open(dir_ + "/seg.ndx"));
+
+    ASSERT_TRUE(builder.write(dir_ + "/seg.ndx"));
+    EXPECT_TRUE(segment.open(dir_ + "/seg.ndx"));
+}
+
+TEST_F(NoteStoreTest, RanksMatchesByRelevance) {
+    NoteStore store;
+    ASSERT_TRUE(store.open(dir_));
+    uint32_t groceries = store.add("groceries: apples, pears, apples again");
+    uint32_t recipe = store.add("apple pie recipe with a long list of other ingredients and steps to follow");
+    uint32_t unrelated = store.add("call the dentist");
+    EXPECT_EQ(store.size(), 3u);
+
+    auto hits = store.search("apples", 10);
+    EXPECT_EQ(ids(hits), (std::vector<uint32_t>{groceries}));
+    hits = store.search("apple*", 10);
+    EXPECT_EQ(ids(hits), (std::vector<uint32_t>{groceries, recipe}));
+    hits = store.search("DENTIST pie", 10);
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(store.search("dentist", 1)[0].id, unrelated);
+    EXPECT_TRUE(store.search("nothing", 10).empty());
+
+    NoteStore::Note note;
+    ASSERT_TRUE(store.get(recipe, note));
+    EXPECT_EQ(note.text, "apple pie recipe with a long list of other ingredients and steps to follow");
+}
+
+TEST_F(NoteStoreTest, EditsAndDeletesHideOldVersions) {
+    NoteStore::Options options;
+    options.flush_threshold = 2;
+    NoteStore store(options);
+    ASSERT_TRUE(store.open(dir_));
+    uint32_t first = store.add("draft about rockets");
+    uint32_t second = store.add("rockets and boosters");
+    ASSERT_TRUE(store.flush());
+
+    // The old versions now sit in a segment file.
+    ASSERT_TRUE(store.update(first, "final text about satellites"));
+    ASSERT_TRUE(store.remove(second));
+    EXPECT_FALSE(store.remove(second));
+    EXPECT_TRUE(store.search("rockets", 10).empty());
+    EXPECT_EQ(ids(store.search("satellites", 10)), (std::vector<uint32_t>{first}));
+    EXPECT_EQ(store.size(), 1u);
+    NoteStore::Note note;
+    EXPECT_FALSE(store.get(second, note));
+}
+
+TEST_F(NoteStoreTest, ReopensFromSegmentsAndLogTail) {
+    NoteStore::Options options;
+    options.flush_threshold = 3;
+    options.background_merge = false;
+    uint32_t last = 0;
+    {
+        NoteStore store(options);
+        ASSERT_TRUE(store.open(dir_));
+        for (int i = 0; i < 5; ++i) last = store.add("note number " + std::to_string(i) + " shared");
+        // Another handle cannot take the store while this one holds it.
+        NoteStore other;
+        EXPECT_FALSE(other.open(dir_));
+    }
+    // Simulate a crash mid-append: garbage after the last record.
+    std::ofstream(dir_ + "/notes.log", std::ios::app | std::ios::binary) << "torn";
+
+    NoteStore store(options);
+    ASSERT_TRUE(store.open(dir_));
+    EXPECT_EQ(store.size(), 5u);
+    EXPECT_EQ(store.search("shared", 10).size(), 5u);
+    EXPECT_EQ(store.add("after reopen"), last + 1);
+    EXPECT_EQ(ids(store.search("reopen", 10)), (std::vector<uint32_t>{last + 1}));
+}
+
+TEST_F(NoteStoreTest, BackgroundMergesKeepResults) {
+    NoteStore::Options options;
+    options.flush_threshold = 4;
+    options.merge_factor = 2;
+    NoteStore store(options);
+    ASSERT_TRUE(store.open(dir_));
+    for (int i = 0; i < 64; ++i) {
+        store.add("entry " + std::to_string(i) + (i % 2 ? " odd" : " even"));
+        if (i % 8 == 0) store.update(static_cast<uint32_t>(i + 1), "rewritten " + std::to_string(i));
+    }
+    store.flush();
+    store.wait_for_merges();
+    // 18 flushed segments merge pairwise into a handful of larger ones.
+    EXPECT_LE(store.segment_count(), 4u);
+    EXPECT_EQ(store.search("even", 100).size(), 24u);
+    EXPECT_EQ(store.search("odd", 100).size(), 32u);
+    EXPECT_EQ(store.search("rewritten", 100).size(), 8u);
+    EXPECT_EQ(ids(store.search("17", 10)), (std::vector<uint32_t>{18}));
+}
+
+TEST_F(NoteStoreTest, FailedMergeLeavesItsInputsAndRetriesOnFlush) {
+    NoteStore::Options options;
+    options.flush_threshold = 4;
+    options.merge_factor = 2;
+    NoteStore store(options);
+    ASSERT_TRUE(store.open(dir_));
+    // The first merge writes the third segment; a directory in the way of
+    // its temporary file makes that fail.
+    const std::string blocker = dir_ + "/seg-00000003.ndx.tmp";
+    ASSERT_EQ(mkdir(blocker.c_str(), 0700), 0);
+    for (int i = 0; i < 8; ++i) store.add("entry " + std::to_string(i));
+    store.wait_for_merges();
+    EXPECT_EQ(store.segment_count(), 2u);
+    EXPECT_EQ(store.search("entry", 100).size(), 8u);
+
+    rmdir(blocker.c_str());
+    for (int i = 8; i < 12; ++i) store.add("entry " + std::to_string(i));
+    store.wait_for_merges();
+    EXPECT_EQ(store.segment_count(), 2u);
+    EXPECT_EQ(store.search("entry", 100).size(), 12u);
+}
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "../shell/pager.hpp"
+#include <cstdio>  // For std::remove
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+// Test fixture with a numbered file and a pager drawing into a scratch file.
+class PagerTest : public ::testing::Test {
+protected:
+    const std::string filename_ = "temp_pager_input.txt";
+    const std::string output_filename_ = "temp_pager_out.txt";
+    int out_fd_ = -1;
+
+    void SetUp() override {
+        write_lines(0, 1000, std::ios::trunc);
+        out_fd_ = open(output_filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(out_fd_, 0);
+    }
+
+    void TearDown() override {
+        close(out_fd_);
+        std::remove(filename_.c_str());
+        std::remove(output_filename_.c_str());
+    }
+
+    void write_lines(int first, int last, std::ios::openmode mode) {
+        std::ofstream file(filename_, std::ios::out | mode);
+        for (int i = first; i < last; ++i) file << "row " << i << "\n";
+    }
+
+    // Text of one screen row in the back buffer, trailing blanks removed.
+    static std::string row_text(Pager& pager, int y) {
+        std::string text;
+        const Neurodeck::ScreenBuffer& buffer = pager.screen().back();
+        for (int x = 0; x < buffer.width(); ++x) text += static_cast<char>(buffer.at(x, y).ch);
+        return text.substr(0, text.find_last_not_of(' ') + 1);
+    }
+
+    void open_pager(Pager& pager) {
+        ASSERT_TRUE(pager.open(filename_));
+        pager.set_size(40, 11);
+    }
+};
+
+TEST_F(PagerTest, FirstScreenRendersFromTheMapping) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 0");
+    EXPECT_EQ(row_text(pager, 9), "row 9");
+    EXPECT_EQ(row_text(pager, 10).substr(0, 27), "temp_pager_input.txt  line ");
+}
+
+TEST_F(PagerTest, ScrollingKeysMoveByLinesAndPages) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.handle_key('j');
+    pager.handle_key(Pager::kKeyDown);
+    pager.handle_key(' ');
+    uint64_t line;
+    ASSERT_TRUE(pager.top_line(line));
+    EXPECT_EQ(line, 12u);
+    pager.handle_key('k');
+    pager.handle_key('b');
+    ASSERT_TRUE(pager.top_line(line));
+    EXPECT_EQ(line, 1u);
+    pager.handle_key('b');
+    EXPECT_EQ(pager.top_offset(), 0u);
+}
+
+TEST_F(PagerTest, EndShowsTheLastPage) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.handle_key('G');
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 990");
+    EXPECT_EQ(row_text(pager, 9), "row 999");
+    pager.handle_key('j');
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 990"); // Cannot scroll past the end.
+    ASSERT_TRUE(pager.index().wait_until_end(5000));
+    uint64_t line;
+    ASSERT_TRUE(pager.top_line(line));
+    EXPECT_EQ(line, 990u);
+}
+
+TEST_F(PagerTest, GoToLineUsesTheIndex) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    ASSERT_TRUE(pager.index().wait_until_end(5000));
+    for (char c : std::string(":500\r")) pager.handle_key(c);
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 499");
+    EXPECT_FALSE(pager.jump_pending());
+}
+
+TEST_F(PagerTest, SearchForwardAndBackward) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    for (char c : std::string("/row 77\r")) pager.handle_key(c);
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 77");
+    pager.handle_key('n');
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 770");
+    pager.handle_key('N');
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "row 77");
+    for (char c : std::string("/no such text\r")) pager.handle_key(c);
+    EXPECT_EQ(pager.message(), "Pattern not found");
+}
+
+TEST_F(PagerTest, FollowTracksAppendedLines) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.handle_key('F');
+    EXPECT_TRUE(pager.following());
+    write_lines(1000, 1005, std::ios::app);
+    EXPECT_TRUE(pager.poll_file());
+    pager.render();
+    EXPECT_EQ(row_text(pager, 9), "row 1004");
+    pager.handle_key('k');
+    EXPECT_FALSE(pager.following());
+}
+
+TEST_F(PagerTest, TruncationWhileOpenShrinksTheView) {
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.handle_key('G');
+    pager.render();
+    EXPECT_EQ(row_text(pager, 9), "row 999");
+    write_lines(0, 5, std::ios::trunc);
+    EXPECT_TRUE(pager.poll_file());
+    EXPECT_EQ(pager.top_offset(), 0u);
+    pager.render();
+    EXPECT_EQ(row_text(pager, 4), "row 4");
+    EXPECT_EQ(row_text(pager, 5), "~");
+}
+
+TEST_F(PagerTest, ControlCharactersAndTabsAreMadeVisible) {
+    std::ofstream(filename_, std::ios::out | std::ios::trunc) << "a\tb\x01" << "c\r\n";
+    Pager pager(-1, out_fd_);
+    open_pager(pager);
+    pager.render();
+    EXPECT_EQ(row_text(pager, 0), "a       b^Ac");
+    EXPECT_EQ(row_text(pager, 1), "~");
+}
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include "../core/piece_table.hpp"
+#include <cstdio>  // For std::remove
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Neurodeck::PieceTable;
+
+namespace {
+
+// Line starts of `text` computed the obvious way.
+std::vector<uint64_t> reference_line_starts(const std::string& text) {
+    std::vector<uint64_t> starts{0};
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') starts.push_back(i + 1);
+    }
+    return starts;
+}
+
+void expect_matches(const PieceTable& table, const std::string& expected) {
+    ASSERT_EQ(table.size(), expected.size());
+    ASSERT_EQ(table.text(), expected);
+    std::vector<uint64_t> starts = reference_line_starts(expected);
+    ASSERT_EQ(table.line_count(), starts.size());
+    for (size_t line = 0; line < starts.size(); line += 1 + line / 4) {
+        ASSERT_EQ(table.line_start(line), starts[line]) << "line " << line;
+        ASSERT_EQ(table.line_of(starts[line]), line);
+    }
+    EXPECT_EQ(table.line_start(starts.size()), expected.size());
+}
+
+} // namespace
+
+// Test fixture providing a scratch file.
+class PieceTableTest : public ::testing::Test {
+protected:
+    const std::string filename_ = "temp_piece_table.txt";
+
+    void TearDown() override {
+        std::remove(filename_.c_str());
+        std::remove((filename_ + ".saved").c_str());
+    }
+
+    void write_file(const std::string& contents) {
+        std::ofstream file(filename_, std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+};
+
+TEST_F(PieceTableTest, EditsLinesAndUndo) {
+    PieceTable table;
+    table.assign("alpha\nbeta\ngamma");
+    EXPECT_EQ(table.line_count(), 3u);
+    EXPECT_EQ(table.line(1), "beta");
+    EXPECT_EQ(table.line(2), "gamma");
+    EXPECT_FALSE(table.can_undo());
+
+    table.insert(6, "BETA ");
+    table.erase(0, 6);
+    EXPECT_EQ(table.text(), "BETA beta\ngamma");
+    EXPECT_EQ(table.line_of(12), 1u);
+    table.insert(1000, "\n"); // Clamped to the end
+    EXPECT_EQ(table.line_count(), 3u);
+    EXPECT_EQ(table.line(2), "");
+
+    PieceTable::Snapshot edited = table.snapshot();
+    ASSERT_TRUE(table.undo());
+    ASSERT_TRUE(table.undo());
+    EXPECT_EQ(table.text(), "alpha\nBETA beta\ngamma");
+    ASSERT_TRUE(table.redo());
+    EXPECT_EQ(table.text(), "BETA beta\ngamma");
+    table.erase(0, 5);
+    EXPECT_FALSE(table.can_redo());
+    table.restore(edited);
+    EXPECT_EQ(table.text(), "BETA beta\ngamma\n");
+    ASSERT_TRUE(table.undo());
+    EXPECT_EQ(table.text(), "beta\ngamma");
+    while (table.undo()) {
+    }
+    EXPECT_EQ(table.text(), "alpha\nbeta\ngamma");
+}
+
+TEST_F(PieceTableTest, RandomEditsMatchReference) {
+    std::mt19937 rng(17);
+    std::string initial;
+    for (int i = 0; i < 300000; ++i) initial += rng() % 40 == 0 ? '\n' : static_cast<char>('a' + rng() % 26);
+    write_file(initial);
+
+    PieceTable table;
+    ASSERT_TRUE(table.open(filename_));
+    EXPECT_GT(table.piece_count(), 1u);
+    std::vector<std::string> history{initial};
+    std::string expected = initial;
+    for (int step = 0; step < 400; ++step) {
+        uint64_t offset = rng() % (expected.size() + 1);
+        if (rng() % 3 == 0 && offset < expected.size()) {
+            // Never empty: a no-op erase records no undo step.
+            uint64_t length = 1 + rng() % (rng() % 10 == 0 ? 200000 : 50);
+            table.erase(offset, length);
+            expected.erase(offset, length);
+        } else {
+            std::string text;
+            size_t length = rng() % 10 == 0 ? 70000 + rng() % 10000 : 1 + rng() % 20;
+            for (size_t i = 0; i < length; ++i) text += rng() % 8 == 0 ? '\n' : 'A' + static_cast<char>(rng() % 26);
+            table.insert(offset, text);
+            expected.insert(offset, text);
+        }
+        history.push_back(expected);
+        if (step % 40 == 0) {
+            expect_matches(table, expected);
+            uint64_t from = rng() % (expected.size() + 1);
+            EXPECT_EQ(table.text(from, 5000), expected.substr(from, 5000));
+        }
+    }
+    expect_matches(table, expected);
+
+    // Walk the whole history back and forth.
+    for (size_t i = history.size() - 1; i > 0; --i) {
+        ASSERT_TRUE(table.undo());
+        if (i % 50 == 1) expect_matches(table, history[i - 1]);
+    }
+    EXPECT_FALSE(table.undo());
+    EXPECT_EQ(table.text(), initial);
+    for (size_t i = 1; i < history.size(); ++i) ASSERT_TRUE(table.redo());
+    EXPECT_EQ(table.text(), expected);
+
+    ASSERT_TRUE(table.save(filename_ + ".saved"));
+    PieceTable reopened;
+    ASSERT_TRUE(reopened.open(filename_ + ".saved"));
+    EXPECT_EQ(reopened.text(), expected);
+}
+
+TEST_F(PieceTableTest, TypingExtendsOnePiece) {
+    write_file(std::string(1 << 20, 'x'));
+    PieceTable table;
+    ASSERT_TRUE(table.open(filename_));
+    size_t pieces = table.piece_count();
+    EXPECT_EQ(pieces, (1u << 20) / PieceTable::kMaxPieceLength);
+    // Typing a line in the middle splits one file piece and adds one piece.
+    uint64_t cursor = 500000;
+    for (char c : std::string("hello, world\n")) table.insert(cursor++, &c, 1);
+    EXPECT_EQ(table.piece_count(), pieces + 2);
+    EXPECT_EQ(table.line_count(), 2u);
+    EXPECT_EQ(table.line_start(1), 500013u);
+    EXPECT_EQ(table.line(0).substr(500000), "hello, world");
+
+    // Saving over the mapped original leaves the buffer readable.
+    ASSERT_TRUE(table.save(filename_));
+    EXPECT_EQ(table.text(499998, 6), "xxhell");
+    EXPECT_FALSE(table.open("temp_missing_file.txt"));
+    EXPECT_EQ(table.size(), 0u);
+}
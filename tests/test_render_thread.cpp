@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "../desktop/render_thread.hpp"
+#include "../desktop/spsc_queue.hpp"
+#include <poll.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Neurodeck::Backend;
+using Neurodeck::Rect;
+using Neurodeck::Region;
+using Neurodeck::RenderThread;
+using Neurodeck::Scene;
+using Neurodeck::ShmBuffer;
+using Neurodeck::ShmPool;
+using Neurodeck::SpscQueue;
+
+namespace {
+
+// A width x height buffer of one colour in its own pool.
+ShmBuffer make_buffer(int32_t width, int32_t height, uint32_t colour) {
+    size_t size = size_t(width) * height * 4;
+    int fd = memfd_create("test_render_thread", MFD_CLOEXEC);
+    EXPECT_EQ(ftruncate(fd, size), 0);
+    uint32_t* data = static_cast<uint32_t*>(mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0));
+    for (size_t i = 0; i < size / 4; ++i) data[i] = colour;
+    munmap(data, size);
+    ShmBuffer buffer;
+    buffer.pool = ShmPool::create(fd, int32_t(size));
+    close(fd);
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = width * 4;
+    return buffer;
+}
+
+// Waits for the render thread to signal, then takes everything it queued.
+std::vector<RenderThread::Completion> wait_for_completions(RenderThread& thread) {
+    struct pollfd fd = {thread.completion_fd(), POLLIN, 0};
+    EXPECT_EQ(poll(&fd, 1, 5000), 1);
+    thread.acknowledge();
+    std::vector<RenderThread::Completion> completions;
+    RenderThread::Completion completion;
+    while (thread.next_completion(completion)) completions.push_back(completion);
+    return completions;
+}
+
+} // namespace
+
+TEST(SpscQueueTest, KeepsOrderAcrossThreads) {
+    const int kCount = 100000;
+    SpscQueue<int> queue;
+    std::thread producer([&]() {
+        for (int i = 0; i < kCount; ++i) queue.push(i);
+    });
+    int expected = 0;
+    while (expected < kCount) {
+        int value;
+        if (!queue.pop(value)) continue;
+        ASSERT_EQ(value, expected);
+        ++expected;
+    }
+    producer.join();
+    int value;
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(RenderThreadTest, ReleasesUploadsBeforeTheFrameThatShowsThem) {
+    // Written on the render thread, read here once its frame completes.
+    auto pixels = std::make_shared<std::vector<uint32_t>>();
+    RenderThread thread;
+    ASSERT_TRUE(thread.start([pixels]() {
+        std::unique_ptr<Backend> backend = Neurodeck::create_headless_backend(8, 8);
+        backend->set_frame_hook([pixels](const std::vector<uint32_t>& frame, int32_t, int32_t) { *pixels = frame; });
+        return backend;
+    }));
+    EXPECT_STREQ(thread.backend_name(), "headless");
+
+    Scene scene(8, 8);
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, 4, 4);
+    scene.commit(id);
+    scene.set_position(id, 2, 2);
+    auto token = std::make_shared<int>(7);
+    thread.upload(id, make_buffer(4, 4, 0xff00ff00), scene.surface(id)->buffer_damage, token);
+    Region damage = scene.take_damage();
+    thread.frame(std::make_shared<const Scene>(scene), damage);
+    thread.wake();
+
+    std::vector<RenderThread::Completion> completions;
+    while (completions.size() < 2) {
+        for (RenderThread::Completion& completion : wait_for_completions(thread)) completions.push_back(completion);
+    }
+    ASSERT_EQ(completions.size(), 2u);
+    EXPECT_EQ(completions[0].kind, RenderThread::Completion::Kind::Upload);
+    EXPECT_EQ(completions[0].token, token);
+    EXPECT_TRUE(completions[0].ok);
+    EXPECT_EQ(completions[1].kind, RenderThread::Completion::Kind::Frame);
+    EXPECT_GT(completions[1].frame.render_wall_nsec, 0);
+
+    ASSERT_EQ(pixels->size(), 64u);
+    EXPECT_EQ((*pixels)[3 * 8 + 3], 0xff00ff00u);
+    EXPECT_NE((*pixels)[0], 0xff00ff00u);
+
+    // A frame with nothing to draw still comes back, without a repaint.
+    thread.frame(nullptr, Region());
+    thread.wake();
+    completions = wait_for_completions(thread);
+    ASSERT_EQ(completions.size(), 1u);
+    EXPECT_EQ(completions[0].frame.render_wall_nsec, 0);
+
+    thread.stop();
+    EXPECT_FALSE(thread.running());
+    thread.upload(id, make_buffer(4, 4, 0), Region(Rect{0, 0, 4, 4}), token); // Dropped.
+    EXPECT_EQ(token.use_count(), 1);
+}
+
+TEST(RenderThreadTest, SurvivesAClientShrinkingItsPool) {
+    RenderThread thread;
+    ASSERT_TRUE(thread.start([]() { return Neurodeck::create_headless_backend(8, 8); }));
+    Scene scene(8, 8);
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, 4, 4);
+    scene.commit(id);
+
+    // The render thread reads the pool after the client truncated it: the
+    // SIGBUS must reach ShmPool's handler there rather than kill us.
+    const size_t size = 4 * 4 * 4;
+    int fd = memfd_create("test_render_thread", MFD_CLOEXEC);
+    ASSERT_EQ(ftruncate(fd, size), 0);
+    ShmBuffer buffer;
+    buffer.pool = ShmPool::create(fd, int32_t(size));
+    buffer.width = buffer.height = 4;
+    buffer.stride = 16;
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    close(fd);
+    auto token = std::make_shared<int>(44);
+    thread.upload(id, buffer, scene.surface(id)->buffer_damage, token);
+    thread.wake();
+
+    std::vector<RenderThread::Completion> completions = wait_for_completions(thread);
+    ASSERT_EQ(completions.size(), 1u);
+    EXPECT_EQ(completions[0].token, token);
+    EXPECT_FALSE(completions[0].ok);
+    thread.stop();
+}
+
+TEST(RenderThreadTest, FailsToStartWithoutABackend) {
+    RenderThread thread;
+    EXPECT_FALSE(thread.start([]() { return std::unique_ptr<Backend>(); }));
+    EXPECT_FALSE(thread.running());
+}
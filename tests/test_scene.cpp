@@ -0,0 +1,314 @@
+#include "gtest/gtest.h"
+#include "../desktop/region.hpp"
+#include "../desktop/scene.hpp"
+#include <random>
+#include <vector>
+
+using Neurodeck::Rect;
+using Neurodeck::Region;
+using Neurodeck::Scene;
+
+namespace {
+
+const int kSize = 64;
+
+// Pixel coverage of `region` on a kSize x kSize grid; fails if any pixel is
+// covered twice.
+std::vector<int> rasterize(const Region& region) {
+    std::vector<int> pixels(kSize * kSize, 0);
+    for (const Rect& rect : region.rects()) {
+        for (int y = rect.y; y < rect.bottom(); ++y) {
+            for (int x = rect.x; x < rect.right(); ++x) {
+                int& pixel = pixels[y * kSize + x];
+                EXPECT_EQ(pixel, 0) << "overlap at " << x << "," << y;
+                pixel = 1;
+            }
+        }
+    }
+    return pixels;
+}
+
+void paint(std::vector<int>& pixels, const Rect& rect, int value) {
+    for (int y = rect.y; y < rect.bottom(); ++y) {
+        for (int x = rect.x; x < rect.right(); ++x) pixels[y * kSize + x] = value;
+    }
+}
+
+Rect random_rect(std::mt19937& rng) {
+    int x = rng() % kSize, y = rng() % kSize;
+    return {x, y, 1 + int(rng() % (kSize - x)), 1 + int(rng() % (kSize - y))};
+}
+
+} // namespace
+
+TEST(RegionTest, MatchesPixelModel) {
+    std::mt19937 rng(7);
+    for (int round = 0; round < 200; ++round) {
+        Region region;
+        std::vector<int> expected(kSize * kSize, 0);
+        bool collapsed = false;
+        for (int step = 0; step < 12; ++step) {
+            Rect rect = random_rect(rng);
+            if (rng() % 4 == 0) {
+                region.subtract(rect);
+                paint(expected, rect, 0);
+            } else {
+                region.add(rect);
+                paint(expected, rect, 1);
+                collapsed = collapsed || region.rects().size() == 1;
+            }
+            ASSERT_LE(region.rects().size(), Region::kMaxRects + 3);
+            std::vector<int> actual = rasterize(region);
+            int64_t covered = 0;
+            for (int pixel : actual) covered += pixel;
+            EXPECT_EQ(region.area(), covered);
+            // The region may cover more than was added once it collapses to
+            // its bounding box, but never less.
+            for (size_t i = 0; i < expected.size(); ++i) {
+                if (!collapsed) ASSERT_EQ(actual[i], expected[i]) << "pixel " << i;
+                else if (expected[i] && !actual[i]) FAIL() << "lost pixel " << i;
+            }
+        }
+    }
+}
+
+TEST(RegionTest, AddsOnlyUncoveredParts) {
+    Region region(Rect{0, 0, 10, 10});
+    region.add(Rect{2, 2, 4, 4});
+    EXPECT_EQ(region.rects().size(), 1u);
+    region.add(Rect{5, 0, 10, 10});
+    EXPECT_EQ(region.area(), 150);
+    EXPECT_EQ(region.bounds(), (Rect{0, 0, 15, 10}));
+    region.intersect(Rect{8, 8, 100, 100});
+    EXPECT_EQ(region.area(), 14);
+    region.translate(-8, -8);
+    EXPECT_TRUE(region.intersects(Rect{0, 0, 1, 1}));
+    EXPECT_FALSE(region.intersects(Rect{7, 0, 5, 5}));
+}
+
+TEST(SceneTest, DamageWaitsForCommit) {
+    Scene scene(640, 480);
+    scene.take_damage();
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, 100, 50);
+    EXPECT_FALSE(scene.needs_frame());
+    scene.commit(id);
+    ASSERT_TRUE(scene.needs_frame());
+    EXPECT_EQ(scene.take_damage().bounds(), (Rect{0, 0, 100, 50}));
+    EXPECT_FALSE(scene.needs_frame());
+
+    // A commit without damage changes nothing on screen.
+    scene.commit(id);
+    EXPECT_FALSE(scene.needs_frame());
+    EXPECT_EQ(scene.surface(id)->commits, 1u);
+
+    // Damage is clipped to the surface and moved to its position.
+    scene.set_position(id, 200, 100);
+    scene.take_damage();
+    scene.damage(id, Rect{90, 10, 50, 5});
+    scene.damage(id, Rect{0, 0, 2, 2});
+    scene.commit(id);
+    Region damage = scene.take_damage();
+    EXPECT_EQ(damage.area(), 10 * 5 + 2 * 2);
+    EXPECT_TRUE(damage.intersects(Rect{290, 110, 10, 5}));
+    EXPECT_TRUE(damage.intersects(Rect{200, 100, 2, 2}));
+    EXPECT_EQ(scene.surface(id)->commits, 2u);
+}
+
+TEST(SceneTest, GeometryChangesDamageOldAndNewBounds) {
+    Scene scene(640, 480);
+    Scene::SurfaceId low = scene.create_surface();
+    Scene::SurfaceId high = scene.create_surface();
+    scene.attach(low, 100, 100);
+    scene.commit(low);
+    scene.attach(high, 50, 50);
+    scene.commit(high);
+    EXPECT_EQ(scene.stacking(), (std::vector<Scene::SurfaceId>{low, high}));
+    scene.take_damage();
+
+    // Moving by attach offsets damages where it was and where it is.
+    scene.attach(high, 50, 50, 300, 0);
+    scene.commit(high);
+    Region damage = scene.take_damage();
+    EXPECT_EQ(damage.area(), 2 * 50 * 50);
+    EXPECT_EQ(scene.surface(high)->x, 300);
+
+    // Raising damages the raised surface; raising the top one is free.
+    scene.raise(low);
+    EXPECT_EQ(scene.stacking().back(), low);
+    EXPECT_EQ(scene.take_damage().bounds(), (Rect{0, 0, 100, 100}));
+    scene.raise(low);
+    EXPECT_FALSE(scene.needs_frame());
+
+    // Damage is clipped to the output.
+    scene.set_position(low, 600, 450);
+    EXPECT_EQ(scene.take_damage().area(), 100 * 100 + 40 * 30);
+
+    // Unmapping and destroying expose what was under the surface.
+    scene.attach(low, 0, 0);
+    scene.commit(low);
+    EXPECT_FALSE(scene.surface(low)->mapped);
+    EXPECT_EQ(scene.take_damage().area(), 40 * 30);
+    scene.destroy_surface(high);
+    EXPECT_EQ(scene.surface(high), nullptr);
+    EXPECT_EQ(scene.take_damage().bounds(), (Rect{300, 0, 50, 50}));
+    EXPECT_EQ(scene.stacking().size(), 1u);
+}
+
+TEST(SceneTest, BufferDamageFollowsScale) {
+    Scene scene(640, 480);
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, 200, 100);
+    scene.set_buffer_scale(id, 2);
+    scene.commit(id);
+    EXPECT_EQ(scene.surface(id)->width, 100);
+    EXPECT_EQ(scene.take_damage().bounds(), (Rect{0, 0, 100, 50}));
+
+    // Odd buffer rectangles round outwards.
+    scene.damage_buffer(id, Rect{3, 3, 2, 2});
+    scene.commit(id);
+    EXPECT_EQ(scene.take_damage().bounds(), (Rect{1, 1, 2, 2}));
+
+    scene.damage_all();
+    EXPECT_EQ(scene.damage().area(), 640 * 480);
+}
+
+TEST(SceneTest, TracksBufferDamageForUploads) {
+    Scene scene(640, 480);
+    Scene::SurfaceId id = scene.create_surface();
+    scene.attach(id, 100, 100);
+    scene.commit(id);
+    // A new buffer size needs a full upload.
+    EXPECT_EQ(scene.surface(id)->buffer_damage.area(), 100 * 100);
+
+    // The same size needs only what was damaged, surface damage scaled to
+    // buffer pixels and "everything" clipped to the buffer.
+    scene.set_buffer_scale(id, 2);
+    scene.commit(id);
+    scene.attach(id, 100, 100);
+    scene.damage(id, Rect{1, 1, 2, 2});
+    scene.damage_buffer(id, Rect{90, 90, INT32_MAX, INT32_MAX});
+    scene.commit(id);
+    EXPECT_EQ(scene.surface(id)->buffer_damage.area(), 4 * 4 + 10 * 10);
+    EXPECT_TRUE(scene.surface(id)->buffer_damage.intersects(Rect{2, 2, 1, 1}));
+
+    scene.commit(id);
+    EXPECT_TRUE(scene.surface(id)->buffer_damage.empty());
+}
+
+TEST(RegionTest, KnowsWhenItCollapsed) {
+    Region region;
+    for (int i = 0; i < int(Region::kMaxRects); ++i) region.add(Rect{i * 2, 0, 1, 1});
+    EXPECT_TRUE(region.exact());
+    Region copy;
+    copy.add(region);
+    EXPECT_TRUE(copy.exact());
+    region.add(Rect{0, 10, 1, 1});
+    EXPECT_FALSE(region.exact());
+    EXPECT_EQ(region.rects().size(), 1u);
+    copy.add(region);
+    EXPECT_FALSE(copy.exact());
+    region.clear();
+    EXPECT_TRUE(region.exact());
+}
+
+TEST(SceneTest, OpaqueSurfacesHideWhatIsBelow) {
+    Scene scene(kSize, kSize);
+    // Ten full-output windows, only the top one opaque.
+    std::vector<Scene::SurfaceId> windows;
+    for (int i = 0; i < 10; ++i) {
+        windows.push_back(scene.create_surface());
+        scene.attach(windows.back(), kSize, kSize, 0, 0, i == 9);
+        scene.commit(windows.back());
+    }
+    Region background;
+    std::vector<Scene::Layer> layers = scene.visible_layers(Region(scene.output()), &background);
+    ASSERT_EQ(layers.size(), 1u);
+    EXPECT_EQ(layers[0].id, windows[9]);
+    EXPECT_EQ(layers[0].opaque, std::vector<Rect>{scene.output()});
+    EXPECT_TRUE(layers[0].blended.empty());
+    EXPECT_TRUE(background.empty());
+
+    // An ARGB window on top, opaque but for a 4-pixel border, with a
+    // translucent window over its corner. Opaque regions are pending until
+    // commit and clipped to the surface.
+    Scene::SurfaceId framed = scene.create_surface();
+    scene.attach(framed, 32, 32);
+    scene.commit(framed);
+    scene.set_position(framed, 16, 16);
+    Region opaque(Rect{4, 4, 24, 24});
+    opaque.add(Rect{30, 30, 100, 100});
+    scene.set_opaque_region(framed, opaque);
+    Scene::SurfaceId corner = scene.create_surface();
+    scene.attach(corner, 8, 8);
+    scene.commit(corner);
+    scene.set_position(corner, 16, 16);
+
+    layers = scene.visible_layers(Region(Rect{16, 16, 32, 32}), &background);
+    ASSERT_EQ(layers.size(), 3u); // Not yet committed: the frame is translucent.
+    EXPECT_EQ(layers[0].id, windows[9]);
+    scene.commit(framed);
+    layers = scene.visible_layers(Region(Rect{16, 16, 32, 32}), &background);
+    ASSERT_EQ(layers.size(), 3u);
+    EXPECT_EQ(layers[0].id, windows[9]);
+    EXPECT_EQ(layers[1].id, framed);
+    EXPECT_EQ(layers[2].id, corner);
+
+    // Every damaged pixel is drawn once by the topmost opaque surface over
+    // it, and blended by translucent ones above that.
+    std::vector<int> opaque_pixels(kSize * kSize, 0), blended_pixels(kSize * kSize, 0);
+    for (const Scene::Layer& layer : layers) {
+        for (const Rect& rect : layer.opaque) paint(opaque_pixels, rect, int(layer.id));
+        for (const Rect& rect : layer.blended) {
+            for (int y = rect.y; y < rect.bottom(); ++y) {
+                for (int x = rect.x; x < rect.right(); ++x) ++blended_pixels[y * kSize + x];
+            }
+        }
+    }
+    EXPECT_EQ(opaque_pixels[17 * kSize + 17], int(windows[9])); // Under the border.
+    EXPECT_EQ(opaque_pixels[21 * kSize + 21], int(framed));      // Under the corner.
+    EXPECT_EQ(opaque_pixels[40 * kSize + 40], int(framed));
+    EXPECT_EQ(opaque_pixels[44 * kSize + 44], int(windows[9])); // Under the border again.
+    EXPECT_EQ(opaque_pixels[47 * kSize + 47], int(framed));      // What is on the surface of (30, 30, 100, 100).
+    EXPECT_EQ(blended_pixels[17 * kSize + 17], 2);              // Border and corner.
+    EXPECT_EQ(blended_pixels[21 * kSize + 21], 1);
+    EXPECT_EQ(blended_pixels[40 * kSize + 40], 0);
+    EXPECT_EQ(opaque_pixels[0], 0); // Outside the damage.
+
+    // A region that collapsed to its bounds is not trusted.
+    Region ragged;
+    for (int i = 0; i <= int(Region::kMaxRects); ++i) ragged.add(Rect{i, i, 1, 1});
+    scene.set_opaque_region(framed, ragged);
+    scene.commit(framed);
+    layers = scene.visible_layers(Region(Rect{40, 40, 1, 1}), &background);
+    ASSERT_EQ(layers.size(), 2u);
+    EXPECT_EQ(layers[1].blended, std::vector<Rect>{(Rect{40, 40, 1, 1})});
+}
+
+TEST(SceneTest, InputRegionsPickTheSurface) {
+    Scene scene(kSize, kSize);
+    Scene::SurfaceId low = scene.create_surface();
+    scene.attach(low, kSize, kSize);
+    scene.commit(low);
+    Scene::SurfaceId high = scene.create_surface();
+    scene.attach(high, 16, 16);
+    scene.commit(high);
+    scene.set_position(high, 8, 8);
+    EXPECT_EQ(scene.surface_at(10, 10), high);
+    EXPECT_EQ(scene.surface_at(30, 30), low);
+
+    // Input goes through everything outside the region, and outside the
+    // surface the region does not count.
+    Region input(Rect{0, 0, 4, 100});
+    scene.set_input_region(high, &input);
+    EXPECT_EQ(scene.surface_at(20, 10), high);
+    scene.commit(high);
+    EXPECT_EQ(scene.surface_at(20, 10), low);
+    EXPECT_EQ(scene.surface_at(9, 10), high);
+    EXPECT_EQ(scene.surface_at(9, 30), low);
+
+    scene.set_input_region(high, nullptr);
+    scene.commit(high);
+    EXPECT_EQ(scene.surface_at(20, 10), high);
+    EXPECT_EQ(scene.surface_at(100, 100), 0u);
+}
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "../desktop/shm_pool.hpp"
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using Neurodeck::ShmBuffer;
+using Neurodeck::ShmFormat;
+using Neurodeck::ShmPool;
+
+namespace {
+
+// A memfd of `size` bytes filled with `byte`, as a client would pass.
+int make_fd(size_t size, uint8_t byte) {
+    int fd = memfd_create("test_shm_pool", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, size) != 0) return -1;
+    void* data = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+    memset(data, byte, size);
+    munmap(data, size);
+    return fd;
+}
+
+} // namespace
+
+TEST(ShmPoolTest, MapsGrowsAndValidatesBuffers) {
+    const int32_t page = int32_t(sysconf(_SC_PAGESIZE));
+    int fd = make_fd(page * 4, 0x5a);
+    ASSERT_GE(fd, 0);
+    std::shared_ptr<ShmPool> pool = ShmPool::create(fd, page);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(ShmPool::create(-1, page), nullptr);
+    EXPECT_EQ(pool->data()[page - 1], 0x5a);
+
+    ShmBuffer buffer;
+    buffer.pool = pool;
+    buffer.width = 16;
+    buffer.height = page / 64;
+    buffer.stride = 64;
+    EXPECT_TRUE(buffer.valid());
+    buffer.offset = 4; // One byte past the end.
+    EXPECT_FALSE(buffer.valid());
+    buffer.offset = 0;
+    buffer.stride = 60; // Narrower than a row.
+    EXPECT_FALSE(buffer.valid());
+    buffer.stride = 64;
+    buffer.format = ShmFormat::XRGB8888;
+    EXPECT_TRUE(buffer.opaque());
+
+    // Growing keeps the contents and makes room for more buffers; the fd
+    // can be closed, as the compositor does.
+    close(fd);
+    EXPECT_FALSE(pool->resize(page / 2));
+    ASSERT_TRUE(pool->resize(page * 4));
+    EXPECT_EQ(pool->size(), page * 4);
+    EXPECT_EQ(pool->data()[page * 4 - 1], 0x5a);
+    buffer.offset = page * 3;
+    EXPECT_TRUE(buffer.valid());
+    EXPECT_EQ(buffer.pixels(), pool->data() + page * 3);
+}
+
+TEST(ShmPoolTest, SurvivesTruncatedFile) {
+    const int32_t page = int32_t(sysconf(_SC_PAGESIZE));
+    int fd = make_fd(page * 2, 0x11);
+    ASSERT_GE(fd, 0);
+    std::shared_ptr<ShmPool> pool = ShmPool::create(fd, page * 2);
+    ASSERT_NE(pool, nullptr);
+
+    pool->begin_access();
+    EXPECT_EQ(pool->data()[page], 0x11);
+    EXPECT_TRUE(pool->end_access());
+
+    // The client shrinks the file: the read raises SIGBUS, which turns into
+    // zeros and a failed access instead of a crash.
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    pool->begin_access();
+    volatile uint8_t byte = pool->data()[page];
+    EXPECT_FALSE(pool->end_access());
+    EXPECT_EQ(byte, 0);
+    close(fd);
+}
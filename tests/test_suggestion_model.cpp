@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "../suggest/suggestion_model.hpp"
+#include "../core/history_store.hpp"
+#include <cstdio>  // For std::remove
+#include <string>
+#include <vector>
+
+using Neurodeck::HistoryStore;
+using Neurodeck::SuggestionModel;
+
+// Test fixture providing scratch model and history files.
+class SuggestionModelTest : public ::testing::Test {
+protected:
+    const std::string model_filename_ = "temp_suggestions.model";
+    const std::string history_filename_ = "temp_suggestions_history";
+
+    void TearDown() override {
+        std::remove(model_filename_.c_str());
+        std::remove(history_filename_.c_str());
+    }
+
+    // Runs `commands` in order as one session, like the shell loop does.
+    static void run(SuggestionModel& model, SuggestionModel::Context& context,
+                    const std::vector<std::pair<std::string, int>>& commands) {
+        for (const auto& command : commands) {
+            ASSERT_TRUE(model.observe(context, command.first, command.second));
+            context.before_previous = context.previous;
+            context.previous = command.first;
+            context.previous_status = command.second;
+        }
+    }
+
+    static std::string best(const SuggestionModel& model, const SuggestionModel::Context& context,
+                            const std::string& typed) {
+        std::vector<SuggestionModel::Suggestion> results = model.suggest(context, typed, 1);
+        return results.empty() ? std::string() : results[0].text;
+    }
+};
+
+TEST_F(SuggestionModelTest, PredictsFromPreviousCommandAndStatus) {
+    SuggestionModel model;
+    ASSERT_TRUE(model.open(model_filename_));
+    SuggestionModel::Context context;
+    context.cwd = "/src/app";
+    for (int i = 0; i < 5; ++i) {
+        run(model, context, {{"git add .", 0}, {"git commit -m wip", 0}, {"make", 2}, {"vim main.cpp", 0},
+                             {"make", 0}, {"./app --verbose", 0}, {"gti status", 127}});
+    }
+    EXPECT_EQ(model.observed(), 30u);
+
+    SuggestionModel::Context after;
+    after.cwd = "/src/app";
+    after.previous = "git add .";
+    EXPECT_EQ(best(model, after, ""), "git commit -m wip");
+    after.previous = "make";
+    after.previous_status = 2;
+    EXPECT_EQ(best(model, after, ""), "vim main.cpp");
+    after.previous_status = 0;
+    EXPECT_EQ(best(model, after, ""), "./app --verbose");
+    EXPECT_EQ(best(model, after, "g").compare(0, 4, "git "), 0);
+
+    // Arguments: the token being typed is completed even when no whole line
+    // matches.
+    EXPECT_EQ(best(model, after, "./app --v"), "./app --verbose");
+    EXPECT_EQ(best(model, after, "vim m"), "vim main.cpp");
+    std::vector<SuggestionModel::Suggestion> git = model.suggest(after, "git ", 5);
+    ASSERT_FALSE(git.empty());
+    for (const auto& suggestion : git) {
+        EXPECT_EQ(suggestion.text.compare(0, 4, "git "), 0) << suggestion.text;
+        EXPECT_GT(suggestion.score, 0.0f);
+    }
+    // Commands that were not found are never suggested.
+    EXPECT_TRUE(model.suggest(after, "gti", 5).empty());
+    EXPECT_TRUE(model.suggest(after, "git commit -m wip", 5).empty());
+}
+
+TEST_F(SuggestionModelTest, PrefersTheWorkingDirectoryAndRecentHabits) {
+    SuggestionModel model;
+    ASSERT_TRUE(model.open(model_filename_));
+    SuggestionModel::Context context;
+    context.cwd = "/srv/web";
+    run(model, context, {{"npm test", 0}, {"npm test", 0}, {"npm test", 0}});
+    context = SuggestionModel::Context();
+    context.cwd = "/srv/api";
+    run(model, context, {{"cargo test", 0}, {"cargo test", 0}});
+
+    SuggestionModel::Context web;
+    web.cwd = "/srv/web";
+    SuggestionModel::Context api;
+    api.cwd = "/srv/api";
+    EXPECT_EQ(best(model, web, ""), "npm test");
+    EXPECT_EQ(best(model, api, ""), "cargo test");
+
+    // A habit that changed outweighs a larger but older count.
+    context = SuggestionModel::Context();
+    context.cwd = "/tmp";
+    for (int i = 0; i < 20; ++i) run(model, context, {{"ls -l", 0}});
+    for (int i = 0; i < 500; ++i) run(model, context, {{"true", 0}});
+    for (int i = 0; i < 5; ++i) run(model, context, {{"ls -la", 0}});
+    EXPECT_EQ(best(model, context, "ls"), "ls -la");
+}
+
+TEST_F(SuggestionModelTest, SharedBetweenSessionsAndRebuiltFromHistory) {
+    SuggestionModel first(16);
+    SuggestionModel second(16);
+    ASSERT_TRUE(first.open(model_filename_));
+    ASSERT_TRUE(second.open(model_filename_));
+    SuggestionModel::Context context;
+    run(first, context, {{"htop", 0}});
+    EXPECT_EQ(best(second, SuggestionModel::Context(), "h"), "htop");
+
+    // A tiny model fills up quickly.
+    for (int i = 0; !second.full() && i < 1000; ++i) {
+        run(second, context, {{"echo " + std::to_string(i), 0}});
+    }
+    ASSERT_TRUE(second.full());
+
+    HistoryStore history;
+    ASSERT_TRUE(history.open(history_filename_));
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(history.append("cat file" + std::to_string(i % 3), "/home", 0, 10, 1000 + i));
+    }
+    history.refresh();
+    ASSERT_TRUE(second.rebuild(history));
+    EXPECT_FALSE(second.full());
+    EXPECT_GT(second.observed(), 0u);
+    SuggestionModel::Context home;
+    home.cwd = "/home";
+    EXPECT_EQ(best(second, home, "cat file").compare(0, 8, "cat file"), 0);
+    EXPECT_EQ(best(second, home, "echo"), "");
+
+    // The other session picks up the rebuilt file on its next observe().
+    ASSERT_TRUE(first.observe(home, "cat file1", 0));
+    EXPECT_EQ(best(first, home, "echo"), "");
+    EXPECT_EQ(first.observed(), second.observed());
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "../desktop/glyph_atlas.hpp"
+#include "../desktop/terminal.hpp"
+#include "../desktop/terminal_renderer.hpp"
+#include "../desktop/vt_parser.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+using Neurodeck::Cell;
+using Neurodeck::GlyphAtlas;
+using Neurodeck::Rect;
+using Neurodeck::Region;
+using Neurodeck::Terminal;
+using Neurodeck::TerminalRenderer;
+using Neurodeck::VtParser;
+
+namespace {
+
+// Writes down what the parser reports, one line per call.
+class Recorder : public VtParser::Handler {
+public:
+    std::vector<std::string> calls;
+
+    void print_ascii(const char* text, size_t length) override {
+        if (!calls.empty() && calls.back().compare(0, 6, "print ") == 0) calls.back().append(text, length);
+        else calls.push_back("print " + std::string(text, length));
+    }
+    void print(char32_t ch) override { calls.push_back("char " + std::to_string(uint32_t(ch))); }
+    void execute(uint8_t control) override { calls.push_back("execute " + std::to_string(control)); }
+    void csi(const int32_t* params, int count, const char* intermediates, char final) override {
+        std::string call = std::string("csi ") + intermediates;
+        for (int i = 0; i < count; ++i) call += (i ? ";" : "") + std::to_string(params[i]);
+        calls.push_back(call + final);
+    }
+    void esc(const char* intermediates, char final) override {
+        calls.push_back(std::string("esc ") + intermediates + final);
+    }
+    void osc(const std::string& text) override { calls.push_back("osc " + text); }
+};
+
+// The characters of row `y`, trailing blanks dropped.
+std::string row_text(const Terminal& terminal, int y) {
+    std::string text;
+    for (int x = 0; x < terminal.columns(); ++x) text += char(terminal.at(x, y).ch);
+    return text.substr(0, text.find_last_not_of(' ') + 1);
+}
+
+// 4x6 cells with a pattern made from the character, so different
+// characters look different.
+const int kCellWidth = 4;
+const int kCellHeight = 6;
+
+bool fake_glyph(char32_t ch, bool bold, uint8_t* mask) {
+    for (int i = 0; i < kCellWidth * kCellHeight; ++i) mask[i] = uint8_t((ch * 37 + i * 11 + bold * 101) % 256);
+    return ch != 0x2603; // No snowman in this font.
+}
+
+} // namespace
+
+TEST(VtParserTest, SplitsTheStreamAcrossFeeds) {
+    Recorder recorder;
+    VtParser parser(recorder);
+    const std::string stream = "ab\x1b[1;32mc\x1b[?25l\r\n\xe2\x82\xac\xff"
+                               "\x1b]0;title\x07\x1b" "7\x1b[;5H\x1b[99\x1b[m";
+    // Any split gives the same calls.
+    for (size_t split = 0; split <= stream.size(); ++split) {
+        recorder.calls.clear();
+        parser.feed(stream.data(), split);
+        parser.feed(stream.data() + split, stream.size() - split);
+        EXPECT_EQ(recorder.calls, (std::vector<std::string>{
+                                      "print ab", "csi 1;32m", "print c", "csi ?25l", "execute 13", "execute 10",
+                                      "char 8364", "char 65533", "osc 0;title", "esc 7", "csi -1;5H", "csi m"}))
+            << "split at " << split;
+    }
+}
+
+TEST(TerminalTest, WrapsAndScrolls) {
+    Terminal terminal(4, 3);
+    terminal.clear_damage();
+    const std::string text = "abcdefg\r\nxy";
+    terminal.feed(text.data(), text.size());
+    EXPECT_EQ(row_text(terminal, 0), "abcd");
+    EXPECT_EQ(row_text(terminal, 1), "efg");
+    EXPECT_EQ(row_text(terminal, 2), "xy");
+    EXPECT_EQ(terminal.scrolled(), 0);
+    EXPECT_EQ(terminal.dirty_begin(2), 0);
+    EXPECT_EQ(terminal.dirty_end(2), 2);
+
+    terminal.clear_damage();
+    const std::string more = "\n\nz";
+    terminal.feed(more.data(), more.size());
+    EXPECT_EQ(terminal.scrolled(), 2);
+    EXPECT_EQ(row_text(terminal, 0), "xy");
+    EXPECT_EQ(row_text(terminal, 2), "  z");
+    EXPECT_GE(terminal.dirty_begin(0), terminal.dirty_end(0)); // Moved, not changed.
+    EXPECT_EQ(terminal.cursor_x(), 3);
+    EXPECT_EQ(terminal.cursor_y(), 2);
+}
+
+TEST(TerminalTest, EditsTheScreen) {
+    Terminal terminal(8, 4);
+    const std::string setup = "12345678\r\nabcdefgh\r\nABCDEFGH\r\nqrstuvwx";
+    terminal.feed(setup.data(), setup.size());
+
+    const std::string edits = "\x1b[2;3H\x1b[2@"    // Insert two blanks at b|c.
+                              "\x1b[1;2H\x1b[3P"    // Delete 234.
+                              "\x1b[3;7H\x1b[K"     // Erase GH.
+                              "\x1b[2;4r\x1b[4H\n"  // Scroll rows 2 to 4 only.
+                              "\x1b[r\x1b[1;8H!";   // Full region again; the last column.
+    terminal.feed(edits.data(), edits.size());
+    EXPECT_EQ(row_text(terminal, 0), "15678  !");
+    EXPECT_EQ(row_text(terminal, 1), "ABCDEF");
+    EXPECT_EQ(row_text(terminal, 2), "qrstuvwx");
+    EXPECT_EQ(row_text(terminal, 3), "");
+    EXPECT_EQ(terminal.scrolled(), 0); // A region scroll redraws instead.
+    EXPECT_EQ(terminal.dirty_end(3), 8);
+}
+
+TEST(TerminalTest, KeepsColoursAndTheAlternateScreen) {
+    Terminal terminal(10, 2);
+    const std::string text = "\x1b[1;31mA\x1b[38;5;200;44mB\x1b[38;2;255;0;0mC\x1b[0mD";
+    terminal.feed(text.data(), text.size());
+    EXPECT_EQ(terminal.at(0, 0).fg, 1);
+    EXPECT_EQ(terminal.at(0, 0).attrs, Neurodeck::kAttrBold);
+    EXPECT_EQ(terminal.at(1, 0).fg, 200);
+    EXPECT_EQ(terminal.at(1, 0).bg, 4);
+    EXPECT_EQ(terminal.at(2, 0).fg, 196); // Pure red in the cube.
+    EXPECT_EQ(terminal.at(3, 0), Cell{U'D'});
+
+    const std::string full_screen = "\x1b[?1049h\x1b[2;2Hmenu\x1b[?1049l";
+    terminal.feed(full_screen.data(), full_screen.size());
+    EXPECT_EQ(row_text(terminal, 0), "ABCD");
+    EXPECT_EQ(row_text(terminal, 1), "");
+    EXPECT_EQ(terminal.cursor_x(), 4);
+}
+
+TEST(TerminalTest, AnswersStatusReports) {
+    Terminal terminal(80, 24);
+    const std::string queries = "\x1b[5;10H\x1b[6n\x1b[c";
+    terminal.feed(queries.data(), queries.size());
+    EXPECT_EQ(terminal.take_replies(), "\x1b[5;10R\x1b[?6c");
+    EXPECT_EQ(terminal.take_replies(), "");
+}
+
+TEST(TerminalRendererTest, RedrawsOnlyWhatChanged) {
+    const int columns = 12, rows = 5;
+    const int32_t width = columns * kCellWidth, height = rows * kCellHeight, stride = width * 4;
+    GlyphAtlas glyphs(kCellWidth, kCellHeight, fake_glyph, 4); // Small, so it fills up.
+    Terminal terminal(columns, rows);
+    TerminalRenderer renderer(glyphs);
+    std::vector<uint8_t> pixels(size_t(stride) * height);
+    Region damage = renderer.draw(terminal, pixels.data(), stride);
+    EXPECT_EQ(damage.area(), int64_t(width) * height);
+    EXPECT_EQ(renderer.cells_drawn(), size_t(columns * rows));
+
+    // A character: it and the cursor, which moved on.
+    terminal.feed("x", 1);
+    damage = renderer.draw(terminal, pixels.data(), stride);
+    EXPECT_EQ(renderer.cells_drawn(), size_t(columns * rows + 2));
+    EXPECT_EQ(damage.bounds(), (Rect{0, 0, 2 * kCellWidth, kCellHeight}));
+    damage = renderer.draw(terminal, pixels.data(), stride);
+    EXPECT_TRUE(damage.empty());
+
+    // Whatever is written, drawing as it goes gives the same pixels as
+    // drawing once at the end.
+    std::mt19937 rng(50);
+    const std::vector<std::string> pieces = {"hello ", "\r\n", "\n", "\x1b[31m", "\x1b[7m", "\x1b[0m", "\x1b[H",
+                                             "\x1b[2J", "\x1b[3;4H", "\x1b[K", "\x1b[2L", "\x1b[M", "\x1b[?25l",
+                                             "\x1b[?25h", "\xe2\x98\x83", "\xc3\xa9", "\t", "\b", "\x1b[4h",
+                                             "\x1b[2;4r", "\x1b[r", "\x1bM", "\x1b[4m", "\x1b[1m"};
+    for (int round = 0; round < 400; ++round) {
+        std::string burst;
+        for (int n = rng() % 8; n >= 0; --n) burst += pieces[rng() % pieces.size()];
+        terminal.feed(burst.data(), burst.size());
+        if (rng() % 3 == 0) renderer.draw(terminal, pixels.data(), stride);
+    }
+    renderer.draw(terminal, pixels.data(), stride);
+    GlyphAtlas fresh_glyphs(kCellWidth, kCellHeight, fake_glyph);
+    TerminalRenderer fresh(fresh_glyphs);
+    std::vector<uint8_t> expected(pixels.size());
+    fresh.draw(terminal, expected.data(), stride);
+    EXPECT_EQ(pixels, expected);
+    EXPECT_GT(glyphs.rasterized(), 12u); // More than there are glyphs: it was refilled.
+}
@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+#include "../core/terminal_screen.hpp"
+#include <cstdio>  // For std::remove
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+// Test fixture capturing everything a TerminalScreen writes.
+class TerminalScreenTest : public ::testing::Test {
+protected:
+    const std::string output_filename_ = "temp_terminal_screen_out.txt";
+    int out_fd_ = -1;
+    off_t consumed_ = 0;
+
+    void SetUp() override {
+        out_fd_ = open(output_filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(out_fd_, 0);
+    }
+
+    void TearDown() override {
+        close(out_fd_);
+        std::remove(output_filename_.c_str());
+    }
+
+    // Returns the bytes written since the previous call.
+    std::string take_output() {
+        off_t end = lseek(out_fd_, 0, SEEK_END);
+        std::string data(static_cast<size_t>(end - consumed_), '\0');
+        if (!data.empty()) {
+            EXPECT_EQ(pread(out_fd_, &data[0], data.size(), consumed_), static_cast<ssize_t>(data.size()));
+        }
+        consumed_ = end;
+        return data;
+    }
+};
+
+TEST(ScreenBufferTest, PutTextDecodesUtf8AndClips) {
+    Neurodeck::ScreenBuffer buffer(4, 2);
+    buffer.clear_dirty();
+    EXPECT_EQ(buffer.put_text(1, 1, "h\xc3\xa9llo"), 4);
+    EXPECT_EQ(buffer.at(1, 1).ch, U'h');
+    EXPECT_EQ(buffer.at(2, 1).ch, U'é');
+    EXPECT_EQ(buffer.at(3, 1).ch, U'l');
+    EXPECT_FALSE(buffer.row_dirty(0));
+    EXPECT_TRUE(buffer.row_dirty(1));
+}
+
+TEST_F(TerminalScreenTest, FirstFrameClearsAndSkipsBlankCells) {
+    Neurodeck::TerminalScreen screen(out_fd_, 10, 3);
+    screen.set_cursor(0, 0, false);
+    screen.back().put_text(2, 1, "hi");
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "\x1b[?25l\x1b[0m\x1b[H\x1b[2J\x1b[2;3Hhi");
+}
+
+TEST_F(TerminalScreenTest, UnchangedFrameWritesNothing) {
+    Neurodeck::TerminalScreen screen(out_fd_, 10, 3);
+    screen.set_cursor(0, 0, false);
+    screen.back().put_text(0, 0, "static");
+    ASSERT_TRUE(screen.present());
+    take_output();
+
+    // Rewriting identical content marks the row dirty but produces no cells.
+    screen.back().put_text(0, 0, "static");
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "");
+}
+
+TEST_F(TerminalScreenTest, OnlyDamagedCellsAreRedrawn) {
+    Neurodeck::TerminalScreen screen(out_fd_, 20, 4);
+    screen.set_cursor(0, 0, false);
+    screen.back().put_text(0, 0, "counter: 0041");
+    screen.back().put_text(0, 3, "footer");
+    ASSERT_TRUE(screen.present());
+    take_output();
+
+    screen.back().put_text(0, 0, "counter: 0042");
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "\x1b[1;13H2");
+}
+
+TEST_F(TerminalScreenTest, SmallGapsAreRewrittenInsteadOfSkipped) {
+    Neurodeck::TerminalScreen screen(out_fd_, 20, 1);
+    screen.set_cursor(0, 0, false);
+    screen.back().put_text(0, 0, "abcdefghij");
+    ASSERT_TRUE(screen.present());
+    take_output();
+
+    screen.back().put_text(0, 0, "AbcDefghiJ");
+    ASSERT_TRUE(screen.present());
+    // "A", then "bc" rewritten to reach "D"; the longer gap before "J" is skipped.
+    EXPECT_EQ(take_output(), "\x1b[1HAbcD\x1b[5CJ");
+}
+
+TEST_F(TerminalScreenTest, StyleChangesEmitMinimalSgr) {
+    Neurodeck::TerminalScreen screen(out_fd_, 10, 1);
+    screen.set_cursor(0, 0, false);
+    Neurodeck::Cell bold;
+    bold.attrs = Neurodeck::kAttrBold;
+    Neurodeck::Cell red_bold = bold;
+    red_bold.fg = 1;
+    screen.back().put_text(0, 0, "a", bold);
+    screen.back().put_text(1, 0, "b", red_bold);
+    screen.back().put_text(2, 0, "c");
+    ASSERT_TRUE(screen.present());
+    std::string out = take_output();
+    EXPECT_NE(out.find("\x1b[1ma\x1b[38;5;1mb\x1b[0mc"), std::string::npos) << out;
+}
+
+TEST_F(TerminalScreenTest, CursorIsPlacedAfterFrame) {
+    Neurodeck::TerminalScreen screen(out_fd_, 10, 2);
+    screen.set_cursor(3, 1, true);
+    screen.back().put_text(0, 0, "x");
+    ASSERT_TRUE(screen.present());
+    std::string out = take_output();
+    EXPECT_EQ(out.substr(out.size() - 12), "\x1b[2;4H\x1b[?25h");
+
+    // Moving only the cursor costs one positioning sequence.
+    screen.set_cursor(5, 1, true);
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "\x1b[2C");
+}
+
+TEST_F(TerminalScreenTest, FrameRateCapCoalescesFrames) {
+    Neurodeck::TerminalScreen screen(out_fd_, 10, 1);
+    screen.set_cursor(0, 0, false);
+    screen.set_max_fps(1);
+    screen.back().put_text(0, 0, "one");
+    ASSERT_TRUE(screen.present());
+    take_output();
+
+    screen.back().put_text(0, 0, "two");
+    EXPECT_FALSE(screen.present());
+    screen.back().put_text(0, 0, "six");
+    EXPECT_FALSE(screen.present());
+    EXPECT_TRUE(screen.has_pending_frame());
+    EXPECT_EQ(screen.frames_coalesced(), 2u);
+    EXPECT_GT(screen.milliseconds_until_next_frame(), 0);
+    EXPECT_EQ(take_output(), "");
+
+    // Once the limit is lifted the accumulated damage goes out in one frame.
+    screen.set_max_fps(0);
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "\x1b[1Hsix");
+    EXPECT_FALSE(screen.has_pending_frame());
+}
+
+TEST_F(TerminalScreenTest, ResizeRepaintsEverything) {
+    Neurodeck::TerminalScreen screen(out_fd_, 5, 1);
+    screen.set_cursor(0, 0, false);
+    screen.back().put_text(0, 0, "abc");
+    ASSERT_TRUE(screen.present());
+    take_output();
+
+    screen.resize(6, 2);
+    screen.back().put_text(0, 1, "z");
+    ASSERT_TRUE(screen.present());
+    EXPECT_EQ(take_output(), "\x1b[0m\x1b[H\x1b[2J\x1b[2Hz");
+}